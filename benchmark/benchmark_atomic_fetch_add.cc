@@ -0,0 +1,79 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/10/24.
+//
+
+#include <benchmark/benchmark.h>
+
+#include <atomic>
+#include <concurrent/sharded_counter.hh>
+#include <cstdint>
+#include <memory>
+
+using namespace com::grakra::concurrent;
+
+static constexpr int MAX_THREAD_NR = 64;
+
+// every thread bumps the same cache line.
+static std::atomic<int64_t> shared_counter(0);
+static void BM_atomic_fetch_add(benchmark::State& state) {
+    for (auto _ : state) {
+        shared_counter.fetch_add(1, std::memory_order_relaxed);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// every thread owns a padded slot, the lower bound of any sharding.
+struct alignas(64) PaddedSlot {
+    std::atomic<int64_t> value{0};
+};
+static PaddedSlot per_thread_slots[MAX_THREAD_NR];
+static void BM_per_thread_slot(benchmark::State& state) {
+    auto& slot = per_thread_slots[state.thread_index];
+    for (auto _ : state) {
+        slot.value.fetch_add(1, std::memory_order_relaxed);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+static std::unique_ptr<ShardedCounter<int64_t>> sharded_counter;
+static void BM_sharded_counter_add(benchmark::State& state) {
+    if (state.thread_index == 0) {
+        sharded_counter.reset(new ShardedCounter<int64_t>());
+    }
+    for (auto _ : state) {
+        sharded_counter->add(1);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// thread#0 reads while the others add.
+template <bool exact>
+static void BM_sharded_counter_read(benchmark::State& state) {
+    if (state.thread_index == 0) {
+        sharded_counter.reset(new ShardedCounter<int64_t>());
+    }
+    int64_t value = 0;
+    for (auto _ : state) {
+        if (state.thread_index != 0) {
+            sharded_counter->add(1);
+        } else if constexpr (exact) {
+            value += sharded_counter->read_exact();
+        } else {
+            value += sharded_counter->read_approx();
+        }
+    }
+    benchmark::DoNotOptimize(value);
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK(BM_atomic_fetch_add)->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK(BM_per_thread_slot)->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK(BM_sharded_counter_add)->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_sharded_counter_read, false)->ThreadRange(2, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_sharded_counter_read, true)->ThreadRange(2, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK_MAIN();
@@ -0,0 +1,144 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/20.
+//
+
+#include <benchmark/benchmark.h>
+
+#include <concurrent/hash.hh>
+#include <memory>
+#include <random>
+#include <vector>
+
+using com::grakra::concurrent::Hash;
+using Int64Hash = Hash<int64_t, int64_t>;
+
+static constexpr size_t HASH_SIZE = 1 << 20;
+static constexpr size_t LOAD_FACTOR = 4;
+static constexpr size_t LOOKUP_NR = 8192;
+
+// the hash is filled with HASH_SIZE keys but created with an expect_max_size
+// underestimated by state.range(0) times, Get latency should keep flat.
+static void BM_Hash_Get_Underestimated(benchmark::State& state) {
+    const size_t n = HASH_SIZE;
+    auto hash = std::make_unique<Int64Hash>(HASH_SIZE / state.range(0), LOAD_FACTOR);
+    for (size_t i = 0; i < n; ++i) {
+        hash->Put(i, i);
+    }
+    std::mt19937_64 gen(n);
+    std::uniform_int_distribution<int64_t> rand(0, n - 1);
+    std::vector<int64_t> keys(LOOKUP_NR);
+    for (auto& key : keys) {
+        key = rand(gen);
+    }
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (auto key : keys) {
+            int64_t value;
+            hash->Get(key, value);
+            sum += value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * LOOKUP_NR);
+    state.counters["slot_nr"] = hash->get_slot_nr();
+    state.counters["level_nr"] = hash->get_level_nr();
+}
+
+static void BM_Hash_Put_Underestimated(benchmark::State& state) {
+    const size_t n = HASH_SIZE;
+    for (auto _ : state) {
+        Int64Hash hash(HASH_SIZE / state.range(0), LOAD_FACTOR);
+        for (size_t i = 0; i < n; ++i) {
+            hash.Put(i, i);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+// tables far larger than LLC, every lookup misses on the slot, the dummy node
+// and the nodes of the chain, GetBatch/PutBatch overlap the misses of
+// HASH_BATCH_SIZE keys.
+static constexpr size_t LARGE_HASH_SIZE = 1 << 24;
+
+static std::vector<int64_t> gen_keys(size_t n, size_t key_range) {
+    std::mt19937_64 gen(n);
+    std::uniform_int_distribution<int64_t> rand(0, key_range - 1);
+    std::vector<int64_t> keys(n);
+    for (auto& key : keys) {
+        key = rand(gen);
+    }
+    return keys;
+}
+
+static Int64Hash& get_large_hash() {
+    static std::unique_ptr<Int64Hash> hash;
+    if (hash == nullptr) {
+        hash = std::make_unique<Int64Hash>(LARGE_HASH_SIZE, LOAD_FACTOR);
+        std::vector<int64_t> keys(LARGE_HASH_SIZE);
+        for (size_t i = 0; i < LARGE_HASH_SIZE; ++i) {
+            keys[i] = i;
+        }
+        hash->PutBatch(keys.data(), keys.data(), keys.size());
+    }
+    return *hash;
+}
+
+static void BM_Hash_Get_Large(benchmark::State& state) {
+    auto& hash = get_large_hash();
+    auto keys = gen_keys(LOOKUP_NR, LARGE_HASH_SIZE);
+    for (auto _ : state) {
+        int64_t sum = 0;
+        for (auto key : keys) {
+            int64_t value;
+            hash.Get(key, value);
+            sum += value;
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetItemsProcessed(state.iterations() * LOOKUP_NR);
+}
+
+static void BM_Hash_GetBatch_Large(benchmark::State& state) {
+    auto& hash = get_large_hash();
+    auto keys = gen_keys(LOOKUP_NR, LARGE_HASH_SIZE);
+    std::vector<int64_t> values(LOOKUP_NR);
+    std::unique_ptr<bool[]> found(new bool[LOOKUP_NR]);
+    for (auto _ : state) {
+        hash.GetBatch(keys.data(), keys.size(), values.data(), found.get());
+        benchmark::DoNotOptimize(values.data());
+    }
+    state.SetItemsProcessed(state.iterations() * LOOKUP_NR);
+}
+
+static void BM_Hash_Put_Large(benchmark::State& state) {
+    auto keys = gen_keys(LARGE_HASH_SIZE, INT64_MAX);
+    for (auto _ : state) {
+        Int64Hash hash(LARGE_HASH_SIZE, LOAD_FACTOR);
+        for (auto key : keys) {
+            hash.Put(key, key);
+        }
+    }
+    state.SetItemsProcessed(state.iterations() * LARGE_HASH_SIZE);
+}
+
+static void BM_Hash_PutBatch_Large(benchmark::State& state) {
+    auto keys = gen_keys(LARGE_HASH_SIZE, INT64_MAX);
+    for (auto _ : state) {
+        Int64Hash hash(LARGE_HASH_SIZE, LOAD_FACTOR);
+        hash.PutBatch(keys.data(), keys.data(), keys.size());
+    }
+    state.SetItemsProcessed(state.iterations() * LARGE_HASH_SIZE);
+}
+
+BENCHMARK(BM_Hash_Get_Underestimated)->Arg(1)->Arg(10)->Arg(100)->Arg(1000)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Hash_Put_Underestimated)->Arg(1)->Arg(10)->Arg(1000)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Hash_Get_Large)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Hash_GetBatch_Large)->Unit(benchmark::kMicrosecond);
+BENCHMARK(BM_Hash_Put_Large)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_Hash_PutBatch_Large)->Iterations(1)->Unit(benchmark::kMillisecond);
+BENCHMARK_MAIN();
@@ -0,0 +1,424 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/11/16.
+//
+
+#include <absl/container/flat_hash_map.h>
+#include <absl/synchronization/mutex.h>
+#include <benchmark/benchmark.h>
+#include <folly/MPMCQueue.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <async.hh>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <concurrent/hash.hh>
+#include <concurrent/list.hh>
+#include <cstdint>
+#include <memory>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "nonblock_queue.hh"
+
+// throughput and latency of the concurrent structures as the thread number
+// grows, next to lock-based and folly baselines. every benchmark is swept
+// over ThreadRange(1, MAX_THREAD_NR), thread i is pinned to cpu
+// i % hardware_concurrency, so oversubscribed runs are visible as such. map
+// benchmarks take Args({read percentage, key distribution}), the writes are
+// split evenly between inserts and removes so the size stays around half of
+// the key range. one op of every LATENCY_SAMPLE_INTERVAL is timed and the
+// percentiles of all the threads are reported as p50_ns/p99_ns/p999_ns, they
+// include the cost of reading the clock.
+
+using namespace com::grakra::concurrent;
+
+static constexpr int MAX_THREAD_NR = 64;
+static constexpr size_t KEY_STREAM_SIZE = 1 << 16;
+static constexpr size_t LATENCY_SAMPLE_INTERVAL = 8;
+static constexpr double ZIPF_THETA = 0.99;
+
+enum KeyDist { UNIFORM_KEYS = 0, ZIPF_KEYS = 1 };
+
+static void pin_current_thread(int thread_index) {
+    auto cpu_nr = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    CPU_SET(thread_index % cpu_nr, &cpu_set);
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+
+static void unpin_current_thread() {
+    cpu_set_t cpu_set;
+    CPU_ZERO(&cpu_set);
+    for (unsigned cpu = 0; cpu < std::max(1u, std::thread::hardware_concurrency()); ++cpu) {
+        CPU_SET(cpu, &cpu_set);
+    }
+    pthread_setaffinity_np(pthread_self(), sizeof(cpu_set), &cpu_set);
+}
+
+// log-linear histogram of nanoseconds, SUB_BUCKET_NR buckets per power of 2,
+// so a percentile is off by at most 1/SUB_BUCKET_NR.
+class LatencyHistogram {
+    static constexpr size_t SUB_BUCKET_BITS = 4;
+    static constexpr size_t SUB_BUCKET_NR = 1 << SUB_BUCKET_BITS;
+    static constexpr size_t BUCKET_NR = (64 - SUB_BUCKET_BITS + 1) * SUB_BUCKET_NR;
+
+public:
+    void record(uint64_t ns) {
+        ++counts[bucket_of(ns)];
+        ++total;
+    }
+    void merge(LatencyHistogram const& other) {
+        for (size_t i = 0; i < BUCKET_NR; ++i) {
+            counts[i] += other.counts[i];
+        }
+        total += other.total;
+    }
+    void clear() {
+        std::fill(std::begin(counts), std::end(counts), 0);
+        total = 0;
+    }
+    // upper bound of the bucket holding the p-th quantile.
+    uint64_t percentile(double p) const {
+        auto rank = static_cast<uint64_t>(std::ceil(p * total));
+        uint64_t seen = 0;
+        for (size_t i = 0; i < BUCKET_NR; ++i) {
+            seen += counts[i];
+            if (seen >= rank && seen > 0) {
+                return upper_bound_of(i);
+            }
+        }
+        return 0;
+    }
+
+private:
+    static size_t bucket_of(uint64_t ns) {
+        if (ns < SUB_BUCKET_NR) {
+            return ns;
+        }
+        auto exp = 63 - __builtin_clzll(ns) - SUB_BUCKET_BITS + 1;
+        return exp * SUB_BUCKET_NR + ((ns >> (exp - 1)) & (SUB_BUCKET_NR - 1));
+    }
+    static uint64_t upper_bound_of(size_t bucket) {
+        auto exp = bucket / SUB_BUCKET_NR;
+        auto sub = bucket % SUB_BUCKET_NR;
+        if (exp == 0) {
+            return sub;
+        }
+        return ((SUB_BUCKET_NR + sub + 1) << (exp - 1)) - 1;
+    }
+
+    uint64_t counts[BUCKET_NR]{};
+    uint64_t total{0};
+};
+
+// the threads of a run merge their samples into it after the timed loop,
+// thread#0 waits for all of them before reporting.
+struct LatencyReport {
+    std::mutex mutex;
+    LatencyHistogram merged;
+    std::atomic<int> merged_nr{0};
+
+    void submit(benchmark::State& state, LatencyHistogram const& local) {
+        {
+            std::lock_guard guard(mutex);
+            merged.merge(local);
+        }
+        merged_nr.fetch_add(1, std::memory_order_acq_rel);
+        if (state.thread_index != 0) {
+            return;
+        }
+        while (merged_nr.load(std::memory_order_acquire) < state.threads) {
+            std::this_thread::yield();
+        }
+        state.counters["p50_ns"] = merged.percentile(0.5);
+        state.counters["p99_ns"] = merged.percentile(0.99);
+        state.counters["p999_ns"] = merged.percentile(0.999);
+        merged.clear();
+        merged_nr.store(0, std::memory_order_release);
+    }
+};
+
+// YCSB zipfian generator(Gray et al., quickly generating billion-record
+// synthetic databases), ranks are scattered over the key range by mix64 so
+// the hot keys do not share slots.
+class ZipfGenerator {
+public:
+    ZipfGenerator(uint64_t n, double theta) : n(n), theta(theta), zetan(zeta(n, theta)) {
+        alpha = 1.0 / (1.0 - theta);
+        eta = (1.0 - std::pow(2.0 / n, 1.0 - theta)) / (1.0 - zeta(2, theta) / zetan);
+    }
+    template <typename Gen>
+    uint64_t operator()(Gen& gen) {
+        auto u = std::uniform_real_distribution<double>(0.0, 1.0)(gen);
+        auto uz = u * zetan;
+        uint64_t rank = 0;
+        if (uz < 1.0) {
+            rank = 0;
+        } else if (uz < 1.0 + std::pow(0.5, theta)) {
+            rank = 1;
+        } else {
+            rank = std::min<uint64_t>(n - 1, static_cast<uint64_t>(n * std::pow(eta * u - eta + 1.0, alpha)));
+        }
+        return mix64(rank) % n;
+    }
+
+private:
+    static double zeta(uint64_t n, double theta) {
+        double sum = 0;
+        for (uint64_t i = 1; i <= n; ++i) {
+            sum += 1.0 / std::pow(i, theta);
+        }
+        return sum;
+    }
+
+    const uint64_t n;
+    const double theta;
+    const double zetan;
+    double alpha;
+    double eta;
+};
+
+static std::vector<int64_t> gen_key_stream(KeyDist dist, uint64_t key_range, uint64_t seed) {
+    std::mt19937_64 gen(seed);
+    std::vector<int64_t> keys(KEY_STREAM_SIZE);
+    if (dist == ZIPF_KEYS) {
+        // zeta(key_range) is O(key_range), share it among the threads.
+        static std::mutex mutex;
+        static std::unique_ptr<ZipfGenerator> zipf;
+        static uint64_t zipf_range = 0;
+        std::lock_guard guard(mutex);
+        if (zipf == nullptr || zipf_range != key_range) {
+            zipf = std::make_unique<ZipfGenerator>(key_range, ZIPF_THETA);
+            zipf_range = key_range;
+        }
+        for (auto& key : keys) {
+            key = (*zipf)(gen);
+        }
+    } else {
+        std::uniform_int_distribution<int64_t> rand(0, key_range - 1);
+        for (auto& key : keys) {
+            key = rand(gen);
+        }
+    }
+    return keys;
+}
+
+struct ConcurrentHashMap {
+    static constexpr uint64_t KEY_RANGE = 1 << 20;
+    Hash<int64_t, int64_t> hash{KEY_RANGE, 4};
+    bool get(int64_t key) {
+        int64_t value;
+        return hash.Get(key, value);
+    }
+    bool insert(int64_t key) { return hash.Put(key, key); }
+    bool remove(int64_t key) { return hash.Remove(key); }
+};
+
+// a single sorted list, so the key range is kept short.
+struct MichaelListMap {
+    static constexpr uint64_t KEY_RANGE = 1 << 10;
+    MichaelList list;
+    bool get(int64_t key) {
+        uint32_t value;
+        return list.Search(key, value);
+    }
+    bool insert(int64_t key) {
+        auto node = new NodeType(key, key);
+        if (!list.Insert(node)) {
+            delete node;
+            return false;
+        }
+        return true;
+    }
+    bool remove(int64_t key) { return list.Remove(key); }
+};
+
+struct StdMutexFlatHashMap {
+    static constexpr uint64_t KEY_RANGE = 1 << 20;
+    std::mutex mutex;
+    absl::flat_hash_map<int64_t, int64_t> map;
+    bool get(int64_t key) {
+        std::lock_guard guard(mutex);
+        return map.find(key) != map.end();
+    }
+    bool insert(int64_t key) {
+        std::lock_guard guard(mutex);
+        return map.emplace(key, key).second;
+    }
+    bool remove(int64_t key) {
+        std::lock_guard guard(mutex);
+        return map.erase(key) > 0;
+    }
+};
+
+// readers share the lock.
+struct AbslMutexFlatHashMap {
+    static constexpr uint64_t KEY_RANGE = 1 << 20;
+    absl::Mutex mutex;
+    absl::flat_hash_map<int64_t, int64_t> map;
+    bool get(int64_t key) {
+        absl::ReaderMutexLock guard(&mutex);
+        return map.find(key) != map.end();
+    }
+    bool insert(int64_t key) {
+        absl::MutexLock guard(&mutex);
+        return map.emplace(key, key).second;
+    }
+    bool remove(int64_t key) {
+        absl::MutexLock guard(&mutex);
+        return map.erase(key) > 0;
+    }
+};
+
+template <typename Map>
+static void BM_map(benchmark::State& state) {
+    static std::unique_ptr<Map> map;
+    static LatencyReport report;
+    const auto read_pct = state.range(0);
+    const auto dist = static_cast<KeyDist>(state.range(1));
+    pin_current_thread(state.thread_index);
+    if (state.thread_index == 0) {
+        map = std::make_unique<Map>();
+        for (uint64_t key = 0; key < Map::KEY_RANGE; key += 2) {
+            map->insert(key);
+        }
+    }
+    auto keys = gen_key_stream(dist, Map::KEY_RANGE, state.thread_index + 1);
+    std::mt19937_64 gen(state.thread_index);
+    std::vector<uint8_t> ops(KEY_STREAM_SIZE);
+    for (auto& op : ops) {
+        op = gen() % 100;
+    }
+    LatencyHistogram latency;
+    size_t i = 0;
+    size_t hit_nr = 0;
+    for (auto _ : state) {
+        auto key = keys[i & (KEY_STREAM_SIZE - 1)];
+        auto op = ops[i & (KEY_STREAM_SIZE - 1)];
+        const bool sampled = i % LATENCY_SAMPLE_INTERVAL == 0;
+        std::chrono::steady_clock::time_point start;
+        if (sampled) {
+            start = std::chrono::steady_clock::now();
+        }
+        if (op < read_pct) {
+            hit_nr += map->get(key);
+        } else if ((op - read_pct) % 2 == 0) {
+            hit_nr += map->insert(key);
+        } else {
+            hit_nr += map->remove(key);
+        }
+        if (sampled) {
+            latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                                start)
+                                   .count());
+        }
+        ++i;
+    }
+    benchmark::DoNotOptimize(hit_nr);
+    state.SetItemsProcessed(state.iterations());
+    report.submit(state, latency);
+    unpin_current_thread();
+}
+
+static void map_args(benchmark::internal::Benchmark* b) {
+    for (auto read_pct : {100, 90, 50}) {
+        for (auto dist : {UNIFORM_KEYS, ZIPF_KEYS}) {
+            b->Args({read_pct, dist});
+        }
+    }
+    b->ArgNames({"read_pct", "zipf"})->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+}
+
+BENCHMARK_TEMPLATE(BM_map, ConcurrentHashMap)->Apply(map_args);
+BENCHMARK_TEMPLATE(BM_map, MichaelListMap)->Apply(map_args);
+BENCHMARK_TEMPLATE(BM_map, StdMutexFlatHashMap)->Apply(map_args);
+BENCHMARK_TEMPLATE(BM_map, AbslMutexFlatHashMap)->Apply(map_args);
+
+static constexpr size_t QUEUE_CAPACITY = 1 << 14;
+
+struct NonblockQueue {
+    nonblock::Queue<int64_t> queue{QUEUE_CAPACITY};
+    bool put(int64_t v) { return queue.try_enqueue(v); }
+    bool take(int64_t& v) { return queue.try_dequeue(v); }
+};
+
+struct AsyncConcurrentQueue {
+    async::ConcurrentQueue<int64_t> queue;
+    bool put(int64_t v) {
+        queue.enqueue(v);
+        return true;
+    }
+    bool take(int64_t& v) {
+        auto item = queue.dequeue();
+        if (!item.has_value()) {
+            return false;
+        }
+        v = *item;
+        return true;
+    }
+};
+
+struct FollyMPMCQueue {
+    folly::MPMCQueue<int64_t> queue{QUEUE_CAPACITY};
+    bool put(int64_t v) { return queue.write(v); }
+    bool take(int64_t& v) { return queue.read(v); }
+};
+
+// every thread alternates a put and a take on a half-full queue, so both ends
+// are contended by all the threads; an item is an op.
+template <typename Queue>
+static void BM_queue(benchmark::State& state) {
+    static std::unique_ptr<Queue> queue;
+    static LatencyReport report;
+    pin_current_thread(state.thread_index);
+    if (state.thread_index == 0) {
+        queue = std::make_unique<Queue>();
+        for (size_t i = 0; i < QUEUE_CAPACITY / 2; ++i) {
+            queue->put(i);
+        }
+    }
+    LatencyHistogram latency;
+    size_t i = 0;
+    int64_t sum = 0;
+    for (auto _ : state) {
+        // i is even for a put, so ops are counted in pairs and both puts and
+        // takes are sampled.
+        const bool sampled = (i >> 1) % LATENCY_SAMPLE_INTERVAL == 0;
+        std::chrono::steady_clock::time_point start;
+        if (sampled) {
+            start = std::chrono::steady_clock::now();
+        }
+        int64_t v = 0;
+        if (i % 2 == 0) {
+            queue->put(i);
+        } else if (queue->take(v)) {
+            sum += v;
+        }
+        if (sampled) {
+            latency.record(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() -
+                                                                                start)
+                                   .count());
+        }
+        ++i;
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations());
+    report.submit(state, latency);
+    unpin_current_thread();
+}
+
+BENCHMARK_TEMPLATE(BM_queue, NonblockQueue)->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_queue, AsyncConcurrentQueue)->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_queue, FollyMPMCQueue)->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK_MAIN();
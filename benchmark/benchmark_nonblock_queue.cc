@@ -0,0 +1,140 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2021/08/13.
+//
+
+#include <benchmark/benchmark.h>
+#include <folly/MPMCQueue.h>
+
+#include <atomic>
+#include <thread>
+#include <vector>
+
+#include "nonblock_queue.hh"
+
+static constexpr size_t QUEUE_CAPACITY = 1024;
+static constexpr size_t ITEM_NR = 1 << 20;
+static constexpr size_t BULK_SIZE = 16;
+
+struct NonblockQueueOps {
+    using Queue = nonblock::Queue<int64_t>;
+    static void put(Queue& q, int64_t v) { q.enqueue(v); }
+    static void take(Queue& q, int64_t& v) { q.dequeue(v); }
+};
+
+struct FollyMPMCQueueOps {
+    using Queue = folly::MPMCQueue<int64_t>;
+    static void put(Queue& q, int64_t v) { q.blockingWrite(v); }
+    static void take(Queue& q, int64_t& v) { q.blockingRead(v); }
+};
+
+// state.range(0) producers and as many consumers pass ITEM_NR items in total,
+// every consumer stops after taking a negative item.
+template <typename Ops>
+static void BM_Queue(benchmark::State& state) {
+    const size_t thread_nr = state.range(0);
+    for (auto _ : state) {
+        typename Ops::Queue q(QUEUE_CAPACITY);
+        std::atomic<int64_t> sum(0);
+        std::vector<std::thread> threads;
+        for (size_t c = 0; c < thread_nr; ++c) {
+            threads.emplace_back([&q, &sum]() {
+                int64_t local_sum = 0;
+                int64_t v;
+                while (true) {
+                    Ops::take(q, v);
+                    if (v < 0) {
+                        break;
+                    }
+                    local_sum += v;
+                }
+                sum += local_sum;
+            });
+        }
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < thread_nr; ++p) {
+            producers.emplace_back([&q, p, thread_nr]() {
+                for (size_t i = p; i < ITEM_NR; i += thread_nr) {
+                    Ops::put(q, i);
+                }
+            });
+        }
+        for (auto& thd : producers) {
+            thd.join();
+        }
+        for (size_t c = 0; c < thread_nr; ++c) {
+            Ops::put(q, -1);
+        }
+        for (auto& thd : threads) {
+            thd.join();
+        }
+        benchmark::DoNotOptimize(sum.load());
+    }
+    state.SetItemsProcessed(state.iterations() * ITEM_NR);
+}
+
+static void BM_NonblockQueue_Bulk(benchmark::State& state) {
+    const size_t thread_nr = state.range(0);
+    for (auto _ : state) {
+        nonblock::Queue<int64_t> q(QUEUE_CAPACITY);
+        std::atomic<int64_t> sum(0);
+        std::vector<std::thread> threads;
+        for (size_t c = 0; c < thread_nr; ++c) {
+            threads.emplace_back([&q, &sum]() {
+                int64_t local_sum = 0;
+                int64_t values[BULK_SIZE];
+                size_t stop_nr = 0;
+                while (stop_nr == 0) {
+                    auto n = q.dequeue_bulk(values, BULK_SIZE);
+                    for (size_t i = 0; i < n; ++i) {
+                        if (values[i] < 0) {
+                            ++stop_nr;
+                        } else {
+                            local_sum += values[i];
+                        }
+                    }
+                }
+                // give back the stop items of the other consumers.
+                for (size_t i = 1; i < stop_nr; ++i) {
+                    q.enqueue(-1);
+                }
+                sum += local_sum;
+            });
+        }
+        std::vector<std::thread> producers;
+        for (size_t p = 0; p < thread_nr; ++p) {
+            producers.emplace_back([&q, p, thread_nr]() {
+                int64_t values[BULK_SIZE];
+                size_t n = 0;
+                for (size_t i = p; i < ITEM_NR; i += thread_nr) {
+                    values[n++] = i;
+                    if (n == BULK_SIZE) {
+                        q.enqueue_bulk(values, n);
+                        n = 0;
+                    }
+                }
+                q.enqueue_bulk(values, n);
+            });
+        }
+        for (auto& thd : producers) {
+            thd.join();
+        }
+        for (size_t c = 0; c < thread_nr; ++c) {
+            q.enqueue(-1);
+        }
+        for (auto& thd : threads) {
+            thd.join();
+        }
+        benchmark::DoNotOptimize(sum.load());
+    }
+    state.SetItemsProcessed(state.iterations() * ITEM_NR);
+}
+
+BENCHMARK_TEMPLATE(BM_Queue, NonblockQueueOps)->RangeMultiplier(2)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_TEMPLATE(BM_Queue, FollyMPMCQueueOps)->RangeMultiplier(2)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_NonblockQueue_Bulk)->RangeMultiplier(2)->Range(1, 64)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_MAIN();
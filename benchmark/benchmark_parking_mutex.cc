@@ -0,0 +1,92 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/11/9.
+//
+
+#include <benchmark/benchmark.h>
+
+#include <concurrent/parking_mutex.hh>
+#include <memory>
+#include <mutex>
+#include <shared_mutex>
+#include <string>
+#include <vector>
+
+#include "lru_cache/lru_cache.hh"
+
+using namespace com::grakra::concurrent;
+
+static constexpr int MAX_THREAD_NR = 64;
+
+// a short critical section every thread contends on.
+template <typename Mutex>
+static void BM_mutex_contention(benchmark::State& state) {
+    static Mutex mutex;
+    static int64_t counter = 0;
+    for (auto _ : state) {
+        std::lock_guard guard(mutex);
+        benchmark::DoNotOptimize(++counter);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+// one writer per state.range(0) lockers, the rest read.
+template <typename SharedMutex>
+static void BM_shared_mutex_contention(benchmark::State& state) {
+    static SharedMutex mutex;
+    static int64_t counter = 0;
+    const bool writer = state.thread_index % state.range(0) == 0;
+    int64_t sum = 0;
+    for (auto _ : state) {
+        if (writer) {
+            std::lock_guard guard(mutex);
+            ++counter;
+        } else {
+            std::shared_lock guard(mutex);
+            sum += counter;
+        }
+    }
+    benchmark::DoNotOptimize(sum);
+    state.SetItemsProcessed(state.iterations());
+}
+
+static constexpr int CACHE_KEY_NR = 10000;
+static void noop_deleter(const starrocks::CacheKey&, void*) {}
+
+template <typename Mutex>
+static void BM_lru_cache_lookup(benchmark::State& state) {
+    static std::unique_ptr<starrocks::ShardedLRUCache<Mutex>> cache;
+    static std::vector<std::string> keys;
+    if (state.thread_index == 0) {
+        cache.reset(new starrocks::ShardedLRUCache<Mutex>(CACHE_KEY_NR * 2));
+        keys.clear();
+        for (int i = 0; i < CACHE_KEY_NR; ++i) {
+            keys.push_back("key_" + std::to_string(i));
+            cache->release(cache->insert(keys.back(), nullptr, 1, &noop_deleter));
+        }
+    }
+    size_t i = state.thread_index * 7919;
+    for (auto _ : state) {
+        auto handle = cache->lookup(keys[i++ % CACHE_KEY_NR]);
+        cache->release(handle);
+    }
+    state.SetItemsProcessed(state.iterations());
+}
+
+BENCHMARK_TEMPLATE(BM_mutex_contention, std::mutex)->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_mutex_contention, ParkingMutex)->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_shared_mutex_contention, std::shared_mutex)
+        ->Arg(8)
+        ->ThreadRange(1, MAX_THREAD_NR)
+        ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_shared_mutex_contention, ParkingSharedMutex)
+        ->Arg(8)
+        ->ThreadRange(1, MAX_THREAD_NR)
+        ->UseRealTime();
+BENCHMARK_TEMPLATE(BM_lru_cache_lookup, std::mutex)->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK_TEMPLATE(BM_lru_cache_lookup, ParkingMutex)->ThreadRange(1, MAX_THREAD_NR)->UseRealTime();
+BENCHMARK_MAIN();
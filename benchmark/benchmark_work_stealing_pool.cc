@@ -0,0 +1,85 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2021/08/13.
+//
+
+#include <benchmark/benchmark.h>
+
+#include <concurrent/morsel.hh>
+#include <concurrent/work_stealing_pool.hh>
+#include <memory>
+#include <random>
+#include <string_functions.hh>
+
+using namespace com::grakra::concurrent;
+
+static constexpr size_t ROW_NR = 1 << 22;
+
+static BinaryColumn& get_column() {
+    static BinaryColumn column = []() {
+        BinaryColumn c;
+        std::mt19937 rand(0);
+        for (size_t i = 0; i < ROW_NR; ++i) {
+            std::string s(8 + rand() % 24, 'a');
+            for (auto& ch : s) {
+                ch = 'A' + rand() % 58;
+            }
+            c.append(s);
+        }
+        return c;
+    }();
+    return column;
+}
+
+static void upper_kernel(BinaryColumn const& src, BinaryColumn& dst) {
+    StringFunctions::case_vector_new1<'a', 'z'>(src, dst);
+}
+
+static void BM_upper_serial(benchmark::State& state) {
+    auto& src = get_column();
+    for (auto _ : state) {
+        BinaryColumn dst;
+        upper_kernel(src, dst);
+        benchmark::DoNotOptimize(dst.bytes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * ROW_NR);
+}
+
+// state.range(0) workers over MORSEL_ROW_NR-row morsels.
+static void BM_upper_morsel(benchmark::State& state) {
+    auto& src = get_column();
+    WorkStealingPool pool(state.range(0));
+    for (auto _ : state) {
+        BinaryColumn dst;
+        ParallelBinaryKernel(pool, src, dst, &upper_kernel);
+        benchmark::DoNotOptimize(dst.bytes.data());
+    }
+    state.SetItemsProcessed(state.iterations() * ROW_NR);
+}
+
+// a compute-bound loop, shows the overhead of splitting and stealing.
+static void BM_parallel_for_sum(benchmark::State& state) {
+    WorkStealingPool pool(state.range(0));
+    const size_t n = 1 << 24;
+    std::unique_ptr<uint64_t[]> partial(new uint64_t[n / MORSEL_ROW_NR]);
+    for (auto _ : state) {
+        ForEachMorsel(pool, n, [&](size_t b, size_t e) {
+            uint64_t s = 0;
+            for (auto i = b; i < e; ++i) {
+                s += i * i;
+            }
+            partial[b / MORSEL_ROW_NR] = s;
+        });
+        benchmark::DoNotOptimize(partial.get());
+    }
+    state.SetItemsProcessed(state.iterations() * n);
+}
+
+BENCHMARK(BM_upper_serial)->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_upper_morsel)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK(BM_parallel_for_sum)->Arg(1)->Arg(2)->Arg(4)->Arg(8)->Arg(16)->UseRealTime()->Unit(benchmark::kMillisecond);
+BENCHMARK_MAIN();
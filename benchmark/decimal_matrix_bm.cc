@@ -0,0 +1,334 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/23.
+//
+
+#include <benchmark/benchmark.h>
+
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <include/decimal/decimal.hh>
+#include <include/decimalv3.hh>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// the decimal kernels over data shaped like real columns rather than the
+// uniform values of PrepareData: most values have a few integer digits, and
+// the full-width rows, zeros, nulls and negatives come at given rates.
+//
+// a data set is decimal(P, S1) op decimal(P, S2) for P in 9/18/38 and three
+// scale pairs; every data set is run with the baseline rates and with one
+// rate changed at a time, so a column of the table shows one effect. null
+// rows hold 0, as a column stores them, and are computed like the others.
+// full-width rows have P digits, they are the ones that overflow products
+// and, at 38 digits, sums.
+//
+// the benchmarks are named Op/Kernel/pP_sS1_S2/negN/zeroN/nullN/fullN and
+// report items_per_second and the data set as counters, in a table by
+// default:
+//   decimal_matrix_bm --benchmark_filter='Mul/.*/p18'
+// batch_size in the environment overrides 8192 rows.
+
+struct DecimalDataSpec {
+    int precision;
+    int lhs_scale;
+    int rhs_scale;
+    int negative_pct;
+    int zero_pct;
+    int null_pct;
+    int full_width_pct;
+
+    std::string name() const {
+        return "p" + std::to_string(precision) + "_s" + std::to_string(lhs_scale) + "_" +
+               std::to_string(rhs_scale) + "/neg" + std::to_string(negative_pct) + "/zero" +
+               std::to_string(zero_pct) + "/null" + std::to_string(null_pct) + "/full" +
+               std::to_string(full_width_pct);
+    }
+};
+
+// the columns of a data set in int128 and in the physical type of the
+// precision, which the DecimalV3 kernels take.
+struct DecimalData {
+    DecimalDataSpec spec;
+    std::vector<int128_t> lhs;
+    std::vector<int128_t> rhs;
+    // rhs with 1 for 0, for the kernels that trap on a zero divisor.
+    std::vector<int128_t> rhs_nonzero;
+    std::vector<uint8_t> lhs_narrow;
+    std::vector<uint8_t> rhs_narrow;
+    std::vector<int128_t> result;
+    std::vector<uint8_t> overflow;
+};
+
+static size_t matrix_batch_size() {
+    auto value = getenv("batch_size");
+    size_t n = value != nullptr ? strtoul(value, nullptr, 10) : 0;
+    return n > 0 ? n : 8192;
+}
+
+static const size_t MATRIX_BATCH_SIZE = matrix_batch_size();
+
+// the number of integer digits is geometric, 1 with probability 0.6, 2 with
+// 0.24 and so on; the fraction has all the scale digits.
+static int128_t random_decimal(std::mt19937_64& rng, DecimalDataSpec const& spec, int scale) {
+    std::uniform_int_distribution<int> pct(0, 99);
+    int128_t magnitude = 0;
+    if (pct(rng) < spec.zero_pct) {
+        return 0;
+    }
+    if (pct(rng) < spec.full_width_pct) {
+        // 9...9xxx, P digits.
+        magnitude = 9;
+        for (int i = 1; i < spec.precision; ++i) {
+            magnitude = magnitude * 10 + rng() % 10;
+        }
+    } else {
+        int int_digits = 1;
+        while (int_digits < spec.precision - scale && pct(rng) < 40) {
+            ++int_digits;
+        }
+        int digits = std::min(int_digits, spec.precision - scale) + scale;
+        for (int i = 0; i < digits; ++i) {
+            magnitude = magnitude * 10 + rng() % 10;
+        }
+    }
+    return pct(rng) < spec.negative_pct ? -magnitude : magnitude;
+}
+
+template <typename T>
+static std::vector<uint8_t> narrow(std::vector<int128_t> const& values) {
+    std::vector<uint8_t> bytes(values.size() * sizeof(T));
+    for (size_t i = 0; i < values.size(); ++i) {
+        auto v = static_cast<T>(values[i]);
+        memcpy(bytes.data() + i * sizeof(T), &v, sizeof(T));
+    }
+    return bytes;
+}
+
+static std::vector<uint8_t> narrow(std::vector<int128_t> const& values, int precision) {
+    switch (decimalv3_width(precision)) {
+    case DECIMAL32:
+        return narrow<int32_t>(values);
+    case DECIMAL64:
+        return narrow<int64_t>(values);
+    default:
+        return narrow<int128_t>(values);
+    }
+}
+
+static std::unique_ptr<DecimalData> generate(DecimalDataSpec const& spec, uint64_t seed) {
+    std::mt19937_64 rng(seed);
+    std::uniform_int_distribution<int> pct(0, 99);
+    auto n = MATRIX_BATCH_SIZE;
+    std::unique_ptr<DecimalData> data(new DecimalData());
+    data->spec = spec;
+    data->lhs.resize(n);
+    data->rhs.resize(n);
+    data->rhs_nonzero.resize(n);
+    for (size_t i = 0; i < n; ++i) {
+        bool is_null = pct(rng) < spec.null_pct;
+        data->lhs[i] = is_null ? 0 : random_decimal(rng, spec, spec.lhs_scale);
+        data->rhs[i] = is_null ? 0 : random_decimal(rng, spec, spec.rhs_scale);
+        data->rhs_nonzero[i] = data->rhs[i] != 0 ? data->rhs[i] : 1;
+    }
+    data->lhs_narrow = narrow(data->lhs, spec.precision);
+    data->rhs_narrow = narrow(data->rhs, spec.precision);
+    data->result.resize(n);
+    data->overflow.resize((n + 7) / 8);
+    return data;
+}
+
+// the result type of the DecimalV3 kernels: the scale is the usual one of the
+// op and the precision is the intermediate one, at most 38. RESCALE takes lhs
+// from scale s1 to s2.
+static DecimalV3Call resolve_decimalv3(DecimalV3Op op, DecimalDataSpec const& spec) {
+    int p = spec.precision, s1 = spec.lhs_scale, s2 = spec.rhs_scale;
+    int rs = 0;
+    switch (op) {
+    case DecimalV3Op::MUL:
+        rs = std::min(s1 + s2, DECIMAL128_MAX_PRECISION);
+        break;
+    case DecimalV3Op::RESCALE:
+        rs = s2;
+        break;
+    default:
+        rs = std::max(s1, s2);
+        break;
+    }
+    int rp = std::min(decimalv3_intermediate_precision(op, p, s1, p, s2, rs), DECIMAL128_MAX_PRECISION);
+    rs = std::min(rs, rp);
+    return decimalv3_resolve(op, p, s1, p, s2, rp, rs);
+}
+
+template <typename Op>
+static void run_rows(benchmark::State& state, DecimalData& data, Op&& op) {
+    for (auto _ : state) {
+        batch_compute(data.lhs.size(), data.lhs.data(), data.rhs.data(), data.result.data(), op);
+        benchmark::DoNotOptimize(data.result.data());
+    }
+}
+
+// lhs * 10^(s2 - s1) + rhs or lhs + rhs * 10^(s1 - s2).
+template <bool check_overflow>
+static void ck_add(benchmark::State& state, DecimalData& data) {
+    auto const& spec = data.spec;
+    if (spec.lhs_scale == spec.rhs_scale) {
+        CKDecimalOp<false, true, check_overflow, check_overflow> op;
+        run_rows(state, data, [&](int128_t x, int128_t y) { return op.add(x, y, 1); });
+    } else if (spec.lhs_scale < spec.rhs_scale) {
+        CKDecimalOp<true, true, check_overflow, check_overflow> op;
+        int128_t scale = decimal_internal::exp10_of(spec.rhs_scale - spec.lhs_scale);
+        run_rows(state, data, [&](int128_t x, int128_t y) { return op.add(x, y, scale); });
+    } else {
+        CKDecimalOp<true, false, check_overflow, check_overflow> op;
+        int128_t scale = decimal_internal::exp10_of(spec.lhs_scale - spec.rhs_scale);
+        run_rows(state, data, [&](int128_t x, int128_t y) { return op.add(x, y, scale); });
+    }
+}
+
+template <bool check_overflow>
+static void ck_mul(benchmark::State& state, DecimalData& data) {
+    CKDecimalOp<false, true, check_overflow, check_overflow> op;
+    run_rows(state, data, [&](int128_t x, int128_t y) { return op.mul(x, y); });
+}
+
+// the dividend is scaled by 10^s2 to keep the scale of the lhs.
+static void ck_div(benchmark::State& state, DecimalData& data) {
+    CKDecimalOp<false, true, true, true> op;
+    int128_t scale = decimal_internal::exp10_of(data.spec.rhs_scale);
+    for (auto _ : state) {
+        batch_compute(data.lhs.size(), data.lhs.data(), data.rhs_nonzero.data(), data.result.data(),
+                      [&](int128_t x, int128_t y) { return op.div<true>(x, y, scale); });
+        benchmark::DoNotOptimize(data.result.data());
+    }
+}
+
+static void decimalv3(benchmark::State& state, DecimalData& data, DecimalV3Op op) {
+    auto call = resolve_decimalv3(op, data.spec);
+    if (!call.valid()) {
+        state.SkipWithError("illegal decimal type");
+        return;
+    }
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(call(data.lhs_narrow.data(), data.rhs_narrow.data(), data.result.data(),
+                                      data.lhs.size(), data.overflow.data()));
+    }
+}
+
+struct DecimalKernel {
+    const char* op;
+    const char* name;
+    std::function<void(benchmark::State&, DecimalData&)> run;
+};
+
+static std::vector<DecimalKernel> decimal_kernels() {
+    return {
+            {"Add", "DorisDecimal",
+             [](benchmark::State& state, DecimalData& data) {
+                 DorisDecimalOp op;
+                 run_rows(state, data, [&](int128_t x, int128_t y) { return op.add(x, y); });
+             }},
+            {"Add", "CKDecimal", ck_add<false>},
+            {"Add", "CKDecimal_CheckOverflow", ck_add<true>},
+            {"Add", "DecimalV3",
+             [](benchmark::State& state, DecimalData& data) { decimalv3(state, data, DecimalV3Op::ADD); }},
+            {"Sub", "DecimalV3",
+             [](benchmark::State& state, DecimalData& data) { decimalv3(state, data, DecimalV3Op::SUB); }},
+            {"Mul", "DorisDecimal",
+             [](benchmark::State& state, DecimalData& data) {
+                 DorisDecimalOp op;
+                 run_rows(state, data, [&](int128_t x, int128_t y) { return op.mul(x, y); });
+             }},
+            {"Mul", "CKDecimal", ck_mul<false>},
+            {"Mul", "CKDecimal_CheckOverflow", ck_mul<true>},
+            {"Mul", "DecimalV3",
+             [](benchmark::State& state, DecimalData& data) { decimalv3(state, data, DecimalV3Op::MUL); }},
+            {"Div", "DorisDecimal",
+             [](benchmark::State& state, DecimalData& data) {
+                 DorisDecimalOp op;
+                 run_rows(state, data, [&](int128_t x, int128_t y) { return op.div(x, y); });
+             }},
+            {"Div", "CKDecimal_CheckOverflow", ck_div},
+            {"Div", "DecimalV3",
+             [](benchmark::State& state, DecimalData& data) { decimalv3(state, data, DecimalV3Op::DIV); }},
+            {"Rescale", "DecimalV3",
+             [](benchmark::State& state, DecimalData& data) { decimalv3(state, data, DecimalV3Op::RESCALE); }},
+    };
+}
+
+static std::vector<DecimalDataSpec> decimal_data_specs() {
+    // negatives, zeros, nulls and full-width rows of the baseline.
+    const DecimalDataSpec baseline = {0, 0, 0, 50, 0, 0, 0};
+    std::vector<DecimalDataSpec> specs;
+    for (int precision : {9, 18, 38}) {
+        int scale_pairs[][2] = {{2, 2}, {2, 4}, {0, precision / 2}};
+        for (auto& scales : scale_pairs) {
+            auto spec = baseline;
+            spec.precision = precision;
+            spec.lhs_scale = scales[0];
+            spec.rhs_scale = scales[1];
+            specs.push_back(spec);
+            auto positive = spec;
+            positive.negative_pct = 0;
+            specs.push_back(positive);
+            auto zeros = spec;
+            zeros.zero_pct = 30;
+            specs.push_back(zeros);
+            auto nulls = spec;
+            nulls.null_pct = 20;
+            specs.push_back(nulls);
+            auto full_width = spec;
+            full_width.full_width_pct = 5;
+            specs.push_back(full_width);
+        }
+    }
+    return specs;
+}
+
+static std::vector<std::unique_ptr<DecimalData>> matrix_data;
+
+static void register_decimal_matrix() {
+    auto kernels = decimal_kernels();
+    uint64_t seed = 0;
+    for (auto const& spec : decimal_data_specs()) {
+        matrix_data.push_back(generate(spec, ++seed));
+        auto* data = matrix_data.back().get();
+        for (auto const& kernel : kernels) {
+            auto name = std::string(kernel.op) + "/" + kernel.name + "/" + spec.name();
+            auto run = kernel.run;
+            benchmark::RegisterBenchmark(name.c_str(), [run, data](benchmark::State& state) {
+                run(state, *data);
+                auto const& spec = data->spec;
+                state.SetItemsProcessed(state.iterations() * data->lhs.size());
+                state.counters["p"] = spec.precision;
+                state.counters["s1"] = spec.lhs_scale;
+                state.counters["s2"] = spec.rhs_scale;
+                state.counters["neg%"] = spec.negative_pct;
+                state.counters["zero%"] = spec.zero_pct;
+                state.counters["null%"] = spec.null_pct;
+                state.counters["full%"] = spec.full_width_pct;
+            });
+        }
+    }
+}
+
+int main(int argc, char** argv) {
+    // the flags of the command line come later and override the table.
+    std::vector<char*> args = {argv[0], const_cast<char*>("--benchmark_counters_tabular=true")};
+    args.insert(args.end(), argv + 1, argv + argc);
+    int args_nr = args.size();
+    register_decimal_matrix();
+    benchmark::Initialize(&args_nr, args.data());
+    if (benchmark::ReportUnrecognizedArguments(args_nr, args.data())) {
+        return 1;
+    }
+    benchmark::RunSpecifiedBenchmarks();
+    return 0;
+}
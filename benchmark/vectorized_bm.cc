@@ -11,7 +11,18 @@
 
 #include <cstring>
 #include <include/decimal/decimal.hh>
+#include <include/decimal/decimal128_column.hh>
+#include <include/decimal/decimal128_agg.hh>
+#include <include/decimal/decimal128_cast.hh>
+#include <include/decimal/decimal128_div.hh>
+#include <include/decimal/decimal128_mul.hh>
+#include <include/decimal/decimal_rescale.hh>
+#include <include/decimal/decimal_string.hh>
+#include <include/decimal/divider.hh>
+#include <include/decimal/sort_key.hh>
+#include <include/decimalv3.hh>
 #include <include/util/defer.hh>
+#include <algorithm>
 #include <iostream>
 #include <random>
 
@@ -61,6 +72,35 @@ static void BM_CKDecimal_Add_CheckOverflow(benchmark::State& state) {
                       [&](auto x, auto y) { return addOp.add(x, y, static_cast<int128_t>(100)); });
 }
 
+// split hi/lo layout, 4 rows per AVX2 op, overflow goes to a bitmap instead
+// of branches.
+Decimal128Column split_lhs(lhs.data(), batch_size);
+Decimal128Column split_rhs(rhs.data(), batch_size);
+Decimal128Column split_result(batch_size);
+std::vector<uint8_t> overflow_bitmap(bitmap_size(batch_size));
+std::vector<uint8_t> lhs_null(batch_size, 0);
+std::vector<uint8_t> rhs_null(batch_size, 0);
+std::vector<uint8_t> result_null(batch_size, 0);
+
+static void BM_Decimal128_Add_AVX2(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decimal128_add(split_lhs, split_rhs, split_result, overflow_bitmap.data()));
+    }
+}
+
+static void BM_Decimal128_Sub_AVX2(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decimal128_sub(split_lhs, split_rhs, split_result, overflow_bitmap.data()));
+    }
+}
+
+static void BM_Decimal128_Add_AVX2_Nullable(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decimal128_add_nullable(split_lhs, lhs_null.data(), split_rhs, rhs_null.data(),
+                                                         split_result, result_null.data(), overflow_bitmap.data()));
+    }
+}
+
 static void BM_Int128_Mul(benchmark::State& state) {
     for (auto _ : state)
         batch_compute(batch_size, lhs.data(), rhs.data(), result.data(), [](int128_t x, int128_t y) { return x * y; });
@@ -87,6 +127,46 @@ static void BM_DorisDecimal_Mul(benchmark::State& state) {
                       [&](int128_t x, int128_t y) { return mulOp.mul(x, y); });
 }
 
+// decimal(9,2) * decimal(9,2) -> decimal(18,4), the intermediate type is
+// int64, compared with the same rows widened to int128.
+std::vector<int32_t> decimal32_lhs(batch_size);
+std::vector<int32_t> decimal32_rhs(batch_size);
+std::vector<int64_t> decimal64_result(batch_size);
+std::vector<int128_t> decimal32_lhs_wide(batch_size);
+std::vector<int128_t> decimal32_rhs_wide(batch_size);
+static bool init_decimal32 = []() {
+    for (size_t i = 0; i < batch_size; ++i) {
+        decimal32_lhs[i] = static_cast<int32_t>(lhs[i] % 1000000000);
+        decimal32_rhs[i] = static_cast<int32_t>(rhs[i] % 1000000000);
+        decimal32_lhs_wide[i] = decimal32_lhs[i];
+        decimal32_rhs_wide[i] = decimal32_rhs[i];
+    }
+    return true;
+}();
+
+static void BM_DecimalV3_Mul_Decimal32_Int128(benchmark::State& state) {
+    CKDecimalOp<false, true, true, true> mulOp;
+    for (auto _ : state)
+        batch_compute(batch_size, decimal32_lhs_wide.data(), decimal32_rhs_wide.data(), result.data(),
+                      [&](int128_t x, int128_t y) { return mulOp.mul(x, y); });
+}
+
+static void BM_DecimalV3_Mul_Decimal32(benchmark::State& state) {
+    using Mul = DecimalV3<DecimalV3Op::MUL, 9, 2, 9, 2, 18, 4>;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Mul::compute(decimal32_lhs.data(), decimal32_rhs.data(), decimal64_result.data(),
+                                              batch_size, overflow_bitmap.data()));
+    }
+}
+
+static void BM_DecimalV3_Mul_Decimal32_Resolved(benchmark::State& state) {
+    auto mul = decimalv3_resolve(DecimalV3Op::MUL, 9, 2, 9, 2, 18, 4);
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(mul(decimal32_lhs.data(), decimal32_rhs.data(), decimal64_result.data(), batch_size,
+                                     overflow_bitmap.data()));
+    }
+}
+
 static void BM_Int128_Div1(benchmark::State& state) {
     for (auto _ : state)
         batch_compute(batch_size, lhs.data(), rhs.data(), result.data(),
@@ -103,6 +183,15 @@ static void BM_Int128_Div2(benchmark::State& state) {
                       [=](int128_t x, int128_t y) { return x * scale * scale / y; });
 }
 
+// x * 100 / y as BM_Int128_Div1, rows are routed to 64/64, 128/64 or
+// 128/128 division and rounded.
+static void BM_Decimal128_Div_Batch(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                decimal128_div(lhs.data(), rhs.data(), result.data(), batch_size, 100, overflow_bitmap.data()));
+    }
+}
+
 static void BM_DorisDecimal_Div(benchmark::State& state) {
     DorisDecimalOp divOp;
     for (auto _ : state)
@@ -138,24 +227,437 @@ static void BM_CKDecimal_NonDecimalDivDecimal_CheckOverflow(benchmark::State& st
                       [&](int128_t x, int128_t y) { return divOp.div<false>(x, y, static_cast<int128_t>(100)); });
 }
 
+// rescaling by a power of ten: __divti3, a divq per 64-bit half
+// (udiv128by64to64) and a precomputed reciprocal(Divider).
+static constexpr int128_t DIV_SCALE = 1000000000ll;
+
+static void BM_Int128_DivConst_Divti3(benchmark::State& state) {
+    volatile int128_t scale = DIV_SCALE;
+    int128_t d = scale;
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch_size; ++i) {
+            result[i] = lhs[i] / d;
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_Int128_DivConst_Udiv128by64to64(benchmark::State& state) {
+    const uint64_t d = DIV_SCALE;
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch_size; ++i) {
+            auto x = lhs[i];
+            int128_t s = x >> 127;
+            uint128_t u = (x ^ s) - s;
+            uint64_t hi = static_cast<uint64_t>(u >> 64);
+            uint64_t r;
+            uint64_t q_hi = hi / d;
+            uint64_t q_lo = DorisDecimalOp::udiv128by64to64(hi % d, static_cast<uint64_t>(u), d, &r);
+            int128_t q = static_cast<int128_t>((static_cast<uint128_t>(q_hi) << 64) | q_lo);
+            result[i] = (q ^ s) - s;
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_Int128_DivConst_Divider(benchmark::State& state) {
+    for (auto _ : state) {
+        divide_column(lhs.data(), result.data(), batch_size, DIV_SCALE);
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_Int64_DivConst_Idiv(benchmark::State& state) {
+    volatile int64_t scale = DIV_SCALE;
+    int64_t d = scale;
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch_size; ++i) {
+            data.result64[i] = data.lhs64[i] / d;
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_Int64_DivConst_Divider(benchmark::State& state) {
+    for (auto _ : state) {
+        divide_column(data.lhs64.data(), data.result64.data(), batch_size, static_cast<int64_t>(DIV_SCALE));
+        benchmark::ClobberMemory();
+    }
+}
+
+// column load/export of decimal(27, 9) texts.
+static constexpr int TEXT_PRECISION = 27;
+static constexpr int TEXT_SCALE = 9;
+static std::vector<uint8_t> text_errors(batch_size);
+
+static BinaryColumn prepare_texts() {
+    BinaryColumn texts;
+    decimal128_format_column(lhs.data(), batch_size, TEXT_PRECISION, TEXT_SCALE, texts, text_errors.data());
+    return texts;
+}
+static BinaryColumn decimal_texts = prepare_texts();
+
+static void BM_Decimal128_Parse_Scalar(benchmark::State& state) {
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch_size; ++i) {
+            auto s = decimal_texts.get_slice(i);
+            text_errors[i] = !decimal_internal::parse_decimal128_scalar(s.data, s.size, TEXT_PRECISION, TEXT_SCALE,
+                                                                        result[i]);
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_Decimal128_Parse_SIMD(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decimal128_parse_column(decimal_texts, TEXT_PRECISION, TEXT_SCALE, result.data(),
+                                                         text_errors.data()));
+    }
+}
+
+static void BM_Decimal128_Format_ToString(benchmark::State& state) {
+    for (auto _ : state) {
+        BinaryColumn texts;
+        for (size_t i = 0; i < batch_size; ++i) {
+            texts.append(to_string(lhs[i], TEXT_PRECISION, TEXT_SCALE));
+        }
+        benchmark::DoNotOptimize(texts.bytes.data());
+    }
+}
+
+static void BM_Decimal128_Format_Batch(benchmark::State& state) {
+    for (auto _ : state) {
+        BinaryColumn texts;
+        decimal128_format_column(lhs.data(), batch_size, TEXT_PRECISION, TEXT_SCALE, texts, text_errors.data());
+        benchmark::DoNotOptimize(texts.bytes.data());
+    }
+}
+
+// SUM over decimal128: a checked add per row against the split accumulators.
+static void BM_CKDecimal_Sum_CheckOverflow(benchmark::State& state) {
+    CKDecimalOp<false, true, true, true> addOp;
+    for (auto _ : state) {
+        int128_t sum = 0;
+        for (size_t i = 0; i < batch_size; ++i) {
+            sum = addOp.add(sum, lhs[i], static_cast<int128_t>(1));
+        }
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+static void BM_Decimal128_Sum_Batch(benchmark::State& state) {
+    for (auto _ : state) {
+        Decimal128SumState sum;
+        decimal128_sum_update(sum, lhs.data(), nullptr, batch_size);
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+static void BM_Decimal128_Sum_Nullable(benchmark::State& state) {
+    std::vector<uint8_t> nulls(batch_size);
+    for (size_t i = 0; i < batch_size; i += 7) {
+        nulls[i] = 1;
+    }
+    for (auto _ : state) {
+        Decimal128SumState sum;
+        decimal128_sum_update(sum, lhs.data(), nulls.data(), batch_size);
+        benchmark::DoNotOptimize(sum);
+    }
+}
+
+static void BM_Decimal128_Sum_Grouped(benchmark::State& state) {
+    std::vector<uint32_t> group_ids(batch_size);
+    std::mt19937 rng(20201219);
+    for (auto& g : group_ids) {
+        g = rng() % state.range(0);
+    }
+    std::vector<Decimal128SumState> sums(state.range(0));
+    for (auto _ : state) {
+        decimal128_sum_update_grouped(sums.data(), group_ids.data(), lhs.data(), nullptr, batch_size);
+        benchmark::ClobberMemory();
+    }
+}
+
+// 64MB of rows, far beyond the caches.
+static void BM_Decimal128_Sum_Memory(benchmark::State& state) {
+    static std::vector<int128_t> rows = [] {
+        std::vector<int128_t> rows(1 << 22);
+        for (size_t i = 0; i < rows.size(); ++i) {
+            rows[i] = lhs[i % batch_size];
+        }
+        return rows;
+    }();
+    for (auto _ : state) {
+        Decimal128SumState sum;
+        decimal128_sum_update(sum, rows.data(), nullptr, rows.size());
+        benchmark::DoNotOptimize(sum);
+    }
+    state.SetBytesProcessed(state.iterations() * rows.size() * sizeof(int128_t));
+}
+
+// decimal128 * decimal128 scaled down by 10^2: a checked int128 product and
+// __divti3 against the 256-bit mul_rescale, whose products of wide operands
+// exceed int128.
+static void BM_Int128_MulRescale_Divti3(benchmark::State& state) {
+    volatile int128_t scale = 100;
+    int128_t d = scale;
+    for (auto _ : state) {
+        for (size_t i = 0; i < batch_size; ++i) {
+            int128_t p;
+            bool ov = __builtin_mul_overflow(lhs[i], rhs[i], &p);
+            int128_t q = p / d;
+            int128_t r = p % d;
+            q += (2 * (r < 0 ? -r : r) >= d) ? (p < 0 ? -1 : 1) : 0;
+            result[i] = ov ? 0 : q;
+        }
+        benchmark::ClobberMemory();
+    }
+}
+
+static void BM_Decimal128_MulRescale_HalfUp(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decimal128_mul_rescale<DecimalRoundingMode::HALF_UP>(
+                lhs.data(), rhs.data(), result.data(), batch_size, 2, overflow_bitmap.data()));
+    }
+}
+
+static void BM_Decimal128_MulRescale_HalfEven(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decimal128_mul_rescale<DecimalRoundingMode::HALF_EVEN>(
+                lhs.data(), rhs.data(), result.data(), batch_size, 2, overflow_bitmap.data()));
+    }
+}
+
+// operands scaled up by 10^25, so the products need about 170 bits and are
+// scaled down by 10^27.
+static void BM_Decimal128_MulRescale_Wide(benchmark::State& state) {
+    static std::vector<int128_t> wide_lhs = [] {
+        std::vector<int128_t> wide(batch_size);
+        int128_t factor = static_cast<int128_t>(10000000000000ll) * 1000000000000ll;
+        for (size_t i = 0; i < batch_size; ++i) {
+            wide[i] = lhs[i] * factor;
+        }
+        return wide;
+    }();
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decimal128_mul_rescale<DecimalRoundingMode::HALF_UP>(
+                wide_lhs.data(), wide_lhs.data(), result.data(), batch_size, 27, overflow_bitmap.data()));
+    }
+}
+
+// ORDER BY a decimal128 column: std::sort of the values, of the row ids,
+// and radix sorts of the normalized keys with the row ids as payload.
+static void BM_Int128_StdSort(benchmark::State& state) {
+    for (auto _ : state) {
+        std::vector<int128_t> values(lhs.begin(), lhs.begin() + batch_size);
+        std::sort(values.begin(), values.end());
+        benchmark::DoNotOptimize(values.data());
+    }
+}
+
+static void BM_Int128_StdSort_RowId(benchmark::State& state) {
+    for (auto _ : state) {
+        std::vector<uint32_t> row_ids(batch_size);
+        for (size_t i = 0; i < batch_size; ++i) {
+            row_ids[i] = i;
+        }
+        std::sort(row_ids.begin(), row_ids.end(), [](uint32_t a, uint32_t b) { return lhs[a] < lhs[b]; });
+        benchmark::DoNotOptimize(row_ids.data());
+    }
+}
+
+template <bool lsd>
+static void radix_sort_int128(benchmark::State& state) {
+    const size_t key_size = sort_key_size<int128_t>();
+    const size_t row_size = key_size + sizeof(uint32_t);
+    for (auto _ : state) {
+        std::vector<uint8_t> rows(batch_size * row_size);
+        encode_sort_key(lhs.data(), batch_size, rows.data(), row_size, 0);
+        encode_row_id(batch_size, rows.data(), row_size, key_size);
+        if constexpr (lsd) {
+            radix_sort_lsd(rows.data(), batch_size, row_size, key_size);
+        } else {
+            radix_sort_msd(rows.data(), batch_size, row_size, key_size);
+        }
+        benchmark::DoNotOptimize(rows.data());
+    }
+}
+
+static void BM_Int128_RadixSort_LSD(benchmark::State& state) {
+    radix_sort_int128<true>(state);
+}
+
+static void BM_Int128_RadixSort_MSD(benchmark::State& state) {
+    radix_sort_int128<false>(state);
+}
+
+// CAST(double AS DECIMAL(27, 9)) of the PrepareData values.
+static std::vector<double> prepare_doubles() {
+    std::vector<double> values(batch_size);
+    for (size_t i = 0; i < batch_size; ++i) {
+        values[i] = static_cast<double>(lhs[i]) / 100;
+    }
+    return values;
+}
+std::vector<double> double_values = prepare_doubles();
+
+static void BM_Double_To_Decimal128_Scalar(benchmark::State& state) {
+    for (auto _ : state) {
+        decimal128_from_float_scalar(double_values.data(), batch_size, 27, 9, result.data(), overflow_bitmap.data());
+        benchmark::DoNotOptimize(result.data());
+    }
+}
+
+static void BM_Double_To_Decimal128_AVX2(benchmark::State& state) {
+    for (auto _ : state) {
+        decimal128_from_double(double_values.data(), batch_size, 27, 9, result.data(), overflow_bitmap.data());
+        benchmark::DoNotOptimize(result.data());
+    }
+}
+
+// rescale by 10^2: the scalar DecimalV3 RESCALE kernel vs the column kernels.
+std::vector<int32_t> decimal32_result(batch_size);
+
+static void BM_DecimalV3_ScaleUp_Decimal64(benchmark::State& state) {
+    using Rescale = DecimalV3Rescale<16, 2, 18, 4>;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                Rescale::compute(data.lhs64.data(), nullptr, data.result64.data(), batch_size, overflow_bitmap.data()));
+    }
+}
+
+static void BM_Decimal64_ScaleUp(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(decimal_scale_up<int64_t, 2>(data.lhs64.data(), data.result64.data(), batch_size, 18,
+                                                              overflow_bitmap.data()));
+    }
+}
+
+static void BM_DecimalV3_ScaleDown_Decimal32(benchmark::State& state) {
+    using Rescale = DecimalV3Rescale<9, 4, 9, 2>;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(Rescale::compute(decimal32_lhs.data(), nullptr, decimal32_result.data(), batch_size,
+                                                  overflow_bitmap.data()));
+    }
+}
+
+static void BM_Decimal32_ScaleDown(benchmark::State& state) {
+    for (auto _ : state) {
+        decimal_scale_down<int32_t, 2>(decimal32_lhs.data(), decimal32_result.data(), batch_size);
+        benchmark::DoNotOptimize(decimal32_result.data());
+    }
+}
+
+static void BM_DecimalV3_ScaleDown_Decimal64(benchmark::State& state) {
+    using Rescale = DecimalV3Rescale<18, 4, 18, 2>;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                Rescale::compute(data.lhs64.data(), nullptr, data.result64.data(), batch_size, overflow_bitmap.data()));
+    }
+}
+
+static void BM_Decimal64_ScaleDown(benchmark::State& state) {
+    for (auto _ : state) {
+        decimal_scale_down<int64_t, 2>(data.lhs64.data(), data.result64.data(), batch_size);
+        benchmark::DoNotOptimize(data.result64.data());
+    }
+}
+
+static void BM_DecimalV3_ScaleUp_Decimal128(benchmark::State& state) {
+    using Rescale = DecimalV3Rescale<36, 2, 38, 4>;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                Rescale::compute(lhs.data(), nullptr, result.data(), batch_size, overflow_bitmap.data()));
+    }
+}
+
+static void BM_Decimal128_ScaleUp(benchmark::State& state) {
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                decimal_scale_up<int128_t, 2>(lhs.data(), result.data(), batch_size, 38, overflow_bitmap.data()));
+    }
+}
+
+static void BM_DecimalV3_ScaleDown_Decimal128(benchmark::State& state) {
+    using Rescale = DecimalV3Rescale<38, 4, 38, 2>;
+    for (auto _ : state) {
+        benchmark::DoNotOptimize(
+                Rescale::compute(lhs.data(), nullptr, result.data(), batch_size, overflow_bitmap.data()));
+    }
+}
+
+static void BM_Decimal128_ScaleDown(benchmark::State& state) {
+    for (auto _ : state) {
+        decimal_scale_down<int128_t, 2>(lhs.data(), result.data(), batch_size);
+        benchmark::DoNotOptimize(result.data());
+    }
+}
+
 BENCHMARK(BM_Int128_Add);
 BENCHMARK(BM_CKDecimal_Add);
 BENCHMARK(BM_CKDecimal_Add_CheckOverflow);
 BENCHMARK(BM_CKDecimal_Add_AdjustScale);
 BENCHMARK(BM_CKDecimal_Add_AdjustScale_CheckOverflow);
 BENCHMARK(BM_DorisDecimal_Add);
+BENCHMARK(BM_Decimal128_Add_AVX2);
+BENCHMARK(BM_Decimal128_Sub_AVX2);
+BENCHMARK(BM_Decimal128_Add_AVX2_Nullable);
 
 BENCHMARK(BM_Int128_Mul);
 BENCHMARK(BM_DorisDecimal_Mul);
 BENCHMARK(BM_CKDecimal_Mul);
 BENCHMARK(BM_CKDecimal_Mul_CheckOverflow);
+BENCHMARK(BM_DecimalV3_Mul_Decimal32_Int128);
+BENCHMARK(BM_DecimalV3_Mul_Decimal32);
+BENCHMARK(BM_DecimalV3_Mul_Decimal32_Resolved);
+BENCHMARK(BM_Int128_MulRescale_Divti3);
+BENCHMARK(BM_Decimal128_MulRescale_HalfUp);
+BENCHMARK(BM_Decimal128_MulRescale_HalfEven);
+BENCHMARK(BM_Decimal128_MulRescale_Wide);
 
 BENCHMARK(BM_Int128_Div1);
 BENCHMARK(BM_Int128_Div2);
+BENCHMARK(BM_Decimal128_Div_Batch);
 BENCHMARK(BM_DorisDecimal_Div);
 BENCHMARK(BM_CKDecimal_DecimalDivDecimal);
 BENCHMARK(BM_CKDecimal_NonDecimalDivDecimal);
 BENCHMARK(BM_CKDecimal_NonDecimalDivDecimal_CheckOverflow);
 BENCHMARK(BM_CKDecimal_DecimalDivDecimal_CheckOverflow);
 
+BENCHMARK(BM_Int128_DivConst_Divti3);
+BENCHMARK(BM_Int128_DivConst_Udiv128by64to64);
+BENCHMARK(BM_Int128_DivConst_Divider);
+BENCHMARK(BM_Int64_DivConst_Idiv);
+BENCHMARK(BM_Int64_DivConst_Divider);
+
+BENCHMARK(BM_Decimal128_Parse_Scalar);
+BENCHMARK(BM_Decimal128_Parse_SIMD);
+BENCHMARK(BM_Decimal128_Format_ToString);
+BENCHMARK(BM_Decimal128_Format_Batch);
+
+BENCHMARK(BM_CKDecimal_Sum_CheckOverflow);
+BENCHMARK(BM_Decimal128_Sum_Batch);
+BENCHMARK(BM_Decimal128_Sum_Nullable);
+BENCHMARK(BM_Decimal128_Sum_Grouped)->Arg(16)->Arg(4096);
+BENCHMARK(BM_Decimal128_Sum_Memory);
+
+BENCHMARK(BM_Int128_StdSort);
+BENCHMARK(BM_Int128_StdSort_RowId);
+BENCHMARK(BM_Int128_RadixSort_LSD);
+BENCHMARK(BM_Int128_RadixSort_MSD);
+
+BENCHMARK(BM_Double_To_Decimal128_Scalar);
+BENCHMARK(BM_Double_To_Decimal128_AVX2);
+
+BENCHMARK(BM_DecimalV3_ScaleUp_Decimal64);
+BENCHMARK(BM_Decimal64_ScaleUp);
+BENCHMARK(BM_DecimalV3_ScaleDown_Decimal32);
+BENCHMARK(BM_Decimal32_ScaleDown);
+BENCHMARK(BM_DecimalV3_ScaleDown_Decimal64);
+BENCHMARK(BM_Decimal64_ScaleDown);
+BENCHMARK(BM_DecimalV3_ScaleUp_Decimal128);
+BENCHMARK(BM_Decimal128_ScaleUp);
+BENCHMARK(BM_DecimalV3_ScaleDown_Decimal128);
+BENCHMARK(BM_Decimal128_ScaleDown);
+
 BENCHMARK_MAIN();
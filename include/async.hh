@@ -8,27 +8,277 @@
 //
 
 #pragma once
+#include <concurrent/epoch.hh>
+#include <concurrent/list.hh>
+#include <concurrent/mark_ptr_type.hh>
+
+#include <algorithm>
 #include <atomic>
 #include <optional>
+#include <vector>
 namespace async {
+namespace detail {
+using com::grakra::concurrent::MarkPtrType;
+
+template <typename T>
+struct LinkedNode {
+    MarkPtrType next;
+    std::optional<T> value;
+};
+
+static inline MarkPtrType load_mark_ptr(std::atomic<void*> const& p,
+                                        std::memory_order order = std::memory_order_acquire) {
+    MarkPtrType snap;
+    snap.ptr = p.load(order);
+    return snap;
+}
+
+static inline MarkPtrType load_mark_ptr(MarkPtrType& p, std::memory_order order = std::memory_order_acquire) {
+    MarkPtrType snap;
+    snap.ptr = atomic_ptr(p.ptr)->load(order);
+    return snap;
+}
+
+// process-wide free list of LinkedNode<T>, nodes are never given back to
+// malloc, so a stale pointer read by a losing CAS always points to a node.
+// the head is a MarkPtrType whose tag is bumped by every pop and push, so a
+// node popped and pushed back between the read and the CAS of a pop does not
+// fool the CAS(ABA).
+template <typename T>
+class NodeFreeList {
+public:
+    using Node = LinkedNode<T>;
+
+    static NodeFreeList& instance() {
+        // leaked on purpose, EpochManager may recycle nodes into it during
+        // static destruction.
+        static auto* free_list = new NodeFreeList();
+        return *free_list;
+    }
+
+    Node* get() {
+        auto head_snap = load_mark_ptr(head);
+        while (true) {
+            auto node = static_cast<Node*>(head_snap.get());
+            if (node == nullptr) {
+                return new Node();
+            }
+            auto next_snap = load_mark_ptr(node->next, std::memory_order_relaxed);
+            auto head_new = MarkPtrType(next_snap.get(), 0, head_snap.get_tag() + 1);
+            if (head.compare_exchange_weak(head_snap.ptr, head_new.ptr, std::memory_order_acquire)) {
+                return node;
+            }
+        }
+    }
+
+    void put(Node* node) {
+        auto head_snap = load_mark_ptr(head, std::memory_order_relaxed);
+        while (true) {
+            atomic_ptr(node->next.ptr)->store(MarkPtrType(head_snap.get(), 0, 0).ptr, std::memory_order_relaxed);
+            auto head_new = MarkPtrType(node, 0, head_snap.get_tag() + 1);
+            if (head.compare_exchange_weak(head_snap.ptr, head_new.ptr, std::memory_order_release)) {
+                return;
+            }
+        }
+    }
+
+    // RetireFunc of EpochManager, the node is recycled once no thread can
+    // observe it.
+    static void recycle(void* node) { instance().put(static_cast<Node*>(node)); }
+    static void retire(Node* node) {
+        com::grakra::concurrent::EpochManager::instance().retire(node, &NodeFreeList::recycle);
+    }
+
+private:
+    NodeFreeList() : head(nullptr) {}
+    std::atomic<void*> head;
+};
+} // namespace detail
+
+// Treiber stack. popped nodes are retired into EpochManager before they are
+// recycled into NodeFreeList, so a concurrent pop never reads the next field
+// of a reused node; the tag of head guards the CAS against ABA all the same.
 template <typename T>
 class ConcurrentLinkedList {
-    struct Node {
-        std::atomic<Node*> next;
-        T value;
-    };
+    using Node = detail::LinkedNode<T>;
+    using FreeList = detail::NodeFreeList<T>;
+    using MarkPtrType = com::grakra::concurrent::MarkPtrType;
 
 public:
-    void add(const T& t) {
-        auto* node = new Node{.next = head.next, .value = t};
-        auto* old_head = head.next;
-        while (!head.next.compare_exchange_strong(old_head, node)) {
-            node->next = head.next;
+    ConcurrentLinkedList() : head(nullptr) {}
+    ~ConcurrentLinkedList() {
+        auto node = static_cast<Node*>(detail::load_mark_ptr(head).get());
+        while (node != nullptr) {
+            auto next = static_cast<Node*>(node->next.get());
+            node->value.reset();
+            FreeList::instance().put(node);
+            node = next;
         }
     }
 
+    void add(const T& t) { push(t); }
+
+    void push(T t) {
+        auto node = FreeList::instance().get();
+        node->value.emplace(std::move(t));
+        auto head_snap = detail::load_mark_ptr(head, std::memory_order_relaxed);
+        while (true) {
+            atomic_ptr(node->next.ptr)->store(MarkPtrType(head_snap.get(), 0, 0).ptr, std::memory_order_relaxed);
+            auto head_new = MarkPtrType(node, 0, head_snap.get_tag() + 1);
+            if (head.compare_exchange_weak(head_snap.ptr, head_new.ptr, std::memory_order_release)) {
+                return;
+            }
+        }
+    }
+
+    std::optional<T> pop() {
+        com::grakra::concurrent::EpochGuard guard;
+        auto head_snap = detail::load_mark_ptr(head);
+        while (true) {
+            auto node = static_cast<Node*>(head_snap.get());
+            if (node == nullptr) {
+                return std::nullopt;
+            }
+            auto next_snap = detail::load_mark_ptr(node->next, std::memory_order_relaxed);
+            auto head_new = MarkPtrType(next_snap.get(), 0, head_snap.get_tag() + 1);
+            if (head.compare_exchange_weak(head_snap.ptr, head_new.ptr, std::memory_order_acquire)) {
+                auto value = std::move(node->value);
+                node->value.reset();
+                FreeList::retire(node);
+                return value;
+            }
+        }
+    }
+
+    // detach all the items with one exchange, they are returned in the order
+    // they are pushed.
+    std::vector<T> pop_all() {
+        com::grakra::concurrent::EpochGuard guard;
+        auto head_snap = detail::load_mark_ptr(head, std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(head_snap.ptr, MarkPtrType(nullptr, 0, head_snap.get_tag() + 1).ptr,
+                                           std::memory_order_acquire)) {
+        }
+        std::vector<T> values;
+        auto node = static_cast<Node*>(head_snap.get());
+        while (node != nullptr) {
+            auto next = static_cast<Node*>(node->next.get());
+            values.push_back(std::move(*node->value));
+            node->value.reset();
+            // concurrent pops may still be reading the detached nodes.
+            FreeList::retire(node);
+            node = next;
+        }
+        std::reverse(values.begin(), values.end());
+        return values;
+    }
+
+    bool empty() const { return detail::load_mark_ptr(head).get() == nullptr; }
+
 private:
-    Node head;
+    ConcurrentLinkedList(ConcurrentLinkedList const&) = delete;
+    ConcurrentLinkedList& operator=(ConcurrentLinkedList const&) = delete;
+    std::atomic<void*> head;
 };
 
-} // namespace async
\ No newline at end of file
+// Michael-Scott queue. head points to a dummy node whose successor holds the
+// front item; the dequeuer that swings head owns the value of the new dummy
+// and retires the old one. head, tail and the next fields are MarkPtrTypes
+// whose tags are bumped by every CAS, nodes are recycled like
+// ConcurrentLinkedList.
+template <typename T>
+class ConcurrentQueue {
+    using Node = detail::LinkedNode<T>;
+    using FreeList = detail::NodeFreeList<T>;
+    using MarkPtrType = com::grakra::concurrent::MarkPtrType;
+
+public:
+    ConcurrentQueue() {
+        auto dummy = new_node();
+        head.store(MarkPtrType(dummy).ptr, std::memory_order_relaxed);
+        tail.store(MarkPtrType(dummy).ptr, std::memory_order_relaxed);
+    }
+    ~ConcurrentQueue() {
+        auto node = static_cast<Node*>(detail::load_mark_ptr(head).get());
+        while (node != nullptr) {
+            auto next = static_cast<Node*>(node->next.get());
+            node->value.reset();
+            FreeList::instance().put(node);
+            node = next;
+        }
+    }
+
+    void enqueue(T t) {
+        auto node = new_node();
+        node->value.emplace(std::move(t));
+        com::grakra::concurrent::EpochGuard guard;
+        while (true) {
+            auto tail_snap = detail::load_mark_ptr(tail);
+            auto last = static_cast<Node*>(tail_snap.get());
+            auto next_snap = detail::load_mark_ptr(last->next);
+            if (!detail::load_mark_ptr(tail).equal_to(tail_snap)) {
+                continue;
+            }
+            if (next_snap.get() != nullptr) {
+                // help the lagging tail forward.
+                advance(tail, tail_snap, static_cast<Node*>(next_snap.get()));
+                continue;
+            }
+            auto next_new = MarkPtrType(node, 0, next_snap.get_tag() + 1);
+            if (atomic_ptr(last->next.ptr)
+                        ->compare_exchange_strong(next_snap.ptr, next_new.ptr, std::memory_order_release)) {
+                advance(tail, tail_snap, node);
+                return;
+            }
+        }
+    }
+
+    std::optional<T> dequeue() {
+        com::grakra::concurrent::EpochGuard guard;
+        while (true) {
+            auto head_snap = detail::load_mark_ptr(head);
+            auto tail_snap = detail::load_mark_ptr(tail);
+            auto dummy = static_cast<Node*>(head_snap.get());
+            auto next_snap = detail::load_mark_ptr(dummy->next);
+            if (!detail::load_mark_ptr(head).equal_to(head_snap)) {
+                continue;
+            }
+            auto next = static_cast<Node*>(next_snap.get());
+            if (next == nullptr) {
+                return std::nullopt;
+            }
+            if (dummy == tail_snap.get()) {
+                advance(tail, tail_snap, next);
+                continue;
+            }
+            if (advance(head, head_snap, next)) {
+                auto value = std::move(next->value);
+                next->value.reset();
+                FreeList::retire(dummy);
+                return value;
+            }
+        }
+    }
+
+    bool empty() {
+        com::grakra::concurrent::EpochGuard guard;
+        auto dummy = static_cast<Node*>(detail::load_mark_ptr(head).get());
+        return detail::load_mark_ptr(dummy->next).get() == nullptr;
+    }
+
+private:
+    ConcurrentQueue(ConcurrentQueue const&) = delete;
+    ConcurrentQueue& operator=(ConcurrentQueue const&) = delete;
+    static Node* new_node() {
+        auto node = FreeList::instance().get();
+        atomic_ptr(node->next.ptr)->store(nullptr, std::memory_order_relaxed);
+        return node;
+    }
+    static bool advance(std::atomic<void*>& cursor, MarkPtrType snap, Node* node) {
+        auto cursor_new = MarkPtrType(node, 0, snap.get_tag() + 1);
+        return cursor.compare_exchange_strong(snap.ptr, cursor_new.ptr, std::memory_order_acq_rel);
+    }
+
+    alignas(64) std::atomic<void*> head;
+    alignas(64) std::atomic<void*> tail;
+};
+} // namespace async
@@ -0,0 +1,126 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/22.
+//
+
+#ifndef CPP_ETUDES_CHASE_LEV_DEQUE_HH
+#define CPP_ETUDES_CHASE_LEV_DEQUE_HH
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <optional>
+#include <type_traits>
+#include <vector>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// work-stealing deque(Chase & Lev, with the C11 orderings of Le et al.), the
+// owner pushes and takes at bottom, thieves steal at top. the circular array
+// doubles when full, retired arrays are kept until the deque is destructed
+// since thieves may still read them.
+template <typename T>
+class ChaseLevDeque {
+    static_assert(std::is_trivially_copyable_v<T>, "T must be trivially copyable");
+
+    struct Array {
+        const int64_t capacity;
+        std::unique_ptr<std::atomic<T>[]> items;
+        explicit Array(int64_t capacity) : capacity(capacity), items(new std::atomic<T>[capacity]) {}
+        T get(int64_t i) { return items[i & (capacity - 1)].load(std::memory_order_relaxed); }
+        void put(int64_t i, T x) { items[i & (capacity - 1)].store(x, std::memory_order_relaxed); }
+    };
+
+    std::atomic<int64_t> top;
+    std::atomic<int64_t> bottom;
+    std::atomic<Array*> array;
+    std::vector<std::unique_ptr<Array>> arrays;
+
+public:
+    // capacity must be power of 2.
+    explicit ChaseLevDeque(int64_t capacity = 1024) : top(0), bottom(0) {
+        arrays.emplace_back(new Array(capacity));
+        array.store(arrays.back().get(), std::memory_order_relaxed);
+    }
+
+    // only called by the owner.
+    void Push(T x) {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_acquire);
+        auto a = array.load(std::memory_order_relaxed);
+        if (b - t > a->capacity - 1) {
+            a = grow(a, t, b);
+        }
+        a->put(b, x);
+        std::atomic_thread_fence(std::memory_order_release);
+        bottom.store(b + 1, std::memory_order_relaxed);
+    }
+
+    // only called by the owner, LIFO.
+    std::optional<T> Take() {
+        auto b = bottom.load(std::memory_order_relaxed) - 1;
+        auto a = array.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto t = top.load(std::memory_order_relaxed);
+        if (t > b) {
+            bottom.store(b + 1, std::memory_order_relaxed);
+            return std::nullopt;
+        }
+        auto x = a->get(b);
+        if (t == b) {
+            // the last item, race with thieves.
+            auto won = top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed);
+            bottom.store(b + 1, std::memory_order_relaxed);
+            if (!won) {
+                return std::nullopt;
+            }
+        }
+        return x;
+    }
+
+    // called by thieves, FIFO. return nullopt if empty or lose the race.
+    std::optional<T> Steal() {
+        auto t = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = bottom.load(std::memory_order_acquire);
+        if (t >= b) {
+            return std::nullopt;
+        }
+        auto a = array.load(std::memory_order_acquire);
+        auto x = a->get(t);
+        if (!top.compare_exchange_strong(t, t + 1, std::memory_order_seq_cst, std::memory_order_relaxed)) {
+            return std::nullopt;
+        }
+        return x;
+    }
+
+    // may be stale once returned.
+    bool Empty() {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto t = top.load(std::memory_order_relaxed);
+        return b <= t;
+    }
+
+private:
+    ChaseLevDeque(ChaseLevDeque const&) = delete;
+    ChaseLevDeque& operator=(ChaseLevDeque const&) = delete;
+    Array* grow(Array* a, int64_t t, int64_t b) {
+        auto new_a = new Array(a->capacity << 1);
+        for (auto i = t; i < b; ++i) {
+            new_a->put(i, a->get(i));
+        }
+        arrays.emplace_back(new_a);
+        array.store(new_a, std::memory_order_release);
+        return new_a;
+    }
+};
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_CHASE_LEV_DEQUE_HH
@@ -0,0 +1,91 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/10.
+//
+
+#ifndef CPP_ETUDES_EPOCH_HH
+#define CPP_ETUDES_EPOCH_HH
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <utility>
+#include <vector>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// epoch-based reclamation(EBR): a thread announces the global epoch when it
+// enters a critical region, unlinked nodes are retired into the limbo list of
+// the epoch in which they are retired, and the limbo list of epoch e is freed
+// only after the global epoch reaches e+2, i.e. all the threads that could
+// observe the retired nodes have left their critical regions.
+using RetireFunc = void (*)(void*);
+
+class EpochManager {
+public:
+    static constexpr size_t EPOCH_NR = 3;
+    static constexpr size_t ADVANCE_INTERVAL = 64;
+
+    static EpochManager& instance();
+
+    void enter();
+    void exit();
+    void retire(void* ptr, RetireFunc func);
+    // try to advance the global epoch and free the limbo lists of current thread
+    // that become safe, return true if the global epoch is advanced.
+    bool try_advance();
+    uint64_t get_global_epoch() { return this->global_epoch.load(std::memory_order_acquire); }
+    // number of nodes retired by current thread but not freed yet.
+    size_t get_pending_nr();
+
+private:
+    struct alignas(64) ThreadRecord {
+        // (epoch << 1) | active
+        std::atomic<uint64_t> epoch{0};
+        std::atomic<bool> in_use{false};
+        ThreadRecord* next{nullptr};
+        uint32_t nesting{0};
+        uint32_t retire_nr{0};
+        uint64_t limbo_epochs[EPOCH_NR]{0, 0, 0};
+        std::vector<std::pair<void*, RetireFunc>> limbo[EPOCH_NR];
+    };
+    struct ThreadRecordHolder {
+        ThreadRecord* record{nullptr};
+        ~ThreadRecordHolder();
+    };
+
+    EpochManager() : global_epoch(EPOCH_NR), records(nullptr) {}
+    EpochManager(EpochManager const&) = delete;
+    EpochManager& operator=(EpochManager const&) = delete;
+    ThreadRecord* get_record();
+    ThreadRecord* acquire_record();
+    void reclaim(ThreadRecord* record, uint64_t epoch);
+    static void free_limbo(std::vector<std::pair<void*, RetireFunc>>& limbo);
+
+    std::atomic<uint64_t> global_epoch;
+    std::atomic<ThreadRecord*> records;
+    static thread_local ThreadRecordHolder holder;
+};
+
+class EpochGuard {
+public:
+    EpochGuard() { EpochManager::instance().enter(); }
+    ~EpochGuard() { EpochManager::instance().exit(); }
+
+private:
+    EpochGuard(EpochGuard const&) = delete;
+    EpochGuard& operator=(EpochGuard const&) = delete;
+};
+
+template <typename T>
+void retire_object(T* ptr) {
+    EpochManager::instance().retire(ptr, [](void* p) { delete static_cast<T*>(p); });
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_EPOCH_HH
@@ -0,0 +1,81 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/11/9.
+//
+
+#ifndef CPP_ETUDES_EVENT_COUNT_HH
+#define CPP_ETUDES_EVENT_COUNT_HH
+#include <atomic>
+#include <cstdint>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// condition variable for lock-free data structures(like folly::EventCount):
+//
+//   if (!try_pop(v)) {
+//       auto key = ec.prepare_wait();
+//       if (try_pop(v)) { ec.cancel_wait(); } else { ec.wait(key); }
+//   }
+//
+// a producer calls notify/notify_all after publishing. the low half of state
+// counts the waiters and the high half is the epoch bumped by notifications,
+// wait parks on a folly::ParkingLot only while the epoch equals key, so a
+// notification between prepare_wait and wait is never lost; notify is a fence
+// and a load when nobody waits.
+class EventCount {
+public:
+    struct Key {
+        uint32_t epoch;
+    };
+
+    EventCount() : state(0) {}
+
+    Key prepare_wait() { return Key{uint32_t(state.fetch_add(WAITER, std::memory_order_seq_cst) >> EPOCH_SHIFT)}; }
+    void cancel_wait() { state.fetch_sub(WAITER, std::memory_order_seq_cst); }
+    void wait(Key key);
+
+    void notify() { do_notify(false); }
+    void notify_all() { do_notify(true); }
+
+    // block until ready() returns true, ready must be thread-safe.
+    template <typename Pred>
+    void await(Pred&& ready) {
+        while (!ready()) {
+            auto key = prepare_wait();
+            if (ready()) {
+                cancel_wait();
+                return;
+            }
+            wait(key);
+        }
+    }
+
+private:
+    static constexpr uint64_t WAITER = 1;
+    static constexpr uint64_t WAITER_MASK = 0xffff'ffffull;
+    static constexpr int EPOCH_SHIFT = 32;
+    static constexpr uint64_t EPOCH = uint64_t(1) << EPOCH_SHIFT;
+
+    EventCount(EventCount const&) = delete;
+    EventCount& operator=(EventCount const&) = delete;
+    void do_notify(bool all) {
+        // pairs with prepare_wait, either the waiter sees the published state
+        // or we see the waiter.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if ((state.load(std::memory_order_relaxed) & WAITER_MASK) != 0) {
+            wake(all);
+        }
+    }
+    void wake(bool all);
+
+    std::atomic<uint64_t> state;
+};
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_EVENT_COUNT_HH
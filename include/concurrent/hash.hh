@@ -9,10 +9,16 @@
 
 #ifndef CPP_ETUDES_HASH_HH
 #define CPP_ETUDES_HASH_HH
+#include <algorithm>
 #include <cassert>
-#include <concurrent/list.hh>
+#include <concurrent/epoch.hh>
+#include <concurrent/hash_key.hh>
+#include <concurrent/sharded_counter.hh>
+#include <concurrent/split_ordered_list.hh>
 #include <cstring>
+#include <functional>
 #include <memory>
+#include <type_traits>
 #include <util/bits_op.hh>
 #include <vector>
 namespace com {
@@ -20,54 +26,478 @@ namespace grakra {
 namespace concurrent {
 
 #define LOG2(n) __builtin_ctzll(n)
-#define CLEAR_MSB(n) ((n) & (((typeof(n))1) << (sizeof(n) - 1 - __builtin_clz(n))))
-#define PARENT_SLOT(n) CLEAR_MSB(n)
 
 constexpr size_t SLOT_INDEX_SHIFT = 12 - LOG2(sizeof(void*));
 constexpr size_t SLOT_INDEX_NR = 1 << SLOT_INDEX_SHIFT;
 constexpr size_t SLOT_INDEX_MASK = SLOT_INDEX_NR - 1;
-constexpr size_t HASH_SIZE_LIMIT = UINT32_MAX >> 1;
-constexpr size_t HASH_KEY_LIMIT = HASH_SIZE_LIMIT;
+constexpr size_t HASH_SIZE_LIMIT = SIZE_MAX >> 1;
+constexpr size_t HASH_MIN_SLOT_NR = 2;
+// slot_nr is halved when size < slot_nr * load_factor / HASH_SHRINK_RATIO
+constexpr size_t HASH_SHRINK_RATIO = 4;
+// number of searches interleaved by GetBatch/PutBatch, the cache misses of one
+// search are overlapped with the misses of the others.
+constexpr size_t HASH_BATCH_SIZE = 16;
+// every Put and Remove updates size, so it is sharded; a stripe is folded into
+// the total of size every HASH_SIZE_BATCH updates.
+constexpr int64_t HASH_SIZE_BATCH = 64;
 
 struct alignas(4096) SlotArray {
     void* slots[SLOT_INDEX_NR];
 };
 
+size_t calc_level_nr(size_t expect_max_size);
+void free_slot_arrays(SlotArray* head, size_t level_nr);
+void** get_slot(SlotArray* head, size_t level_nr, size_t slot_i, bool create_if_not_exists);
+
+// number of slots addressable by a directory of level_nr levels
+static inline size_t slot_capacity(size_t level_nr) {
+    return level_nr * SLOT_INDEX_SHIFT >= sizeof(size_t) * 8 ? SIZE_MAX : size_t(1) << (level_nr * SLOT_INDEX_SHIFT);
+}
+
+// the directory of SlotArrays grows by putting a new SlotArray on top whose
+// slot#0 is the old root, so slot indices addressable by the old root keep
+// the same path and readers holding the old root are still correct. the root
+// and its level_nr are packed into a MarkPtrType(tag=level_nr), so they are
+// replaced atomically.
+class SlotDirectory {
+    std::atomic<void*> root;
+
+public:
+    explicit SlotDirectory(size_t level_nr);
+    ~SlotDirectory();
+    size_t get_level_nr() { return snapshot().get_tag(); }
+    size_t get_capacity() { return slot_capacity(get_level_nr()); }
+    void** get_slot(size_t slot_i, bool create_if_not_exists) {
+        auto root_snap = snapshot();
+        return concurrent::get_slot((SlotArray*)root_snap.get(), root_snap.get_tag(), slot_i, create_if_not_exists);
+    }
+    // add levels on top until slot_i is addressable.
+    void ensure_capacity(size_t slot_i);
+
+private:
+    SlotDirectory(SlotDirectory const&) = delete;
+    SlotDirectory& operator=(SlotDirectory const&) = delete;
+    MarkPtrType snapshot() {
+        MarkPtrType root_snap;
+        root_snap.ptr = root.load(std::memory_order_acquire);
+        return root_snap;
+    }
+};
+
+// parent slot is the slot with the most significant bit cleared.
+static inline size_t parent_slot(size_t slot_i) {
+    return slot_i & ~(size_t(1) << (sizeof(size_t) * 8 - 1 - __builtin_clzll(slot_i)));
+}
+
+static inline uint64_t dummy_key(size_t slot_i) {
+    return com::grakra::util::reverse_bits64(slot_i);
+}
+
+static inline uint64_t regular_key(uint64_t hash) {
+    return com::grakra::util::reverse_bits64(hash) | 0x1;
+}
+
+// lock-free split-ordered hash(Shalev & Shavit), keys and values must be
+// trivially copyable, values are read and written atomically. expect_max_size
+// is only a hint of the initial directory depth, slot_nr keeps doubling while
+// size / slot_nr > load_factor.
+template <typename K = uint32_t, typename V = uint32_t, typename HashFn = HashKeyFn<K>, typename Eq = std::equal_to<K>>
 class Hash {
-    SlotArray* head;
-    MichaelList list;
-    std::atomic<uint32_t> size;
+    static_assert(std::is_trivially_copyable_v<K>, "K must be trivially copyable");
+    static_assert(std::is_trivially_copyable_v<V> && sizeof(V) <= sizeof(uint64_t), "V must be atomic accessible");
+
+public:
+    using List = SplitOrderedList<K, V, Eq>;
+    using NodeType = typename List::Node;
+
+private:
+    SlotDirectory directory;
+    typename List::Pool pool;
+    List list;
+    ShardedCounter<int64_t> size;
     std::atomic<size_t> slot_nr;
     const size_t expect_max_size;
-    const size_t level_nr;
     const size_t load_factor;
-    const size_t max_slot_nr;
+    HashFn hash_fn;
 
 public:
     Hash(size_t expect_max_size, size_t load_factor);
-    ~Hash();
-    MichaelList& get_list() { return this->list; }
+    List& get_list() { return this->list; }
     size_t get_expect_max_size() { return this->expect_max_size; }
-    size_t get_level_nr() { return this->level_nr; }
+    size_t get_level_nr() { return this->directory.get_level_nr(); }
     size_t get_load_factor() { return this->load_factor; }
-    size_t get_max_slot_nr() { return this->max_slot_nr; }
-    uint32_t get_slot_nr() { return this->slot_nr.load(std::memory_order_relaxed); }
-    size_t get_size() { return this->size.load(std::memory_order_relaxed); }
+    size_t get_max_slot_nr() { return this->directory.get_capacity(); }
+    size_t get_slot_nr() { return this->slot_nr.load(std::memory_order_relaxed); }
+    size_t get_size() { return this->size.read_exact(); }
 
-    bool Put(uint32_t key, uint32_t value);
-    bool Get(uint32_t key, uint32_t& value);
+    bool Put(K const& key, V value);
+    bool Get(K const& key, V& value);
+    bool Remove(K const& key);
+    // insert key or overwrite the value of the existing key, return true if
+    // key is inserted.
+    bool Upsert(K const& key, V value);
+    // return true and set the value to desired iff key exists and its value is
+    // expected, otherwise return false and expected is set to the current value
+    // if key exists.
+    bool CompareAndSwap(K const& key, V& expected, V desired);
+    // return true if key is inserted, actual_value is set to the value in hash
+    // after the operation.
+    bool GetOrInsert(K const& key, V value, V& actual_value);
+    // batched Get, found[i] tells whether keys[i] exists, values[i] is set
+    // only if it does. return the number of keys found.
+    size_t GetBatch(K const* keys, size_t n, V* values, bool* found);
+    // batched Put, return the number of keys inserted.
+    size_t PutBatch(K const* keys, V const* values, size_t n);
 
 private:
     Hash(Hash const&) = delete;
     Hash& operator=(Hash const&) = delete;
-    uint32_t get_slot_idx(uint32_t key);
-    MarkPtrType** get_slot(size_t slot_i, bool create_if_not_exists);
-    MarkPtrType** get_or_create_slot(size_t slot_i) { return get_slot(slot_i, true); }
-    MarkPtrType** get_slot_if_exists(size_t slot_i) { return get_slot(slot_i, false); }
-    void free_slots();
+    size_t get_slot_idx(uint64_t hash) { return hash & (slot_nr.load(std::memory_order_acquire) - 1); }
+    MarkPtrType** get_or_create_slot(size_t slot_i) { return (MarkPtrType**)directory.get_slot(slot_i, true); }
+    MarkPtrType** get_slot_if_exists(size_t slot_i) { return (MarkPtrType**)directory.get_slot(slot_i, false); }
     void maybe_resize();
-    MarkPtrType* ensure_slot_exists(uint32_t slot_i);
+    void maybe_shrink();
+    MarkPtrType* ensure_slot_exists(size_t slot_i);
+    MarkPtrType* get_nearest_slot(size_t slot_i);
+    // resolve slot heads of m <= HASH_BATCH_SIZE hashes, the slot and the
+    // dummy node of each head are prefetched one stage ahead of their use.
+    template <bool create_if_not_exists>
+    void get_heads(uint64_t const* hashes, size_t m, MarkPtrType** heads);
+    // interleave the searches of m <= HASH_BATCH_SIZE keys, nodes[i] is set to
+    // the live node of keys[i] or nullptr. only safe to call inside an
+    // EpochGuard.
+    void find_batch(K const* keys, uint64_t const* hashes, MarkPtrType* const* heads, size_t m, NodeType** nodes);
+    static std::atomic<V>* atomic_value(NodeType* node) { return reinterpret_cast<std::atomic<V>*>(&node->value); }
+    static bool is_removed(NodeType* node) {
+        MarkPtrType next;
+        next.ptr = atomic_ptr(node->next.ptr)->load(std::memory_order_acquire);
+        return next.is_mark_delete();
+    }
 };
+
+template <typename K, typename V, typename HashFn, typename Eq>
+Hash<K, V, HashFn, Eq>::Hash(size_t expect_max_size, size_t load_factor)
+        : directory(calc_level_nr((expect_max_size + load_factor - 1) / load_factor)),
+          list(pool),
+          size(HASH_SIZE_BATCH),
+          slot_nr(HASH_MIN_SLOT_NR),
+          expect_max_size(expect_max_size),
+          load_factor(load_factor) {
+    assert(0 < expect_max_size && expect_max_size < HASH_SIZE_LIMIT);
+    assert(0 < load_factor && load_factor <= expect_max_size);
+    // initialize slot#0
+    auto slot_ptr = get_or_create_slot(0);
+    auto node = pool.Allocate(dummy_key(0), K(), V());
+    list.Insert(list.get_head(), node);
+    *slot_ptr = &node->next;
+}
+
+// resizes are decided by the approximate size, one load per write. it lags
+// the exact size by less than size.get_max_error(), which only delays a
+// resize; slot_nr doubles at size >= (load_factor + 1) * slot_nr and halves
+// at size < slot_nr * load_factor / HASH_SHRINK_RATIO, so the thresholds of
+// a doubling and of the halving back are apart by a factor of at least 2
+// and the approximation can not make slot_nr flap.
+template <typename K, typename V, typename HashFn, typename Eq>
+void Hash<K, V, HashFn, Eq>::maybe_resize() {
+    auto slot_nr_snap = this->slot_nr.load(std::memory_order_relaxed);
+    if ((slot_nr_snap << 1) >= HASH_SIZE_LIMIT) {
+        return;
+    }
+    auto size_snap = std::max<int64_t>(this->size.read_approx(), 0);
+    if (size_t(size_snap) / slot_nr_snap > load_factor) {
+        // the directory must address the new slots before they are visible.
+        directory.ensure_capacity((slot_nr_snap << 1) - 1);
+        slot_nr.compare_exchange_strong(slot_nr_snap, slot_nr_snap << 1, std::memory_order_acq_rel);
+    }
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+void Hash<K, V, HashFn, Eq>::maybe_shrink() {
+    auto slot_nr_snap = this->slot_nr.load(std::memory_order_relaxed);
+    if (slot_nr_snap <= HASH_MIN_SLOT_NR) {
+        return;
+    }
+    auto size_snap = std::max<int64_t>(this->size.read_approx(), 0);
+    // dummy nodes of the vanished slots stay in the list, keys of them are
+    // re-routed to their parent slots, so halving slot_nr needs no rehashing.
+    if (size_t(size_snap) * HASH_SHRINK_RATIO < slot_nr_snap * load_factor) {
+        slot_nr.compare_exchange_strong(slot_nr_snap, slot_nr_snap >> 1, std::memory_order_acq_rel);
+    }
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+MarkPtrType* Hash<K, V, HashFn, Eq>::ensure_slot_exists(size_t slot_i) {
+    auto slot_ptr = get_or_create_slot(slot_i);
+    if (__builtin_expect(*slot_ptr != nullptr, 1)) {
+        return *slot_ptr;
+    }
+
+    size_t missing_slot_indices[sizeof(size_t) * 8];
+    ssize_t msi_i = 0;
+    missing_slot_indices[msi_i++] = slot_i;
+    auto parent_slot_i = parent_slot(slot_i);
+    auto parent_slot_ptr = get_or_create_slot(parent_slot_i);
+    while (*parent_slot_ptr == nullptr) {
+        missing_slot_indices[msi_i++] = parent_slot_i;
+        parent_slot_i = parent_slot(parent_slot_i);
+        parent_slot_ptr = get_or_create_slot(parent_slot_i);
+    }
+
+    // dummy node of a slot always follows the dummy node of its parent slot, so
+    // insert it from the parent slot instead of the list head.
+    auto parent_head = *parent_slot_ptr;
+    for (--msi_i; msi_i >= 0; --msi_i) {
+        auto missing_slot_i = missing_slot_indices[msi_i];
+        auto dummy_node = pool.Allocate(dummy_key(missing_slot_i), K(), V());
+        NodeType* exist_node;
+        if (!this->list.Insert(parent_head, dummy_node, &exist_node)) {
+            // dummy nodes are never removed, so exist_node is always valid.
+            pool.Free(dummy_node);
+            dummy_node = exist_node;
+        }
+        auto missing_slot_ptr = get_or_create_slot(missing_slot_i);
+        *missing_slot_ptr = &dummy_node->next;
+        parent_head = &dummy_node->next;
+    }
+    return *slot_ptr;
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+MarkPtrType* Hash<K, V, HashFn, Eq>::get_nearest_slot(size_t slot_i) {
+    while (true) {
+        auto slot_head = get_slot_if_exists(slot_i);
+        if (__builtin_expect(slot_head != nullptr && *slot_head != nullptr, 1)) {
+            return *slot_head;
+        }
+        slot_i = parent_slot(slot_i);
+    }
+    // never reach here
+    return nullptr;
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+bool Hash<K, V, HashFn, Eq>::Put(K const& key, V value) {
+    auto hash = hash_fn(key);
+    auto so_key = regular_key(hash);
+    maybe_resize();
+    auto head = ensure_slot_exists(get_slot_idx(hash));
+    {
+        // probe before allocating, most of the duplicated keys never touch the pool.
+        EpochGuard guard;
+        if (list.Find(head, so_key, key) != nullptr) {
+            return false;
+        }
+    }
+    auto node = pool.Allocate(so_key, key, value);
+    if (!list.Insert(head, node)) {
+        pool.Free(node);
+        return false;
+    } else {
+        this->size.add(1);
+        return true;
+    }
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+bool Hash<K, V, HashFn, Eq>::Get(K const& key, V& value) {
+    auto hash = hash_fn(key);
+    return list.Search(get_nearest_slot(get_slot_idx(hash)), regular_key(hash), key, value);
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+bool Hash<K, V, HashFn, Eq>::Remove(K const& key) {
+    auto hash = hash_fn(key);
+    if (!list.Remove(get_nearest_slot(get_slot_idx(hash)), regular_key(hash), key)) {
+        return false;
+    }
+    this->size.sub(1);
+    maybe_shrink();
+    return true;
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+bool Hash<K, V, HashFn, Eq>::Upsert(K const& key, V value) {
+    auto hash = hash_fn(key);
+    auto so_key = regular_key(hash);
+    maybe_resize();
+    auto head = ensure_slot_exists(get_slot_idx(hash));
+    EpochGuard guard;
+    NodeType* node = nullptr;
+    while (true) {
+        auto exist_node = list.Find(head, so_key, key);
+        if (exist_node == nullptr) {
+            if (node == nullptr) {
+                node = pool.Allocate(so_key, key, value);
+            }
+            if (list.Insert(head, node, &exist_node)) {
+                this->size.add(1);
+                return true;
+            }
+        }
+        atomic_value(exist_node)->exchange(value, std::memory_order_acq_rel);
+        // exist_node may be removed before the value is overwritten, then the
+        // overwriting is invisible, so insert the key again.
+        if (!is_removed(exist_node)) {
+            if (node != nullptr) {
+                pool.Free(node);
+            }
+            return false;
+        }
+    }
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+bool Hash<K, V, HashFn, Eq>::CompareAndSwap(K const& key, V& expected, V desired) {
+    auto hash = hash_fn(key);
+    auto head = get_nearest_slot(get_slot_idx(hash));
+    EpochGuard guard;
+    auto node = list.Find(head, regular_key(hash), key);
+    if (node == nullptr) {
+        return false;
+    }
+    if (!atomic_value(node)->compare_exchange_strong(expected, desired, std::memory_order_acq_rel)) {
+        return false;
+    }
+    // node may be removed before the value is swapped, then the swapping is
+    // invisible and key does not exist.
+    return !is_removed(node);
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+bool Hash<K, V, HashFn, Eq>::GetOrInsert(K const& key, V value, V& actual_value) {
+    auto hash = hash_fn(key);
+    auto so_key = regular_key(hash);
+    maybe_resize();
+    auto head = ensure_slot_exists(get_slot_idx(hash));
+    EpochGuard guard;
+    NodeType* node = nullptr;
+    while (true) {
+        auto exist_node = list.Find(head, so_key, key);
+        if (exist_node == nullptr) {
+            if (node == nullptr) {
+                node = pool.Allocate(so_key, key, value);
+            }
+            if (list.Insert(head, node, &exist_node)) {
+                this->size.add(1);
+                actual_value = value;
+                return true;
+            }
+        }
+        actual_value = atomic_value(exist_node)->load(std::memory_order_acquire);
+        if (!is_removed(exist_node)) {
+            if (node != nullptr) {
+                pool.Free(node);
+            }
+            return false;
+        }
+    }
+}
+template <typename K, typename V, typename HashFn, typename Eq>
+template <bool create_if_not_exists>
+void Hash<K, V, HashFn, Eq>::get_heads(uint64_t const* hashes, size_t m, MarkPtrType** heads) {
+    size_t slot_indices[HASH_BATCH_SIZE];
+    MarkPtrType** slot_ptrs[HASH_BATCH_SIZE];
+    for (size_t i = 0; i < m; ++i) {
+        slot_indices[i] = get_slot_idx(hashes[i]);
+        slot_ptrs[i] = create_if_not_exists ? get_or_create_slot(slot_indices[i]) : get_slot_if_exists(slot_indices[i]);
+        __builtin_prefetch(slot_ptrs[i]);
+    }
+    for (size_t i = 0; i < m; ++i) {
+        if (create_if_not_exists) {
+            heads[i] = ensure_slot_exists(slot_indices[i]);
+        } else if (slot_ptrs[i] != nullptr && *slot_ptrs[i] != nullptr) {
+            heads[i] = *slot_ptrs[i];
+        } else {
+            heads[i] = get_nearest_slot(slot_indices[i]);
+        }
+        __builtin_prefetch(heads[i]);
+    }
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+void Hash<K, V, HashFn, Eq>::find_batch(K const* keys, uint64_t const* hashes, MarkPtrType* const* heads, size_t m,
+                                        NodeType** nodes) {
+    typename List::Cursor cursors[HASH_BATCH_SIZE];
+    size_t active[HASH_BATCH_SIZE];
+    for (size_t i = 0; i < m; ++i) {
+        cursors[i] = {heads[i], regular_key(hashes[i]), &keys[i]};
+        active[i] = i;
+    }
+    // finished cursors are swapped out of the active ones, the others advance
+    // one node per round.
+    auto active_nr = m;
+    while (active_nr > 0) {
+        for (size_t k = 0; k < active_nr;) {
+            auto i = active[k];
+            if (list.Step(cursors[i], nodes[i])) {
+                active[k] = active[--active_nr];
+            } else {
+                ++k;
+            }
+        }
+    }
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+size_t Hash<K, V, HashFn, Eq>::GetBatch(K const* keys, size_t n, V* values, bool* found) {
+    uint64_t hashes[HASH_BATCH_SIZE];
+    MarkPtrType* heads[HASH_BATCH_SIZE];
+    NodeType* nodes[HASH_BATCH_SIZE];
+    size_t found_nr = 0;
+    EpochGuard guard;
+    for (size_t base = 0; base < n; base += HASH_BATCH_SIZE) {
+        auto m = std::min(HASH_BATCH_SIZE, n - base);
+        for (size_t i = 0; i < m; ++i) {
+            hashes[i] = hash_fn(keys[base + i]);
+        }
+        get_heads<false>(hashes, m, heads);
+        find_batch(keys + base, hashes, heads, m, nodes);
+        for (size_t i = 0; i < m; ++i) {
+            found[base + i] = nodes[i] != nullptr;
+            if (nodes[i] != nullptr) {
+                values[base + i] = atomic_value(nodes[i])->load(std::memory_order_acquire);
+                ++found_nr;
+            }
+        }
+    }
+    return found_nr;
+}
+
+template <typename K, typename V, typename HashFn, typename Eq>
+size_t Hash<K, V, HashFn, Eq>::PutBatch(K const* keys, V const* values, size_t n) {
+    uint64_t hashes[HASH_BATCH_SIZE];
+    MarkPtrType* heads[HASH_BATCH_SIZE];
+    NodeType* nodes[HASH_BATCH_SIZE];
+    size_t inserted_nr = 0;
+    for (size_t base = 0; base < n; base += HASH_BATCH_SIZE) {
+        auto m = std::min(HASH_BATCH_SIZE, n - base);
+        maybe_resize();
+        for (size_t i = 0; i < m; ++i) {
+            hashes[i] = hash_fn(keys[base + i]);
+        }
+        get_heads<true>(hashes, m, heads);
+        {
+            // probe before allocating like Put, the paths walked by the probes
+            // stay in cache for the insertions.
+            EpochGuard guard;
+            find_batch(keys + base, hashes, heads, m, nodes);
+        }
+        for (size_t i = 0; i < m; ++i) {
+            if (nodes[i] != nullptr) {
+                continue;
+            }
+            auto node = pool.Allocate(regular_key(hashes[i]), keys[base + i], values[base + i]);
+            if (list.Insert(heads[i], node)) {
+                this->size.add(1);
+                ++inserted_nr;
+            } else {
+                pool.Free(node);
+            }
+        }
+    }
+    return inserted_nr;
+}
 } // namespace concurrent
 } // namespace grakra
 } // namespace com
@@ -0,0 +1,71 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/14.
+//
+
+#ifndef CPP_ETUDES_HASH_KEY_HH
+#define CPP_ETUDES_HASH_KEY_HH
+#include <cstdint>
+#include <cstring>
+#include <string_view>
+#include <type_traits>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// finalizer of MurmurHash3, low bits of the result are used as slot index of
+// Hash, so the input must be mixed thoroughly.
+static inline uint64_t mix64(uint64_t h) {
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdull;
+    h ^= h >> 33;
+    h *= 0xc4ceb9fe1a85ec53ull;
+    h ^= h >> 33;
+    return h;
+}
+
+// fixed-width binary key, shorter strings are padded with zeros, used as key
+// of concurrent string dictionary.
+template <size_t N>
+struct FixedBinaryKey {
+    static_assert(N > 0 && N % sizeof(uint64_t) == 0, "N must be multiple of 8");
+    uint8_t data[N];
+
+    FixedBinaryKey() { memset(data, 0, N); }
+    explicit FixedBinaryKey(std::string_view s) {
+        auto n = s.size() < N ? s.size() : N;
+        memcpy(data, s.data(), n);
+        memset(data + n, 0, N - n);
+    }
+    bool operator==(FixedBinaryKey const& other) const { return memcmp(data, other.data, N) == 0; }
+    bool operator!=(FixedBinaryKey const& other) const { return !(*this == other); }
+};
+
+template <typename K, typename = void>
+struct HashKeyFn;
+
+template <typename K>
+struct HashKeyFn<K, std::enable_if_t<std::is_integral_v<K> || std::is_pointer_v<K>>> {
+    uint64_t operator()(K key) const { return mix64(static_cast<uint64_t>((uintptr_t)key)); }
+};
+
+template <size_t N>
+struct HashKeyFn<FixedBinaryKey<N>> {
+    uint64_t operator()(FixedBinaryKey<N> const& key) const {
+        uint64_t h = N;
+        for (auto i = 0; i < N; i += sizeof(uint64_t)) {
+            uint64_t word;
+            memcpy(&word, key.data + i, sizeof(word));
+            h = (h ^ mix64(word)) * 0x9e3779b97f4a7c15ull;
+        }
+        return mix64(h);
+    }
+};
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_HASH_KEY_HH
@@ -36,12 +36,17 @@ public:
     MichaelList() : head(MarkPtrType(nullptr)) {}
     ~MichaelList() { Clear(); }
     void Clear();
+    // exist_node is reclaimed once removed, so it is only safe to dereference
+    // inside an EpochGuard.
     bool Insert(MarkPtrType* head, NodeType* node, NodeType** exist_node = nullptr);
     bool Insert(NodeType* node, NodeType** exist_node = nullptr) { return Insert(&this->head, node, exist_node); }
     bool Remove(MarkPtrType* head, uint32_t key);
     bool Remove(uint32_t key) { return Remove(&this->head, key); }
     bool Search(MarkPtrType* head, uint32_t key, uint32_t& value);
     bool Search(uint32_t key, uint32_t& value) { return Search(&this->head, key, value); }
+    // return the live node of key or nullptr, only safe to call inside an
+    // EpochGuard.
+    NodeType* Find(MarkPtrType* head, uint32_t key);
     void Unshift(NodeType* node);
     void Push(NodeType* node);
     NodeType* Shift();
@@ -0,0 +1,81 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/22.
+//
+
+#ifndef CPP_ETUDES_MORSEL_HH
+#define CPP_ETUDES_MORSEL_HH
+#include <algorithm>
+#include <binary_column.hh>
+#include <concurrent/work_stealing_pool.hh>
+#include <cstring>
+#include <vector>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// rows of a morsel, the unit of work that column kernels are split into.
+constexpr size_t MORSEL_ROW_NR = 8192;
+
+// run fn(begin_row, end_row) over the morsels of [0, row_nr).
+template <typename F>
+void ForEachMorsel(WorkStealingPool& pool, size_t row_nr, F&& fn, size_t morsel_row_nr = MORSEL_ROW_NR) {
+    pool.ParallelFor(0, row_nr, morsel_row_nr, fn);
+}
+
+// copy rows [begin, end) of src into a standalone column.
+static inline void slice_binary_column(BinaryColumn const& src, size_t begin, size_t end, BinaryColumn& dst) {
+    auto byte_begin = src.offsets[begin];
+    auto byte_end = src.offsets[end];
+    dst.bytes.assign(src.bytes.begin() + byte_begin, src.bytes.begin() + byte_end);
+    dst.offsets.resize(end - begin + 1);
+    for (size_t i = begin; i <= end; ++i) {
+        dst.offsets[i - begin] = src.offsets[i] - byte_begin;
+    }
+}
+
+// run kernel(BinaryColumn const& src_morsel, BinaryColumn& dst_morsel) over
+// the morsels of src in parallel, then concatenate the output morsels into
+// dst in parallel too.
+template <typename Kernel>
+void ParallelBinaryKernel(WorkStealingPool& pool, BinaryColumn const& src, BinaryColumn& dst, Kernel&& kernel,
+                          size_t morsel_row_nr = MORSEL_ROW_NR) {
+    const auto row_nr = src.size();
+    const auto morsel_nr = (row_nr + morsel_row_nr - 1) / morsel_row_nr;
+    std::vector<BinaryColumn> outputs(morsel_nr);
+    pool.ParallelFor(0, morsel_nr, 1, [&](size_t begin, size_t end) {
+        BinaryColumn input;
+        for (auto m = begin; m < end; ++m) {
+            slice_binary_column(src, m * morsel_row_nr, std::min(row_nr, (m + 1) * morsel_row_nr), input);
+            kernel(static_cast<BinaryColumn const&>(input), outputs[m]);
+        }
+    });
+
+    std::vector<size_t> byte_offsets(morsel_nr + 1, 0);
+    for (size_t m = 0; m < morsel_nr; ++m) {
+        byte_offsets[m + 1] = byte_offsets[m] + outputs[m].bytes.size();
+    }
+    dst.bytes.resize(byte_offsets[morsel_nr]);
+    dst.offsets.resize(row_nr + 1);
+    dst.offsets[0] = 0;
+    pool.ParallelFor(0, morsel_nr, 1, [&](size_t begin, size_t end) {
+        for (auto m = begin; m < end; ++m) {
+            auto& output = outputs[m];
+            if (!output.bytes.empty()) {
+                memcpy(dst.bytes.data() + byte_offsets[m], output.bytes.data(), output.bytes.size());
+            }
+            auto first_row = m * morsel_row_nr;
+            for (size_t i = 1; i < output.offsets.size(); ++i) {
+                dst.offsets[first_row + i] = output.offsets[i] + byte_offsets[m];
+            }
+        }
+    });
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_MORSEL_HH
@@ -0,0 +1,328 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/14.
+//
+
+#ifndef CPP_ETUDES_NODE_POOL_HH
+#define CPP_ETUDES_NODE_POOL_HH
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <concurrent/epoch.hh>
+#include <concurrent/list.hh>
+#include <cstddef>
+#include <cstdint>
+#include <cstdlib>
+#include <new>
+#include <type_traits>
+#include <utility>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// blocks handed out by NodePool are aligned to NODE_POOL_ALIGN, so the low
+// bits of node addresses stay free for the mark of MarkPtrType.
+constexpr size_t NODE_POOL_ALIGN = 16;
+// free blocks move between the thread caches and the shared free stack in
+// batches of NODE_POOL_BATCH_NR blocks.
+constexpr size_t NODE_POOL_BATCH_NR = 32;
+
+// fixed-size node pool. every thread allocates from and frees into its own
+// cache without any atomic operation; a cache is refilled with a batch popped
+// from the shared lock-free free stack, or carved from the current chunk when
+// the stack is empty, and spills a batch onto the stack when it holds too
+// many blocks. chunks are CHUNK_BYTES-aligned and start with a header
+// pointing to the arena, so a block finds its arena by masking its address.
+//
+// Retire hands an unlinked node to the EpochManager, it is put back into the
+// pool once no reader can reference it. the chunks are owned by a refcounted
+// arena: the pool, every thread cache holding blocks of the arena and every
+// retired node not yet recycled keep a reference, so a retired node may
+// outlive the pool. nodes are never destructed, Node must be trivially
+// destructible.
+template <typename Node, size_t CHUNK_BYTES = (size_t(1) << 16)>
+class NodePool {
+    static_assert(std::is_trivially_destructible_v<Node>, "Node must be trivially destructible");
+    static_assert((CHUNK_BYTES & (CHUNK_BYTES - 1)) == 0, "CHUNK_BYTES must be power of 2");
+
+    struct FreeBlock {
+        FreeBlock* next;
+        // only meaningful in the first block of a batch on the free stack:
+        // MarkPtrType(next batch, 0, block number of this batch).
+        void* next_batch;
+    };
+
+    struct Arena;
+    struct alignas(64) Chunk {
+        Arena* arena;
+        Chunk* next;
+        std::atomic<size_t> used;
+        Chunk(Arena* arena, Chunk* next) : arena(arena), next(next), used(0) {}
+    };
+
+    static constexpr size_t BLOCK_ALIGN = std::max(alignof(Node), NODE_POOL_ALIGN);
+    static constexpr size_t BLOCK_SIZE =
+            (std::max(sizeof(Node), sizeof(FreeBlock)) + BLOCK_ALIGN - 1) / BLOCK_ALIGN * BLOCK_ALIGN;
+    static constexpr size_t BLOCK_OFFSET = (sizeof(Chunk) + BLOCK_ALIGN - 1) / BLOCK_ALIGN * BLOCK_ALIGN;
+    static constexpr size_t BLOCK_NR = (CHUNK_BYTES - BLOCK_OFFSET) / BLOCK_SIZE;
+    static_assert(BLOCK_NR >= NODE_POOL_BATCH_NR, "CHUNK_BYTES is too small for Node");
+
+    struct Arena {
+        // MarkPtrType(first block of the top batch, 0, ABA tag)
+        std::atomic<void*> batches{nullptr};
+        alignas(64) std::atomic<Chunk*> current{nullptr};
+        std::atomic<size_t> ref_nr{1};
+    };
+
+    struct ThreadCache {
+        Arena* arena{nullptr};
+        FreeBlock* head{nullptr};
+        size_t nr{0};
+        ~ThreadCache() { unbind(*this); }
+    };
+
+    Arena* arena;
+
+public:
+    NodePool() : arena(new Arena()) {}
+    ~NodePool() {
+        // blocks cached by the current thread are useless from now on.
+        for (auto cache : {&thread_cache(), &foreign_cache()}) {
+            if (cache->arena == arena) {
+                cache->head = nullptr;
+                cache->nr = 0;
+                unbind(*cache);
+            }
+        }
+        unref(arena);
+    }
+
+    template <typename... Args>
+    Node* Allocate(Args&&... args) {
+        auto& cache = thread_cache();
+        if (__builtin_expect(cache.arena != arena, 0)) {
+            bind(cache, arena);
+            adopt_foreign_blocks(cache);
+        }
+        if (__builtin_expect(cache.head == nullptr, 0)) {
+            refill(cache);
+        }
+        auto block = cache.head;
+        cache.head = block->next;
+        --cache.nr;
+        return new (block) Node(std::forward<Args>(args)...);
+    }
+
+    // node was never published, so it is reused at once.
+    void Free(Node* node) { free_block(arena, node); }
+
+    // node is unlinked from the list, it is recycled after all the readers
+    // that may still reference it have left their critical regions.
+    void Retire(Node* node) {
+        arena->ref_nr.fetch_add(1, std::memory_order_relaxed);
+        EpochManager::instance().retire(node, &NodePool::recycle);
+    }
+
+    size_t get_chunk_nr() {
+        size_t n = 0;
+        for (auto chunk = arena->current.load(std::memory_order_acquire); chunk != nullptr; chunk = chunk->next) {
+            ++n;
+        }
+        return n;
+    }
+
+private:
+    NodePool(NodePool const&) = delete;
+    NodePool& operator=(NodePool const&) = delete;
+
+    static ThreadCache& thread_cache() {
+        static thread_local ThreadCache cache;
+        return cache;
+    }
+    // frees into an arena other than the one thread_cache serves, e.g. nodes
+    // of another pool recycled by this thread, gather here and go back to
+    // their arena a batch at a time, so they do not flush thread_cache.
+    static ThreadCache& foreign_cache() {
+        static thread_local ThreadCache cache;
+        return cache;
+    }
+
+    static Arena* arena_of(void* block) {
+        return reinterpret_cast<Chunk*>(reinterpret_cast<uintptr_t>(block) & ~(CHUNK_BYTES - 1))->arena;
+    }
+
+    static void recycle(void* node) {
+        auto node_arena = arena_of(node);
+        free_block(node_arena, node);
+        unref(node_arena);
+    }
+
+    static void unref(Arena* arena) {
+        if (arena->ref_nr.fetch_sub(1, std::memory_order_acq_rel) != 1) {
+            return;
+        }
+        auto chunk = arena->current.load(std::memory_order_acquire);
+        while (chunk != nullptr) {
+            auto next = chunk->next;
+            chunk->~Chunk();
+            std::free(chunk);
+            chunk = next;
+        }
+        delete arena;
+    }
+
+    // the cache serves one arena at a time, a thread switching between pools
+    // of the same Node type gives its blocks back first.
+    static void bind(ThreadCache& cache, Arena* arena) {
+        unbind(cache);
+        arena->ref_nr.fetch_add(1, std::memory_order_relaxed);
+        cache.arena = arena;
+    }
+
+    static void unbind(ThreadCache& cache) {
+        if (cache.arena == nullptr) {
+            return;
+        }
+        while (cache.head != nullptr) {
+            push_batch(cache.arena, split_batch(cache));
+        }
+        unref(cache.arena);
+        cache.arena = nullptr;
+    }
+
+    static void free_block(Arena* arena, void* p) {
+        auto& cache = thread_cache();
+        if (__builtin_expect(cache.arena != arena && cache.arena != nullptr, 0)) {
+            free_foreign_block(arena, p);
+            return;
+        }
+        if (__builtin_expect(cache.arena == nullptr, 0)) {
+            bind(cache, arena);
+        }
+        auto block = new (p) FreeBlock{cache.head, nullptr};
+        cache.head = block;
+        if (++cache.nr >= 2 * NODE_POOL_BATCH_NR) {
+            push_batch(arena, split_batch(cache));
+        }
+    }
+
+    // the blocks freed into the arena thread_cache has just been bound to are
+    // allocated first.
+    static void adopt_foreign_blocks(ThreadCache& cache) {
+        auto& foreign = foreign_cache();
+        if (foreign.arena != cache.arena) {
+            return;
+        }
+        assert(cache.head == nullptr);
+        cache.head = foreign.head;
+        cache.nr = foreign.nr;
+        foreign.head = nullptr;
+        foreign.nr = 0;
+        unbind(foreign);
+    }
+
+    // nothing is allocated from foreign_cache, so it is emptied by every full
+    // batch and holds less than a batch when it moves to another arena.
+    static void free_foreign_block(Arena* arena, void* p) {
+        auto& cache = foreign_cache();
+        if (cache.arena != arena) {
+            bind(cache, arena);
+        }
+        auto block = new (p) FreeBlock{cache.head, nullptr};
+        cache.head = block;
+        if (++cache.nr >= NODE_POOL_BATCH_NR) {
+            push_batch(arena, split_batch(cache));
+        }
+    }
+
+    // detach at most NODE_POOL_BATCH_NR blocks from the head of the cache.
+    static FreeBlock* split_batch(ThreadCache& cache) {
+        auto batch = cache.head;
+        auto last = batch;
+        uint16_t n = 1;
+        while (n < NODE_POOL_BATCH_NR && last->next != nullptr) {
+            last = last->next;
+            ++n;
+        }
+        cache.head = last->next;
+        cache.nr = cache.nr > n ? cache.nr - n : 0;
+        last->next = nullptr;
+        batch->next_batch = MarkPtrType(nullptr, 0, n).ptr;
+        return batch;
+    }
+
+    static void push_batch(Arena* arena, FreeBlock* batch) {
+        MarkPtrType batch_nr;
+        batch_nr.ptr = batch->next_batch;
+        MarkPtrType top;
+        top.ptr = arena->batches.load(std::memory_order_relaxed);
+        while (true) {
+            atomic_ptr(batch->next_batch)->store(MarkPtrType(top.get(), 0, batch_nr.get_tag()).ptr, std::memory_order_relaxed);
+            auto new_top = MarkPtrType(batch, 0, top.get_tag() + 1);
+            if (arena->batches.compare_exchange_weak(top.ptr, new_top.ptr, std::memory_order_release,
+                                                     std::memory_order_relaxed)) {
+                return;
+            }
+        }
+    }
+
+    // the chunks outlive any block, so reading next_batch of a batch popped by
+    // another thread in the meantime is harmless, the tag fails the CAS.
+    static FreeBlock* pop_batch(Arena* arena, size_t& batch_nr) {
+        MarkPtrType top;
+        top.ptr = arena->batches.load(std::memory_order_acquire);
+        while (top.get() != nullptr) {
+            auto batch = static_cast<FreeBlock*>(top.get());
+            MarkPtrType next;
+            next.ptr = atomic_ptr(batch->next_batch)->load(std::memory_order_relaxed);
+            auto new_top = MarkPtrType(next.get(), 0, top.get_tag() + 1);
+            if (arena->batches.compare_exchange_weak(top.ptr, new_top.ptr, std::memory_order_acquire,
+                                                     std::memory_order_acquire)) {
+                batch_nr = next.get_tag();
+                return batch;
+            }
+        }
+        return nullptr;
+    }
+
+    void refill(ThreadCache& cache) {
+        size_t batch_nr = 0;
+        if (auto batch = pop_batch(arena, batch_nr); batch != nullptr) {
+            cache.head = batch;
+            cache.nr = batch_nr;
+            return;
+        }
+        while (true) {
+            auto chunk = arena->current.load(std::memory_order_acquire);
+            if (chunk != nullptr) {
+                auto i = chunk->used.fetch_add(NODE_POOL_BATCH_NR, std::memory_order_relaxed);
+                if (__builtin_expect(i < BLOCK_NR, 1)) {
+                    auto n = std::min(NODE_POOL_BATCH_NR, BLOCK_NR - i);
+                    auto blocks = reinterpret_cast<char*>(chunk) + BLOCK_OFFSET + i * BLOCK_SIZE;
+                    FreeBlock* head = nullptr;
+                    for (auto k = n; k > 0; --k) {
+                        head = new (blocks + (k - 1) * BLOCK_SIZE) FreeBlock{head, nullptr};
+                    }
+                    cache.head = head;
+                    cache.nr = n;
+                    return;
+                }
+            }
+            auto mem = std::aligned_alloc(CHUNK_BYTES, CHUNK_BYTES);
+            assert(mem != nullptr);
+            auto new_chunk = new (mem) Chunk(arena, chunk);
+            if (!arena->current.compare_exchange_strong(chunk, new_chunk, std::memory_order_acq_rel)) {
+                new_chunk->~Chunk();
+                std::free(mem);
+            }
+        }
+    }
+};
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_NODE_POOL_HH
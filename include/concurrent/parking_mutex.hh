@@ -0,0 +1,110 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/11/9.
+//
+
+#ifndef CPP_ETUDES_PARKING_MUTEX_HH
+#define CPP_ETUDES_PARKING_MUTEX_HH
+#include <atomic>
+#include <cstdint>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// 1-byte mutex: uncontended lock/unlock is one CAS each. a contended locker
+// spins for a while, then sets PARKED and parks on a folly::ParkingLot keyed
+// by the mutex address; unlock only goes to the ParkingLot when it finds
+// PARKED. the spin limit adapts to how long recent lockers of the mutex had to
+// spin before they succeeded, it is kept in a table hashed by the address
+// since there is no room in the mutex itself.
+class ParkingMutex {
+public:
+    ParkingMutex() : state(0) {}
+
+    void lock() {
+        uint8_t expected = 0;
+        if (!state.compare_exchange_weak(expected, LOCKED, std::memory_order_acquire, std::memory_order_relaxed)) {
+            lock_slow();
+        }
+    }
+    bool try_lock() {
+        auto s = state.load(std::memory_order_relaxed);
+        return (s & LOCKED) == 0 && state.compare_exchange_strong(s, s | LOCKED, std::memory_order_acquire);
+    }
+    void unlock() {
+        uint8_t expected = LOCKED;
+        if (!state.compare_exchange_strong(expected, 0, std::memory_order_release, std::memory_order_relaxed)) {
+            unlock_slow();
+        }
+    }
+
+private:
+    static constexpr uint8_t LOCKED = 1;
+    static constexpr uint8_t PARKED = 2;
+
+    ParkingMutex(ParkingMutex const&) = delete;
+    ParkingMutex& operator=(ParkingMutex const&) = delete;
+    void lock_slow();
+    void unlock_slow();
+
+    std::atomic<uint8_t> state;
+};
+static_assert(sizeof(ParkingMutex) == 1, "ParkingMutex must be 1 byte");
+
+// writer-preferring reader-writer lock on the same ParkingLot: a waiting
+// writer sets WRITER_PENDING to hold back new readers. waiters of both kinds
+// park on the address and are all woken when the lock is released, so it
+// suits read-mostly data with short critical sections.
+class ParkingSharedMutex {
+public:
+    ParkingSharedMutex() : state(0) {}
+
+    void lock() {
+        uint32_t expected = 0;
+        if (!state.compare_exchange_weak(expected, WRITER, std::memory_order_acquire, std::memory_order_relaxed)) {
+            lock_slow();
+        }
+    }
+    bool try_lock() {
+        auto s = state.load(std::memory_order_relaxed);
+        return (s & (WRITER | READER_MASK)) == 0 &&
+               state.compare_exchange_strong(s, (s | WRITER) & ~WRITER_PENDING, std::memory_order_acquire);
+    }
+    void unlock();
+
+    void lock_shared() {
+        auto s = state.load(std::memory_order_relaxed);
+        if ((s & (WRITER | WRITER_PENDING)) != 0 ||
+            !state.compare_exchange_weak(s, s + READER, std::memory_order_acquire, std::memory_order_relaxed)) {
+            lock_shared_slow();
+        }
+    }
+    bool try_lock_shared() {
+        auto s = state.load(std::memory_order_relaxed);
+        return (s & (WRITER | WRITER_PENDING)) == 0 &&
+               state.compare_exchange_strong(s, s + READER, std::memory_order_acquire);
+    }
+    void unlock_shared();
+
+private:
+    static constexpr uint32_t WRITER = 1;
+    static constexpr uint32_t WRITER_PENDING = 2;
+    static constexpr uint32_t PARKED = 4;
+    static constexpr uint32_t READER = 8;
+    static constexpr uint32_t READER_MASK = ~(READER - 1);
+
+    ParkingSharedMutex(ParkingSharedMutex const&) = delete;
+    ParkingSharedMutex& operator=(ParkingSharedMutex const&) = delete;
+    void lock_slow();
+    void lock_shared_slow();
+
+    std::atomic<uint32_t> state;
+};
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_PARKING_MUTEX_HH
@@ -0,0 +1,70 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/10.
+//
+
+#ifndef CPP_ETUDES_RCU_CELL_HH
+#define CPP_ETUDES_RCU_CELL_HH
+#include <atomic>
+#include <concurrent/epoch.hh>
+#include <utility>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// read-copy-update cell for read-mostly objects: readers load the pointer
+// inside an EpochGuard and never write shared memory except their epoch
+// announcement; writers publish a new copy with one pointer swap and retire
+// the old one into EpochManager, so a writer never waits for readers.
+template <typename T>
+class RcuCell {
+public:
+    explicit RcuCell(T value) : ptr(new T(std::move(value))) {}
+    // no reader may be left.
+    ~RcuCell() { delete ptr.load(std::memory_order_acquire); }
+
+    // f(T const&) runs inside an epoch, the object stays alive until f
+    // returns; f must not keep the reference.
+    template <typename F>
+    auto read(F&& f) const {
+        EpochGuard guard;
+        return f(*ptr.load(std::memory_order_acquire));
+    }
+    T load() const {
+        return read([](T const& value) { return value; });
+    }
+
+    void store(T value) {
+        auto old = ptr.exchange(new T(std::move(value)), std::memory_order_acq_rel);
+        retire_object(old);
+    }
+    // copy, modify by f(T&) and publish; retried if other writers published in
+    // between, so concurrent updates are not lost.
+    template <typename F>
+    void update(F&& f) {
+        EpochGuard guard;
+        auto curr = ptr.load(std::memory_order_acquire);
+        while (true) {
+            auto next = new T(*curr);
+            f(*next);
+            if (ptr.compare_exchange_weak(curr, next, std::memory_order_acq_rel, std::memory_order_acquire)) {
+                retire_object(curr);
+                return;
+            }
+            delete next;
+        }
+    }
+
+private:
+    RcuCell(RcuCell const&) = delete;
+    RcuCell& operator=(RcuCell const&) = delete;
+    std::atomic<T*> ptr;
+};
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_RCU_CELL_HH
@@ -0,0 +1,113 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/10.
+//
+
+#ifndef CPP_ETUDES_SEQ_LOCK_HH
+#define CPP_ETUDES_SEQ_LOCK_HH
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// sequence lock for small trivially copyable objects. seq is odd while a
+// writer is copying in, a reader copies out and retries if seq was odd or
+// changed, so readers only load. the object is kept in atomic words to make
+// the racy copy well-defined(Boehm, "Can seqlocks get along with programming
+// language memory models?"). writers are serialized by the CAS on seq.
+template <typename T>
+class SeqLock {
+    static_assert(std::is_trivially_copyable_v<T> && std::is_default_constructible_v<T>,
+                  "T must be trivially copyable and default constructible");
+    static constexpr size_t WORD_NR = (sizeof(T) + sizeof(uint64_t) - 1) / sizeof(uint64_t);
+
+public:
+    explicit SeqLock(T const& value = T()) : seq(0) { write_words(value); }
+
+    T load() const {
+        uint64_t buffer[WORD_NR];
+        while (true) {
+            auto seq0 = seq.load(std::memory_order_acquire);
+            if ((seq0 & 1) != 0) {
+                __builtin_ia32_pause();
+                continue;
+            }
+            for (size_t i = 0; i < WORD_NR; ++i) {
+                buffer[i] = words[i].load(std::memory_order_relaxed);
+            }
+            std::atomic_thread_fence(std::memory_order_acquire);
+            if (seq.load(std::memory_order_relaxed) == seq0) {
+                T value;
+                memcpy(&value, buffer, sizeof(T));
+                return value;
+            }
+        }
+    }
+
+    void store(T const& value) {
+        auto seq0 = lock();
+        write_words(value);
+        seq.store(seq0 + 2, std::memory_order_release);
+    }
+    // read-modify-write under the writer lock, f(T&).
+    template <typename F>
+    void update(F&& f) {
+        auto seq0 = lock();
+        auto value = load_words();
+        f(value);
+        write_words(value);
+        seq.store(seq0 + 2, std::memory_order_release);
+    }
+    uint64_t get_version() const { return seq.load(std::memory_order_acquire) >> 1; }
+
+private:
+    SeqLock(SeqLock const&) = delete;
+    SeqLock& operator=(SeqLock const&) = delete;
+
+    // make seq odd, return the even seq before.
+    uint64_t lock() {
+        auto seq0 = seq.load(std::memory_order_relaxed);
+        while (true) {
+            if ((seq0 & 1) != 0) {
+                __builtin_ia32_pause();
+                seq0 = seq.load(std::memory_order_relaxed);
+                continue;
+            }
+            if (seq.compare_exchange_weak(seq0, seq0 + 1, std::memory_order_acquire, std::memory_order_relaxed)) {
+                // the odd seq must be visible before any word is.
+                std::atomic_thread_fence(std::memory_order_release);
+                return seq0;
+            }
+        }
+    }
+    void write_words(T const& value) {
+        uint64_t buffer[WORD_NR] = {};
+        memcpy(buffer, &value, sizeof(T));
+        for (size_t i = 0; i < WORD_NR; ++i) {
+            words[i].store(buffer[i], std::memory_order_relaxed);
+        }
+    }
+    T load_words() const {
+        uint64_t buffer[WORD_NR];
+        for (size_t i = 0; i < WORD_NR; ++i) {
+            buffer[i] = words[i].load(std::memory_order_relaxed);
+        }
+        T value;
+        memcpy(&value, buffer, sizeof(T));
+        return value;
+    }
+
+    std::atomic<uint64_t> seq;
+    std::atomic<uint64_t> words[WORD_NR];
+};
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_SEQ_LOCK_HH
@@ -0,0 +1,130 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/10/24.
+//
+
+#ifndef CPP_ETUDES_SHARDED_COUNTER_HH
+#define CPP_ETUDES_SHARDED_COUNTER_HH
+#include <folly/lang/Align.h>
+#include <sched.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <thread>
+#include <type_traits>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+constexpr size_t SHARDED_COUNTER_MAX_STRIPE_NR = 256;
+constexpr int64_t SHARDED_COUNTER_DEFAULT_BATCH = 1024;
+
+// cpu of the calling thread, refreshed every CPU_CACHE_USE_NR calls since
+// sched_getcpu costs more than the counter update itself. threads on a
+// platform without getcpu are numbered sequentially instead.
+inline size_t current_cpu() {
+    static constexpr unsigned CPU_CACHE_USE_NR = 32;
+    static std::atomic<unsigned> thread_seq(0);
+    struct CpuCache {
+        unsigned cpu{0};
+        unsigned uses{0};
+    };
+    static thread_local CpuCache cache;
+    if (cache.uses-- == 0) {
+        auto cpu = sched_getcpu();
+        cache.cpu = cpu >= 0 ? cpu : thread_seq.fetch_add(1, std::memory_order_relaxed);
+        cache.uses = CPU_CACHE_USE_NR - 1;
+    }
+    return cache.cpu;
+}
+
+// a counter striped over cache-line-padded slots, a thread updates the slot of
+// its cpu so updates from different cpus do not bounce the same cache line. a
+// slot is folded into the shared total once its absolute value reaches batch,
+// so read_approx is one load that lags behind the exact value by less than
+// get_max_error(); read_exact also sums the slots.
+template <typename T = int64_t>
+class ShardedCounter {
+    static_assert(std::is_integral_v<T> && std::is_signed_v<T>, "T must be signed integer");
+
+    struct alignas(folly::hardware_destructive_interference_size) Stripe {
+        std::atomic<T> value{0};
+    };
+
+public:
+    // stripe_nr must be power of 2.
+    explicit ShardedCounter(T batch = SHARDED_COUNTER_DEFAULT_BATCH, size_t stripe_nr = default_stripe_nr())
+            : stripe_mask(stripe_nr - 1), batch(batch), stripes(new Stripe[stripe_nr]), total(0), fold_state(0) {}
+
+    static size_t default_stripe_nr() {
+        size_t n = 1;
+        while (n < std::thread::hardware_concurrency() && n < SHARDED_COUNTER_MAX_STRIPE_NR) {
+            n <<= 1;
+        }
+        return n;
+    }
+    size_t get_stripe_nr() const { return stripe_mask + 1; }
+    T get_max_error() const { return static_cast<T>(get_stripe_nr()) * batch; }
+
+    void add(T delta) {
+        auto& stripe = stripes[current_cpu() & stripe_mask];
+        auto value = stripe.value.fetch_add(delta, std::memory_order_relaxed) + delta;
+        if (value >= batch || value <= -batch) {
+            fold(stripe);
+        }
+    }
+    void sub(T delta) { add(-delta); }
+
+    T read_approx() const { return total.load(std::memory_order_relaxed); }
+
+    // include all the updates that happen before the call, retry while a fold
+    // is moving a slot into total.
+    T read_exact() const {
+        while (true) {
+            auto state = fold_state.load(std::memory_order_seq_cst);
+            if ((state & FOLDING_MASK) != 0) {
+                std::this_thread::yield();
+                continue;
+            }
+            auto sum = total.load(std::memory_order_seq_cst);
+            for (size_t i = 0; i <= stripe_mask; ++i) {
+                sum += stripes[i].value.load(std::memory_order_seq_cst);
+            }
+            if (fold_state.load(std::memory_order_seq_cst) == state) {
+                return sum;
+            }
+        }
+    }
+
+private:
+    ShardedCounter(ShardedCounter const&) = delete;
+    ShardedCounter& operator=(ShardedCounter const&) = delete;
+
+    // low half of fold_state counts the folds in flight, high half counts the
+    // finished ones, so a reader can tell whether a fold overlapped its sum.
+    static constexpr uint64_t FOLDING_MASK = 0xffff'ffffull;
+    static constexpr uint64_t FOLDED_ONE = FOLDING_MASK + 1;
+
+    void fold(Stripe& stripe) {
+        fold_state.fetch_add(1, std::memory_order_seq_cst);
+        auto value = stripe.value.exchange(0, std::memory_order_seq_cst);
+        total.fetch_add(value, std::memory_order_seq_cst);
+        fold_state.fetch_add(FOLDED_ONE - 1, std::memory_order_seq_cst);
+    }
+
+    const size_t stripe_mask;
+    const T batch;
+    std::unique_ptr<Stripe[]> stripes;
+    alignas(folly::hardware_destructive_interference_size) std::atomic<T> total;
+    std::atomic<uint64_t> fold_state;
+};
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_SHARDED_COUNTER_HH
@@ -0,0 +1,380 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/21.
+//
+
+#ifndef CPP_ETUDES_SKIP_LIST_HH
+#define CPP_ETUDES_SKIP_LIST_HH
+#include <atomic>
+#include <cassert>
+#include <concurrent/epoch.hh>
+#include <concurrent/list.hh>
+#include <concurrent/mark_ptr_type.hh>
+#include <functional>
+#include <new>
+#include <type_traits>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+constexpr size_t SKIP_LIST_MAX_LEVEL = 24;
+// a node of level l is promoted to level l+1 with probability 1/SKIP_LIST_BRANCHING
+constexpr size_t SKIP_LIST_BRANCHING = 4;
+
+// next[l] is the link of level l, its mark bit is set when the node is deleted
+// from level l. next[] is allocated along with the node and has `level` items.
+template <typename K, typename V>
+struct SkipListNode {
+    // the node is linked at all of its levels by the inserter.
+    static constexpr uint8_t STATE_INSERTED = 1;
+    // the node is marked at level 0 by the remover.
+    static constexpr uint8_t STATE_REMOVED = 2;
+
+    K key;
+    V value;
+    std::atomic<uint8_t> state;
+    const uint8_t level;
+    MarkPtrType next[1];
+
+    static SkipListNode* create(K const& key, V value, size_t level) {
+        auto mem = ::operator new(sizeof(SkipListNode) + (level - 1) * sizeof(MarkPtrType));
+        return new (mem) SkipListNode(key, value, level);
+    }
+    static void destroy(SkipListNode* node) {
+        node->~SkipListNode();
+        ::operator delete(node);
+    }
+    MarkPtrType load_next(size_t l) {
+        MarkPtrType next_snap;
+        next_snap.ptr = atomic_ptr(next[l].ptr)->load(std::memory_order_acquire);
+        return next_snap;
+    }
+    bool cas_next(size_t l, MarkPtrType expect, MarkPtrType desired) {
+        return atomic_ptr(next[l].ptr)->compare_exchange_strong(expect.ptr, desired.ptr, std::memory_order_acq_rel);
+    }
+
+private:
+    SkipListNode(K const& key, V value, size_t level) : key(key), value(value), state(0), level(level) {
+        for (size_t l = 0; l < level; ++l) {
+            new (&next[l]) MarkPtrType(nullptr);
+        }
+    }
+};
+
+// lock-free ordered map(Herlihy & Shavit's LockFreeSkipList), the deleted
+// flag of a link is the mark bit of MarkPtrType and every CAS on a link bumps
+// its tag. a node is deleted top-down, it is logically removed once its level
+// 0 link is marked. searching threads unlink the marked nodes they pass, the
+// unlinked nodes are reclaimed by EpochManager only after both the inserter
+// and the remover have finished with them, so the inserter never links a
+// reclaimed node back. values must be trivially copyable and are read and
+// written atomically like Hash.
+template <typename K, typename V, typename Cmp = std::less<K>>
+class SkipList {
+    static_assert(std::is_trivially_copyable_v<V> && sizeof(V) <= sizeof(uint64_t), "V must be atomic accessible");
+
+public:
+    using Node = SkipListNode<K, V>;
+
+    // forward iterator over level 0, it stays in a epoch critical region until
+    // destructed, so the node under it is never reclaimed. keys are visited in
+    // ascending order; keys present during the whole scan are always visited,
+    // keys absent during the whole scan are never visited, the concurrently
+    // inserted or removed keys may or may not be visited.
+    class Iterator {
+        Node* node;
+        bool guarded;
+
+    public:
+        Iterator(Iterator&& other) : node(other.node), guarded(other.guarded) { other.guarded = false; }
+        ~Iterator() {
+            if (guarded) {
+                EpochManager::instance().exit();
+            }
+        }
+        bool Valid() const { return node != nullptr; }
+        K const& key() const { return node->key; }
+        V value() const { return reinterpret_cast<std::atomic<V>*>(&node->value)->load(std::memory_order_acquire); }
+        void Next() { node = SkipList::next_live(node); }
+
+    private:
+        friend class SkipList;
+        // adopt the critical region entered by the caller.
+        explicit Iterator(Node* node) : node(node), guarded(true) {}
+        Iterator(Iterator const&) = delete;
+        Iterator& operator=(Iterator const&) = delete;
+        Iterator& operator=(Iterator&&) = delete;
+    };
+
+private:
+    Node* head;
+    std::atomic<size_t> level_nr;
+    std::atomic<size_t> size;
+    Cmp cmp;
+
+public:
+    SkipList() : head(Node::create(K(), V(), SKIP_LIST_MAX_LEVEL)), level_nr(1), size(0) {}
+    ~SkipList();
+    size_t get_size() { return this->size.load(std::memory_order_relaxed); }
+    size_t get_level_nr() { return this->level_nr.load(std::memory_order_relaxed); }
+
+    // return false if key exists.
+    bool Insert(K const& key, V value);
+    bool Get(K const& key, V& value);
+    bool Remove(K const& key);
+    // iterator at the first key not less than key.
+    Iterator LowerBound(K const& key);
+    Iterator Begin();
+
+private:
+    SkipList(SkipList const&) = delete;
+    SkipList& operator=(SkipList const&) = delete;
+    static size_t random_level();
+    static Node* next_live(Node* node);
+    static void retire_node(Node* node) {
+        EpochManager::instance().retire(node, [](void* p) { Node::destroy(static_cast<Node*>(p)); });
+    }
+    bool equal(K const& a, K const& b) { return !cmp(a, b) && !cmp(b, a); }
+    // find preds and succs of key at each level and unlink the marked nodes
+    // on the way, pred_nexts[l] is the value of preds[l]->next[l] that points
+    // to succs[l]. return true if succs[0] is the live node of key.
+    bool find(K const& key, Node** preds, MarkPtrType* pred_nexts, Node** succs);
+    // read-only search, return the first live node whose key is not less than
+    // key at level 0.
+    Node* find_greater_or_equal(K const& key);
+    // the last one of the inserter and the remover unlinks and retires node.
+    void finish(Node* node, uint8_t state);
+};
+
+template <typename K, typename V, typename Cmp>
+SkipList<K, V, Cmp>::~SkipList() {
+    auto node = head;
+    while (node != nullptr) {
+        auto next = reinterpret_cast<Node*>(node->next[0].get());
+        Node::destroy(node);
+        node = next;
+    }
+}
+
+template <typename K, typename V, typename Cmp>
+size_t SkipList<K, V, Cmp>::random_level() {
+    static thread_local uint64_t seed = reinterpret_cast<uintptr_t>(&seed) | 1;
+    // xorshift64
+    seed ^= seed << 13;
+    seed ^= seed >> 7;
+    seed ^= seed << 17;
+    auto r = seed;
+    size_t level = 1;
+    while (level < SKIP_LIST_MAX_LEVEL && r % SKIP_LIST_BRANCHING == 0) {
+        r /= SKIP_LIST_BRANCHING;
+        ++level;
+    }
+    return level;
+}
+
+template <typename K, typename V, typename Cmp>
+typename SkipList<K, V, Cmp>::Node* SkipList<K, V, Cmp>::next_live(Node* node) {
+    // the links of marked nodes are frozen and still point forward, so they
+    // are passed through.
+    auto next = reinterpret_cast<Node*>(node->load_next(0).get());
+    while (next != nullptr && next->load_next(0).is_mark_delete()) {
+        next = reinterpret_cast<Node*>(next->load_next(0).get());
+    }
+    return next;
+}
+
+template <typename K, typename V, typename Cmp>
+bool SkipList<K, V, Cmp>::find(K const& key, Node** preds, MarkPtrType* pred_nexts, Node** succs) {
+retry:
+    auto pred = head;
+    for (ssize_t l = level_nr.load(std::memory_order_acquire) - 1; l >= 0; --l) {
+        auto pred_next = pred->load_next(l);
+        if (pred_next.is_mark_delete()) {
+            goto retry;
+        }
+        auto curr = reinterpret_cast<Node*>(pred_next.get());
+        while (curr != nullptr) {
+            auto curr_next = curr->load_next(l);
+            if (curr_next.is_mark_delete()) {
+                auto pred_new = MarkPtrType(curr_next.get(), 0, pred_next.get_tag() + 1);
+                if (!pred->cas_next(l, pred_next, pred_new)) {
+                    goto retry;
+                }
+                pred_next = pred_new;
+                curr = reinterpret_cast<Node*>(curr_next.get());
+            } else if (cmp(curr->key, key)) {
+                pred = curr;
+                pred_next = curr_next;
+                curr = reinterpret_cast<Node*>(curr_next.get());
+            } else {
+                break;
+            }
+        }
+        preds[l] = pred;
+        pred_nexts[l] = pred_next;
+        succs[l] = curr;
+    }
+    return succs[0] != nullptr && !cmp(key, succs[0]->key);
+}
+
+template <typename K, typename V, typename Cmp>
+typename SkipList<K, V, Cmp>::Node* SkipList<K, V, Cmp>::find_greater_or_equal(K const& key) {
+    auto pred = head;
+    Node* curr = nullptr;
+    for (ssize_t l = level_nr.load(std::memory_order_acquire) - 1; l >= 0; --l) {
+        curr = reinterpret_cast<Node*>(pred->load_next(l).get());
+        while (curr != nullptr) {
+            auto curr_next = curr->load_next(l);
+            if (!curr_next.is_mark_delete()) {
+                if (!cmp(curr->key, key)) {
+                    break;
+                }
+                pred = curr;
+            }
+            curr = reinterpret_cast<Node*>(curr_next.get());
+        }
+    }
+    return curr;
+}
+
+template <typename K, typename V, typename Cmp>
+void SkipList<K, V, Cmp>::finish(Node* node, uint8_t state) {
+    if ((node->state.fetch_or(state, std::memory_order_acq_rel) | state) !=
+        (Node::STATE_INSERTED | Node::STATE_REMOVED)) {
+        return;
+    }
+    // node is marked at all the levels and no more links to it are made, find
+    // unlinks it from every level.
+    Node* preds[SKIP_LIST_MAX_LEVEL];
+    MarkPtrType pred_nexts[SKIP_LIST_MAX_LEVEL];
+    Node* succs[SKIP_LIST_MAX_LEVEL];
+    find(node->key, preds, pred_nexts, succs);
+    retire_node(node);
+}
+
+template <typename K, typename V, typename Cmp>
+bool SkipList<K, V, Cmp>::Insert(K const& key, V value) {
+    EpochGuard guard;
+    auto top = random_level();
+    auto level_nr_snap = level_nr.load(std::memory_order_relaxed);
+    while (level_nr_snap < top &&
+           !level_nr.compare_exchange_weak(level_nr_snap, top, std::memory_order_acq_rel)) {
+    }
+    Node* preds[SKIP_LIST_MAX_LEVEL];
+    MarkPtrType pred_nexts[SKIP_LIST_MAX_LEVEL];
+    Node* succs[SKIP_LIST_MAX_LEVEL];
+    Node* node = nullptr;
+    while (true) {
+        if (find(key, preds, pred_nexts, succs)) {
+            if (node != nullptr) {
+                // never published
+                Node::destroy(node);
+            }
+            return false;
+        }
+        if (node == nullptr) {
+            node = Node::create(key, value, top);
+        }
+        for (size_t l = 0; l < top; ++l) {
+            node->next[l] = MarkPtrType(succs[l], 0, 0);
+        }
+        auto pred_new = MarkPtrType(node, 0, pred_nexts[0].get_tag() + 1);
+        if (preds[0]->cas_next(0, pred_nexts[0], pred_new)) {
+            break;
+        }
+    }
+    this->size.fetch_add(1, std::memory_order_relaxed);
+
+    // link upper levels bottom-up, give up once node is being removed.
+    for (size_t l = 1; l < top; ++l) {
+        while (true) {
+            auto node_next = node->load_next(l);
+            if (node_next.is_mark_delete()) {
+                finish(node, Node::STATE_INSERTED);
+                return true;
+            }
+            if (node_next.get() != succs[l] &&
+                !node->cas_next(l, node_next, MarkPtrType(succs[l], 0, node_next.get_tag() + 1))) {
+                continue;
+            }
+            auto pred_new = MarkPtrType(node, 0, pred_nexts[l].get_tag() + 1);
+            if (preds[l]->cas_next(l, pred_nexts[l], pred_new)) {
+                break;
+            }
+            find(key, preds, pred_nexts, succs);
+            if (succs[0] != node) {
+                // node is removed, it is marked at all levels already.
+                finish(node, Node::STATE_INSERTED);
+                return true;
+            }
+        }
+    }
+    finish(node, Node::STATE_INSERTED);
+    return true;
+}
+
+template <typename K, typename V, typename Cmp>
+bool SkipList<K, V, Cmp>::Get(K const& key, V& value) {
+    EpochGuard guard;
+    auto node = find_greater_or_equal(key);
+    if (node == nullptr || !equal(node->key, key)) {
+        return false;
+    }
+    value = reinterpret_cast<std::atomic<V>*>(&node->value)->load(std::memory_order_acquire);
+    return true;
+}
+
+template <typename K, typename V, typename Cmp>
+bool SkipList<K, V, Cmp>::Remove(K const& key) {
+    EpochGuard guard;
+    Node* preds[SKIP_LIST_MAX_LEVEL];
+    MarkPtrType pred_nexts[SKIP_LIST_MAX_LEVEL];
+    Node* succs[SKIP_LIST_MAX_LEVEL];
+    if (!find(key, preds, pred_nexts, succs)) {
+        return false;
+    }
+    auto node = succs[0];
+    for (size_t l = node->level - 1; l > 0; --l) {
+        auto node_next = node->load_next(l);
+        while (!node_next.is_mark_delete()) {
+            auto node_new = MarkPtrType(node_next.get(), 1, node_next.get_tag() + 1);
+            if (node->cas_next(l, node_next, node_new)) {
+                break;
+            }
+            node_next = node->load_next(l);
+        }
+    }
+    while (true) {
+        auto node_next = node->load_next(0);
+        if (node_next.is_mark_delete()) {
+            // removed by another thread
+            return false;
+        }
+        if (node->cas_next(0, node_next, MarkPtrType(node_next.get(), 1, node_next.get_tag() + 1))) {
+            break;
+        }
+    }
+    this->size.fetch_sub(1, std::memory_order_relaxed);
+    finish(node, Node::STATE_REMOVED);
+    return true;
+}
+
+template <typename K, typename V, typename Cmp>
+typename SkipList<K, V, Cmp>::Iterator SkipList<K, V, Cmp>::LowerBound(K const& key) {
+    EpochManager::instance().enter();
+    return Iterator(find_greater_or_equal(key));
+}
+
+template <typename K, typename V, typename Cmp>
+typename SkipList<K, V, Cmp>::Iterator SkipList<K, V, Cmp>::Begin() {
+    EpochManager::instance().enter();
+    return Iterator(next_live(head));
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_SKIP_LIST_HH
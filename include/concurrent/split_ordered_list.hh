@@ -0,0 +1,219 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/14.
+//
+
+#ifndef CPP_ETUDES_SPLIT_ORDERED_LIST_HH
+#define CPP_ETUDES_SPLIT_ORDERED_LIST_HH
+#include <concurrent/epoch.hh>
+#include <concurrent/list.hh>
+#include <concurrent/node_pool.hh>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// so_key is the split-order key, i.e. bit-reversed hash of key for regular
+// nodes and bit-reversed slot index for dummy nodes. distinct keys may share
+// the same so_key, so nodes are ordered by so_key and keys in a run of equal
+// so_key are told apart by Eq.
+template <typename K, typename V>
+struct HashNode {
+    MarkPtrType next;
+    uint64_t so_key;
+    K key;
+    V value;
+    HashNode(uint64_t so_key, K const& key, V value) : next(nullptr), so_key(so_key), key(key), value(value) {}
+};
+
+// MichaelList generalized to HashNode, nodes are allocated from the NodePool
+// and retired into it by whichever thread unlinks them, so they are recycled
+// once no reader can reference them.
+template <typename K, typename V, typename Eq>
+class SplitOrderedList {
+public:
+    using Node = HashNode<K, V>;
+    using Pool = NodePool<Node>;
+
+private:
+    MarkPtrType head;
+    Pool& pool;
+    Eq eq;
+
+public:
+    explicit SplitOrderedList(Pool& pool) : head(MarkPtrType(nullptr)), pool(pool) {}
+    MarkPtrType* get_head() { return &this->head; }
+    // exist_node is only safe to dereference inside an EpochGuard.
+    bool Insert(MarkPtrType* head, Node* node, Node** exist_node = nullptr);
+    bool Remove(MarkPtrType* head, uint64_t so_key, K const& key);
+    bool Search(MarkPtrType* head, uint64_t so_key, K const& key, V& value);
+    // only safe to call inside an EpochGuard.
+    Node* Find(MarkPtrType* head, uint64_t so_key, K const& key);
+
+    // read-only search advanced by one node per Step, the next node is
+    // prefetched before Step returns, so the cache misses of interleaved
+    // cursors overlap. marked nodes are passed through instead of unlinked.
+    struct Cursor {
+        MarkPtrType* curr;
+        uint64_t so_key;
+        K const* key;
+    };
+    // return true when the search is finished, node is set to the live node
+    // of the key or nullptr. only safe to call inside an EpochGuard.
+    bool Step(Cursor& cursor, Node*& node);
+
+private:
+    SplitOrderedList(SplitOrderedList const&) = delete;
+    SplitOrderedList& operator=(SplitOrderedList const&) = delete;
+    static Node* to_node(MarkPtrType* p) { return list_node_(p, Node, next); }
+    bool find(MarkPtrType* head, MarkPtrType*& prev, MarkPtrType& pmark_curr_ptag, MarkPtrType& cmark_next_ctag,
+              uint64_t so_key, K const& key, Node** node = nullptr);
+};
+
+template <typename K, typename V, typename Eq>
+bool SplitOrderedList<K, V, Eq>::Insert(MarkPtrType* head, Node* node, Node** exist_node) {
+    EpochGuard guard;
+    MarkPtrType* prev = head;
+    MarkPtrType pmark_curr_ptag;
+    MarkPtrType cmark_next_ctag;
+    while (true) {
+        if (find(head, prev, pmark_curr_ptag, cmark_next_ctag, node->so_key, node->key, exist_node)) {
+            return false;
+        }
+        node->next = MarkPtrType(list_next(pmark_curr_ptag), 0, 0);
+        auto prev_old = MarkPtrType(list_next(pmark_curr_ptag), 0, pmark_curr_ptag.get_tag());
+        auto prev_new = MarkPtrType(&node->next, 0, pmark_curr_ptag.get_tag() + 1);
+        if (atomic_ptr(prev->ptr)->compare_exchange_strong(prev_old.ptr, prev_new.ptr, std::memory_order_acq_rel)) {
+            return true;
+        }
+    }
+}
+
+template <typename K, typename V, typename Eq>
+bool SplitOrderedList<K, V, Eq>::Remove(MarkPtrType* head, uint64_t so_key, K const& key) {
+    EpochGuard guard;
+    MarkPtrType* prev = nullptr;
+    MarkPtrType pmark_curr_ptag;
+    MarkPtrType cmark_next_ctag;
+    while (true) {
+        if (!find(head, prev, pmark_curr_ptag, cmark_next_ctag, so_key, key)) {
+            return false;
+        }
+        auto curr = list_next(pmark_curr_ptag);
+        auto curr_old = cmark_next_ctag;
+        curr_old.unmark_delete();
+        auto curr_new = MarkPtrType(list_next(cmark_next_ctag), 1, cmark_next_ctag.get_tag() + 1);
+        if (!atomic_ptr(curr->ptr)->compare_exchange_strong(curr_old.ptr, curr_new.ptr, std::memory_order_acq_rel)) {
+            continue;
+        }
+        auto prev_old = pmark_curr_ptag;
+        prev_old.unmark_delete();
+        auto prev_new = MarkPtrType(list_next(cmark_next_ctag), 0, pmark_curr_ptag.get_tag() + 1);
+        if (atomic_ptr(prev->ptr)->compare_exchange_strong(prev_old.ptr, prev_new.ptr)) {
+            pool.Retire(to_node(curr));
+        } else {
+            find(head, prev, pmark_curr_ptag, cmark_next_ctag, so_key, key);
+        }
+        return true;
+    }
+}
+
+template <typename K, typename V, typename Eq>
+bool SplitOrderedList<K, V, Eq>::Search(MarkPtrType* head, uint64_t so_key, K const& key, V& value) {
+    EpochGuard guard;
+    auto node = Find(head, so_key, key);
+    if (node == nullptr) {
+        return false;
+    }
+    value = reinterpret_cast<std::atomic<V>*>(&node->value)->load(std::memory_order_acquire);
+    return true;
+}
+
+template <typename K, typename V, typename Eq>
+typename SplitOrderedList<K, V, Eq>::Node* SplitOrderedList<K, V, Eq>::Find(MarkPtrType* head, uint64_t so_key,
+                                                                          K const& key) {
+    MarkPtrType* prev = head;
+    MarkPtrType pmark_curr_ptag;
+    MarkPtrType cmark_next_ctag;
+    Node* node = nullptr;
+    if (!find(head, prev, pmark_curr_ptag, cmark_next_ctag, so_key, key, &node)) {
+        return nullptr;
+    }
+    return node;
+}
+
+template <typename K, typename V, typename Eq>
+bool SplitOrderedList<K, V, Eq>::Step(Cursor& cursor, Node*& node) {
+    node = nullptr;
+    if (cursor.curr == nullptr) {
+        return true;
+    }
+    auto curr_node = to_node(cursor.curr);
+    MarkPtrType cmark_next_ctag;
+    cmark_next_ctag.ptr = atomic_ptr(curr_node->next.ptr)->load(std::memory_order_acquire);
+    if (curr_node->so_key > cursor.so_key) {
+        return true;
+    }
+    if (curr_node->so_key == cursor.so_key && !cmark_next_ctag.is_mark_delete() && eq(curr_node->key, *cursor.key)) {
+        node = curr_node;
+        return true;
+    }
+    cursor.curr = list_next(cmark_next_ctag);
+    __builtin_prefetch(cursor.curr);
+    return false;
+}
+
+template <typename K, typename V, typename Eq>
+bool SplitOrderedList<K, V, Eq>::find(MarkPtrType* head, MarkPtrType*& prev, MarkPtrType& pmark_curr_ptag,
+                                      MarkPtrType& cmark_next_ctag, uint64_t so_key, K const& key, Node** node) {
+    prev = head;
+    pmark_curr_ptag = *prev;
+    while (true) {
+        if (list_next(pmark_curr_ptag) == nullptr) {
+            return false;
+        }
+        cmark_next_ctag = *list_next(pmark_curr_ptag);
+        auto curr_node = to_node(list_next(pmark_curr_ptag));
+        auto c_so_key = curr_node->so_key;
+        // read prev again, if prev is mutated or marked, then retry from scratch.
+        auto prev_old = MarkPtrType(pmark_curr_ptag.get(), 0, pmark_curr_ptag.get_tag());
+        if (!prev->equal_to(prev_old)) {
+            prev = head;
+            pmark_curr_ptag = *prev;
+            continue;
+        }
+        if (!cmark_next_ctag.is_mark_delete()) {
+            if (c_so_key > so_key) {
+                return false;
+            }
+            if (c_so_key == so_key && eq(curr_node->key, key)) {
+                if (node != nullptr) {
+                    *node = curr_node;
+                }
+                return true;
+            }
+            // advance prev
+            prev = list_next(pmark_curr_ptag);
+        } else {
+            auto prev_new = MarkPtrType(cmark_next_ctag.get(), 0, pmark_curr_ptag.get_tag() + 1);
+            if (atomic_ptr(prev->ptr)->compare_exchange_strong(prev_old.ptr, prev_new.ptr, std::memory_order_acq_rel)) {
+                pool.Retire(curr_node);
+                // now prev->get_tag() == pmark_curr_ptag.get_tag()+1
+                cmark_next_ctag.set_tag(pmark_curr_ptag.get_tag() + 1);
+            } else {
+                prev = head;
+                pmark_curr_ptag = *prev;
+                continue;
+            }
+        }
+        // advance pmark_curr_ptag, so pmark_curr_ptag keep consistent with *prev
+        pmark_curr_ptag = cmark_next_ctag;
+    }
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_SPLIT_ORDERED_LIST_HH
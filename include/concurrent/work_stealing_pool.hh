@@ -0,0 +1,80 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/22.
+//
+
+#ifndef CPP_ETUDES_WORK_STEALING_POOL_HH
+#define CPP_ETUDES_WORK_STEALING_POOL_HH
+#include <async.hh>
+#include <atomic>
+#include <concurrent/chase_lev_deque.hh>
+#include <folly/synchronization/ParkingLot.h>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <vector>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+// every worker owns a ChaseLevDeque, tasks spawned by a worker are pushed to
+// its own deque and taken LIFO, idle workers steal FIFO from the others, tasks
+// submitted by non-worker threads go through a shared injection queue. workers
+// out of work park on a folly::ParkingLot and are woken one per new task.
+class WorkStealingPool {
+public:
+    using Task = std::function<void()>;
+    using RangeFunc = std::function<void(size_t, size_t)>;
+
+    explicit WorkStealingPool(size_t worker_nr = std::thread::hardware_concurrency());
+    ~WorkStealingPool();
+    size_t get_worker_nr() { return this->workers.size(); }
+
+    void Submit(Task task);
+    // run fn(b, e) over sub-ranges of [begin, end) no larger than grain and
+    // wait for all of them. the range is split in halves recursively, so idle
+    // workers steal the big halves first. a worker calling ParallelFor runs
+    // other tasks while waiting, so ParallelFor can be nested.
+    void ParallelFor(size_t begin, size_t end, size_t grain, RangeFunc const& fn);
+
+private:
+    struct TaskNode {
+        Task fn;
+    };
+    struct ForJob {
+        RangeFunc const& fn;
+        const size_t grain;
+        std::atomic<size_t> remaining;
+    };
+    struct alignas(64) Worker {
+        ChaseLevDeque<TaskNode*> deque;
+        std::thread thread;
+    };
+
+    WorkStealingPool(WorkStealingPool const&) = delete;
+    WorkStealingPool& operator=(WorkStealingPool const&) = delete;
+    Worker* current_worker();
+    void push(TaskNode* task);
+    TaskNode* find_task(Worker* self);
+    void run(TaskNode* task);
+    void run_range(ForJob* job, size_t begin, size_t end);
+    void notify();
+    void work(Worker* self);
+
+    std::vector<std::unique_ptr<Worker>> workers;
+    async::ConcurrentQueue<TaskNode*> injection;
+    std::atomic<bool> stop;
+    // bumped on every notification, idle workers only park if it is unchanged
+    // since they found no task.
+    std::atomic<uint64_t> work_epoch;
+    std::atomic<size_t> idle_nr;
+    folly::ParkingLot<> idle_lot;
+};
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+#endif // CPP_ETUDES_WORK_STEALING_POOL_HH
@@ -0,0 +1,253 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/19.
+//
+
+#ifndef CPP_ETUDES_DECIMAL128_AGG_HH
+#define CPP_ETUDES_DECIMAL128_AGG_HH
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <decimal/decimal128_div.hh>
+#include <decimal/decimal_exp10.hh>
+
+// the state of SUM/AVG over decimal128 values x = (hi << 64) + lo: the sum is
+// hi_sum * 2^64 + lo_sum, i.e. the low and the high halves are summed apart
+// and neither sum can overflow before 2^63 rows. so a row costs two 128-bit
+// adds and no overflow check; whether the sum fits the result type is told
+// once, when the state is finalized.
+struct Decimal128SumState {
+    uint128_t lo_sum{0};
+    int128_t hi_sum{0};
+    int64_t count{0};
+};
+
+namespace decimal_internal {
+// the lane sums of a block are folded into the state once per block, a lane
+// sums the 32-bit quarters of DECIMAL128_SUM_BLOCK / 2 rows at most.
+constexpr size_t DECIMAL128_SUM_BLOCK = 4096;
+
+static inline void decimal128_sum_add_row(Decimal128SumState& state, int128_t x) {
+    state.lo_sum += static_cast<uint64_t>(x);
+    state.hi_sum += static_cast<int64_t>(x >> 64);
+}
+
+// 2 rows in a register: [lo0, hi0, lo1, hi1]. the low 32 bits of each 64-bit
+// word go to low_sums, the high 32 bits to high_sums, sign-extended for the
+// high halves of the rows.
+static inline void decimal128_sum_add_x2(__m256i v, __m256i& low_sums, __m256i& high_sums) {
+    const auto low_mask = _mm256_set1_epi64x(0xffffffffll);
+    auto high = _mm256_blend_epi32(_mm256_srli_epi64(v, 32), _mm256_srai_epi32(v, 31), 0b10001000);
+    low_sums = _mm256_add_epi64(low_sums, _mm256_and_si256(v, low_mask));
+    high_sums = _mm256_add_epi64(high_sums, high);
+}
+
+// the null flags of 2 rows to a mask that keeps the non-null rows, flags
+// holds the flags of 4 rows, row pair k = 0 or 1.
+template <int k>
+static inline __m256i decimal128_sum_keep_x2(__m128i flags) {
+    const auto spread =
+            _mm_setr_epi8(2 * k, 2 * k, 2 * k + 1, 2 * k + 1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1, -1);
+    auto pair = _mm256_cvtepu8_epi64(_mm_shuffle_epi8(flags, spread));
+    return _mm256_cmpeq_epi64(pair, _mm256_setzero_si256());
+}
+
+template <bool nullable>
+static inline void decimal128_sum_block(Decimal128SumState& state, int128_t const* data, uint8_t const* nulls,
+                                        size_t n) {
+    auto low_sums0 = _mm256_setzero_si256();
+    auto high_sums0 = _mm256_setzero_si256();
+    auto low_sums1 = _mm256_setzero_si256();
+    auto high_sums1 = _mm256_setzero_si256();
+    size_t i = 0;
+    // two pairs of accumulators, or the adds of consecutive rows would wait
+    // for each other.
+    for (; i + 4 <= n; i += 4) {
+        auto v0 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i));
+        auto v1 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(data + i + 2));
+        if constexpr (nullable) {
+            uint32_t flags32;
+            memcpy(&flags32, nulls + i, 4);
+            auto flags = _mm_cvtsi32_si128(static_cast<int>(flags32));
+            v0 = _mm256_and_si256(v0, decimal128_sum_keep_x2<0>(flags));
+            v1 = _mm256_and_si256(v1, decimal128_sum_keep_x2<1>(flags));
+        }
+        decimal128_sum_add_x2(v0, low_sums0, high_sums0);
+        decimal128_sum_add_x2(v1, low_sums1, high_sums1);
+    }
+    alignas(32) uint64_t low[4];
+    alignas(32) int64_t high[4];
+    _mm256_store_si256(reinterpret_cast<__m256i*>(low), _mm256_add_epi64(low_sums0, low_sums1));
+    _mm256_store_si256(reinterpret_cast<__m256i*>(high), _mm256_add_epi64(high_sums0, high_sums1));
+    // words 0 and 2 are of the low halves, words 1 and 3 of the high halves.
+    state.lo_sum += static_cast<uint128_t>(low[0]) + low[2] + ((static_cast<uint128_t>(high[0]) + high[2]) << 32);
+    state.hi_sum += static_cast<int128_t>(low[1]) + low[3] + (static_cast<int128_t>(high[1]) + high[3]) * (1ll << 32);
+    for (; i < n; ++i) {
+        if constexpr (nullable) {
+            decimal128_sum_add_row(state, nulls[i] == 0 ? data[i] : 0);
+        } else {
+            decimal128_sum_add_row(state, data[i]);
+        }
+    }
+    if constexpr (nullable) {
+        size_t null_nr = 0;
+        for (size_t k = 0; k < n; ++k) {
+            null_nr += nulls[k] != 0;
+        }
+        state.count += n - null_nr;
+    } else {
+        state.count += n;
+    }
+}
+
+template <bool nullable>
+static inline void decimal128_sum_grouped(Decimal128SumState* states, uint32_t const* group_ids,
+                                          int128_t const* data, uint8_t const* nulls, size_t n) {
+    for (size_t i = 0; i < n; ++i) {
+        auto& state = states[group_ids[i]];
+        if constexpr (nullable) {
+            // null rows add 0 instead of branching.
+            uint128_t keep = static_cast<uint128_t>(nulls[i] != 0) - 1;
+            decimal128_sum_add_row(state, static_cast<int128_t>(static_cast<uint128_t>(data[i]) & keep));
+            state.count += nulls[i] == 0;
+        } else {
+            decimal128_sum_add_row(state, data[i]);
+            ++state.count;
+        }
+    }
+}
+
+// the sum of a state as sign and 192-bit magnitude (m2:m1:m0).
+static inline bool decimal128_sum_magnitude(Decimal128SumState const& state, uint64_t& m2, uint64_t& m1,
+                                            uint64_t& m0) {
+    // sum = mid * 2^64 + low 64 bits of lo_sum, |hi_sum| < 2^126 so mid does
+    // not overflow.
+    int128_t mid = state.hi_sum + static_cast<int128_t>(state.lo_sum >> 64);
+    m0 = static_cast<uint64_t>(state.lo_sum);
+    m1 = static_cast<uint64_t>(mid);
+    m2 = static_cast<uint64_t>(mid >> 64);
+    bool negative = mid < 0;
+    if (negative) {
+        m0 = -m0;
+        m1 = ~m1 + (m0 == 0);
+        m2 = ~m2 + (m0 == 0 && m1 == 0);
+    }
+    return negative;
+}
+
+// (m1:m0) as a decimal(precision, *) value, false if it has more digits.
+static inline bool decimal128_fit(bool negative, uint64_t m2, uint64_t m1, uint64_t m0, int128_t max_result,
+                                  int128_t& result) {
+    uint128_t m = static_cast<uint128_t>(m1) << 64 | m0;
+    if (m2 != 0 || m > static_cast<uint128_t>(max_result)) {
+        result = 0;
+        return false;
+    }
+    result = negative ? -static_cast<int128_t>(m) : static_cast<int128_t>(m);
+    return true;
+}
+} // namespace decimal_internal
+
+// state += the non-null rows of data, nulls holds one byte per row(non-zero
+// is null) or is nullptr.
+static inline void decimal128_sum_update(Decimal128SumState& state, int128_t const* data, uint8_t const* nulls,
+                                         size_t n) {
+    using namespace decimal_internal;
+    for (size_t base = 0; base < n; base += DECIMAL128_SUM_BLOCK) {
+        auto m = std::min(DECIMAL128_SUM_BLOCK, n - base);
+        if (nulls != nullptr) {
+            decimal128_sum_block<true>(state, data + base, nulls + base, m);
+        } else {
+            decimal128_sum_block<false>(state, data + base, nullptr, m);
+        }
+    }
+}
+
+// states[group_ids[i]] += data[i] for the non-null rows, the group ids are
+// dense, i.e. indexes of states.
+static inline void decimal128_sum_update_grouped(Decimal128SumState* states, uint32_t const* group_ids,
+                                                 int128_t const* data, uint8_t const* nulls, size_t n) {
+    if (nulls != nullptr) {
+        decimal_internal::decimal128_sum_grouped<true>(states, group_ids, data, nulls, n);
+    } else {
+        decimal_internal::decimal128_sum_grouped<false>(states, group_ids, data, nullptr, n);
+    }
+}
+
+static inline void decimal128_sum_merge(Decimal128SumState& dst, Decimal128SumState const& src) {
+    dst.lo_sum += src.lo_sum;
+    dst.hi_sum += src.hi_sum;
+    dst.count += src.count;
+}
+
+// result[i] = the sum of states[i], it has the scale of the rows. bit i of
+// overflow(bitmap_size(n) bytes) is set and result[i] is 0 iff the sum has
+// more than precision digits. return the number of such states.
+static inline size_t decimal128_sum_finalize(Decimal128SumState const* states, size_t n, int precision,
+                                             int128_t* result, uint8_t* overflow) {
+    using namespace decimal_internal;
+    const int128_t max_result = max_decimal_of(precision);
+    memset(overflow, 0, bitmap_size(n));
+    size_t overflow_nr = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint64_t m2, m1, m0;
+        bool negative = decimal128_sum_magnitude(states[i], m2, m1, m0);
+        if (!decimal128_fit(negative, m2, m1, m0, max_result, result[i])) {
+            overflow[i >> 3] |= 1 << (i & 7);
+            ++overflow_nr;
+        }
+    }
+    return overflow_nr;
+}
+
+// result[i] = the sum of states[i] * scale_up / the count of states[i],
+// rounding half away from zero, scale_up = 10^(result scale - scale of the
+// rows). result[i] is 0 if the count is 0, i.e. AVG is NULL. otherwise like
+// decimal128_sum_finalize.
+static inline size_t decimal128_avg_finalize(Decimal128SumState const* states, size_t n, int precision,
+                                             uint64_t scale_up, int128_t* result, uint8_t* overflow) {
+    using namespace decimal_internal;
+    const int128_t max_result = max_decimal_of(precision);
+    memset(overflow, 0, bitmap_size(n));
+    size_t overflow_nr = 0;
+    for (size_t i = 0; i < n; ++i) {
+        auto count = static_cast<uint64_t>(states[i].count);
+        if (count == 0) {
+            result[i] = 0;
+            continue;
+        }
+        uint64_t m2, m1, m0;
+        bool negative = decimal128_sum_magnitude(states[i], m2, m1, m0);
+        // the 256-bit product, a quotient of it above 2^192 does not fit.
+        uint128_t p0 = static_cast<uint128_t>(m0) * scale_up;
+        uint128_t p1 = static_cast<uint128_t>(m1) * scale_up + static_cast<uint64_t>(p0 >> 64);
+        uint128_t p2 = static_cast<uint128_t>(m2) * scale_up + static_cast<uint64_t>(p1 >> 64);
+        bool ok = (p2 >> 64) == 0;
+        // the quotient by long division, the 128/64 steps never overflow
+        // since each remainder is below count.
+        uint64_t r;
+        uint64_t q2 = static_cast<uint64_t>(p2) / count;
+        r = static_cast<uint64_t>(p2) % count;
+        uint64_t q1 = udiv128by64to64(r, static_cast<uint64_t>(p1), count, &r);
+        uint64_t q0 = udiv128by64to64(r, static_cast<uint64_t>(p0), count, &r);
+        uint64_t up = round_up<uint64_t>(count, r);
+        q0 += up;
+        q1 += q0 < up;
+        q2 += q1 == 0 && q0 < up;
+        if (!ok || !decimal128_fit(negative, q2, q1, q0, max_result, result[i])) {
+            result[i] = 0;
+            overflow[i >> 3] |= 1 << (i & 7);
+            ++overflow_nr;
+        }
+    }
+    return overflow_nr;
+}
+
+#endif // CPP_ETUDES_DECIMAL128_AGG_HH
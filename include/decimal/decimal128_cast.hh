@@ -0,0 +1,158 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/22.
+//
+
+#ifndef CPP_ETUDES_DECIMAL128_CAST_HH
+#define CPP_ETUDES_DECIMAL128_CAST_HH
+
+#include <immintrin.h>
+
+#include <cmath>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <decimal/decimal128_column.hh>
+#include <decimal/decimal_exp10.hh>
+
+// float/double to decimal128(precision, scale): the value is multiplied by
+// 10^scale in double and truncated toward zero, i.e.
+// static_cast<int128_t>(v * static_cast<double>(10^scale)). the truncation is
+// exact, a product of 2^70 converts to 2^70, not to a rounded int64.
+//
+// a row is null when the product is NaN, +/-inf or its magnitude is not below
+// 10^precision. since the product is a double, |x| < 10^precision iff
+// |x| < bound, the least double not below 10^precision, so one compare tells
+// both the overflow and the non-finite rows.
+namespace decimal_internal {
+struct DoubleToDecimal128 {
+    DoubleToDecimal128(int precision, int scale) {
+        const int128_t max_value = exp10_of(precision);
+        scale_factor = static_cast<double>(exp10_of(scale));
+        bound = static_cast<double>(max_value);
+        if (static_cast<int128_t>(bound) < max_value) {
+            bound = std::nextafter(bound, INFINITY);
+        }
+    }
+    double scale_factor;
+    double bound;
+};
+
+// return the null flag of the row.
+static inline uint8_t double_to_decimal128(double v, DoubleToDecimal128 const& cast, int128_t& result) {
+    double x = v * cast.scale_factor;
+    if (!(std::fabs(x) < cast.bound)) {
+        result = 0;
+        return 1;
+    }
+    result = static_cast<int128_t>(x);
+    return 0;
+}
+
+// 4 products to int128: x = m * 2^sh, m is the 53-bit mantissa with the
+// implicit bit, the magnitude is m << sh or m >> -sh in two 64-bit words.
+// vpsllvq/vpsrlvq give 0 for counts above 63, negative ones included, so no
+// lane needs a branch; zeros and denormals are shifted out entirely.
+// return the null bits of the 4 rows.
+static inline int double_to_decimal128_x4(__m256d x, __m256d bound, int128_t* result) {
+    const auto abs_mask = _mm256_castsi256_pd(_mm256_set1_epi64x(0x7fffffffffffffffll));
+    const auto mantissa_mask = _mm256_set1_epi64x((1ll << 52) - 1);
+    const auto implicit_bit = _mm256_set1_epi64x(1ll << 52);
+    const auto exp_mask = _mm256_set1_epi64x(0x7ff);
+    const auto bias = _mm256_set1_epi64x(1075);
+    const auto c64 = _mm256_set1_epi64x(64);
+    const auto zero = _mm256_setzero_si256();
+    const auto ones = _mm256_set1_epi64x(-1);
+
+    // ordered compare, false for NaN.
+    auto keep = _mm256_castpd_si256(_mm256_cmp_pd(_mm256_and_pd(x, abs_mask), bound, _CMP_LT_OQ));
+    auto bits = _mm256_castpd_si256(x);
+    auto sign = _mm256_cmpgt_epi64(zero, bits);
+    auto m = _mm256_or_si256(_mm256_and_si256(bits, mantissa_mask), implicit_bit);
+    auto sh = _mm256_sub_epi64(_mm256_and_si256(_mm256_srli_epi64(bits, 52), exp_mask), bias);
+    auto lo = _mm256_or_si256(_mm256_sllv_epi64(m, sh), _mm256_srlv_epi64(m, _mm256_sub_epi64(zero, sh)));
+    auto hi = _mm256_or_si256(_mm256_srlv_epi64(m, _mm256_sub_epi64(c64, sh)),
+                              _mm256_sllv_epi64(m, _mm256_sub_epi64(sh, c64)));
+    // -(hi, lo) = (~hi + (lo == 0), -lo).
+    auto neg_lo = _mm256_sub_epi64(zero, lo);
+    auto neg_hi = _mm256_sub_epi64(_mm256_xor_si256(hi, ones), _mm256_cmpeq_epi64(lo, zero));
+    lo = _mm256_and_si256(_mm256_blendv_epi8(lo, neg_lo, sign), keep);
+    hi = _mm256_and_si256(_mm256_blendv_epi8(hi, neg_hi, sign), keep);
+    // [lo0, hi0, lo2, hi2] and [lo1, hi1, lo3, hi3].
+    auto r02 = _mm256_unpacklo_epi64(lo, hi);
+    auto r13 = _mm256_unpackhi_epi64(lo, hi);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(result), _mm256_permute2x128_si256(r02, r13, 0x20));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(result + 2), _mm256_permute2x128_si256(r02, r13, 0x31));
+    return _mm256_movemask_pd(_mm256_castsi256_pd(keep)) ^ 0xf;
+}
+
+static inline __m256d load_as_double_x4(double const* src) {
+    return _mm256_loadu_pd(src);
+}
+
+static inline __m256d load_as_double_x4(float const* src) {
+    return _mm256_cvtps_pd(_mm_loadu_ps(src));
+}
+
+template <typename T>
+static inline size_t float_to_decimal128(T const* src, size_t n, int precision, int scale, int128_t* result,
+                                         uint8_t* nulls) {
+    DoubleToDecimal128 cast(precision, scale);
+    const auto scale_factor = _mm256_set1_pd(cast.scale_factor);
+    const auto bound = _mm256_set1_pd(cast.bound);
+    size_t null_nr = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        auto x0 = _mm256_mul_pd(load_as_double_x4(src + i), scale_factor);
+        auto x1 = _mm256_mul_pd(load_as_double_x4(src + i + 4), scale_factor);
+        int bits = double_to_decimal128_x4(x0, bound, result + i);
+        bits |= double_to_decimal128_x4(x1, bound, result + i + 4) << 4;
+        nulls[i >> 3] = bits;
+        null_nr += __builtin_popcount(bits);
+    }
+    if (i < n) {
+        uint8_t bits = 0;
+        for (size_t k = 0; i + k < n; ++k) {
+            bits |= double_to_decimal128(src[i + k], cast, result[i + k]) << k;
+        }
+        nulls[i >> 3] = bits;
+        null_nr += __builtin_popcount(bits);
+    }
+    return null_nr;
+}
+} // namespace decimal_internal
+
+// convert n doubles to decimal128(precision, scale), 1 <= precision <= 38,
+// 0 <= scale <= 38. nulls must hold bitmap_size(n) bytes; bit i is set and
+// result[i] is 0 iff src[i] * 10^scale is NaN, infinite or does not fit the
+// precision. return the number of such rows.
+static inline size_t decimal128_from_double(double const* src, size_t n, int precision, int scale,
+                                            int128_t* result, uint8_t* nulls) {
+    return decimal_internal::float_to_decimal128(src, n, precision, scale, result, nulls);
+}
+
+// floats are widened to double first, which is exact.
+static inline size_t decimal128_from_float(float const* src, size_t n, int precision, int scale, int128_t* result,
+                                           uint8_t* nulls) {
+    return decimal_internal::float_to_decimal128(src, n, precision, scale, result, nulls);
+}
+
+// the scalar path, row by row.
+template <typename T>
+size_t decimal128_from_float_scalar(T const* src, size_t n, int precision, int scale, int128_t* result,
+                                    uint8_t* nulls) {
+    decimal_internal::DoubleToDecimal128 cast(precision, scale);
+    size_t null_nr = 0;
+    for (size_t i = 0; i < n; ++i) {
+        uint8_t is_null = decimal_internal::double_to_decimal128(src[i], cast, result[i]);
+        nulls[i >> 3] = (nulls[i >> 3] & ~(1 << (i & 7))) | is_null << (i & 7);
+        null_nr += is_null;
+    }
+    return null_nr;
+}
+
+#endif // CPP_ETUDES_DECIMAL128_CAST_HH
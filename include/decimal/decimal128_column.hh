@@ -0,0 +1,195 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/14.
+//
+
+#ifndef CPP_ETUDES_DECIMAL128_COLUMN_HH
+#define CPP_ETUDES_DECIMAL128_COLUMN_HH
+
+#include <immintrin.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <decimal/decimal_exp10.hh>
+#include <vector>
+
+// decimal128 column in split layout: row i is (int128_t(hi[i]) << 64) | lo[i],
+// so the low and the high halves of 4 rows fill one AVX2 register each.
+struct Decimal128Column {
+    std::vector<uint64_t> lo;
+    std::vector<int64_t> hi;
+
+    Decimal128Column() = default;
+    explicit Decimal128Column(size_t n) : lo(n), hi(n) {}
+    Decimal128Column(int128_t const* data, size_t n) : lo(n), hi(n) {
+        for (size_t i = 0; i < n; ++i) {
+            set(i, data[i]);
+        }
+    }
+
+    size_t size() const { return lo.size(); }
+    void resize(size_t n) {
+        lo.resize(n);
+        hi.resize(n);
+    }
+    int128_t get(size_t i) const { return static_cast<int128_t>(static_cast<__uint128_t>(hi[i]) << 64 | lo[i]); }
+    void set(size_t i, int128_t v) {
+        lo[i] = static_cast<uint64_t>(v);
+        hi[i] = static_cast<int64_t>(v >> 64);
+    }
+    void to_int128(int128_t* data) const {
+        for (size_t i = 0; i < size(); ++i) {
+            data[i] = get(i);
+        }
+    }
+};
+
+// a bitmap holds bit i % 8 of byte i / 8 for row i.
+static inline size_t bitmap_size(size_t n) {
+    return (n + 7) / 8;
+}
+
+static inline bool bitmap_test(uint8_t const* bitmap, size_t i) {
+    return (bitmap[i >> 3] >> (i & 7)) & 1;
+}
+
+namespace decimal_internal {
+// 128-bit add/sub of one row without branches, the signed overflow of x+y or
+// x-y is told by the sign bits of the high halves alone.
+template <bool is_sub>
+static inline uint8_t decimal128_add_sub_row(uint64_t a_lo, int64_t a_hi, uint64_t b_lo, int64_t b_hi, uint64_t& c_lo,
+                                             int64_t& c_hi) {
+    uint64_t ov;
+    if constexpr (is_sub) {
+        c_lo = a_lo - b_lo;
+        c_hi = static_cast<int64_t>(static_cast<uint64_t>(a_hi) - static_cast<uint64_t>(b_hi) - (a_lo < b_lo));
+        ov = (a_hi ^ b_hi) & (a_hi ^ c_hi);
+    } else {
+        c_lo = a_lo + b_lo;
+        c_hi = static_cast<int64_t>(static_cast<uint64_t>(a_hi) + static_cast<uint64_t>(b_hi) + (c_lo < a_lo));
+        ov = (c_hi ^ a_hi) & (c_hi ^ b_hi);
+    }
+    return ov >> 63;
+}
+
+// 4 rows per call, return the overflow bits of the rows.
+template <bool is_sub>
+static inline uint8_t decimal128_add_sub_x4(uint64_t const* a_lo, int64_t const* a_hi, uint64_t const* b_lo,
+                                            int64_t const* b_hi, uint64_t* c_lo, int64_t* c_hi) {
+    const auto sign = _mm256_set1_epi64x(INT64_MIN);
+    auto x_lo = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a_lo));
+    auto x_hi = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(a_hi));
+    auto y_lo = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b_lo));
+    auto y_hi = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(b_hi));
+    __m256i z_lo, z_hi, ov;
+    // AVX2 has no unsigned 64-bit compare, flipping the sign bits turns it into
+    // a signed one; the all-ones lanes of the mask are -1, i.e. carry/borrow.
+    if constexpr (is_sub) {
+        z_lo = _mm256_sub_epi64(x_lo, y_lo);
+        auto borrow = _mm256_cmpgt_epi64(_mm256_xor_si256(y_lo, sign), _mm256_xor_si256(x_lo, sign));
+        z_hi = _mm256_add_epi64(_mm256_sub_epi64(x_hi, y_hi), borrow);
+        ov = _mm256_and_si256(_mm256_xor_si256(x_hi, y_hi), _mm256_xor_si256(x_hi, z_hi));
+    } else {
+        z_lo = _mm256_add_epi64(x_lo, y_lo);
+        auto carry = _mm256_cmpgt_epi64(_mm256_xor_si256(x_lo, sign), _mm256_xor_si256(z_lo, sign));
+        z_hi = _mm256_sub_epi64(_mm256_add_epi64(x_hi, y_hi), carry);
+        ov = _mm256_and_si256(_mm256_xor_si256(z_hi, x_hi), _mm256_xor_si256(z_hi, y_hi));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(c_lo), z_lo);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(c_hi), z_hi);
+    return _mm256_movemask_pd(_mm256_castsi256_pd(ov));
+}
+
+// null flags of 8 rows(one byte per row, non-zero is null) to 8 bits.
+static inline uint8_t null_flags_x8(uint8_t const* nulls) {
+    auto flags = _mm_loadl_epi64(reinterpret_cast<__m128i const*>(nulls));
+    return ~_mm_movemask_epi8(_mm_cmpeq_epi8(flags, _mm_setzero_si128()));
+}
+
+// c = a +/- b over n rows, overflow bit i is set iff row i overflows int128
+// and neither a nor b is null. when nullable, c_null[i] = a_null[i] |
+// b_null[i]; null rows are computed too, their results are unspecified. return
+// the number of overflowed rows.
+template <bool is_sub, bool nullable>
+size_t decimal128_add_sub(uint64_t const* a_lo, int64_t const* a_hi, uint64_t const* b_lo, int64_t const* b_hi,
+                          uint64_t* c_lo, int64_t* c_hi, size_t n, uint8_t* overflow, uint8_t const* a_null = nullptr,
+                          uint8_t const* b_null = nullptr, uint8_t* c_null = nullptr) {
+    size_t overflow_nr = 0;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint8_t ov = decimal128_add_sub_x4<is_sub>(a_lo + i, a_hi + i, b_lo + i, b_hi + i, c_lo + i, c_hi + i);
+        ov |= decimal128_add_sub_x4<is_sub>(a_lo + i + 4, a_hi + i + 4, b_lo + i + 4, b_hi + i + 4, c_lo + i + 4,
+                                            c_hi + i + 4)
+              << 4;
+        if constexpr (nullable) {
+            uint64_t x, y;
+            memcpy(&x, a_null + i, 8);
+            memcpy(&y, b_null + i, 8);
+            x |= y;
+            memcpy(c_null + i, &x, 8);
+            ov &= ~null_flags_x8(c_null + i);
+        }
+        overflow[i >> 3] = ov;
+        overflow_nr += __builtin_popcount(ov);
+    }
+    if (i < n) {
+        uint8_t ov = 0;
+        for (auto k = 0; i + k < n; ++k) {
+            auto row = i + k;
+            uint8_t row_ov = decimal128_add_sub_row<is_sub>(a_lo[row], a_hi[row], b_lo[row], b_hi[row], c_lo[row],
+                                                            c_hi[row]);
+            if constexpr (nullable) {
+                c_null[row] = a_null[row] | b_null[row];
+                row_ov &= c_null[row] == 0;
+            }
+            ov |= row_ov << k;
+        }
+        overflow[i >> 3] = ov;
+        overflow_nr += __builtin_popcount(ov);
+    }
+    return overflow_nr;
+}
+} // namespace decimal_internal
+
+// c = a + b, overflow must hold bitmap_size(a.size()) bytes. return the number
+// of rows that overflow int128.
+static inline size_t decimal128_add(Decimal128Column const& a, Decimal128Column const& b, Decimal128Column& c,
+                                    uint8_t* overflow) {
+    c.resize(a.size());
+    return decimal_internal::decimal128_add_sub<false, false>(a.lo.data(), a.hi.data(), b.lo.data(), b.hi.data(),
+                                                              c.lo.data(), c.hi.data(), a.size(), overflow);
+}
+
+static inline size_t decimal128_sub(Decimal128Column const& a, Decimal128Column const& b, Decimal128Column& c,
+                                    uint8_t* overflow) {
+    c.resize(a.size());
+    return decimal_internal::decimal128_add_sub<true, false>(a.lo.data(), a.hi.data(), b.lo.data(), b.hi.data(),
+                                                             c.lo.data(), c.hi.data(), a.size(), overflow);
+}
+
+// nullable variants, a_null/b_null/c_null hold one byte per row, overflow of
+// null rows is not reported.
+static inline size_t decimal128_add_nullable(Decimal128Column const& a, uint8_t const* a_null,
+                                             Decimal128Column const& b, uint8_t const* b_null, Decimal128Column& c,
+                                             uint8_t* c_null, uint8_t* overflow) {
+    c.resize(a.size());
+    return decimal_internal::decimal128_add_sub<false, true>(a.lo.data(), a.hi.data(), b.lo.data(), b.hi.data(),
+                                                             c.lo.data(), c.hi.data(), a.size(), overflow, a_null,
+                                                             b_null, c_null);
+}
+
+static inline size_t decimal128_sub_nullable(Decimal128Column const& a, uint8_t const* a_null,
+                                             Decimal128Column const& b, uint8_t const* b_null, Decimal128Column& c,
+                                             uint8_t* c_null, uint8_t* overflow) {
+    c.resize(a.size());
+    return decimal_internal::decimal128_add_sub<true, true>(a.lo.data(), a.hi.data(), b.lo.data(), b.hi.data(),
+                                                            c.lo.data(), c.hi.data(), a.size(), overflow, a_null,
+                                                            b_null, c_null);
+}
+
+#endif // CPP_ETUDES_DECIMAL128_COLUMN_HH
@@ -0,0 +1,216 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/17.
+//
+
+#ifndef CPP_ETUDES_DECIMAL128_DIV_HH
+#define CPP_ETUDES_DECIMAL128_DIV_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <decimal/decimal128_column.hh>
+#include <decimal/decimal_exp10.hh>
+
+namespace decimal_internal {
+// rows are divided a block at a time, the scratch of a block stays in L1. the
+// 16-byte scratch arrays are not 4KB long, or their rows would alias in the
+// store buffer at 4KB distance.
+constexpr size_t DECIMAL128_DIV_BLOCK = 248;
+
+// the narrowest division a row needs, told by the magnitudes.
+enum Decimal128DivPath : uint8_t {
+    // dividend and divisor < 2^64: one 64-bit(or 32-bit) div.
+    DIV_64_64,
+    // divisor < 2^64 <= dividend: one or two divq.
+    DIV_128_64,
+    // divisor >= 2^64: __udivti3/__umodti3, the quotient is below 2^64 though.
+    DIV_128_128,
+    DIV_PATH_NR,
+};
+
+// (u1:u0) / v, u1 < v, i.e. the quotient fits in 64 bits.
+static inline uint64_t udiv128by64to64(uint64_t u1, uint64_t u0, uint64_t v, uint64_t* r) {
+    uint64_t q;
+    __asm__("divq %[v]" : "=a"(q), "=d"(*r) : [v] "r"(v), "a"(u0), "d"(u1));
+    return q;
+}
+
+// the rounding is a coin flip on real data and compilers turn a comparison of
+// uint128 into a branch, so whether remainder >= divisor - remainder is told
+// by the sign bit of divisor - 2 * remainder - 1, remainder < divisor <= 2^(w-1).
+template <typename U>
+static inline U round_up(U divisor, U remainder) {
+    return (divisor - (remainder << 1) - 1) >> (sizeof(U) * 8 - 1);
+}
+
+// all the operands and lhs * scale fit in int64, so every row is one 64-bit
+// or 32-bit div, the whole division is done in one pass without scratch. return false if
+// some lhs * scale does not fit, the block is left to decimal128_div_wide.
+static inline bool decimal128_div_narrow(int128_t const* lhs, int128_t const* rhs, int128_t* result, size_t n,
+                                         int64_t scale, uint8_t* row_overflow) {
+    bool product_ov = false;
+    for (size_t k = 0; k < n; ++k) {
+        int64_t a;
+        product_ov |= __builtin_mul_overflow(static_cast<int64_t>(lhs[k]), scale, &a);
+        auto b = static_cast<int64_t>(rhs[k]);
+        uint64_t sa = a >> 63;
+        uint64_t sb = b >> 63;
+        uint64_t ua = (static_cast<uint64_t>(a) ^ sa) - sa;
+        uint64_t ub = (static_cast<uint64_t>(b) ^ sb) - sb;
+        uint8_t ov = b == 0;
+        ub |= ov;
+        // a 64-bit div takes several times as long as a 32-bit one on many
+        // x86 cores, and the magnitudes of most rows fit in 32 bits, so the
+        // branch is well predicted.
+        uint64_t q, r;
+        if (((ua | ub) >> 32) == 0) {
+            q = static_cast<uint32_t>(ua) / static_cast<uint32_t>(ub);
+            r = static_cast<uint32_t>(ua) % static_cast<uint32_t>(ub);
+        } else {
+            q = ua / ub;
+            r = ua % ub;
+        }
+        // q <= 2^63, i.e. no int128 overflow.
+        q += round_up(ub, r);
+        uint128_t s = -static_cast<uint128_t>((sa ^ sb) & 1);
+        uint128_t keep = static_cast<uint128_t>(ov) - 1;
+        result[k] = static_cast<int128_t>(((static_cast<uint128_t>(q) ^ s) - s) & keep);
+        row_overflow[k] = ov;
+    }
+    return !product_ov;
+}
+
+static inline void decimal128_div_wide(int128_t const* lhs, int128_t const* rhs, int128_t* result, size_t n,
+                                       int128_t scale, uint8_t* row_overflow) {
+    uint128_t dividend[DECIMAL128_DIV_BLOCK];
+    uint128_t divisor[DECIMAL128_DIV_BLOCK];
+    uint128_t quotient[DECIMAL128_DIV_BLOCK];
+    uint128_t remainder[DECIMAL128_DIV_BLOCK];
+    uint8_t negative[DECIMAL128_DIV_BLOCK];
+    uint16_t selection[DIV_PATH_NR][DECIMAL128_DIV_BLOCK];
+    size_t nr64 = 0, nr128_64 = 0, nr128 = 0;
+
+    // magnitudes and signs. rows are partitioned by path without branches:
+    // the row index is written to every selection, only the counter of its
+    // path advances.
+    for (size_t k = 0; k < n; ++k) {
+        int128_t a;
+        bool ov = __builtin_mul_overflow(lhs[k], scale, &a);
+        int128_t b = rhs[k];
+        ov |= b == 0;
+        uint128_t sa = static_cast<uint128_t>(a >> 127);
+        uint128_t sb = static_cast<uint128_t>(b >> 127);
+        uint128_t ua = (static_cast<uint128_t>(a) ^ sa) - sa;
+        uint128_t ub = (static_cast<uint128_t>(b) ^ sb) - sb;
+        // x / 0 is computed as x / 1 and reported as overflow.
+        ub |= ub == 0;
+        dividend[k] = ua;
+        divisor[k] = ub;
+        negative[k] = static_cast<uint8_t>((sa ^ sb) & 1);
+        row_overflow[k] = ov;
+        bool divisor_wide = (ub >> 64) != 0;
+        bool dividend_wide = (ua >> 64) != 0;
+        selection[DIV_64_64][nr64] = k;
+        selection[DIV_128_64][nr128_64] = k;
+        selection[DIV_128_128][nr128] = k;
+        nr64 += !divisor_wide & !dividend_wide;
+        nr128_64 += !divisor_wide & dividend_wide;
+        nr128 += divisor_wide;
+    }
+
+    for (size_t j = 0; j < nr64; ++j) {
+        auto k = selection[DIV_64_64][j];
+        auto x = static_cast<uint64_t>(dividend[k]);
+        auto y = static_cast<uint64_t>(divisor[k]);
+        quotient[k] = x / y;
+        remainder[k] = x % y;
+    }
+    for (size_t j = 0; j < nr128_64; ++j) {
+        auto k = selection[DIV_128_64][j];
+        auto x1 = static_cast<uint64_t>(dividend[k] >> 64);
+        auto x0 = static_cast<uint64_t>(dividend[k]);
+        auto y = static_cast<uint64_t>(divisor[k]);
+        // divq faults if the quotient exceeds 64 bits, so x1 is reduced first.
+        uint64_t q1 = x1 / y;
+        uint64_t r;
+        uint64_t q0 = udiv128by64to64(x1 % y, x0, y, &r);
+        quotient[k] = static_cast<uint128_t>(q1) << 64 | q0;
+        remainder[k] = r;
+    }
+    for (size_t j = 0; j < nr128; ++j) {
+        auto k = selection[DIV_128_128][j];
+        quotient[k] = dividend[k] / divisor[k];
+        remainder[k] = dividend[k] % divisor[k];
+    }
+
+    // round half away from zero, restore the signs.
+    for (size_t k = 0; k < n; ++k) {
+        uint128_t q = quotient[k] + round_up(divisor[k], remainder[k]);
+        uint128_t s = -static_cast<uint128_t>(negative[k]);
+        // q <= 2^127 + 1, 2^127 is representable only when negative.
+        auto q_hi = static_cast<uint64_t>(q >> 64);
+        auto q_lo = static_cast<uint64_t>(q);
+        uint8_t ov = row_overflow[k] | ((q_hi >> 63) & ~(negative[k] & (q_hi == (1ull << 63)) & (q_lo == 0)));
+        row_overflow[k] = ov;
+        uint128_t keep = static_cast<uint128_t>(ov) - 1;
+        result[k] = static_cast<int128_t>(((q ^ s) - s) & keep);
+    }
+}
+
+// one block of decimal128_div, overflow points to the byte of row 0 of the
+// block.
+static inline size_t decimal128_div_block(int128_t const* lhs, int128_t const* rhs, int128_t* result, size_t n,
+                                          int128_t scale, uint8_t* overflow) {
+    uint8_t row_overflow[DECIMAL128_DIV_BLOCK];
+    // 64-bit operands are the common case, they are told without a branch per
+    // row.
+    uint64_t wide = (scale >> 63) != 0;
+    for (size_t k = 0; k < n; ++k) {
+        auto a = static_cast<int64_t>(lhs[k]);
+        auto b = static_cast<int64_t>(rhs[k]);
+        wide |= static_cast<uint64_t>(lhs[k] >> 64) ^ static_cast<uint64_t>(a >> 63);
+        wide |= static_cast<uint64_t>(rhs[k] >> 64) ^ static_cast<uint64_t>(b >> 63);
+    }
+    if (wide != 0 || !decimal128_div_narrow(lhs, rhs, result, n, static_cast<int64_t>(scale), row_overflow)) {
+        decimal128_div_wide(lhs, rhs, result, n, scale, row_overflow);
+    }
+
+    // the flags of the rows past n in the last 8 rows are garbage.
+    size_t overflow_nr = 0;
+    for (size_t base = 0; base < n; base += 8) {
+        uint8_t bits = null_flags_x8(row_overflow + base);
+        if (n - base < 8) {
+            bits &= (1u << (n - base)) - 1;
+        }
+        overflow[base >> 3] = bits;
+        overflow_nr += __builtin_popcount(bits);
+    }
+    return overflow_nr;
+}
+} // namespace decimal_internal
+
+// result[i] = lhs[i] * scale / rhs[i] rounding half away from zero, scale is
+// 10^(result scale + rhs scale - lhs scale) >= 1. each row is routed to the
+// narrowest of 64/64, 128/64 and 128/128 division by the magnitudes of its
+// operands, rows of the same path are divided in one tight loop; a block of
+// rows that all fit in int64 is divided in one pass instead. overflow
+// must hold bitmap_size(n) bytes; bit i is set and result[i] is 0 iff
+// rhs[i] is 0 or lhs[i] * scale or the quotient overflows int128. return the
+// number of such rows.
+static inline size_t decimal128_div(int128_t const* lhs, int128_t const* rhs, int128_t* result, size_t n,
+                                    int128_t scale, uint8_t* overflow) {
+    size_t overflow_nr = 0;
+    for (size_t base = 0; base < n; base += decimal_internal::DECIMAL128_DIV_BLOCK) {
+        auto m = std::min(decimal_internal::DECIMAL128_DIV_BLOCK, n - base);
+        overflow_nr += decimal_internal::decimal128_div_block(lhs + base, rhs + base, result + base, m, scale,
+                                                              overflow + (base >> 3));
+    }
+    return overflow_nr;
+}
+
+#endif // CPP_ETUDES_DECIMAL128_DIV_HH
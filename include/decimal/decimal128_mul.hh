@@ -0,0 +1,189 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/20.
+//
+
+#ifndef CPP_ETUDES_DECIMAL128_MUL_HH
+#define CPP_ETUDES_DECIMAL128_MUL_HH
+
+#include <cstddef>
+#include <cstdint>
+#include <decimal/decimal128_div.hh>
+#include <decimal/decimal_exp10.hh>
+#include <decimal/divider.hh>
+
+// how the digits dropped by a scale-down round the magnitude of the result.
+enum class DecimalRoundingMode : uint8_t {
+    // half away from zero, like divide_round.
+    HALF_UP,
+    // half to the even neighbour.
+    HALF_EVEN,
+    // toward zero.
+    TRUNCATE,
+};
+
+namespace decimal_internal {
+// the 256-bit product of two magnitudes, w[0] is the least significant word.
+// 4 64x64->128 products; the compiler emits mulx for them when BMI2 is on.
+static inline void mul_128x128(uint128_t a, uint128_t b, uint64_t* w) {
+    uint64_t a0 = static_cast<uint64_t>(a), a1 = static_cast<uint64_t>(a >> 64);
+    uint64_t b0 = static_cast<uint64_t>(b), b1 = static_cast<uint64_t>(b >> 64);
+    uint128_t p00 = static_cast<uint128_t>(a0) * b0;
+    uint128_t p01 = static_cast<uint128_t>(a0) * b1;
+    uint128_t p10 = static_cast<uint128_t>(a1) * b0;
+    uint128_t p11 = static_cast<uint128_t>(a1) * b1;
+    uint128_t mid = (p00 >> 64) + static_cast<uint64_t>(p01) + static_cast<uint64_t>(p10);
+    uint128_t hi = p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+    w[0] = static_cast<uint64_t>(p00);
+    w[1] = static_cast<uint64_t>(mid);
+    w[2] = static_cast<uint64_t>(hi);
+    w[3] = static_cast<uint64_t>(hi >> 64);
+}
+
+// w /= d in place by a divq per word, d < 2^64. return the remainder.
+static inline uint64_t div_256_by_64(uint64_t* w, uint64_t d) {
+    uint64_t r = 0;
+    for (int i = w[3] != 0 ? 3 : 2; i >= 0; --i) {
+        w[i] = udiv128by64to64(r, w[i], d, &r);
+    }
+    return r;
+}
+
+// rounding is a coin flip on real data, so it is told by sign bits instead of
+// comparisons of uint128 that compilers turn into branches, r < d <= 2^(w-1).
+template <DecimalRoundingMode mode, typename U>
+static inline U round_quotient(U q, U r, U d) {
+    if constexpr (mode == DecimalRoundingMode::HALF_UP) {
+        return q + round_up(d, r);
+    } else if constexpr (mode == DecimalRoundingMode::HALF_EVEN) {
+        // c < 0 iff r > d / 2, c = 0 iff r = d / 2.
+        U c = d - (r << 1);
+        if constexpr (sizeof(U) == 16) {
+            auto c_hi = static_cast<uint64_t>(c >> 64);
+            auto c_lo = static_cast<uint64_t>(c);
+            return q + ((c_hi >> 63) | (((c_hi | c_lo) == 0) & static_cast<uint64_t>(q)));
+        } else {
+            return q + ((c >> (sizeof(U) * 8 - 1)) | ((c == 0) & q));
+        }
+    } else {
+        return q;
+    }
+}
+
+// the divisor 10^k of mul_rescale: the Divider serves products below 2^128,
+// the rest is divided by lo_factor and then by hi_factor, both below 2^64;
+// floor(floor(p / lo) / hi) = floor(p / (lo * hi)) and the remainder of p is
+// r2 * lo + r1.
+struct MulRescaleDivisor {
+    explicit MulRescaleDivisor(int k)
+            : lo_factor(exp10_of<uint64_t>(k < 19 ? k : 19)),
+              hi_factor(exp10_of<uint64_t>(k < 19 ? 0 : k - 19)),
+              factor(static_cast<uint128_t>(lo_factor) * hi_factor),
+              divider(factor) {}
+    uint64_t lo_factor;
+    uint64_t hi_factor;
+    uint128_t factor;
+    Divider<uint128_t> divider;
+};
+
+// return the overflow flag of the row.
+template <DecimalRoundingMode mode, DividerAlgo A>
+static inline uint8_t mul_rescale_row(int128_t x, int128_t y, MulRescaleDivisor const& down, int128_t& result) {
+    uint128_t sx = static_cast<uint128_t>(x >> 127);
+    uint128_t sy = static_cast<uint128_t>(y >> 127);
+    uint128_t ux = (static_cast<uint128_t>(x) ^ sx) - sx;
+    uint128_t uy = (static_cast<uint128_t>(y) ^ sy) - sy;
+    uint128_t s = sx ^ sy;
+    uint64_t w[4];
+    if (__builtin_expect(((ux | uy) >> 64) == 0, 1)) {
+        uint128_t p = static_cast<uint128_t>(static_cast<uint64_t>(ux)) * static_cast<uint64_t>(uy);
+        w[0] = static_cast<uint64_t>(p);
+        w[1] = static_cast<uint64_t>(p >> 64);
+        w[2] = w[3] = 0;
+    } else {
+        mul_128x128(ux, uy, w);
+    }
+    uint128_t q, r;
+    uint8_t ov = 0;
+    if (__builtin_expect((w[2] | w[3]) == 0, 1)) {
+        uint128_t p = static_cast<uint128_t>(w[1]) << 64 | w[0];
+        q = down.divider.template divide<A>(p);
+        if (w[1] == 0) {
+            // r <= p < 2^64, so it is exact in 64 bits.
+            r = w[0] - static_cast<uint64_t>(q) * static_cast<uint64_t>(down.factor);
+        } else {
+            r = p - q * down.factor;
+        }
+    } else {
+        uint64_t r1 = div_256_by_64(w, down.lo_factor);
+        uint64_t r2 = down.hi_factor != 1 ? div_256_by_64(w, down.hi_factor) : 0;
+        ov = (w[2] | w[3]) != 0;
+        q = static_cast<uint128_t>(w[1]) << 64 | w[0];
+        r = static_cast<uint128_t>(r2) * down.lo_factor + r1;
+    }
+    // q < 2^127 before rounding, so rounding up does not wrap.
+    ov |= static_cast<uint8_t>(q >> 127);
+    q = round_quotient<mode>(q, r, down.factor);
+    ov |= static_cast<uint8_t>(q >> 127);
+    uint128_t keep = static_cast<uint128_t>(ov) - 1;
+    result = static_cast<int128_t>(((q ^ s) - s) & keep);
+    return ov;
+}
+
+template <DecimalRoundingMode mode, DividerAlgo A>
+static inline size_t decimal128_mul_rescale(int128_t const* lhs, int128_t const* rhs, int128_t* result, size_t n,
+                                            MulRescaleDivisor const& down, uint8_t* overflow) {
+    size_t overflow_nr = 0;
+    for (size_t base = 0; base < n; base += 8) {
+        size_t m = n - base < 8 ? n - base : 8;
+        uint8_t bits = 0;
+        for (size_t k = 0; k < m; ++k) {
+            auto i = base + k;
+            bits |= mul_rescale_row<mode, A>(lhs[i], rhs[i], down, result[i]) << k;
+        }
+        overflow[base >> 3] = bits;
+        overflow_nr += __builtin_popcount(bits);
+    }
+    return overflow_nr;
+}
+} // namespace decimal_internal
+
+// result[i] = lhs[i] * rhs[i] / 10^down_scale rounded by mode, down_scale =
+// lhs scale + rhs scale - result scale, 0 <= down_scale <= 38. the product is
+// kept in 256 bits, so it may exceed int128 as long as the result does not.
+// a product below 2^128 is divided by a precomputed reciprocal, a wider one
+// by at most 8 divq. overflow must hold bitmap_size(n) bytes; bit i is set
+// and result[i] is 0 iff the result overflows int128. return the number of
+// such rows.
+template <DecimalRoundingMode mode>
+size_t decimal128_mul_rescale(int128_t const* lhs, int128_t const* rhs, int128_t* result, size_t n, int down_scale,
+                              uint8_t* overflow) {
+    using namespace decimal_internal;
+    MulRescaleDivisor down(down_scale);
+    switch (down.divider.get_algo()) {
+    case DividerAlgo::SHIFT:
+        return decimal128_mul_rescale<mode, DividerAlgo::SHIFT>(lhs, rhs, result, n, down, overflow);
+    case DividerAlgo::MUL_SHIFT:
+        return decimal128_mul_rescale<mode, DividerAlgo::MUL_SHIFT>(lhs, rhs, result, n, down, overflow);
+    default:
+        return decimal128_mul_rescale<mode, DividerAlgo::MUL_ADD_SHIFT>(lhs, rhs, result, n, down, overflow);
+    }
+}
+
+static inline size_t decimal128_mul_rescale(int128_t const* lhs, int128_t const* rhs, int128_t* result, size_t n,
+                                            int down_scale, DecimalRoundingMode mode, uint8_t* overflow) {
+    switch (mode) {
+    case DecimalRoundingMode::HALF_UP:
+        return decimal128_mul_rescale<DecimalRoundingMode::HALF_UP>(lhs, rhs, result, n, down_scale, overflow);
+    case DecimalRoundingMode::HALF_EVEN:
+        return decimal128_mul_rescale<DecimalRoundingMode::HALF_EVEN>(lhs, rhs, result, n, down_scale, overflow);
+    default:
+        return decimal128_mul_rescale<DecimalRoundingMode::TRUNCATE>(lhs, rhs, result, n, down_scale, overflow);
+    }
+}
+
+#endif // CPP_ETUDES_DECIMAL128_MUL_HH
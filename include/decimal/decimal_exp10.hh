@@ -0,0 +1,52 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/25.
+//
+
+#ifndef CPP_ETUDES_DECIMAL_EXP10_HH
+#define CPP_ETUDES_DECIMAL_EXP10_HH
+
+#include <cstddef>
+#include <cstdint>
+
+typedef __int128 int128_t;
+typedef unsigned __int128 uint128_t;
+
+// powers of ten shared by the decimal kernels, all computed at compile time.
+namespace decimal_internal {
+constexpr int DECIMAL_EXP10_NR = 39;
+
+struct DecimalExp10Table {
+    // exp10[n] = 10^n.
+    int128_t exp10[DECIMAL_EXP10_NR];
+    // max_decimal[p] = 10^p - 1, the largest magnitude of decimal(p).
+    int128_t max_decimal[DECIMAL_EXP10_NR];
+    constexpr DecimalExp10Table() : exp10(), max_decimal() {
+        int128_t v = 1;
+        for (int n = 0; n < DECIMAL_EXP10_NR; ++n) {
+            exp10[n] = v;
+            max_decimal[n] = v - 1;
+            v = n + 1 < DECIMAL_EXP10_NR ? v * 10 : v;
+        }
+    }
+};
+static constexpr DecimalExp10Table DECIMAL_EXP10_TABLE{};
+
+// 10^n, 0 <= n <= 38 and 10^n must fit T.
+template <typename T = int128_t>
+static constexpr T exp10_of(int n) {
+    return static_cast<T>(DECIMAL_EXP10_TABLE.exp10[n]);
+}
+
+// 10^precision - 1, 0 <= precision <= 38.
+template <typename T = int128_t>
+static constexpr T max_decimal_of(int precision) {
+    return static_cast<T>(DECIMAL_EXP10_TABLE.max_decimal[precision]);
+}
+} // namespace decimal_internal
+
+#endif // CPP_ETUDES_DECIMAL_EXP10_HH
@@ -0,0 +1,317 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/24.
+//
+
+#ifndef CPP_ETUDES_DECIMAL_RESCALE_HH
+#define CPP_ETUDES_DECIMAL_RESCALE_HH
+
+#include <immintrin.h>
+
+#include <array>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <decimal/decimal128_column.hh>
+#include <decimal/decimal128_mul.hh>
+#include <decimal/decimal_exp10.hh>
+#include <decimal/divider.hh>
+#include <utility>
+
+// rescale a column of decimal32/decimal64/decimal128 by 10^k, k known at
+// compile time. scaling up multiplies and may overflow the result precision,
+// scaling down divides with rounding and never overflows.
+//
+// decimal32 takes 8 rows and decimal64 4 rows per AVX2 op: the products are
+// vpmulld, or 3 vpmuludq for the 64-bit ones, and the overflow is told by
+// comparing the rows with (10^precision - 1) / 10^k before multiplying.
+// decimal32 is divided by a 32-bit magic number in vpmuludq, decimal64 and
+// decimal128 by a magic number per row, there is no 64-bit multiply-high in
+// AVX2.
+namespace decimal_internal {
+template <typename T>
+struct rescale_traits;
+template <>
+struct rescale_traits<int32_t> {
+    static constexpr int MAX_SCALE = 9;
+};
+template <>
+struct rescale_traits<int64_t> {
+    static constexpr int MAX_SCALE = 18;
+};
+template <>
+struct rescale_traits<int128_t> {
+    static constexpr int MAX_SCALE = 38;
+};
+
+// the largest magnitude that does not overflow decimal(precision) after it
+// is scaled up by 10^k.
+template <typename T>
+static constexpr T scale_up_bound(int precision, int k) {
+    return precision > k ? max_decimal_of<T>(precision - k) : 0;
+}
+
+// return the overflow flag of the row.
+template <typename T, int k>
+static inline uint8_t scale_up_row(T v, T bound, T& result) {
+    using U = typename divider_traits<T>::unsigned_type;
+    constexpr U factor = exp10_of<U>(k);
+    // -bound <= v <= bound iff v + bound <= 2 * bound, modulo 2^w.
+    auto ov = static_cast<uint8_t>(static_cast<U>(v) + static_cast<U>(bound) > static_cast<U>(bound) << 1);
+    U keep = static_cast<U>(ov) - 1;
+    result = static_cast<T>(static_cast<U>(v) * factor & keep);
+    return ov;
+}
+
+// decimal32 and decimal64: the compiler divides by the constant 10^k with a
+// multiply-high.
+template <typename T, int k, DecimalRoundingMode mode>
+static inline T scale_down_row(T v) {
+    using U = typename divider_traits<T>::unsigned_type;
+    constexpr U factor = exp10_of<U>(k);
+    U s = static_cast<U>(v >> (sizeof(U) * 8 - 1));
+    U u = (static_cast<U>(v) ^ s) - s;
+    U q = u / factor;
+    q = round_quotient<mode>(q, u - q * factor, factor);
+    return static_cast<T>((q ^ s) - s);
+}
+
+// a uint128 divided by a constant is still a __udivti3 call, so decimal128
+// goes through a Divider.
+template <DecimalRoundingMode mode, DividerAlgo A>
+static inline int128_t scale_down_row(int128_t v, Divider<uint128_t> const& divider) {
+    uint128_t factor = divider.divisor();
+    uint128_t s = static_cast<uint128_t>(v >> 127);
+    uint128_t u = (static_cast<uint128_t>(v) ^ s) - s;
+    uint128_t q = divider.template divide<A>(u);
+    q = round_quotient<mode>(q, u - q * factor, factor);
+    return static_cast<int128_t>((q ^ s) - s);
+}
+
+template <int k>
+static inline int scale_up_x8(int32_t const* src, __m256i bound, __m256i neg_bound, int32_t* dst) {
+    const auto factor = _mm256_set1_epi32(exp10_of<int32_t>(k));
+    auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src));
+    auto ov = _mm256_or_si256(_mm256_cmpgt_epi32(v, bound), _mm256_cmpgt_epi32(neg_bound, v));
+    auto product = _mm256_mullo_epi32(v, factor);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_andnot_si256(ov, product));
+    return _mm256_movemask_ps(_mm256_castsi256_ps(ov));
+}
+
+// v * 10^k mod 2^64 = lo * f_lo + ((hi * f_lo + lo * f_hi) << 32), where lo and
+// hi are the 32-bit halves of v; vpmuludq multiplies the low halves of lanes.
+template <int k>
+static inline int scale_up_x4(int64_t const* src, __m256i bound, __m256i neg_bound, int64_t* dst) {
+    constexpr uint64_t FACTOR = exp10_of<uint64_t>(k);
+    const auto factor_lo = _mm256_set1_epi64x(FACTOR & 0xffffffffull);
+    auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src));
+    auto ov = _mm256_or_si256(_mm256_cmpgt_epi64(v, bound), _mm256_cmpgt_epi64(neg_bound, v));
+    auto cross = _mm256_mul_epu32(_mm256_srli_epi64(v, 32), factor_lo);
+    if constexpr ((FACTOR >> 32) != 0) {
+        const auto factor_hi = _mm256_set1_epi64x(FACTOR >> 32);
+        cross = _mm256_add_epi64(cross, _mm256_mul_epu32(v, factor_hi));
+    }
+    auto product = _mm256_add_epi64(_mm256_mul_epu32(v, factor_lo), _mm256_slli_epi64(cross, 32));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_andnot_si256(ov, product));
+    return _mm256_movemask_pd(_mm256_castsi256_pd(ov));
+}
+
+// u / 10^k = (u * MAGIC) >> SHIFT for u < 2^31, with SHIFT = 31 + ceil(log2(10^k))
+// and MAGIC = ceil(2^SHIFT / 10^k) < 2^32.
+template <int k>
+struct Decimal32DivMagic {
+    static constexpr uint32_t FACTOR = exp10_of<uint32_t>(k);
+    static constexpr int LOG2 = [] {
+        int l = 0;
+        while ((1ull << l) < FACTOR) {
+            ++l;
+        }
+        return l;
+    }();
+    static constexpr int SHIFT = 31 + LOG2;
+    static constexpr uint64_t MAGIC = ((1ull << SHIFT) + FACTOR - 1) / FACTOR;
+    static_assert(MAGIC >> 32 == 0, "magic number of decimal32 is above 2^32");
+};
+
+template <int k, DecimalRoundingMode mode>
+static inline void scale_down_x8(int32_t const* src, int32_t* dst) {
+    using Magic = Decimal32DivMagic<k>;
+    const auto magic = _mm256_set1_epi64x(Magic::MAGIC);
+    const auto factor = _mm256_set1_epi32(Magic::FACTOR);
+    auto v = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(src));
+    auto s = _mm256_srai_epi32(v, 31);
+    auto u = _mm256_sub_epi32(_mm256_xor_si256(v, s), s);
+    auto q_even = _mm256_srli_epi64(_mm256_mul_epu32(u, magic), Magic::SHIFT);
+    auto q_odd = _mm256_srli_epi64(_mm256_mul_epu32(_mm256_srli_epi64(u, 32), magic), Magic::SHIFT);
+    auto q = _mm256_blend_epi32(q_even, _mm256_slli_epi64(q_odd, 32), 0b10101010);
+    // r < 10^k <= 10^9, so 2 * r does not wrap.
+    auto twice_r = _mm256_slli_epi32(_mm256_sub_epi32(u, _mm256_mullo_epi32(q, factor)), 1);
+    if constexpr (mode == DecimalRoundingMode::HALF_UP) {
+        auto c = _mm256_sub_epi32(_mm256_sub_epi32(factor, twice_r), _mm256_set1_epi32(1));
+        q = _mm256_add_epi32(q, _mm256_srli_epi32(c, 31));
+    } else if constexpr (mode == DecimalRoundingMode::HALF_EVEN) {
+        auto c = _mm256_sub_epi32(factor, twice_r);
+        auto tie = _mm256_and_si256(_mm256_cmpeq_epi32(c, _mm256_setzero_si256()), q);
+        q = _mm256_add_epi32(q, _mm256_or_si256(_mm256_srli_epi32(c, 31), _mm256_and_si256(tie, _mm256_set1_epi32(1))));
+    }
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(dst), _mm256_sub_epi32(_mm256_xor_si256(q, s), s));
+}
+
+template <typename T, int k>
+static inline size_t scale_up_tail(T const* src, T* dst, size_t i, size_t n, T bound, uint8_t* overflow) {
+    if (i >= n) {
+        return 0;
+    }
+    uint8_t bits = 0;
+    for (size_t j = 0; i + j < n; ++j) {
+        bits |= scale_up_row<T, k>(src[i + j], bound, dst[i + j]) << j;
+    }
+    overflow[i >> 3] = bits;
+    return __builtin_popcount(bits);
+}
+
+template <DecimalRoundingMode mode, DividerAlgo A>
+static inline void decimal128_scale_down(int128_t const* src, int128_t* dst, size_t n,
+                                         Divider<uint128_t> const& divider) {
+    for (size_t i = 0; i < n; ++i) {
+        dst[i] = scale_down_row<mode, A>(src[i], divider);
+    }
+}
+} // namespace decimal_internal
+
+// dst[i] = src[i] * 10^k, decimal(precision - k) to decimal(precision),
+// precision <= 9/18/38 for T = int32_t/int64_t/int128_t. overflow must hold
+// bitmap_size(n) bytes; bit i is set and dst[i] is 0 iff |src[i] * 10^k| >=
+// 10^precision. return the number of such rows. src and dst may be the same
+// column.
+template <typename T, int k>
+size_t decimal_scale_up(T const* src, T* dst, size_t n, int precision, uint8_t* overflow) {
+    using namespace decimal_internal;
+    static_assert(0 <= k && k <= rescale_traits<T>::MAX_SCALE, "scale out of range");
+    const T bound = scale_up_bound<T>(precision, k);
+    size_t overflow_nr = 0;
+    size_t i = 0;
+    if constexpr (sizeof(T) == 4) {
+        const auto bound_x8 = _mm256_set1_epi32(bound);
+        const auto neg_bound_x8 = _mm256_set1_epi32(-bound);
+        for (; i + 8 <= n; i += 8) {
+            int bits = scale_up_x8<k>(src + i, bound_x8, neg_bound_x8, dst + i);
+            overflow[i >> 3] = bits;
+            overflow_nr += __builtin_popcount(bits);
+        }
+    } else if constexpr (sizeof(T) == 8) {
+        const auto bound_x4 = _mm256_set1_epi64x(bound);
+        const auto neg_bound_x4 = _mm256_set1_epi64x(-bound);
+        for (; i + 8 <= n; i += 8) {
+            int bits = scale_up_x4<k>(src + i, bound_x4, neg_bound_x4, dst + i);
+            bits |= scale_up_x4<k>(src + i + 4, bound_x4, neg_bound_x4, dst + i + 4) << 4;
+            overflow[i >> 3] = bits;
+            overflow_nr += __builtin_popcount(bits);
+        }
+    } else {
+        // masking costs more than the multiply here, the rare overflowed rows
+        // are cleared afterwards.
+        constexpr uint128_t FACTOR = exp10_of<uint128_t>(k);
+        const auto ubound = static_cast<uint128_t>(bound);
+        const auto range = ubound << 1;
+        for (; i + 8 <= n; i += 8) {
+            uint8_t bits = 0;
+            for (size_t j = 0; j < 8; ++j) {
+                T v = src[i + j];
+                bits |= static_cast<uint8_t>(static_cast<uint128_t>(v) + ubound > range) << j;
+                dst[i + j] = static_cast<T>(static_cast<uint128_t>(v) * FACTOR);
+            }
+            overflow[i >> 3] = bits;
+            if (__builtin_expect(bits != 0, 0)) {
+                for (size_t j = 0; j < 8; ++j) {
+                    dst[i + j] = (bits >> j) & 1 ? 0 : dst[i + j];
+                }
+                overflow_nr += __builtin_popcount(bits);
+            }
+        }
+    }
+    return overflow_nr + scale_up_tail<T, k>(src, dst, i, n, bound, overflow);
+}
+
+// dst[i] = src[i] / 10^k rounded by mode, decimal(precision) to
+// decimal(precision - k). src and dst may be the same column.
+template <typename T, int k, DecimalRoundingMode mode = DecimalRoundingMode::HALF_UP>
+void decimal_scale_down(T const* src, T* dst, size_t n) {
+    using namespace decimal_internal;
+    static_assert(0 <= k && k <= rescale_traits<T>::MAX_SCALE, "scale out of range");
+    if constexpr (k == 0) {
+        if (src != dst) {
+            memmove(dst, src, n * sizeof(T));
+        }
+    } else if constexpr (sizeof(T) == 16) {
+        Divider<uint128_t> divider(exp10_of<uint128_t>(k));
+        if (divider.get_algo() == DividerAlgo::MUL_SHIFT) {
+            decimal128_scale_down<mode, DividerAlgo::MUL_SHIFT>(src, dst, n, divider);
+        } else {
+            decimal128_scale_down<mode, DividerAlgo::MUL_ADD_SHIFT>(src, dst, n, divider);
+        }
+    } else {
+        size_t i = 0;
+        if constexpr (sizeof(T) == 4) {
+            for (; i + 8 <= n; i += 8) {
+                scale_down_x8<k, mode>(src + i, dst + i);
+            }
+        }
+        for (; i < n; ++i) {
+            dst[i] = scale_down_row<T, k, mode>(src[i]);
+        }
+    }
+}
+
+// the kernels of every k for scales known only at runtime.
+namespace decimal_internal {
+template <typename T>
+using ScaleUpFn = size_t (*)(T const*, T*, size_t, int, uint8_t*);
+template <typename T>
+using ScaleDownFn = void (*)(T const*, T*, size_t);
+
+template <typename T, size_t... K>
+static constexpr std::array<ScaleUpFn<T>, sizeof...(K)> make_scale_up_table(std::index_sequence<K...>) {
+    return {&decimal_scale_up<T, K>...};
+}
+
+template <typename T, DecimalRoundingMode mode, size_t... K>
+static constexpr std::array<ScaleDownFn<T>, sizeof...(K)> make_scale_down_table(std::index_sequence<K...>) {
+    return {&decimal_scale_down<T, K, mode>...};
+}
+
+template <typename T>
+inline constexpr auto SCALE_UP_KERNELS =
+        make_scale_up_table<T>(std::make_index_sequence<rescale_traits<T>::MAX_SCALE + 1>());
+
+template <typename T, DecimalRoundingMode mode>
+inline constexpr auto SCALE_DOWN_KERNELS =
+        make_scale_down_table<T, mode>(std::make_index_sequence<rescale_traits<T>::MAX_SCALE + 1>());
+} // namespace decimal_internal
+
+template <typename T>
+size_t decimal_scale_up(T const* src, T* dst, size_t n, int k, int precision, uint8_t* overflow) {
+    assert(0 <= k && k <= decimal_internal::rescale_traits<T>::MAX_SCALE);
+    return decimal_internal::SCALE_UP_KERNELS<T>[k](src, dst, n, precision, overflow);
+}
+
+template <typename T>
+void decimal_scale_down(T const* src, T* dst, size_t n, int k, DecimalRoundingMode mode) {
+    using namespace decimal_internal;
+    assert(0 <= k && k <= rescale_traits<T>::MAX_SCALE);
+    switch (mode) {
+    case DecimalRoundingMode::HALF_UP:
+        return SCALE_DOWN_KERNELS<T, DecimalRoundingMode::HALF_UP>[k](src, dst, n);
+    case DecimalRoundingMode::HALF_EVEN:
+        return SCALE_DOWN_KERNELS<T, DecimalRoundingMode::HALF_EVEN>[k](src, dst, n);
+    default:
+        return SCALE_DOWN_KERNELS<T, DecimalRoundingMode::TRUNCATE>[k](src, dst, n);
+    }
+}
+
+#endif // CPP_ETUDES_DECIMAL_RESCALE_HH
@@ -0,0 +1,359 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/18.
+//
+
+#ifndef CPP_ETUDES_DECIMAL_STRING_HH
+#define CPP_ETUDES_DECIMAL_STRING_HH
+
+#include <immintrin.h>
+
+#include <algorithm>
+#include <binary_column.hh>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <decimal/decimal128_div.hh>
+#include <decimal/decimal_exp10.hh>
+
+// a decimal(p, s) in text is [+-]digits[.digits], p <= 38. parsing keeps s
+// fraction digits and rounds half up by the next one; more than p - s
+// significant integer digits, a result beyond p digits or a malformed text is
+// an error. formatting emits the minimal integer part and exactly s fraction
+// digits.
+namespace decimal_internal {
+// the normalized digits of a row: right-aligned, zero-padded, 6 groups of 8.
+constexpr size_t DECIMAL_TEXT_DIGITS = 48;
+// texts longer than it go through the scalar parser.
+constexpr size_t DECIMAL_TEXT_MAX_SIMD = 48;
+// sign, 39 digits of int128, '.' and the leading "0" of a fraction-only value.
+constexpr size_t DECIMAL_TEXT_MAX_FORMAT = 42;
+
+constexpr uint64_t EXP10_8 = exp10_of<uint64_t>(8);
+constexpr uint64_t EXP10_9 = exp10_of<uint64_t>(9);
+constexpr uint64_t EXP10_16 = exp10_of<uint64_t>(16);
+constexpr uint64_t EXP10_18 = exp10_of<uint64_t>(18);
+
+// the scalar parser, it is the fallback of over-long texts and the reference
+// of the SIMD one.
+static inline bool parse_decimal128_scalar(char const* s, size_t len, int precision, int scale, int128_t& value) {
+    value = 0;
+    size_t i = 0;
+    bool negative = false;
+    if (len > 0 && (s[0] == '-' || s[0] == '+')) {
+        negative = s[0] == '-';
+        ++i;
+    }
+    int int_digits = 0;
+    int frac_digits = 0;
+    int digits = 0;
+    bool dot = false;
+    bool round_up = false;
+    int128_t v = 0;
+    for (; i < len; ++i) {
+        char c = s[i];
+        if (c == '.') {
+            if (dot) {
+                return false;
+            }
+            dot = true;
+            continue;
+        }
+        if (c < '0' || c > '9') {
+            return false;
+        }
+        ++digits;
+        if (!dot) {
+            if (v == 0 && c == '0') {
+                continue;
+            }
+            if (++int_digits > precision - scale) {
+                return false;
+            }
+            v = v * 10 + (c - '0');
+        } else if (frac_digits < scale) {
+            ++frac_digits;
+            v = v * 10 + (c - '0');
+        } else if (frac_digits++ == scale) {
+            round_up = c >= '5';
+        }
+    }
+    if (digits == 0) {
+        return false;
+    }
+    for (; frac_digits < scale; ++frac_digits) {
+        v *= 10;
+    }
+    v += round_up;
+    if (v > max_decimal_of(precision)) {
+        return false;
+    }
+    value = negative ? -v : v;
+    return true;
+}
+
+// 16 digits(0-9 each byte) to two 8-digit values: pairs, quads, then octets
+// by multiply-add, the most significant digit first.
+static inline uint64_t convert_digits16(__m128i d) {
+    const auto mul_10 = _mm_setr_epi8(10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1, 10, 1);
+    const auto mul_100 = _mm_setr_epi16(100, 1, 100, 1, 100, 1, 100, 1);
+    const auto mul_10000 = _mm_setr_epi16(10000, 1, 10000, 1, 10000, 1, 10000, 1);
+    auto pairs = _mm_maddubs_epi16(d, mul_10);
+    auto quads = _mm_madd_epi16(pairs, mul_100);
+    auto octets = _mm_madd_epi16(_mm_packus_epi32(quads, quads), mul_10000);
+    auto v = static_cast<uint64_t>(_mm_cvtsi128_si64(octets));
+    return (v & 0xffffffffull) * EXP10_8 + (v >> 32);
+}
+
+static inline uint64_t parse_digits16(char const* p) {
+    return convert_digits16(
+            _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p)), _mm_set1_epi8('0')));
+}
+
+// the kept digits of a text of at most 16 bytes, right-aligned in 16 bytes
+// by one shuffle instead of a round trip through memory: kept digit k, at
+// byte j = k + 16 - total, comes from byte k + leading_zeros of the text, one
+// byte further past the '.'; bytes before the first kept digit and past the
+// last one are zeroed.
+static inline uint64_t parse_short_text(char const* p, int leading_zeros, int int_digits, int kept_frac_digits,
+                                        int total) {
+    auto k = _mm_add_epi8(_mm_setr_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15),
+                          _mm_set1_epi8(static_cast<char>(total - 16)));
+    auto in_frac = _mm_cmpgt_epi8(k, _mm_set1_epi8(static_cast<char>(int_digits - 1)));
+    auto before = _mm_cmpgt_epi8(_mm_setzero_si128(), k);
+    auto pad = _mm_cmpgt_epi8(k, _mm_set1_epi8(static_cast<char>(int_digits + kept_frac_digits - 1)));
+    auto index = _mm_sub_epi8(_mm_add_epi8(k, _mm_set1_epi8(static_cast<char>(leading_zeros))), in_frac);
+    index = _mm_or_si128(index, _mm_or_si128(before, pad));
+    auto d = _mm_sub_epi8(_mm_loadu_si128(reinterpret_cast<__m128i const*>(p)), _mm_set1_epi8('0'));
+    return convert_digits16(_mm_shuffle_epi8(d, index));
+}
+
+// masks of the digits, the dots and the '0's among the first 48 bytes of p.
+static inline void classify_text48(char const* p, uint64_t& digit_mask, uint64_t& dot_mask, uint64_t& zero_mask) {
+    const auto zero32 = _mm256_set1_epi8('0');
+    const auto nine32 = _mm256_set1_epi8(9);
+    const auto dot32 = _mm256_set1_epi8('.');
+    auto v32 = _mm256_loadu_si256(reinterpret_cast<__m256i const*>(p));
+    auto d32 = _mm256_sub_epi8(v32, zero32);
+    auto digit32 = _mm256_cmpeq_epi8(_mm256_max_epu8(d32, nine32), nine32);
+    auto v16 = _mm_loadu_si128(reinterpret_cast<__m128i const*>(p + 32));
+    auto d16 = _mm_sub_epi8(v16, _mm256_castsi256_si128(zero32));
+    auto nine16 = _mm256_castsi256_si128(nine32);
+    auto digit16 = _mm_cmpeq_epi8(_mm_max_epu8(d16, nine16), nine16);
+    digit_mask = static_cast<uint32_t>(_mm256_movemask_epi8(digit32)) |
+                 static_cast<uint64_t>(static_cast<uint16_t>(_mm_movemask_epi8(digit16))) << 32;
+    dot_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v32, dot32))) |
+               static_cast<uint64_t>(static_cast<uint16_t>(
+                       _mm_movemask_epi8(_mm_cmpeq_epi8(v16, _mm256_castsi256_si128(dot32)))))
+                       << 32;
+    zero_mask = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_cmpeq_epi8(v32, zero32))) |
+                static_cast<uint64_t>(static_cast<uint16_t>(
+                        _mm_movemask_epi8(_mm_cmpeq_epi8(v16, _mm256_castsi256_si128(zero32)))))
+                        << 32;
+}
+
+// p holds at least 48 readable bytes, len <= 48.
+static inline bool parse_decimal128_simd(char const* p, size_t len, int precision, int scale, int128_t& value) {
+    value = 0;
+    uint64_t digit_mask, dot_mask, zero_mask;
+    classify_text48(p, digit_mask, dot_mask, zero_mask);
+    const uint64_t valid = (1ull << len) - 1;
+    digit_mask &= valid;
+    dot_mask &= valid;
+    if (((digit_mask | dot_mask) != valid) | (__builtin_popcountll(dot_mask) > 1) | (digit_mask == 0)) {
+        return false;
+    }
+    const int int_end = dot_mask != 0 ? __builtin_ctzll(dot_mask) : static_cast<int>(len);
+    const int frac_digits = dot_mask != 0 ? static_cast<int>(len) - int_end - 1 : 0;
+    // leading zeros of the integer part are not significant.
+    const int leading_zeros = std::min(__builtin_ctzll(~zero_mask), int_end);
+    const int int_digits = int_end - leading_zeros;
+    if (int_digits > precision - scale) {
+        return false;
+    }
+    const int kept_frac_digits = std::min(frac_digits, scale);
+    const int total = int_digits + scale;
+
+    int128_t v;
+    if (len <= 16 && total <= 16) {
+        v = parse_short_text(p, leading_zeros, int_digits, kept_frac_digits, total);
+    } else {
+        alignas(16) char digits[DECIMAL_TEXT_DIGITS];
+        const auto zeros = _mm_set1_epi8('0');
+        _mm_store_si128(reinterpret_cast<__m128i*>(digits), zeros);
+        _mm_store_si128(reinterpret_cast<__m128i*>(digits + 16), zeros);
+        _mm_store_si128(reinterpret_cast<__m128i*>(digits + 32), zeros);
+        char* start = digits + DECIMAL_TEXT_DIGITS - total;
+        memcpy(start, p + leading_zeros, int_digits);
+        memcpy(start + int_digits, p + int_end + 1, kept_frac_digits);
+        // at most 38 digits, so the first 16 digits are at most 999999.
+        uint128_t hi_mid =
+                static_cast<uint128_t>(parse_digits16(digits)) * EXP10_16 + parse_digits16(digits + 16);
+        v = static_cast<int128_t>(hi_mid * EXP10_16 + parse_digits16(digits + 32));
+    }
+    v += frac_digits > scale && p[int_end + 1 + scale] >= '5';
+    if (v > max_decimal_of(precision)) {
+        return false;
+    }
+    value = v;
+    return true;
+}
+
+// a 9-digit limb, leading zeros included.
+static inline void format_digits9(uint32_t v, char* p) {
+    static constexpr char DIGIT_PAIRS[201] =
+            "0001020304050607080910111213141516171819"
+            "2021222324252627282930313233343536373839"
+            "4041424344454647484950515253545556575859"
+            "6061626364656667686970717273747576777879"
+            "8081828384858687888990919293949596979899";
+    p[0] = static_cast<char>('0' + v / EXP10_8);
+    v %= EXP10_8;
+    uint32_t hi = v / 10000;
+    uint32_t lo = v % 10000;
+    memcpy(p + 1, DIGIT_PAIRS + 2 * (hi / 100), 2);
+    memcpy(p + 3, DIGIT_PAIRS + 2 * (hi % 100), 2);
+    memcpy(p + 5, DIGIT_PAIRS + 2 * (lo / 100), 2);
+    memcpy(p + 7, DIGIT_PAIRS + 2 * (lo % 100), 2);
+}
+
+// u < 2^127 to base-1e9 limbs, the least significant first. above 2^64, u is
+// split by 1e18 twice: the quotient of the high half by 1e18 is at most 9, so
+// each split is one div and one divq instead of a call to __udivti3.
+static inline int split_base1e9(uint128_t u, uint32_t* limbs) {
+    uint64_t lo, mid, hi;
+    if ((u >> 64) == 0) {
+        lo = static_cast<uint64_t>(u) % EXP10_18;
+        mid = static_cast<uint64_t>(u) / EXP10_18;
+        hi = 0;
+    } else {
+        auto u1 = static_cast<uint64_t>(u >> 64);
+        auto u0 = static_cast<uint64_t>(u);
+        uint64_t q1 = u1 / EXP10_18;
+        uint64_t q0 = udiv128by64to64(u1 % EXP10_18, u0, EXP10_18, &lo);
+        hi = udiv128by64to64(q1, q0, EXP10_18, &mid);
+    }
+    limbs[0] = static_cast<uint32_t>(lo % EXP10_9);
+    limbs[1] = static_cast<uint32_t>(lo / EXP10_9);
+    limbs[2] = static_cast<uint32_t>(mid % EXP10_9);
+    limbs[3] = static_cast<uint32_t>(mid / EXP10_9);
+    limbs[4] = static_cast<uint32_t>(hi);
+    int nr = 5;
+    while (nr > 1 && limbs[nr - 1] == 0) {
+        --nr;
+    }
+    return nr;
+}
+
+static inline int digits_of(uint32_t v) {
+    int n = 1;
+    while (v >= 10) {
+        v /= 10;
+        ++n;
+    }
+    return n;
+}
+
+// dst holds DECIMAL_TEXT_MAX_FORMAT bytes, return the length.
+static inline size_t format_decimal128(int128_t value, int scale, char* dst) {
+    uint128_t s = static_cast<uint128_t>(value >> 127);
+    uint128_t u = (static_cast<uint128_t>(value) ^ s) - s;
+    uint32_t limbs[5];
+    int limb_nr = split_base1e9(u, limbs);
+    int digit_nr = (limb_nr - 1) * 9 + digits_of(limbs[limb_nr - 1]);
+    int int_len = std::max(1, digit_nr - scale);
+    int len = int_len + scale;
+    // the fraction may need zero limbs above the value.
+    int emit_limb_nr = std::max(limb_nr, (len + 8) / 9);
+    char digits[45];
+    for (int i = 0; i < emit_limb_nr; ++i) {
+        format_digits9(i < limb_nr ? limbs[i] : 0, digits + 9 * (emit_limb_nr - 1 - i));
+    }
+    char const* first = digits + 9 * emit_limb_nr - len;
+    char* p = dst;
+    *p = '-';
+    p += s & 1;
+    memcpy(p, first, int_len);
+    p += int_len;
+    if (scale > 0) {
+        *p++ = '.';
+        memcpy(p, first + int_len, scale);
+        p += scale;
+    }
+    return p - dst;
+}
+} // namespace decimal_internal
+
+// parse every row of src as decimal(precision, scale) into dst. errors[i] is
+// set to 1 and dst[i] to 0 if row i is not a decimal(precision, scale), to 0
+// otherwise. return the number of errors.
+static inline size_t decimal128_parse_column(BinaryColumn const& src, int precision, int scale, int128_t* dst,
+                                             uint8_t* errors) {
+    using namespace decimal_internal;
+    const auto n = src.size();
+    const char* bytes = reinterpret_cast<char const*>(src.bytes.data());
+    const size_t bytes_size = src.bytes.size();
+    size_t error_nr = 0;
+    for (size_t i = 0; i < n; ++i) {
+        const size_t offset = src.offsets[i];
+        const size_t size = src.offsets[i + 1] - offset;
+        const char* p = bytes + offset;
+        size_t len = size;
+        // signs are a coin flip on real data, so they are skipped without a
+        // branch.
+        const char c = size > 0 ? *p : 0;
+        const size_t has_sign = (c == '-') | (c == '+');
+        const uint128_t negative = -static_cast<uint128_t>(c == '-');
+        p += has_sign;
+        len -= has_sign;
+        int128_t v;
+        bool ok;
+        if (__builtin_expect(len > DECIMAL_TEXT_MAX_SIMD, 0)) {
+            // the scalar parser takes the sign itself.
+            ok = parse_decimal128_scalar(bytes + offset, size, precision, scale, v);
+            v = static_cast<int128_t>((static_cast<uint128_t>(v) ^ negative) - negative);
+        } else if (__builtin_expect(bytes_size - (p - bytes) < DECIMAL_TEXT_MAX_SIMD, 0)) {
+            // the 48-byte loads would run past the column.
+            char tail[DECIMAL_TEXT_MAX_SIMD] = {};
+            memcpy(tail, p, len);
+            ok = parse_decimal128_simd(tail, len, precision, scale, v);
+        } else {
+            ok = parse_decimal128_simd(p, len, precision, scale, v);
+        }
+        dst[i] = static_cast<int128_t>((static_cast<uint128_t>(v) ^ negative) - negative);
+        errors[i] = !ok;
+        error_nr += !ok;
+    }
+    return error_nr;
+}
+
+// format n decimal(precision, scale) values into dst. errors[i] is set to 1 if
+// src[i] has more than precision digits, the row is formatted anyway. return
+// the number of errors.
+static inline size_t decimal128_format_column(int128_t const* src, size_t n, int precision, int scale,
+                                              BinaryColumn& dst, uint8_t* errors) {
+    using namespace decimal_internal;
+    const int128_t max_value = max_decimal_of(precision);
+    auto& bytes = dst.bytes;
+    auto& offsets = dst.offsets;
+    size_t pos = bytes.size();
+    bytes.resize(pos + n * DECIMAL_TEXT_MAX_FORMAT);
+    offsets.reserve(offsets.size() + n);
+    size_t error_nr = 0;
+    for (size_t i = 0; i < n; ++i) {
+        auto v = src[i];
+        bool error = (v > max_value) | (v < -max_value);
+        errors[i] = error;
+        error_nr += error;
+        pos += format_decimal128(v, scale, reinterpret_cast<char*>(bytes.data()) + pos);
+        offsets.push_back(pos);
+    }
+    bytes.resize(pos);
+    return error_nr;
+}
+
+#endif // CPP_ETUDES_DECIMAL_STRING_HH
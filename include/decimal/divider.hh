@@ -0,0 +1,306 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/16.
+//
+
+#ifndef CPP_ETUDES_DIVIDER_HH
+#define CPP_ETUDES_DIVIDER_HH
+
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <decimal/decimal_exp10.hh>
+
+template <typename T>
+struct divider_traits;
+template <>
+struct divider_traits<int32_t> {
+    using unsigned_type = uint32_t;
+    static constexpr bool is_signed = true;
+};
+template <>
+struct divider_traits<uint32_t> {
+    using unsigned_type = uint32_t;
+    static constexpr bool is_signed = false;
+};
+template <>
+struct divider_traits<int64_t> {
+    using unsigned_type = uint64_t;
+    static constexpr bool is_signed = true;
+};
+template <>
+struct divider_traits<uint64_t> {
+    using unsigned_type = uint64_t;
+    static constexpr bool is_signed = false;
+};
+template <>
+struct divider_traits<int128_t> {
+    using unsigned_type = uint128_t;
+    static constexpr bool is_signed = true;
+};
+template <>
+struct divider_traits<uint128_t> {
+    using unsigned_type = uint128_t;
+    static constexpr bool is_signed = false;
+};
+
+namespace divider_internal {
+// high half of the double-width product.
+static inline uint32_t mulhi(uint32_t a, uint32_t b) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(a) * b) >> 32);
+}
+
+static inline uint64_t mulhi(uint64_t a, uint64_t b) {
+    return static_cast<uint64_t>((static_cast<uint128_t>(a) * b) >> 64);
+}
+
+// 4 64x64->128 products, the 3 middle terms fit in 128 bits without carry.
+static inline uint128_t mulhi(uint128_t a, uint128_t b) {
+    uint64_t a0 = static_cast<uint64_t>(a), a1 = static_cast<uint64_t>(a >> 64);
+    uint64_t b0 = static_cast<uint64_t>(b), b1 = static_cast<uint64_t>(b >> 64);
+    uint128_t p00 = static_cast<uint128_t>(a0) * b0;
+    uint128_t p01 = static_cast<uint128_t>(a0) * b1;
+    uint128_t p10 = static_cast<uint128_t>(a1) * b0;
+    uint128_t p11 = static_cast<uint128_t>(a1) * b1;
+    uint128_t mid = (p00 >> 64) + static_cast<uint64_t>(p01) + static_cast<uint64_t>(p10);
+    return p11 + (p01 >> 64) + (p10 >> 64) + (mid >> 64);
+}
+
+template <typename U>
+static inline int floor_log2(U d) {
+    if constexpr (sizeof(U) == 16) {
+        auto hi = static_cast<uint64_t>(d >> 64);
+        return hi != 0 ? 127 - __builtin_clzll(hi) : 63 - __builtin_clzll(static_cast<uint64_t>(d));
+    } else if constexpr (sizeof(U) == 8) {
+        return 63 - __builtin_clzll(d);
+    } else {
+        return 31 - __builtin_clz(d);
+    }
+}
+
+// (hi:0) / d by shift-subtract, hi < d. it runs once per divisor, so one
+// version serves all the widths.
+template <typename U>
+static inline U div_wide(U hi, U d, U& rem) {
+    constexpr int BITS = sizeof(U) * 8;
+    U q = 0;
+    for (int i = 0; i < BITS; ++i) {
+        U carry = hi >> (BITS - 1);
+        hi <<= 1;
+        q <<= 1;
+        if (carry != 0 || hi >= d) {
+            hi -= d;
+            q |= 1;
+        }
+    }
+    rem = hi;
+    return q;
+}
+} // namespace divider_internal
+
+// how a Divider divides, kernels switch on it once per column instead of once
+// per row.
+enum class DividerAlgo : uint8_t {
+    // n >> shift
+    SHIFT,
+    // mulhi(magic, n) >> shift
+    MUL_SHIFT,
+    // the magic number needs BITS+1 bits: t = mulhi(magic, n),
+    // (((n - t) >> 1) + t) >> shift
+    MUL_ADD_SHIFT,
+};
+
+namespace divider_internal {
+// the magic number of a divisor d that is not a power of 2, shift is
+// floor(log2(d)). MUL_SHIFT is chosen if the BITS-bit magic number is exact
+// enough, unless force_add, since the MUL_ADD_SHIFT sequence works for any d.
+template <typename U>
+static inline DividerAlgo gen_magic(U d, int shift, bool force_add, U& magic) {
+    U rem;
+    U m = div_wide<U>(U(1) << shift, d, rem);
+    DividerAlgo algo;
+    if (!force_add && d - rem < (U(1) << shift)) {
+        algo = DividerAlgo::MUL_SHIFT;
+    } else {
+        // 2^(BITS+shift+1)/d rounded up, the lost top bit is added back by the
+        // MUL_ADD_SHIFT sequence.
+        m += m;
+        U twice_rem = rem + rem;
+        if (twice_rem >= d || twice_rem < rem) {
+            m += 1;
+        }
+        algo = DividerAlgo::MUL_ADD_SHIFT;
+    }
+    magic = m + 1;
+    return algo;
+}
+} // namespace divider_internal
+
+// division by a runtime constant via a precomputed magic number (libdivide's
+// round-up method): the quotient costs one multiply-high, a few adds and
+// shifts instead of a div instruction, or a call to __udivti3/__divti3 for
+// 128-bit integers. signed division goes through the magnitudes and truncates
+// toward zero like '/'.
+//
+// a 128-bit multiply-high takes 4 mulq, so a 128-bit Divider of a divisor
+// below 2^64 also keeps a 64-bit MUL_ADD_SHIFT magic number for dividends
+// below 2^64, which most decimal values are.
+template <typename T>
+class Divider {
+    using U = typename divider_traits<T>::unsigned_type;
+    static constexpr int BITS = sizeof(U) * 8;
+    static constexpr bool SIGNED = divider_traits<T>::is_signed;
+
+public:
+    explicit Divider(T d) : d(d) {
+        assert(d != 0);
+        U abs_d = static_cast<U>(d);
+        if constexpr (SIGNED) {
+            d_sign = static_cast<U>(d < 0 ? -1 : 0);
+            abs_d = (abs_d ^ d_sign) - d_sign;
+        }
+        shift = divider_internal::floor_log2(abs_d);
+        if ((abs_d & (abs_d - 1)) == 0) {
+            algo = DividerAlgo::SHIFT;
+            return;
+        }
+        algo = divider_internal::gen_magic<U>(abs_d, shift, false, magic);
+        if constexpr (BITS == 128) {
+            if ((abs_d >> 64) == 0) {
+                divider_internal::gen_magic<uint64_t>(static_cast<uint64_t>(abs_d), shift, true, narrow_magic);
+            }
+        }
+    }
+
+    T divisor() const { return d; }
+    DividerAlgo get_algo() const { return algo; }
+
+    template <DividerAlgo A>
+    T divide(T n) const {
+        if constexpr (SIGNED) {
+            U s = static_cast<U>(n < 0 ? -1 : 0);
+            U q = udivide<A>((static_cast<U>(n) ^ s) - s);
+            s ^= d_sign;
+            return static_cast<T>((q ^ s) - s);
+        } else {
+            return udivide<A>(n);
+        }
+    }
+
+    T divide(T n) const {
+        switch (algo) {
+        case DividerAlgo::SHIFT:
+            return divide<DividerAlgo::SHIFT>(n);
+        case DividerAlgo::MUL_SHIFT:
+            return divide<DividerAlgo::MUL_SHIFT>(n);
+        default:
+            return divide<DividerAlgo::MUL_ADD_SHIFT>(n);
+        }
+    }
+
+    // n / d rounding half away from zero.
+    template <DividerAlgo A>
+    T divide_round(T n) const {
+        T q = divide<A>(n);
+        U r = static_cast<U>(n) - static_cast<U>(q) * static_cast<U>(d);
+        U abs_d = static_cast<U>(d);
+        if constexpr (SIGNED) {
+            U rs = static_cast<U>(static_cast<T>(r) < 0 ? -1 : 0);
+            r = (r ^ rs) - rs;
+            abs_d = (abs_d ^ d_sign) - d_sign;
+            if (r >= abs_d - r) {
+                q += ((n < 0) != (d < 0)) ? T(-1) : T(1);
+            }
+        } else {
+            if (r >= abs_d - r) {
+                q += 1;
+            }
+        }
+        return q;
+    }
+
+    T divide_round(T n) const {
+        switch (algo) {
+        case DividerAlgo::SHIFT:
+            return divide_round<DividerAlgo::SHIFT>(n);
+        case DividerAlgo::MUL_SHIFT:
+            return divide_round<DividerAlgo::MUL_SHIFT>(n);
+        default:
+            return divide_round<DividerAlgo::MUL_ADD_SHIFT>(n);
+        }
+    }
+
+private:
+    template <DividerAlgo A>
+    U udivide(U n) const {
+        if constexpr (A == DividerAlgo::SHIFT) {
+            return n >> shift;
+        } else {
+            if constexpr (BITS == 128) {
+                if (narrow_magic != 0 && (n >> 64) == 0) {
+                    auto n64 = static_cast<uint64_t>(n);
+                    uint64_t t = divider_internal::mulhi(narrow_magic, n64);
+                    return (((n64 - t) >> 1) + t) >> shift;
+                }
+            }
+            if constexpr (A == DividerAlgo::MUL_SHIFT) {
+                return divider_internal::mulhi(magic, n) >> shift;
+            } else {
+                U t = divider_internal::mulhi(magic, n);
+                return (((n - t) >> 1) + t) >> shift;
+            }
+        }
+    }
+
+    T d;
+    U magic{0};
+    U d_sign{0};
+    // 0 unless BITS is 128 and d is below 2^64.
+    uint64_t narrow_magic{0};
+    int shift{0};
+    DividerAlgo algo{DividerAlgo::SHIFT};
+};
+
+namespace divider_internal {
+template <typename T, DividerAlgo A, bool round>
+static void divide_column(T const* src, T* dst, size_t n, Divider<T> const& divider) {
+    for (size_t i = 0; i < n; ++i) {
+        if constexpr (round) {
+            dst[i] = divider.template divide_round<A>(src[i]);
+        } else {
+            dst[i] = divider.template divide<A>(src[i]);
+        }
+    }
+}
+
+template <typename T, bool round>
+static void divide_column(T const* src, T* dst, size_t n, Divider<T> const& divider) {
+    switch (divider.get_algo()) {
+    case DividerAlgo::SHIFT:
+        return divide_column<T, DividerAlgo::SHIFT, round>(src, dst, n, divider);
+    case DividerAlgo::MUL_SHIFT:
+        return divide_column<T, DividerAlgo::MUL_SHIFT, round>(src, dst, n, divider);
+    default:
+        return divide_column<T, DividerAlgo::MUL_ADD_SHIFT, round>(src, dst, n, divider);
+    }
+}
+} // namespace divider_internal
+
+// dst[i] = src[i] / d, d is a power of ten when rescaling decimals, or the
+// value of a constant divisor column. src and dst may be the same.
+template <typename T>
+void divide_column(T const* src, T* dst, size_t n, T d) {
+    divider_internal::divide_column<T, false>(src, dst, n, Divider<T>(d));
+}
+
+// dst[i] = src[i] / d rounding half away from zero.
+template <typename T>
+void divide_round_column(T const* src, T* dst, size_t n, T d) {
+    divider_internal::divide_column<T, true>(src, dst, n, Divider<T>(d));
+}
+
+#endif // CPP_ETUDES_DIVIDER_HH
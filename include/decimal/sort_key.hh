@@ -0,0 +1,306 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/21.
+//
+
+#ifndef CPP_ETUDES_SORT_KEY_HH
+#define CPP_ETUDES_SORT_KEY_HH
+
+#include <algorithm>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <decimal/decimal_exp10.hh>
+#include <limits>
+#include <type_traits>
+#include <vector>
+
+// byte-comparable keys: the rows of a sort are laid out contiguously,
+// row_size bytes each, the first key_size bytes of a row are its key, the
+// rest is payload(e.g. the row id). the columns of an ORDER BY are encoded
+// one after another into the key, so that memcmp of two keys orders the rows
+// like the ORDER BY, and the rows can be radix sorted byte by byte.
+//
+// a value is encoded big-endian with the sign bit flipped; a float is
+// encoded by its bits, negative ones inverted. -0.0 is encoded as 0.0 and
+// all the NaNs as one NaN above +inf. a descending column is encoded with
+// all its bytes inverted.
+namespace sort_key_internal {
+template <typename T>
+struct key_traits;
+template <>
+struct key_traits<int32_t> {
+    using unsigned_type = uint32_t;
+};
+template <>
+struct key_traits<int64_t> {
+    using unsigned_type = uint64_t;
+};
+template <>
+struct key_traits<int128_t> {
+    using unsigned_type = uint128_t;
+};
+template <>
+struct key_traits<float> {
+    using unsigned_type = uint32_t;
+};
+template <>
+struct key_traits<double> {
+    using unsigned_type = uint64_t;
+};
+
+static inline uint32_t to_big_endian(uint32_t v) {
+    return __builtin_bswap32(v);
+}
+
+static inline uint64_t to_big_endian(uint64_t v) {
+    return __builtin_bswap64(v);
+}
+
+static inline uint128_t to_big_endian(uint128_t v) {
+    return static_cast<uint128_t>(__builtin_bswap64(static_cast<uint64_t>(v))) << 64 |
+           __builtin_bswap64(static_cast<uint64_t>(v >> 64));
+}
+
+// the value as an unsigned integer of the same order.
+template <typename T>
+static inline typename key_traits<T>::unsigned_type order_preserving(T v) {
+    using U = typename key_traits<T>::unsigned_type;
+    constexpr U SIGN_BIT = static_cast<U>(1) << (sizeof(U) * 8 - 1);
+    if constexpr (std::is_floating_point_v<T>) {
+        if (v != v) {
+            v = std::numeric_limits<T>::quiet_NaN();
+        }
+        // -0.0 == 0.0
+        v = v == 0 ? 0 : v;
+        U bits;
+        memcpy(&bits, &v, sizeof(T));
+        // negative: invert all the bits, otherwise flip the sign bit.
+        U mask = -(bits >> (sizeof(U) * 8 - 1)) | SIGN_BIT;
+        return bits ^ mask;
+    } else {
+        return static_cast<U>(v) ^ SIGN_BIT;
+    }
+}
+
+template <typename T, bool descending>
+static inline void encode_sort_key(T const* src, size_t n, uint8_t* rows, size_t row_size) {
+    using U = typename key_traits<T>::unsigned_type;
+    for (size_t i = 0; i < n; ++i) {
+        U key = to_big_endian(order_preserving(src[i]));
+        if constexpr (descending) {
+            key = ~key;
+        }
+        memcpy(rows + i * row_size, &key, sizeof(U));
+    }
+}
+
+// a row has a compile-time size in the scatter loops, or memcpy is a call.
+template <size_t ROW_SIZE>
+struct RowCopy {
+    static void copy(uint8_t* dst, uint8_t const* src, size_t) { memcpy(dst, src, ROW_SIZE); }
+};
+template <>
+struct RowCopy<0> {
+    static void copy(uint8_t* dst, uint8_t const* src, size_t row_size) { memcpy(dst, src, row_size); }
+};
+
+// one LSD pass per key byte from the last one, a stable counting sort each.
+// passes where all the rows have the same byte are skipped.
+template <size_t ROW_SIZE>
+static void radix_sort_lsd(uint8_t* rows, size_t n, size_t row_size, size_t key_size, uint8_t* tmp) {
+    std::vector<size_t> counts(key_size * 256, 0);
+    for (size_t i = 0; i < n; ++i) {
+        auto* row = rows + i * row_size;
+        for (size_t b = 0; b < key_size; ++b) {
+            ++counts[b * 256 + row[b]];
+        }
+    }
+    uint8_t* src = rows;
+    uint8_t* dst = tmp;
+    for (size_t b = key_size; b-- > 0;) {
+        size_t* offsets = counts.data() + b * 256;
+        if (offsets[src[b]] == n) {
+            continue;
+        }
+        size_t sum = 0;
+        for (size_t k = 0; k < 256; ++k) {
+            auto c = offsets[k];
+            offsets[k] = sum;
+            sum += c;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            auto* row = src + i * row_size;
+            RowCopy<ROW_SIZE>::copy(dst + offsets[row[b]]++ * row_size, row, row_size);
+        }
+        std::swap(src, dst);
+    }
+    if (src != rows) {
+        memcpy(rows, src, n * row_size);
+    }
+}
+
+// buckets this small are insertion sorted by memcmp.
+constexpr size_t MSD_INSERTION_THRESHOLD = 24;
+
+static inline void insertion_sort(uint8_t* rows, size_t n, size_t row_size, size_t key_size, size_t byte,
+                                  uint8_t* row_buf) {
+    for (size_t i = 1; i < n; ++i) {
+        auto* row = rows + i * row_size;
+        size_t j = i;
+        while (j > 0 && memcmp(rows + (j - 1) * row_size + byte, row + byte, key_size - byte) > 0) {
+            --j;
+        }
+        if (j != i) {
+            memcpy(row_buf, row, row_size);
+            memmove(rows + (j + 1) * row_size, rows + j * row_size, (i - j) * row_size);
+            memcpy(rows + j * row_size, row_buf, row_size);
+        }
+    }
+}
+
+// MSD: a counting sort by one byte, then every bucket by the next bytes, tmp
+// is the scratch of as many rows.
+template <size_t ROW_SIZE>
+static void radix_sort_msd(uint8_t* rows, size_t n, size_t row_size, size_t key_size, size_t byte, uint8_t* tmp,
+                           uint8_t* row_buf) {
+    size_t counts[256];
+    for (; byte < key_size; ++byte) {
+        if (n <= MSD_INSERTION_THRESHOLD) {
+            insertion_sort(rows, n, row_size, key_size, byte, row_buf);
+            return;
+        }
+        memset(counts, 0, sizeof(counts));
+        for (size_t i = 0; i < n; ++i) {
+            ++counts[rows[i * row_size + byte]];
+        }
+        // all the rows in one bucket, go on with the next byte.
+        if (counts[rows[byte]] == n) {
+            continue;
+        }
+        size_t offsets[256];
+        size_t sum = 0;
+        for (size_t k = 0; k < 256; ++k) {
+            offsets[k] = sum;
+            sum += counts[k];
+        }
+        for (size_t i = 0; i < n; ++i) {
+            auto* row = rows + i * row_size;
+            RowCopy<ROW_SIZE>::copy(tmp + offsets[row[byte]]++ * row_size, row, row_size);
+        }
+        memcpy(rows, tmp, n * row_size);
+        if (byte + 1 == key_size) {
+            return;
+        }
+        size_t start = 0;
+        for (size_t k = 0; k < 256; ++k) {
+            if (counts[k] > 1) {
+                radix_sort_msd<ROW_SIZE>(rows + start * row_size, counts[k], row_size, key_size, byte + 1,
+                                         tmp + start * row_size, row_buf);
+            }
+            start += counts[k];
+        }
+        return;
+    }
+}
+
+template <size_t ROW_SIZE>
+static void radix_sort(uint8_t* rows, size_t n, size_t row_size, size_t key_size, bool lsd) {
+    if (n < 2) {
+        return;
+    }
+    std::vector<uint8_t> tmp(n * row_size);
+    if (lsd) {
+        radix_sort_lsd<ROW_SIZE>(rows, n, row_size, key_size, tmp.data());
+    } else {
+        std::vector<uint8_t> row_buf(row_size);
+        radix_sort_msd<ROW_SIZE>(rows, n, row_size, key_size, 0, tmp.data(), row_buf.data());
+    }
+}
+
+static inline void radix_sort(uint8_t* rows, size_t n, size_t row_size, size_t key_size, bool lsd) {
+    switch (row_size) {
+    case 8:
+        return radix_sort<8>(rows, n, row_size, key_size, lsd);
+    case 12:
+        return radix_sort<12>(rows, n, row_size, key_size, lsd);
+    case 16:
+        return radix_sort<16>(rows, n, row_size, key_size, lsd);
+    case 20:
+        return radix_sort<20>(rows, n, row_size, key_size, lsd);
+    case 24:
+        return radix_sort<24>(rows, n, row_size, key_size, lsd);
+    case 32:
+        return radix_sort<32>(rows, n, row_size, key_size, lsd);
+    default:
+        return radix_sort<0>(rows, n, row_size, key_size, lsd);
+    }
+}
+} // namespace sort_key_internal
+
+// the size of the key of a column of T, one more byte if it is nullable.
+template <typename T>
+constexpr size_t sort_key_size(bool nullable = false) {
+    return sizeof(T) + nullable;
+}
+
+// encode n values of a column of int32_t/int64_t/int128_t decimals, float or
+// double at offset of each row's key.
+template <typename T>
+void encode_sort_key(T const* src, size_t n, uint8_t* rows, size_t row_size, size_t offset,
+                     bool descending = false) {
+    if (descending) {
+        sort_key_internal::encode_sort_key<T, true>(src, n, rows + offset, row_size);
+    } else {
+        sort_key_internal::encode_sort_key<T, false>(src, n, rows + offset, row_size);
+    }
+}
+
+// a nullable column: a byte that puts the nulls first or last, then the key of
+// the value, all 0 for a null row so that null rows tie. nulls holds one byte
+// per row, non-zero is null.
+template <typename T>
+void encode_sort_key_nullable(T const* src, uint8_t const* nulls, size_t n, uint8_t* rows, size_t row_size,
+                              size_t offset, bool descending = false, bool nulls_first = true) {
+    encode_sort_key(src, n, rows, row_size, offset + 1, descending);
+    for (size_t i = 0; i < n; ++i) {
+        auto* key = rows + i * row_size + offset;
+        bool is_null = nulls[i] != 0;
+        key[0] = is_null != nulls_first;
+        if (is_null) {
+            memset(key + 1, 0, sizeof(T));
+        }
+    }
+}
+
+// write the row ids 0..n-1 at offset of each row, after the key.
+static inline void encode_row_id(size_t n, uint8_t* rows, size_t row_size, size_t offset) {
+    for (size_t i = 0; i < n; ++i) {
+        auto id = static_cast<uint32_t>(i);
+        memcpy(rows + i * row_size + offset, &id, sizeof(id));
+    }
+}
+
+static inline uint32_t decode_row_id(uint8_t const* rows, size_t i, size_t row_size, size_t offset) {
+    uint32_t id;
+    memcpy(&id, rows + i * row_size + offset, sizeof(id));
+    return id;
+}
+
+// sort n rows by their key_size-byte keys in memcmp order, stably. LSD makes
+// one pass per key byte that varies, MSD recurses into the buckets of a byte
+// and insertion sorts small ones, so it is better for long keys whose order
+// is told by a few leading bytes.
+static inline void radix_sort_lsd(uint8_t* rows, size_t n, size_t row_size, size_t key_size) {
+    sort_key_internal::radix_sort(rows, n, row_size, key_size, true);
+}
+
+static inline void radix_sort_msd(uint8_t* rows, size_t n, size_t row_size, size_t key_size) {
+    sort_key_internal::radix_sort(rows, n, row_size, key_size, false);
+}
+
+#endif // CPP_ETUDES_SORT_KEY_HH
@@ -4,9 +4,18 @@
 
 #ifndef CPP_ETUDES_INCLUDE_DECIMALV3_HH_
 #define CPP_ETUDES_INCLUDE_DECIMALV3_HH_
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cstddef>
 #include <cstdint>
+#include <limits>
 #include <type_traits>
-typedef __int128 int128_t;
+#include <utility>
+
+#include <decimal/decimal_exp10.hh>
+#include <decimal/decimal_rescale.hh>
+#include <decimal/divider.hh>
 
 template <typename T>
 constexpr bool is_underlying_type_of_decimal = false;
@@ -29,4 +38,530 @@ struct EXP10<T, 0> {
     static constexpr type value = static_cast<type>(1);
 };
 
+constexpr int DECIMAL32_MAX_PRECISION = 9;
+constexpr int DECIMAL64_MAX_PRECISION = 18;
+constexpr int DECIMAL128_MAX_PRECISION = 38;
+
+// decimal(p, s) is stored in the narrowest of int32/int64/int128 holding p
+// digits.
+template <int precision>
+using decimal_type_t =
+        std::conditional_t<precision <= DECIMAL32_MAX_PRECISION, int32_t,
+                           std::conditional_t<precision <= DECIMAL64_MAX_PRECISION, int64_t, int128_t>>;
+
+enum class DecimalV3Op : uint8_t { ADD, SUB, MUL, DIV, RESCALE };
+constexpr size_t DECIMALV3_OP_NR = 5;
+
+// digits of the intermediate value of op, i.e. of the operands after they are
+// scaled to the common scale, or of the product/dividend before it is scaled
+// down. rules of the result scale:
+// ADD/SUB: rs >= max(s1, s2), both operands are scaled to rs.
+// MUL: the product of scale s1+s2 is scaled to rs.
+// DIV: rs + s2 >= s1, the dividend is scaled to rs + s2.
+// RESCALE: unary, decimal(p1, s1) to decimal(rp, rs).
+static constexpr int decimalv3_intermediate_precision(DecimalV3Op op, int p1, int s1, int p2, int s2, int rs) {
+    switch (op) {
+    case DecimalV3Op::ADD:
+    case DecimalV3Op::SUB:
+        return std::max(p1 - s1, p2 - s2) + rs + 1;
+    case DecimalV3Op::MUL:
+        return p1 + p2 + std::max(0, rs - s1 - s2);
+    case DecimalV3Op::DIV:
+        return std::max(p1 + rs + s2 - s1, p2);
+    case DecimalV3Op::RESCALE:
+        return p1 + std::max(0, rs - s1);
+    }
+    return 0;
+}
+
+// the intermediate type is the narrowest integer holding the intermediate
+// precision, most of decimal32/decimal64 operations never touch int128.
+// INTER128_CHECKED is int128 whose arithmetic may overflow, so it is checked.
+enum DecimalV3InterClass : uint8_t { INTER32, INTER64, INTER128, INTER128_CHECKED };
+constexpr size_t DECIMALV3_INTER_CLASS_NR = 4;
+// physical types of operands and results.
+enum DecimalV3Width : uint8_t { DECIMAL32, DECIMAL64, DECIMAL128 };
+constexpr size_t DECIMALV3_WIDTH_NR = 3;
+
+static constexpr DecimalV3InterClass decimalv3_inter_class(int inter_precision) {
+    return inter_precision <= DECIMAL32_MAX_PRECISION    ? INTER32
+           : inter_precision <= DECIMAL64_MAX_PRECISION  ? INTER64
+           : inter_precision <= DECIMAL128_MAX_PRECISION ? INTER128
+                                                         : INTER128_CHECKED;
+}
+
+static constexpr DecimalV3Width decimalv3_width(int precision) {
+    return precision <= DECIMAL32_MAX_PRECISION ? DECIMAL32
+           : precision <= DECIMAL64_MAX_PRECISION ? DECIMAL64
+                                                  : DECIMAL128;
+}
+
+template <DecimalV3Width width>
+using decimalv3_width_type_t =
+        std::conditional_t<width == DECIMAL32, int32_t, std::conditional_t<width == DECIMAL64, int64_t, int128_t>>;
+template <DecimalV3InterClass inter>
+using decimalv3_inter_type_t = decimalv3_width_type_t<static_cast<DecimalV3Width>(std::min<int>(inter, DECIMAL128))>;
+
+// scale factors of a kernel, they are loop invariants converted to the
+// intermediate type once.
+struct DecimalV3Args {
+    // operands are multiplied by them, products and quotients by up_factor.
+    int128_t lhs_factor{1};
+    int128_t rhs_factor{1};
+    int128_t up_factor{1};
+    // products are divided by it with rounding half up.
+    int128_t down_factor{1};
+    // |result| <= max_result, i.e. 10^rp - 1.
+    int128_t max_result{0};
+    // the exponents taken by the rescale kernels: ADD/SUB scale the operands
+    // up by lhs_up_scale/rhs_up_scale, RESCALE scales the operand up by
+    // lhs_up_scale or down by down_scale, checked MUL scales the product down
+    // by down_scale.
+    int lhs_up_scale{0};
+    int rhs_up_scale{0};
+    int down_scale{0};
+    int result_precision{0};
+};
+
+static constexpr DecimalV3Args decimalv3_args(DecimalV3Op op, int s1, int s2, int rp, int rs) {
+    DecimalV3Args args;
+    args.max_result = decimal_internal::max_decimal_of(rp);
+    args.result_precision = rp;
+    switch (op) {
+    case DecimalV3Op::ADD:
+    case DecimalV3Op::SUB:
+        args.lhs_up_scale = rs - s1;
+        args.rhs_up_scale = rs - s2;
+        args.lhs_factor = decimal_internal::exp10_of(args.lhs_up_scale);
+        args.rhs_factor = decimal_internal::exp10_of(args.rhs_up_scale);
+        break;
+    case DecimalV3Op::MUL:
+        args.down_scale = std::max(0, s1 + s2 - rs);
+        args.up_factor = decimal_internal::exp10_of(std::max(0, rs - s1 - s2));
+        args.down_factor = decimal_internal::exp10_of(args.down_scale);
+        break;
+    case DecimalV3Op::DIV:
+        args.lhs_factor = decimal_internal::exp10_of(rs + s2 - s1);
+        break;
+    case DecimalV3Op::RESCALE:
+        args.lhs_up_scale = std::max(0, rs - s1);
+        args.down_scale = std::max(0, s1 - rs);
+        break;
+    }
+    return args;
+}
+
+static constexpr bool decimalv3_is_legal(DecimalV3Op op, int p1, int s1, int p2, int s2, int rp, int rs) {
+    auto legal = [](int p, int s) { return 0 < p && p <= DECIMAL128_MAX_PRECISION && 0 <= s && s <= p; };
+    if (!legal(p1, s1) || !legal(rp, rs) || (op != DecimalV3Op::RESCALE && !legal(p2, s2))) {
+        return false;
+    }
+    switch (op) {
+    case DecimalV3Op::ADD:
+    case DecimalV3Op::SUB:
+        return rs >= std::max(s1, s2);
+    case DecimalV3Op::MUL:
+        // 10^(s1 + s2 - rs) must be an int128.
+        return s1 + s2 - rs <= DECIMAL128_MAX_PRECISION;
+    case DecimalV3Op::DIV:
+        return rs + s2 >= s1 && rs + s2 - s1 <= DECIMAL128_MAX_PRECISION;
+    default:
+        return true;
+    }
+}
+
+namespace decimalv3_internal {
+template <typename T, bool checked>
+static inline T mul(T a, T b, bool& overflow) {
+    if constexpr (checked) {
+        T r;
+        overflow |= __builtin_mul_overflow(a, b, &r);
+        return r;
+    } else {
+        return a * b;
+    }
+}
+
+template <typename T, bool checked>
+static inline T add(T a, T b, bool& overflow) {
+    if constexpr (checked) {
+        T r;
+        overflow |= __builtin_add_overflow(a, b, &r);
+        return r;
+    } else {
+        return a + b;
+    }
+}
+
+template <typename T, bool checked>
+static inline T sub(T a, T b, bool& overflow) {
+    if constexpr (checked) {
+        T r;
+        overflow |= __builtin_sub_overflow(a, b, &r);
+        return r;
+    } else {
+        return a - b;
+    }
+}
+
+// a / b rounding half away from zero, b != 0.
+template <typename T>
+static inline T div_round(T a, T b) {
+    T q = a / b;
+    T r = a % b;
+    T abs_r = r < 0 ? -r : r;
+    T abs_b = b < 0 ? -b : b;
+    if (abs_r >= abs_b - abs_r) {
+        q += ((a < 0) != (b < 0)) ? T(-1) : T(1);
+    }
+    return q;
+}
+
+// the products are divided by the power of ten down_factor via Divider,
+// down_algo is fixed per kernel call.
+template <DecimalV3Op op, typename InterT, bool checked, bool scale_down, DividerAlgo down_algo>
+static inline InterT compute_row(InterT a, InterT b, InterT lhs_factor, InterT rhs_factor, InterT up_factor,
+                                 Divider<InterT> const& down, bool& overflow) {
+    if constexpr (op == DecimalV3Op::ADD) {
+        return add<InterT, checked>(mul<InterT, checked>(a, lhs_factor, overflow),
+                                    mul<InterT, checked>(b, rhs_factor, overflow), overflow);
+    } else if constexpr (op == DecimalV3Op::SUB) {
+        return sub<InterT, checked>(mul<InterT, checked>(a, lhs_factor, overflow),
+                                    mul<InterT, checked>(b, rhs_factor, overflow), overflow);
+    } else if constexpr (op == DecimalV3Op::MUL) {
+        auto product = mul<InterT, checked>(mul<InterT, checked>(a, b, overflow), up_factor, overflow);
+        if constexpr (scale_down) {
+            product = down.template divide_round<down_algo>(product);
+        }
+        return product;
+    } else if constexpr (op == DecimalV3Op::DIV) {
+        if (b == 0) {
+            overflow = true;
+            return 0;
+        }
+        auto dividend = mul<InterT, checked>(a, lhs_factor, overflow);
+        // a wrapped dividend may be the minimum of InterT, which traps on / -1.
+        if (checked && overflow) {
+            return 0;
+        }
+        return div_round(dividend, b);
+    }
+}
+
+// the result may be wider than the intermediate value, which always holds
+// the intermediate precision.
+template <typename InterT>
+static inline InterT clamp_max_result(DecimalV3Args const& args) {
+    return static_cast<InterT>(
+            std::min<int128_t>(args.max_result, static_cast<int128_t>(std::numeric_limits<InterT>::max())));
+}
+
+template <DecimalV3Op op, typename LhsT, typename RhsT, typename ResultT, typename InterT, bool checked,
+          bool scale_down, DividerAlgo down_algo = DividerAlgo::SHIFT>
+static size_t compute(LhsT const* lhs, RhsT const* rhs, ResultT* result, size_t n, DecimalV3Args const& args,
+                      uint8_t* overflow) {
+    const auto lhs_factor = static_cast<InterT>(args.lhs_factor);
+    const auto rhs_factor = static_cast<InterT>(args.rhs_factor);
+    const auto up_factor = static_cast<InterT>(args.up_factor);
+    const Divider<InterT> down(static_cast<InterT>(args.down_factor));
+    const auto max_result = clamp_max_result<InterT>(args);
+    size_t overflow_nr = 0;
+    for (size_t base = 0; base < n; base += 8) {
+        auto m = std::min<size_t>(8, n - base);
+        uint8_t bits = 0;
+        for (size_t k = 0; k < m; ++k) {
+            auto i = base + k;
+            bool ov = false;
+            auto r = compute_row<op, InterT, checked, scale_down, down_algo>(lhs[i], rhs[i], lhs_factor, rhs_factor,
+                                                                              up_factor, down, ov);
+            ov |= (r > max_result) | (r < -max_result);
+            result[i] = static_cast<ResultT>(r);
+            bits |= static_cast<uint8_t>(ov) << k;
+        }
+        overflow[base >> 3] = bits;
+        overflow_nr += __builtin_popcount(bits);
+    }
+    return overflow_nr;
+}
+
+// the kernels below run on the intermediate type a chunk of rows at a time; a
+// chunk is a multiple of 8 rows, so it starts at a byte of the overflow bitmap.
+constexpr size_t CHUNK_SIZE = 256;
+
+// src as the intermediate type, in chunk unless it already is.
+template <typename T, typename InterT>
+static inline InterT const* widen(T const* src, InterT* chunk, size_t n) {
+    if constexpr (std::is_same_v<T, InterT>) {
+        return src;
+    } else {
+        for (size_t i = 0; i < n; ++i) {
+            chunk[i] = src[i];
+        }
+        return chunk;
+    }
+}
+
+// the operand scaled up by 10^k in the intermediate type. the intermediate
+// precision holds every aligned operand, so the scale-up never overflows.
+template <typename T, typename InterT>
+static inline InterT const* align(T const* src, InterT* chunk, size_t n, int k) {
+    auto v = widen(src, chunk, n);
+    if (k != 0) {
+        uint8_t overflow[CHUNK_SIZE / 8];
+        decimal_scale_up(v, chunk, n, k, decimal_internal::rescale_traits<InterT>::MAX_SCALE, overflow);
+        v = chunk;
+    }
+    return v;
+}
+
+template <typename LhsT, typename ResultT, typename InterT>
+static size_t rescale(LhsT const* lhs, ResultT* result, size_t n, DecimalV3Args const& args, uint8_t* overflow) {
+    // an intermediate type of fewer digits than the result already bounds it.
+    const int precision = std::min(args.result_precision, decimal_internal::rescale_traits<InterT>::MAX_SCALE);
+    const auto max_result = clamp_max_result<InterT>(args);
+    InterT chunk[CHUNK_SIZE];
+    size_t overflow_nr = 0;
+    for (size_t base = 0; base < n; base += CHUNK_SIZE) {
+        auto m = std::min(CHUNK_SIZE, n - base);
+        InterT* v = chunk;
+        if constexpr (std::is_same_v<ResultT, InterT>) {
+            v = result + base;
+        }
+        auto src = widen(lhs + base, v, m);
+        if (args.down_scale == 0) {
+            // overflowed rows are set to 0.
+            overflow_nr += decimal_scale_up(src, v, m, args.lhs_up_scale, precision, overflow + (base >> 3));
+        } else {
+            decimal_scale_down(src, v, m, args.down_scale, DecimalRoundingMode::HALF_UP);
+            for (size_t i = 0; i < m; i += 8) {
+                uint8_t bits = 0;
+                for (size_t k = 0; k < 8 && i + k < m; ++k) {
+                    bits |= static_cast<uint8_t>((v[i + k] > max_result) | (v[i + k] < -max_result)) << k;
+                }
+                overflow[(base + i) >> 3] = bits;
+                overflow_nr += __builtin_popcount(bits);
+            }
+        }
+        if constexpr (!std::is_same_v<ResultT, InterT>) {
+            for (size_t i = 0; i < m; ++i) {
+                result[base + i] = static_cast<ResultT>(v[i]);
+            }
+        }
+    }
+    return overflow_nr;
+}
+
+// ADD/SUB whose intermediate type never overflows.
+template <DecimalV3Op op, typename LhsT, typename RhsT, typename ResultT, typename InterT>
+static size_t add_sub(LhsT const* lhs, RhsT const* rhs, ResultT* result, size_t n, DecimalV3Args const& args,
+                      uint8_t* overflow) {
+    const auto max_result = clamp_max_result<InterT>(args);
+    InterT lhs_chunk[CHUNK_SIZE];
+    InterT rhs_chunk[CHUNK_SIZE];
+    size_t overflow_nr = 0;
+    for (size_t base = 0; base < n; base += CHUNK_SIZE) {
+        auto m = std::min(CHUNK_SIZE, n - base);
+        auto x = align(lhs + base, lhs_chunk, m, args.lhs_up_scale);
+        auto y = align(rhs + base, rhs_chunk, m, args.rhs_up_scale);
+        for (size_t i = 0; i < m; i += 8) {
+            uint8_t bits = 0;
+            for (size_t k = 0; k < 8 && i + k < m; ++k) {
+                InterT r = op == DecimalV3Op::ADD ? x[i + k] + y[i + k] : x[i + k] - y[i + k];
+                bits |= static_cast<uint8_t>((r > max_result) | (r < -max_result)) << k;
+                result[base + i + k] = static_cast<ResultT>(r);
+            }
+            overflow[(base + i) >> 3] = bits;
+            overflow_nr += __builtin_popcount(bits);
+        }
+    }
+    return overflow_nr;
+}
+
+// checked MUL with a scale-down: the int128 product may overflow while the
+// scaled result fits, so the product is kept in 256 bits by
+// decimal128_mul_rescale and the range is checked after the scale-down.
+template <DividerAlgo A, typename LhsT, typename RhsT, typename ResultT>
+static size_t mul_rescale(LhsT const* lhs, RhsT const* rhs, ResultT* result, size_t n,
+                          decimal_internal::MulRescaleDivisor const& down, int128_t max_result, uint8_t* overflow) {
+    int128_t lhs_chunk[CHUNK_SIZE];
+    int128_t rhs_chunk[CHUNK_SIZE];
+    int128_t product_chunk[CHUNK_SIZE];
+    size_t overflow_nr = 0;
+    for (size_t base = 0; base < n; base += CHUNK_SIZE) {
+        auto m = std::min(CHUNK_SIZE, n - base);
+        int128_t* v = product_chunk;
+        if constexpr (std::is_same_v<ResultT, int128_t>) {
+            v = result + base;
+        }
+        decimal_internal::decimal128_mul_rescale<DecimalRoundingMode::HALF_UP, A>(
+                widen(lhs + base, lhs_chunk, m), widen(rhs + base, rhs_chunk, m), v, m, down, overflow + (base >> 3));
+        for (size_t i = 0; i < m; i += 8) {
+            uint8_t bits = overflow[(base + i) >> 3];
+            for (size_t k = 0; k < 8 && i + k < m; ++k) {
+                bits |= static_cast<uint8_t>((v[i + k] > max_result) | (v[i + k] < -max_result)) << k;
+            }
+            overflow[(base + i) >> 3] = bits;
+            overflow_nr += __builtin_popcount(bits);
+        }
+        if constexpr (!std::is_same_v<ResultT, int128_t>) {
+            for (size_t i = 0; i < m; ++i) {
+                result[base + i] = static_cast<ResultT>(v[i]);
+            }
+        }
+    }
+    return overflow_nr;
+}
+
+template <typename LhsT, typename RhsT, typename ResultT>
+static size_t mul_rescale(LhsT const* lhs, RhsT const* rhs, ResultT* result, size_t n, DecimalV3Args const& args,
+                          uint8_t* overflow) {
+    decimal_internal::MulRescaleDivisor down(args.down_scale);
+    // 10^k is never a power of 2 for k > 0, so SHIFT is left out.
+    if (down.divider.get_algo() == DividerAlgo::MUL_SHIFT) {
+        return mul_rescale<DividerAlgo::MUL_SHIFT>(lhs, rhs, result, n, down, args.max_result, overflow);
+    }
+    return mul_rescale<DividerAlgo::MUL_ADD_SHIFT>(lhs, rhs, result, n, down, args.max_result, overflow);
+}
+} // namespace decimalv3_internal
+
+// result = lhs op rhs over n rows with the scale factors of args, overflow
+// must hold (n + 7) / 8 bytes, bit i is set iff row i overflows the result
+// precision(or divides by zero). return the number of overflowed rows.
+template <DecimalV3Op op, typename LhsT, typename RhsT, typename ResultT, typename InterT, bool checked>
+size_t decimalv3_kernel(void const* lhs, void const* rhs, void* result, size_t n, DecimalV3Args const& args,
+                        uint8_t* overflow) {
+    auto typed_lhs = static_cast<LhsT const*>(lhs);
+    auto typed_rhs = static_cast<RhsT const*>(rhs);
+    auto typed_result = static_cast<ResultT*>(result);
+    if constexpr (op == DecimalV3Op::RESCALE) {
+        return decimalv3_internal::rescale<LhsT, ResultT, InterT>(typed_lhs, typed_result, n, args, overflow);
+    } else if constexpr ((op == DecimalV3Op::ADD || op == DecimalV3Op::SUB) && !checked) {
+        return decimalv3_internal::add_sub<op, LhsT, RhsT, ResultT, InterT>(typed_lhs, typed_rhs, typed_result, n,
+                                                                             args, overflow);
+    } else if constexpr (op == DecimalV3Op::MUL && checked) {
+        if (args.down_scale != 0) {
+            return decimalv3_internal::mul_rescale(typed_lhs, typed_rhs, typed_result, n, args, overflow);
+        }
+        return decimalv3_internal::compute<op, LhsT, RhsT, ResultT, InterT, checked, false>(
+                typed_lhs, typed_rhs, typed_result, n, args, overflow);
+    } else {
+        // an int128 sum of more than 38 digits may still come back into
+        // range, so checked ADD/SUB keep the overflow builtins.
+        constexpr bool has_scale_down = op == DecimalV3Op::MUL;
+        // 10^k is never a power of 2 for k > 0, so SHIFT is left out.
+        if (has_scale_down && args.down_factor != 1) {
+            if (Divider<InterT>(static_cast<InterT>(args.down_factor)).get_algo() == DividerAlgo::MUL_SHIFT) {
+                return decimalv3_internal::compute<op, LhsT, RhsT, ResultT, InterT, checked, has_scale_down,
+                                                   DividerAlgo::MUL_SHIFT>(typed_lhs, typed_rhs, typed_result, n,
+                                                                           args, overflow);
+            }
+            return decimalv3_internal::compute<op, LhsT, RhsT, ResultT, InterT, checked, has_scale_down,
+                                               DividerAlgo::MUL_ADD_SHIFT>(typed_lhs, typed_rhs, typed_result, n,
+                                                                           args, overflow);
+        }
+        return decimalv3_internal::compute<op, LhsT, RhsT, ResultT, InterT, checked, false>(
+                typed_lhs, typed_rhs, typed_result, n, args, overflow);
+    }
+}
+
+using DecimalV3KernelFn = size_t (*)(void const*, void const*, void*, size_t, DecimalV3Args const&, uint8_t*);
+
+// kernels of every (op, lhs width, rhs width, result width, intermediate
+// class), the intermediate class is never narrower than the operands. RESCALE
+// is unary, its rhs width is always DECIMAL32.
+namespace decimalv3_internal {
+constexpr size_t TABLE_SIZE = DECIMALV3_OP_NR * DECIMALV3_WIDTH_NR * DECIMALV3_WIDTH_NR * DECIMALV3_WIDTH_NR *
+                              DECIMALV3_INTER_CLASS_NR;
+
+static constexpr size_t table_index(DecimalV3Op op, DecimalV3Width lhs, DecimalV3Width rhs, DecimalV3Width res,
+                                    DecimalV3InterClass inter) {
+    return (((static_cast<size_t>(op) * DECIMALV3_WIDTH_NR + lhs) * DECIMALV3_WIDTH_NR + rhs) * DECIMALV3_WIDTH_NR +
+            res) *
+                   DECIMALV3_INTER_CLASS_NR +
+           inter;
+}
+
+template <size_t I>
+static constexpr DecimalV3KernelFn table_entry() {
+    constexpr auto inter = static_cast<DecimalV3InterClass>(I % DECIMALV3_INTER_CLASS_NR);
+    constexpr auto res = static_cast<DecimalV3Width>(I / DECIMALV3_INTER_CLASS_NR % DECIMALV3_WIDTH_NR);
+    constexpr auto rhs =
+            static_cast<DecimalV3Width>(I / DECIMALV3_INTER_CLASS_NR / DECIMALV3_WIDTH_NR % DECIMALV3_WIDTH_NR);
+    constexpr auto lhs = static_cast<DecimalV3Width>(I / DECIMALV3_INTER_CLASS_NR / DECIMALV3_WIDTH_NR /
+                                                     DECIMALV3_WIDTH_NR % DECIMALV3_WIDTH_NR);
+    constexpr auto op = static_cast<DecimalV3Op>(I / DECIMALV3_INTER_CLASS_NR / DECIMALV3_WIDTH_NR /
+                                                 DECIMALV3_WIDTH_NR / DECIMALV3_WIDTH_NR);
+    constexpr bool legal = std::min<int>(inter, DECIMAL128) >= std::max(lhs, rhs) &&
+                           (op != DecimalV3Op::RESCALE || rhs == DECIMAL32);
+    if constexpr (legal) {
+        return &decimalv3_kernel<op, decimalv3_width_type_t<lhs>, decimalv3_width_type_t<rhs>,
+                                 decimalv3_width_type_t<res>, decimalv3_inter_type_t<inter>,
+                                 inter == INTER128_CHECKED>;
+    } else {
+        return nullptr;
+    }
+}
+
+template <size_t... I>
+static constexpr std::array<DecimalV3KernelFn, sizeof...(I)> make_table(std::index_sequence<I...>) {
+    return {table_entry<I>()...};
+}
+
+inline constexpr auto KERNELS = make_table(std::make_index_sequence<TABLE_SIZE>());
+} // namespace decimalv3_internal
+
+// a kernel resolved from runtime (precision, scale), invalid if the
+// precisions/scales are illegal.
+struct DecimalV3Call {
+    DecimalV3KernelFn kernel{nullptr};
+    DecimalV3Args args;
+    int inter_precision{0};
+
+    bool valid() const { return kernel != nullptr; }
+    size_t operator()(void const* lhs, void const* rhs, void* result, size_t n, uint8_t* overflow) const {
+        return kernel(lhs, rhs, result, n, args, overflow);
+    }
+};
+
+// p2 and s2 are ignored by RESCALE.
+static inline DecimalV3Call decimalv3_resolve(DecimalV3Op op, int p1, int s1, int p2, int s2, int rp, int rs) {
+    DecimalV3Call call;
+    if (op == DecimalV3Op::RESCALE) {
+        p2 = 1;
+        s2 = 0;
+    }
+    if (!decimalv3_is_legal(op, p1, s1, p2, s2, rp, rs)) {
+        return call;
+    }
+    call.inter_precision = decimalv3_intermediate_precision(op, p1, s1, p2, s2, rs);
+    auto index = decimalv3_internal::table_index(op, decimalv3_width(p1), decimalv3_width(p2), decimalv3_width(rp),
+                                                 decimalv3_inter_class(call.inter_precision));
+    call.kernel = decimalv3_internal::KERNELS[index];
+    call.args = decimalv3_args(op, s1, s2, rp, rs);
+    assert(call.kernel != nullptr);
+    return call;
+}
+
+// the same kernels with all the precisions and scales known at compile time.
+template <DecimalV3Op op, int P1, int S1, int P2, int S2, int RP, int RS>
+struct DecimalV3 {
+    static_assert(decimalv3_is_legal(op, P1, S1, P2, S2, RP, RS), "illegal precision or scale");
+    static constexpr int INTER_PRECISION = decimalv3_intermediate_precision(op, P1, S1, P2, S2, RS);
+    static constexpr DecimalV3Args ARGS = decimalv3_args(op, S1, S2, RP, RS);
+    static constexpr DecimalV3InterClass INTER_CLASS = decimalv3_inter_class(INTER_PRECISION);
+    static constexpr bool CHECKED = INTER_CLASS == INTER128_CHECKED;
+    using LhsType = decimal_type_t<P1>;
+    using RhsType = decimal_type_t<P2>;
+    using ResultType = decimal_type_t<RP>;
+    using InterType = decimalv3_inter_type_t<INTER_CLASS>;
+
+    static size_t compute(LhsType const* lhs, RhsType const* rhs, ResultType* result, size_t n, uint8_t* overflow) {
+        return decimalv3_kernel<op, LhsType, RhsType, ResultType, InterType, CHECKED>(
+                lhs, rhs, result, n, ARGS, overflow);
+    }
+};
+
+template <int P1, int S1, int RP, int RS>
+using DecimalV3Rescale = DecimalV3<DecimalV3Op::RESCALE, P1, S1, 1, 0, RP, RS>;
+
 #endif // CPP_ETUDES_INCLUDE_DECIMALV3_HH_
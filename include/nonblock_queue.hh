@@ -8,10 +8,291 @@
 //
 
 #pragma once
+#include <folly/detail/Futex.h>
+#include <folly/lang/Align.h>
+
+#include <atomic>
+#include <cassert>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <memory>
+#include <new>
+#include <type_traits>
+#include <utility>
 
 namespace nonblock {
+// futex word: (generation << 1) | has_sleepers. sleepers set has_sleepers
+// before sleeping, a notifier only issues FUTEX_WAKE when it finds the bit and
+// clears it by starting a new generation, so a burst of operations wakes the
+// sleepers only once.
+class FutexWaiters {
+public:
+    void notify_all() {
+        // pairs with the fence in await, either the sleeper sees the slot or
+        // we see has_sleepers.
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto key = _futex.load(std::memory_order_relaxed);
+        if ((key & 1) != 0 && _futex.compare_exchange_strong(key, key + 1, std::memory_order_relaxed)) {
+            folly::detail::futexWake(&_futex);
+        }
+    }
+
+    template <typename Pred>
+    void await(Pred&& ready) {
+        while (true) {
+            auto key = _futex.fetch_or(1, std::memory_order_relaxed) | 1;
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            if (ready()) {
+                return;
+            }
+            folly::detail::futexWait(&_futex, key);
+            if (ready()) {
+                return;
+            }
+        }
+    }
+
+private:
+    folly::detail::Futex<> _futex{0};
+};
+
+// bounded MPMC queue(Dmitry Vyukov). slot i of lap l carries sequence number
+// l*capacity+i when it is empty and l*capacity+i+1 when it is full, so a
+// producer owns the slot at _tail once its seq equals _tail, a consumer owns
+// the slot at _head once its seq equals _head+1, and each operation costs one
+// CAS on _tail or _head. blocking variants spin for a while, then sleep on
+// Waiters, which is FutexWaiters or anything with notify_all() and
+// await(ready), e.g. concurrent::EventCount.
+template <typename T, typename Waiters = FutexWaiters>
 class Queue {
+    static_assert(std::is_nothrow_move_constructible_v<T>, "T must be nothrow move constructible");
+    static constexpr size_t SPIN_NR = 128;
+
+    struct Slot {
+        std::atomic<uint64_t> seq;
+        std::aligned_storage_t<sizeof(T), alignof(T)> storage;
+        T* get() { return reinterpret_cast<T*>(&storage); }
+    };
+
 public:
+    // capacity is rounded up to power of 2, at least 2: with one slot the full
+    // seq of a lap equals the empty seq of the next lap.
+    explicit Queue(size_t capacity);
+    ~Queue();
+
+    size_t capacity() const { return _mask + 1; }
+    // may be stale once returned.
+    size_t size_approx() const {
+        auto tail = _tail.load(std::memory_order_relaxed);
+        auto head = _head.load(std::memory_order_relaxed);
+        return tail > head ? tail - head : 0;
+    }
+
+    template <typename... Args>
+    bool try_emplace(Args&&... args);
+    bool try_enqueue(T const& v) { return try_emplace(v); }
+    bool try_enqueue(T&& v) { return try_emplace(std::move(v)); }
+    bool try_dequeue(T& v);
+
+    // wait while the queue is full.
+    template <typename... Args>
+    void emplace(Args&&... args);
+    void enqueue(T const& v) { emplace(v); }
+    void enqueue(T&& v) { emplace(std::move(v)); }
+    // wait while the queue is empty.
+    void dequeue(T& v);
+
+    // move the longest prefix of [first, first+n) that fits into the queue with
+    // one CAS, return the number of items enqueued.
+    template <typename It>
+    size_t try_enqueue_bulk(It first, size_t n);
+    // dequeue up to n items into out with one CAS, return the number of items
+    // dequeued.
+    template <typename OutIt>
+    size_t try_dequeue_bulk(OutIt out, size_t n);
+    // wait until all n items are enqueued.
+    template <typename It>
+    void enqueue_bulk(It first, size_t n);
+    // wait until at least one item is dequeued.
+    template <typename OutIt>
+    size_t dequeue_bulk(OutIt out, size_t n);
+
 private:
+    Queue(Queue const&) = delete;
+    Queue& operator=(Queue const&) = delete;
+    // reserve up to n consecutive slots from cursor, whose seq must be
+    // cursor+delta, return the first reserved position and set n to the number
+    // of slots reserved, n is set to 0 if no slot is ready.
+    uint64_t reserve(std::atomic<uint64_t>& cursor, uint64_t delta, size_t& n);
+    void notify(Waiters& waiters);
+    template <typename Pred>
+    void wait(Waiters& waiters, Pred&& ready);
+
+    const size_t _mask;
+    std::unique_ptr<Slot[]> _slots;
+    alignas(folly::hardware_destructive_interference_size) std::atomic<uint64_t> _tail{0};
+    alignas(folly::hardware_destructive_interference_size) std::atomic<uint64_t> _head{0};
+    alignas(folly::hardware_destructive_interference_size) Waiters _not_empty;
+    alignas(folly::hardware_destructive_interference_size) Waiters _not_full;
 };
-} // namespace nonblock
\ No newline at end of file
+
+template <typename T, typename Waiters>
+Queue<T, Waiters>::Queue(size_t capacity)
+        : _mask((capacity <= 2 ? 2 : size_t(1) << (64 - __builtin_clzll(capacity - 1))) - 1),
+          _slots(new Slot[_mask + 1]) {
+    for (size_t i = 0; i <= _mask; ++i) {
+        _slots[i].seq.store(i, std::memory_order_relaxed);
+    }
+}
+
+template <typename T, typename Waiters>
+Queue<T, Waiters>::~Queue() {
+    auto tail = _tail.load(std::memory_order_relaxed);
+    for (auto head = _head.load(std::memory_order_relaxed); head < tail; ++head) {
+        _slots[head & _mask].get()->~T();
+    }
+}
+
+template <typename T, typename Waiters>
+uint64_t Queue<T, Waiters>::reserve(std::atomic<uint64_t>& cursor, uint64_t delta, size_t& n) {
+    auto pos = cursor.load(std::memory_order_relaxed);
+    while (true) {
+        size_t ready_nr = 0;
+        while (ready_nr < n && ready_nr <= _mask &&
+               _slots[(pos + ready_nr) & _mask].seq.load(std::memory_order_acquire) == pos + ready_nr + delta) {
+            ++ready_nr;
+        }
+        if (ready_nr == 0) {
+            auto seq = _slots[pos & _mask].seq.load(std::memory_order_acquire);
+            // the slot is not released by the previous lap, i.e. full for
+            // producers or empty for consumers.
+            if ((int64_t)(seq - (pos + delta)) < 0) {
+                n = 0;
+                return pos;
+            }
+            // other threads moved cursor forward.
+            pos = cursor.load(std::memory_order_relaxed);
+            continue;
+        }
+        if (cursor.compare_exchange_weak(pos, pos + ready_nr, std::memory_order_relaxed)) {
+            n = ready_nr;
+            return pos;
+        }
+    }
+}
+
+template <typename T, typename Waiters>
+void Queue<T, Waiters>::notify(Waiters& waiters) {
+    waiters.notify_all();
+}
+
+template <typename T, typename Waiters>
+template <typename Pred>
+void Queue<T, Waiters>::wait(Waiters& waiters, Pred&& ready) {
+    for (size_t i = 0; i < SPIN_NR; ++i) {
+        if (ready()) {
+            return;
+        }
+        __builtin_ia32_pause();
+    }
+    waiters.await(ready);
+}
+
+template <typename T, typename Waiters>
+template <typename... Args>
+bool Queue<T, Waiters>::try_emplace(Args&&... args) {
+    size_t n = 1;
+    auto pos = reserve(_tail, 0, n);
+    if (n == 0) {
+        return false;
+    }
+    auto& slot = _slots[pos & _mask];
+    new (slot.get()) T(std::forward<Args>(args)...);
+    slot.seq.store(pos + 1, std::memory_order_release);
+    notify(_not_empty);
+    return true;
+}
+
+template <typename T, typename Waiters>
+bool Queue<T, Waiters>::try_dequeue(T& v) {
+    size_t n = 1;
+    auto pos = reserve(_head, 1, n);
+    if (n == 0) {
+        return false;
+    }
+    auto& slot = _slots[pos & _mask];
+    v = std::move(*slot.get());
+    slot.get()->~T();
+    slot.seq.store(pos + _mask + 1, std::memory_order_release);
+    notify(_not_full);
+    return true;
+}
+
+template <typename T, typename Waiters>
+template <typename... Args>
+void Queue<T, Waiters>::emplace(Args&&... args) {
+    // args are only consumed by the successful try_emplace.
+    wait(_not_full, [&]() { return try_emplace(std::forward<Args>(args)...); });
+}
+
+template <typename T, typename Waiters>
+void Queue<T, Waiters>::dequeue(T& v) {
+    wait(_not_empty, [&]() { return try_dequeue(v); });
+}
+
+template <typename T, typename Waiters>
+template <typename It>
+size_t Queue<T, Waiters>::try_enqueue_bulk(It first, size_t n) {
+    auto pos = reserve(_tail, 0, n);
+    for (size_t i = 0; i < n; ++i, ++first) {
+        auto& slot = _slots[(pos + i) & _mask];
+        new (slot.get()) T(std::move(*first));
+        slot.seq.store(pos + i + 1, std::memory_order_release);
+    }
+    if (n > 0) {
+        notify(_not_empty);
+    }
+    return n;
+}
+
+template <typename T, typename Waiters>
+template <typename OutIt>
+size_t Queue<T, Waiters>::try_dequeue_bulk(OutIt out, size_t n) {
+    auto pos = reserve(_head, 1, n);
+    for (size_t i = 0; i < n; ++i, ++out) {
+        auto& slot = _slots[(pos + i) & _mask];
+        *out = std::move(*slot.get());
+        slot.get()->~T();
+        slot.seq.store(pos + i + _mask + 1, std::memory_order_release);
+    }
+    if (n > 0) {
+        notify(_not_full);
+    }
+    return n;
+}
+
+template <typename T, typename Waiters>
+template <typename It>
+void Queue<T, Waiters>::enqueue_bulk(It first, size_t n) {
+    while (n > 0) {
+        wait(_not_full, [&]() {
+            auto enqueued_nr = try_enqueue_bulk(first, n);
+            std::advance(first, enqueued_nr);
+            n -= enqueued_nr;
+            return enqueued_nr > 0;
+        });
+    }
+}
+
+template <typename T, typename Waiters>
+template <typename OutIt>
+size_t Queue<T, Waiters>::dequeue_bulk(OutIt out, size_t n) {
+    size_t dequeued_nr = 0;
+    wait(_not_empty, [&]() {
+        dequeued_nr = try_dequeue_bulk(out, n);
+        return dequeued_nr > 0;
+    });
+    return dequeued_nr;
+}
+} // namespace nonblock
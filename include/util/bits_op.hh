@@ -24,6 +24,14 @@ static inline uint32_t reverse_bits(uint32_t n) {
     return m;
 }
 
+static inline uint64_t reverse_bits64(uint64_t n) {
+    n = __builtin_bswap64(n);
+    n = ((n & 0x0f0f0f0f0f0f0f0full) << 4) | ((n >> 4) & 0x0f0f0f0f0f0f0f0full);
+    n = ((n & 0x3333333333333333ull) << 2) | ((n >> 2) & 0x3333333333333333ull);
+    n = ((n & 0x5555555555555555ull) << 1) | ((n >> 1) & 0x5555555555555555ull);
+    return n;
+}
+
 } // namespace util
 } // namespace grakra
 } // namespace com
@@ -0,0 +1,149 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/10.
+//
+
+#include <cassert>
+#include <concurrent/epoch.hh>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+thread_local EpochManager::ThreadRecordHolder EpochManager::holder;
+
+EpochManager& EpochManager::instance() {
+    // never destructed, so threads exiting after main can still release records.
+    static EpochManager* manager = new EpochManager();
+    return *manager;
+}
+
+EpochManager::ThreadRecordHolder::~ThreadRecordHolder() {
+    if (record == nullptr) {
+        return;
+    }
+    // the limbo lists are inherited by the next thread that acquires the record.
+    record->nesting = 0;
+    record->epoch.store(0, std::memory_order_release);
+    record->in_use.store(false, std::memory_order_release);
+    record = nullptr;
+}
+
+EpochManager::ThreadRecord* EpochManager::acquire_record() {
+    for (auto record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+        auto in_use = false;
+        if (!record->in_use.load(std::memory_order_relaxed) &&
+            record->in_use.compare_exchange_strong(in_use, true, std::memory_order_acq_rel)) {
+            return record;
+        }
+    }
+    auto record = new ThreadRecord();
+    assert(record != nullptr);
+    record->in_use.store(true, std::memory_order_relaxed);
+    auto head = records.load(std::memory_order_relaxed);
+    do {
+        record->next = head;
+    } while (!records.compare_exchange_weak(head, record, std::memory_order_acq_rel));
+    return record;
+}
+
+EpochManager::ThreadRecord* EpochManager::get_record() {
+    if (__builtin_expect(holder.record == nullptr, 0)) {
+        holder.record = acquire_record();
+    }
+    return holder.record;
+}
+
+void EpochManager::enter() {
+    auto record = get_record();
+    if (record->nesting++ > 0) {
+        return;
+    }
+    auto epoch = global_epoch.load(std::memory_order_seq_cst);
+    while (true) {
+        record->epoch.store((epoch << 1) | 1, std::memory_order_seq_cst);
+        // re-read the global epoch, the announcement is valid only if the global
+        // epoch is not advanced in the meantime.
+        auto curr_epoch = global_epoch.load(std::memory_order_seq_cst);
+        if (curr_epoch == epoch) {
+            break;
+        }
+        epoch = curr_epoch;
+    }
+}
+
+void EpochManager::exit() {
+    auto record = get_record();
+    assert(record->nesting > 0);
+    if (--record->nesting > 0) {
+        return;
+    }
+    record->epoch.store(record->epoch.load(std::memory_order_relaxed) & ~uint64_t(1), std::memory_order_release);
+}
+
+void EpochManager::free_limbo(std::vector<std::pair<void*, RetireFunc>>& limbo) {
+    for (auto& [ptr, func] : limbo) {
+        func(ptr);
+    }
+    limbo.clear();
+}
+
+void EpochManager::reclaim(ThreadRecord* record, uint64_t epoch) {
+    for (auto i = 0; i < EPOCH_NR; ++i) {
+        if (record->limbo_epochs[i] + 2 <= epoch) {
+            free_limbo(record->limbo[i]);
+        }
+    }
+}
+
+void EpochManager::retire(void* ptr, RetireFunc func) {
+    auto record = get_record();
+    // the epoch must be read after the node has been unlinked, so threads that
+    // still reference the node announced an epoch not greater than it.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    auto epoch = global_epoch.load(std::memory_order_seq_cst);
+    auto idx = epoch % EPOCH_NR;
+    if (record->limbo_epochs[idx] != epoch) {
+        // nodes in this limbo list were retired at least EPOCH_NR epochs ago.
+        free_limbo(record->limbo[idx]);
+        record->limbo_epochs[idx] = epoch;
+    }
+    record->limbo[idx].emplace_back(ptr, func);
+    if (++record->retire_nr % ADVANCE_INTERVAL == 0) {
+        try_advance();
+    }
+}
+
+bool EpochManager::try_advance() {
+    auto epoch = global_epoch.load(std::memory_order_seq_cst);
+    auto advanced = true;
+    for (auto record = records.load(std::memory_order_acquire); record != nullptr; record = record->next) {
+        auto record_epoch = record->epoch.load(std::memory_order_seq_cst);
+        if ((record_epoch & 1) && (record_epoch >> 1) != epoch) {
+            advanced = false;
+            break;
+        }
+    }
+    if (advanced) {
+        global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+        epoch = global_epoch.load(std::memory_order_seq_cst);
+    }
+    reclaim(get_record(), epoch);
+    return advanced;
+}
+
+size_t EpochManager::get_pending_nr() {
+    auto record = get_record();
+    size_t n = 0;
+    for (auto i = 0; i < EPOCH_NR; ++i) {
+        n += record->limbo[i].size();
+    }
+    return n;
+}
+
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
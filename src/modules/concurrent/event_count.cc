@@ -0,0 +1,40 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/11/9.
+//
+
+#include <concurrent/event_count.hh>
+#include <folly/synchronization/ParkingLot.h>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+namespace {
+folly::ParkingLot<> event_count_lot;
+} // namespace
+
+void EventCount::wait(Key key) {
+    while ((state.load(std::memory_order_seq_cst) >> EPOCH_SHIFT) == key.epoch) {
+        event_count_lot.park(
+                this, folly::Unit(),
+                [this, key]() { return (state.load(std::memory_order_seq_cst) >> EPOCH_SHIFT) == key.epoch; },
+                []() {});
+    }
+    cancel_wait();
+}
+
+void EventCount::wake(bool all) {
+    state.fetch_add(EPOCH, std::memory_order_seq_cst);
+    if (all) {
+        event_count_lot.unpark(this, [](folly::Unit) { return folly::UnparkControl::RemoveContinue; });
+    } else {
+        event_count_lot.unpark(this, [](folly::Unit) { return folly::UnparkControl::RemoveBreak; });
+    }
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
@@ -8,6 +8,7 @@
 //
 #include <atomic>
 #include <cassert>
+#include <concurrent/epoch.hh>
 #include <concurrent/list.hh>
 namespace com {
 namespace grakra {
@@ -77,6 +78,7 @@ void MichaelList::Clear() {
 }
 
 bool MichaelList::Insert(MarkPtrType* head, NodeType* node, NodeType** exist_node) {
+    EpochGuard guard;
     MarkPtrType* prev = head;
     MarkPtrType pmark_curr_ptag;
     MarkPtrType cmark_next_ctag;
@@ -94,6 +96,7 @@ bool MichaelList::Insert(MarkPtrType* head, NodeType* node, NodeType** exist_nod
 }
 
 bool MichaelList::Remove(MarkPtrType* head, uint32_t key) {
+    EpochGuard guard;
     MarkPtrType* prev = nullptr;
     MarkPtrType pmark_curr_ptag;
     MarkPtrType cmark_next_ctag;
@@ -113,7 +116,7 @@ bool MichaelList::Remove(MarkPtrType* head, uint32_t key) {
         auto prev_new = MarkPtrType(list_next(cmark_next_ctag), 0, pmark_curr_ptag.get_tag() + 1);
         if (atomic_ptr(prev->ptr)->compare_exchange_strong(prev_old.ptr, prev_new.ptr)) {
             if (__builtin_expect(list_next(pmark_curr_ptag) != nullptr, 1)) {
-                delete list_node(list_next(pmark_curr_ptag));
+                retire_object(list_node(list_next(pmark_curr_ptag)));
             }
         } else {
             find(head, prev, pmark_curr_ptag, cmark_next_ctag, key);
@@ -123,6 +126,7 @@ bool MichaelList::Remove(MarkPtrType* head, uint32_t key) {
 }
 
 bool MichaelList::Search(MarkPtrType* head, uint32_t key, uint32_t& value) {
+    EpochGuard guard;
     MarkPtrType* prev = head;
     MarkPtrType pmark_curr_ptag;
     MarkPtrType cmark_next_ctag;
@@ -130,10 +134,21 @@ bool MichaelList::Search(MarkPtrType* head, uint32_t key, uint32_t& value) {
         return false;
     }
     auto node = list_node(list_next(pmark_curr_ptag));
-    value = node->value;
+    value = atomic_ptr(node->value)->load(std::memory_order_acquire);
     return !list_next(pmark_curr_ptag)->is_mark_delete();
 }
 
+NodeType* MichaelList::Find(MarkPtrType* head, uint32_t key) {
+    MarkPtrType* prev = head;
+    MarkPtrType pmark_curr_ptag;
+    MarkPtrType cmark_next_ctag;
+    NodeType* node = nullptr;
+    if (!find(head, prev, pmark_curr_ptag, cmark_next_ctag, key, &node)) {
+        return nullptr;
+    }
+    return node;
+}
+
 bool MichaelList::find(MarkPtrType* head, MarkPtrType*& prev, MarkPtrType& pmark_curr_ptag,
                        MarkPtrType& cmark_next_ctag, uint32_t key, NodeType** node) {
     prev = head;
@@ -165,7 +180,7 @@ bool MichaelList::find(MarkPtrType* head, MarkPtrType*& prev, MarkPtrType& pmark
             auto prev_new = MarkPtrType(cmark_next_ctag.get(), 0, pmark_curr_ptag.get_tag() + 1);
             if (atomic_ptr(prev->ptr)->compare_exchange_strong(prev_old.ptr, prev_new.ptr, std::memory_order_acq_rel)) {
                 if (__builtin_expect(list_next(pmark_curr_ptag) != nullptr, 1)) {
-                    delete list_node(list_next(pmark_curr_ptag));
+                    retire_object(list_node(list_next(pmark_curr_ptag)));
                 }
                 // now prev->get_tag() == pmark_curr_ptag.get_tag()+1
                 cmark_next_ctag.set_tag(pmark_curr_ptag.get_tag() + 1);
@@ -0,0 +1,170 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/11/9.
+//
+
+#include <concurrent/parking_mutex.hh>
+#include <folly/synchronization/ParkingLot.h>
+
+#include <algorithm>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+namespace {
+folly::ParkingLot<> mutex_lot;
+
+constexpr size_t SPIN_TABLE_SIZE = 64;
+constexpr uint32_t MIN_SPIN_NR = 16;
+constexpr uint32_t MAX_SPIN_NR = 2048;
+constexpr uint32_t INIT_SPIN_NR = 128;
+// spin limits of ParkingMutexes hashed by address. a locker that gets the lock
+// by spinning moves the limit towards the spins it took(glibc's adaptive
+// mutex), a locker that has to park shrinks it since spinning did not pay.
+std::atomic<uint16_t> spin_limits[SPIN_TABLE_SIZE];
+
+std::atomic<uint16_t>& spin_limit_of(void const* addr) {
+    auto h = reinterpret_cast<uintptr_t>(addr) * 0x9E3779B97F4A7C15ull;
+    return spin_limits[h >> (64 - 6)];
+}
+
+void wake_one(void const* addr) {
+    mutex_lot.unpark(addr, [](folly::Unit) { return folly::UnparkControl::RemoveBreak; });
+}
+
+void wake_all(void const* addr) {
+    mutex_lot.unpark(addr, [](folly::Unit) { return folly::UnparkControl::RemoveContinue; });
+}
+} // namespace
+
+void ParkingMutex::lock_slow() {
+    auto& limit = spin_limit_of(this);
+    uint32_t spin_limit = limit.load(std::memory_order_relaxed);
+    spin_limit = spin_limit == 0 ? INIT_SPIN_NR : spin_limit;
+    const auto max_spin_nr = std::min(MAX_SPIN_NR, spin_limit * 2 + 10);
+    uint32_t spin_nr = 0;
+    bool parked = false;
+    while (true) {
+        auto s = state.load(std::memory_order_relaxed);
+        if ((s & LOCKED) == 0) {
+            // a thread woken from the ParkingLot can not tell whether others
+            // are still parked, so it keeps PARKED and the next unlock checks.
+            uint8_t locked = parked ? (LOCKED | PARKED) : LOCKED;
+            if (state.compare_exchange_weak(s, s | locked, std::memory_order_acquire, std::memory_order_relaxed)) {
+                break;
+            }
+            continue;
+        }
+        if ((s & PARKED) == 0 && spin_nr < max_spin_nr) {
+            ++spin_nr;
+            __builtin_ia32_pause();
+            continue;
+        }
+        if ((s & PARKED) == 0 &&
+            !state.compare_exchange_weak(s, s | PARKED, std::memory_order_relaxed, std::memory_order_relaxed)) {
+            continue;
+        }
+        mutex_lot.park(
+                this, folly::Unit(),
+                [this]() { return state.load(std::memory_order_seq_cst) == (LOCKED | PARKED); }, []() {});
+        parked = true;
+    }
+    if (parked) {
+        spin_limit -= spin_limit / 8;
+    } else {
+        spin_limit += (int32_t(spin_nr) - int32_t(spin_limit)) / 8;
+    }
+    limit.store(std::clamp(spin_limit, MIN_SPIN_NR, MAX_SPIN_NR), std::memory_order_relaxed);
+}
+
+void ParkingMutex::unlock_slow() {
+    state.store(0, std::memory_order_seq_cst);
+    wake_one(this);
+}
+
+void ParkingSharedMutex::lock_slow() {
+    uint32_t spin_nr = 0;
+    while (true) {
+        auto s = state.load(std::memory_order_relaxed);
+        if ((s & (WRITER | READER_MASK)) == 0) {
+            if (state.compare_exchange_weak(s, (s | WRITER) & ~WRITER_PENDING, std::memory_order_acquire,
+                                            std::memory_order_relaxed)) {
+                return;
+            }
+            continue;
+        }
+        if ((s & WRITER_PENDING) == 0 &&
+            !state.compare_exchange_weak(s, s | WRITER_PENDING, std::memory_order_relaxed)) {
+            continue;
+        }
+        if (spin_nr < MIN_SPIN_NR * 4) {
+            ++spin_nr;
+            __builtin_ia32_pause();
+            continue;
+        }
+        s |= WRITER_PENDING;
+        if ((s & PARKED) == 0 && !state.compare_exchange_weak(s, s | PARKED, std::memory_order_relaxed)) {
+            continue;
+        }
+        mutex_lot.park(
+                this, folly::Unit(),
+                [this]() {
+                    auto s = state.load(std::memory_order_seq_cst);
+                    return (s & (WRITER | READER_MASK)) != 0 && (s & PARKED) != 0;
+                },
+                []() {});
+    }
+}
+
+void ParkingSharedMutex::unlock() {
+    auto s = state.fetch_and(~(WRITER | PARKED), std::memory_order_seq_cst);
+    if ((s & PARKED) != 0) {
+        wake_all(this);
+    }
+}
+
+void ParkingSharedMutex::lock_shared_slow() {
+    uint32_t spin_nr = 0;
+    while (true) {
+        auto s = state.load(std::memory_order_relaxed);
+        if ((s & (WRITER | WRITER_PENDING)) == 0) {
+            if (state.compare_exchange_weak(s, s + READER, std::memory_order_acquire, std::memory_order_relaxed)) {
+                return;
+            }
+            continue;
+        }
+        if (spin_nr < MIN_SPIN_NR * 4) {
+            ++spin_nr;
+            __builtin_ia32_pause();
+            continue;
+        }
+        if ((s & PARKED) == 0 && !state.compare_exchange_weak(s, s | PARKED, std::memory_order_relaxed)) {
+            continue;
+        }
+        mutex_lot.park(
+                this, folly::Unit(),
+                [this]() {
+                    auto s = state.load(std::memory_order_seq_cst);
+                    return (s & (WRITER | WRITER_PENDING)) != 0 && (s & PARKED) != 0;
+                },
+                []() {});
+    }
+}
+
+void ParkingSharedMutex::unlock_shared() {
+    auto s = state.fetch_sub(READER, std::memory_order_seq_cst) - READER;
+    // the last reader wakes the parked writers and the readers behind them.
+    while ((s & READER_MASK) == 0 && (s & PARKED) != 0) {
+        if (state.compare_exchange_weak(s, s & ~PARKED, std::memory_order_seq_cst)) {
+            wake_all(this);
+            return;
+        }
+    }
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
@@ -0,0 +1,194 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/22.
+//
+
+#include <concurrent/work_stealing_pool.hh>
+namespace com {
+namespace grakra {
+namespace concurrent {
+
+namespace {
+struct CurrentWorker {
+    void* pool{nullptr};
+    void* worker{nullptr};
+};
+thread_local CurrentWorker current;
+// ForJob waiters of non-worker threads park here, keyed by the job address.
+folly::ParkingLot<> job_lot;
+constexpr size_t SPIN_ROUND_NR = 64;
+} // namespace
+
+WorkStealingPool::WorkStealingPool(size_t worker_nr) : stop(false), work_epoch(0), idle_nr(0) {
+    if (worker_nr == 0) {
+        worker_nr = 1;
+    }
+    for (size_t i = 0; i < worker_nr; ++i) {
+        workers.emplace_back(new Worker());
+    }
+    // threads are started after all the deques exist, they steal from each other.
+    for (auto& worker : workers) {
+        auto self = worker.get();
+        worker->thread = std::thread([this, self]() { work(self); });
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    stop.store(true, std::memory_order_release);
+    work_epoch.fetch_add(1, std::memory_order_seq_cst);
+    idle_lot.unpark(this, [](folly::Unit) { return folly::UnparkControl::RemoveContinue; });
+    for (auto& worker : workers) {
+        worker->thread.join();
+    }
+    for (auto& worker : workers) {
+        while (auto task = worker->deque.Take()) {
+            delete task.value();
+        }
+    }
+    while (auto task = injection.dequeue()) {
+        delete task.value();
+    }
+}
+
+WorkStealingPool::Worker* WorkStealingPool::current_worker() {
+    return current.pool == this ? static_cast<Worker*>(current.worker) : nullptr;
+}
+
+void WorkStealingPool::push(TaskNode* task) {
+    auto self = current_worker();
+    if (self != nullptr) {
+        self->deque.Push(task);
+    } else {
+        injection.enqueue(task);
+    }
+    notify();
+}
+
+void WorkStealingPool::notify() {
+    // pairs with the increment of idle_nr in work, either the idle worker sees
+    // the task or we see the idle worker.
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (idle_nr.load(std::memory_order_relaxed) > 0) {
+        work_epoch.fetch_add(1, std::memory_order_seq_cst);
+        idle_lot.unpark(this, [](folly::Unit) { return folly::UnparkControl::RemoveBreak; });
+    }
+}
+
+WorkStealingPool::TaskNode* WorkStealingPool::find_task(Worker* self) {
+    if (self != nullptr) {
+        if (auto task = self->deque.Take()) {
+            return task.value();
+        }
+    }
+    if (auto task = injection.dequeue()) {
+        return task.value();
+    }
+    // steal from a pseudo-random victim on, so thieves do not gang up on the
+    // first worker.
+    static thread_local uint64_t seed = reinterpret_cast<uintptr_t>(&seed);
+    seed = seed * 6364136223846793005ull + 1442695040888963407ull;
+    const auto n = workers.size();
+    const auto start = (seed >> 33) % n;
+    for (size_t i = 0; i < n; ++i) {
+        auto victim = workers[(start + i) % n].get();
+        if (victim == self) {
+            continue;
+        }
+        if (auto task = victim->deque.Steal()) {
+            return task.value();
+        }
+    }
+    return nullptr;
+}
+
+void WorkStealingPool::run(TaskNode* task) {
+    task->fn();
+    delete task;
+}
+
+void WorkStealingPool::work(Worker* self) {
+    current.pool = this;
+    current.worker = self;
+    while (!stop.load(std::memory_order_acquire)) {
+        TaskNode* task = nullptr;
+        for (size_t i = 0; i < SPIN_ROUND_NR && task == nullptr; ++i) {
+            task = find_task(self);
+        }
+        if (task != nullptr) {
+            run(task);
+            continue;
+        }
+        auto epoch = work_epoch.load(std::memory_order_acquire);
+        idle_nr.fetch_add(1, std::memory_order_seq_cst);
+        task = find_task(self);
+        if (task == nullptr) {
+            idle_lot.park(this, folly::Unit(),
+                          [&]() {
+                              return work_epoch.load(std::memory_order_acquire) == epoch &&
+                                     !stop.load(std::memory_order_acquire);
+                          },
+                          []() {});
+        }
+        idle_nr.fetch_sub(1, std::memory_order_relaxed);
+        if (task != nullptr) {
+            run(task);
+        }
+    }
+    current.pool = nullptr;
+    current.worker = nullptr;
+}
+
+void WorkStealingPool::Submit(Task task) {
+    push(new TaskNode{std::move(task)});
+}
+
+void WorkStealingPool::run_range(ForJob* job, size_t begin, size_t end) {
+    while (end - begin > job->grain) {
+        auto mid = begin + (end - begin) / 2;
+        push(new TaskNode{[this, job, mid, end]() { run_range(job, mid, end); }});
+        end = mid;
+    }
+    job->fn(begin, end);
+    if (job->remaining.fetch_sub(end - begin, std::memory_order_acq_rel) == end - begin) {
+        // job may be destructed by the waiter from now on, unpark only hashes
+        // its address.
+        job_lot.unpark(job, [](folly::Unit) { return folly::UnparkControl::RemoveContinue; });
+    }
+}
+
+void WorkStealingPool::ParallelFor(size_t begin, size_t end, size_t grain, RangeFunc const& fn) {
+    if (begin >= end) {
+        return;
+    }
+    grain = grain == 0 ? 1 : grain;
+    if (end - begin <= grain) {
+        fn(begin, end);
+        return;
+    }
+    ForJob job{fn, grain, {end - begin}};
+    auto self = current_worker();
+    if (self != nullptr) {
+        // work-first, then help the others until the job is done.
+        run_range(&job, begin, end);
+        while (job.remaining.load(std::memory_order_acquire) != 0) {
+            if (auto task = find_task(self)) {
+                run(task);
+            } else {
+                std::this_thread::yield();
+            }
+        }
+        return;
+    }
+    push(new TaskNode{[this, &job, begin, end]() { run_range(&job, begin, end); }});
+    while (job.remaining.load(std::memory_order_acquire) != 0) {
+        job_lot.park(&job, folly::Unit(), [&]() { return job.remaining.load(std::memory_order_acquire) != 0; },
+                     []() {});
+    }
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
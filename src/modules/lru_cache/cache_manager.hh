@@ -66,7 +66,7 @@ public:
     size_t capacity();
 
 private:
-    ShardedLRUCache _cache;
+    ShardedLRUCache<> _cache;
 };
 
 } // namespace query_cache
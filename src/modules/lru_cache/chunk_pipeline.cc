@@ -0,0 +1,143 @@
+// This file is licensed under the Elastic License 2.0. Copyright 2021-present, StarRocks Limited.
+#include "lru_cache/chunk_pipeline.hh"
+
+#include <glog/logging.h>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+namespace starrocks {
+namespace query_cache {
+
+ChunkOperator make_filter(std::function<bool(const Chunk&)> pred) {
+    return [pred = std::move(pred)](ChunkPtr chunk) { return pred(*chunk) ? std::move(chunk) : nullptr; };
+}
+
+ChunkOperator make_project(std::function<ChunkPtr(const Chunk&)> project) {
+    return [project = std::move(project)](ChunkPtr chunk) { return project(*chunk); };
+}
+
+// the threads of a stage finish items out of order, the buffer releases them to
+// the output queue in seq order. a thread whose item is capacity or more ahead
+// of the next one to release waits; the thread holding the next one never
+// does, so the window keeps moving.
+class ChunkPipeline::ReorderBuffer {
+public:
+    ReorderBuffer(size_t capacity, Queue* output) : _slots(capacity), _filled(capacity, false), _output(output) {}
+
+    void write(Item&& item) {
+        std::unique_lock l(_mutex);
+        _not_full.wait(l, [&]() { return item.seq < _next_seq + _slots.size(); });
+        auto i = item.seq % _slots.size();
+        DCHECK(!_filled[i]);
+        _slots[i] = std::move(item);
+        _filled[i] = true;
+        if (i != _next_seq % _slots.size()) {
+            return;
+        }
+        // the lock is held across the writes, so the output keeps the order.
+        for (; _filled[i]; i = _next_seq % _slots.size()) {
+            _output->blockingWrite(std::move(_slots[i]));
+            _filled[i] = false;
+            ++_next_seq;
+        }
+        _not_full.notify_all();
+    }
+
+private:
+    std::mutex _mutex;
+    std::condition_variable _not_full;
+    std::vector<Item> _slots;
+    std::vector<bool> _filled;
+    uint64_t _next_seq{0};
+    Queue* const _output;
+};
+
+ChunkPipeline& ChunkPipeline::add_stage(ChunkOperator op, size_t parallelism) {
+    _stages.push_back({std::move(op), std::max<size_t>(parallelism, 1)});
+    return *this;
+}
+
+size_t ChunkPipeline::run(const ChunkSource& source, const ChunkSink& sink) {
+    // every queue ends with eos_nr eos items: the last parallelism eos items a
+    // stage reads make its threads quit, the others are only forwarded, so all
+    // the seqs of every queue are written and no thread waits forever.
+    size_t eos_nr = 1;
+    for (auto& stage : _stages) {
+        eos_nr = std::max(eos_nr, stage.parallelism);
+    }
+    CHECK(_queue_capacity >= eos_nr) << "queue_capacity must not be less than the parallelism of any stage";
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (size_t i = 0; i <= _stages.size(); ++i) {
+        queues.emplace_back(new Queue(_queue_capacity));
+    }
+    std::vector<std::thread> threads;
+    std::vector<std::unique_ptr<std::atomic<size_t>>> eos_left;
+    std::vector<std::unique_ptr<ReorderBuffer>> reorders;
+    for (size_t i = 0; i < _stages.size(); ++i) {
+        eos_left.emplace_back(new std::atomic<size_t>(eos_nr));
+        reorders.emplace_back(new ReorderBuffer(_queue_capacity, queues[i + 1].get()));
+    }
+    for (size_t i = 0; i < _stages.size(); ++i) {
+        auto& stage = _stages[i];
+        auto* input = queues[i].get();
+        auto* output = reorders[i].get();
+        auto* left = eos_left[i].get();
+        for (size_t k = 0; k < stage.parallelism; ++k) {
+            threads.emplace_back([&stage, input, output, left]() {
+                while (true) {
+                    Item item;
+                    input->blockingRead(item);
+                    if (item.eos) {
+                        output->write(std::move(item));
+                        if (left->fetch_sub(1) <= stage.parallelism) {
+                            return;
+                        }
+                        continue;
+                    }
+                    if (item.chunk != nullptr) {
+                        item.chunk = stage.op(std::move(item.chunk));
+                    }
+                    output->write(std::move(item));
+                }
+            });
+        }
+    }
+
+    // the sink runs on its own thread, the source may block on a full queue.
+    auto* last = queues.back().get();
+    std::thread sink_thread([&sink, last, eos_nr]() {
+        size_t eos_seen = 0;
+        while (eos_seen < eos_nr) {
+            Item item;
+            last->blockingRead(item);
+            if (item.eos) {
+                ++eos_seen;
+            } else if (item.chunk != nullptr) {
+                sink(std::move(item.chunk));
+            }
+        }
+    });
+
+    uint64_t seq = 0;
+    auto* first = queues.front().get();
+    while (auto chunk = source()) {
+        first->blockingWrite(Item{seq++, std::move(chunk), false});
+    }
+    const size_t chunk_nr = seq;
+    for (size_t i = 0; i < eos_nr; ++i) {
+        first->blockingWrite(Item{seq++, nullptr, true});
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    sink_thread.join();
+    return chunk_nr;
+}
+
+} // namespace query_cache
+} // namespace starrocks
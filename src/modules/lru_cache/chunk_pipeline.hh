@@ -0,0 +1,60 @@
+// This file is licensed under the Elastic License 2.0. Copyright 2021-present, StarRocks Limited.
+#pragma once
+#include <folly/MPMCQueue.h>
+
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <utility>
+#include <vector>
+
+#include "lru_cache/cache_manager.hh"
+
+namespace starrocks {
+namespace query_cache {
+
+// maps a chunk to a chunk, returning nullptr drops it(filter).
+using ChunkOperator = std::function<ChunkPtr(ChunkPtr)>;
+// produces the next chunk, nullptr means the end(scan).
+using ChunkSource = std::function<ChunkPtr()>;
+// consumes the surviving chunks in source order(aggregate).
+using ChunkSink = std::function<void(ChunkPtr)>;
+
+ChunkOperator make_filter(std::function<bool(const Chunk&)> pred);
+ChunkOperator make_project(std::function<ChunkPtr(const Chunk&)> project);
+
+// push-based pipeline: source -> stage#0 -> ... -> stage#n-1 -> sink. a stage
+// runs its operator on parallelism threads, stages are connected by bounded
+// MPMCQueues. the source numbers the chunks and every stage puts them back in
+// that order before its output queue, so the sink sees the chunks in source
+// order while the stages overlap. dropped chunks travel on as nullptr to keep
+// the sequence numbers dense.
+class ChunkPipeline {
+public:
+    explicit ChunkPipeline(size_t queue_capacity = 64) : _queue_capacity(queue_capacity) {}
+
+    ChunkPipeline& add_stage(ChunkOperator op, size_t parallelism);
+    // pull the source on the calling thread until it returns nullptr, return
+    // once the sink has consumed every surviving chunk. the number of chunks
+    // produced by the source is returned.
+    size_t run(const ChunkSource& source, const ChunkSink& sink);
+
+private:
+    struct Item {
+        uint64_t seq{0};
+        ChunkPtr chunk;
+        bool eos{false};
+    };
+    using Queue = folly::MPMCQueue<Item>;
+    class ReorderBuffer;
+    struct Stage {
+        ChunkOperator op;
+        size_t parallelism;
+    };
+
+    const size_t _queue_capacity;
+    std::vector<Stage> _stages;
+};
+
+} // namespace query_cache
+} // namespace starrocks
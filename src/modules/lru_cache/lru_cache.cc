@@ -4,6 +4,7 @@
 
 #include "lru_cache/lru_cache.hh"
 
+#include <concurrent/parking_mutex.hh>
 #include <glog/logging.h>
 
 #include <cstdio>
@@ -150,29 +151,34 @@ bool HandleTable::_resize() {
     return true;
 }
 
-LRUCache::LRUCache() {
+template <typename Mutex>
+LRUCache<Mutex>::LRUCache() {
     // Make empty circular linked list
     _lru.next = &_lru;
     _lru.prev = &_lru;
 }
 
-LRUCache::~LRUCache() {
+template <typename Mutex>
+LRUCache<Mutex>::~LRUCache() {
     prune();
 }
 
-bool LRUCache::_unref(LRUHandle* e) {
+template <typename Mutex>
+bool LRUCache<Mutex>::_unref(LRUHandle* e) {
     DCHECK(e->refs > 0);
     e->refs--;
     return e->refs == 0;
 }
 
-void LRUCache::_lru_remove(LRUHandle* e) {
+template <typename Mutex>
+void LRUCache<Mutex>::_lru_remove(LRUHandle* e) {
     e->next->prev = e->prev;
     e->prev->next = e->next;
     e->prev = e->next = nullptr;
 }
 
-void LRUCache::_lru_append(LRUHandle* list, LRUHandle* e) {
+template <typename Mutex>
+void LRUCache<Mutex>::_lru_append(LRUHandle* list, LRUHandle* e) {
     // Make "e" newest entry by inserting just before *list
     e->next = list;
     e->prev = list->prev;
@@ -180,11 +186,12 @@ void LRUCache::_lru_append(LRUHandle* list, LRUHandle* e) {
     e->next->prev = e;
 }
 
-void LRUCache::set_capacity(size_t capacity) {
+template <typename Mutex>
+void LRUCache<Mutex>::set_capacity(size_t capacity) {
     std::vector<LRUHandle*> last_ref_list;
     {
         std::lock_guard l(_mutex);
-        _capacity = capacity;
+        _capacity.store(capacity, std::memory_order_relaxed);
         _evict_from_lru(0, &last_ref_list);
     }
 
@@ -193,27 +200,31 @@ void LRUCache::set_capacity(size_t capacity) {
     }
 }
 
-uint64_t LRUCache::get_lookup_count() {
+template <typename Mutex>
+uint64_t LRUCache<Mutex>::get_lookup_count() {
     std::lock_guard l(_mutex);
     return _lookup_count;
 }
 
-uint64_t LRUCache::get_hit_count() {
+template <typename Mutex>
+uint64_t LRUCache<Mutex>::get_hit_count() {
     std::lock_guard l(_mutex);
     return _hit_count;
 }
 
-size_t LRUCache::get_usage() {
+template <typename Mutex>
+size_t LRUCache<Mutex>::get_usage() {
     std::lock_guard l(_mutex);
     return _usage;
 }
 
-size_t LRUCache::get_capacity() {
-    std::lock_guard l(_mutex);
-    return _capacity;
+template <typename Mutex>
+size_t LRUCache<Mutex>::get_capacity() {
+    return _capacity.load(std::memory_order_relaxed);
 }
 
-Cache::Handle* LRUCache::lookup(const CacheKey& key, uint32_t hash) {
+template <typename Mutex>
+Cache::Handle* LRUCache<Mutex>::lookup(const CacheKey& key, uint32_t hash) {
     std::lock_guard l(_mutex);
     ++_lookup_count;
     LRUHandle* e = _table.lookup(key, hash);
@@ -230,7 +241,8 @@ Cache::Handle* LRUCache::lookup(const CacheKey& key, uint32_t hash) {
     return reinterpret_cast<Cache::Handle*>(e);
 }
 
-void LRUCache::release(Cache::Handle* handle) {
+template <typename Mutex>
+void LRUCache<Mutex>::release(Cache::Handle* handle) {
     if (handle == nullptr) {
         return;
     }
@@ -243,7 +255,7 @@ void LRUCache::release(Cache::Handle* handle) {
             _usage -= e->charge;
         } else if (e->in_cache && e->refs == 1) {
             // only exists in cache
-            if (_usage > _capacity) {
+            if (_usage > _capacity.load(std::memory_order_relaxed)) {
                 // take this opportunity and remove the item
                 _table.remove(e->key(), e->hash);
                 e->in_cache = false;
@@ -263,10 +275,12 @@ void LRUCache::release(Cache::Handle* handle) {
     }
 }
 
-void LRUCache::_evict_from_lru(size_t charge, std::vector<LRUHandle*>* deleted) {
+template <typename Mutex>
+void LRUCache<Mutex>::_evict_from_lru(size_t charge, std::vector<LRUHandle*>* deleted) {
+    const size_t capacity = _capacity.load(std::memory_order_relaxed);
     LRUHandle* cur = &_lru;
     // 1. evict normal cache entries
-    while (_usage + charge > _capacity && cur->next != &_lru) {
+    while (_usage + charge > capacity && cur->next != &_lru) {
         LRUHandle* old = cur->next;
         if (old->priority == CachePriority::DURABLE) {
             cur = cur->next;
@@ -276,7 +290,7 @@ void LRUCache::_evict_from_lru(size_t charge, std::vector<LRUHandle*>* deleted)
         deleted->push_back(old);
     }
     // 2. evict durable cache entries if need
-    while (_usage + charge > _capacity && _lru.next != &_lru) {
+    while (_usage + charge > capacity && _lru.next != &_lru) {
         LRUHandle* old = _lru.next;
         DCHECK(old->priority == CachePriority::DURABLE);
         _evict_one_entry(old);
@@ -284,7 +298,8 @@ void LRUCache::_evict_from_lru(size_t charge, std::vector<LRUHandle*>* deleted)
     }
 }
 
-void LRUCache::_evict_one_entry(LRUHandle* e) {
+template <typename Mutex>
+void LRUCache<Mutex>::_evict_one_entry(LRUHandle* e) {
     DCHECK(e->in_cache);
     DCHECK(e->refs == 1); // LRU list contains elements which may be evicted
     _lru_remove(e);
@@ -294,7 +309,8 @@ void LRUCache::_evict_one_entry(LRUHandle* e) {
     _usage -= e->charge;
 }
 
-Cache::Handle* LRUCache::insert(const CacheKey& key, uint32_t hash, void* value, size_t charge,
+template <typename Mutex>
+Cache::Handle* LRUCache<Mutex>::insert(const CacheKey& key, uint32_t hash, void* value, size_t charge,
                                 void (*deleter)(const CacheKey& key, void* value), CachePriority priority) {
     LRUHandle* e = reinterpret_cast<LRUHandle*>(malloc(sizeof(LRUHandle) - 1 + key.size()));
     e->value = value;
@@ -341,7 +357,8 @@ Cache::Handle* LRUCache::insert(const CacheKey& key, uint32_t hash, void* value,
     return reinterpret_cast<Cache::Handle*>(e);
 }
 
-void LRUCache::erase(const CacheKey& key, uint32_t hash) {
+template <typename Mutex>
+void LRUCache<Mutex>::erase(const CacheKey& key, uint32_t hash) {
     LRUHandle* e = nullptr;
     bool last_ref = false;
     {
@@ -365,7 +382,8 @@ void LRUCache::erase(const CacheKey& key, uint32_t hash) {
     }
 }
 
-int LRUCache::prune() {
+template <typename Mutex>
+int LRUCache<Mutex>::prune() {
     std::vector<LRUHandle*> last_ref_list;
     {
         std::lock_guard l(_mutex);
@@ -387,72 +405,83 @@ int LRUCache::prune() {
     return last_ref_list.size();
 }
 
-inline uint32_t ShardedLRUCache::_hash_slice(const CacheKey& s) {
+template <typename Mutex>
+inline uint32_t ShardedLRUCache<Mutex>::_hash_slice(const CacheKey& s) {
     return s.hash(s.data(), s.size(), 0);
 }
 
-uint32_t ShardedLRUCache::_shard(uint32_t hash) {
+template <typename Mutex>
+uint32_t ShardedLRUCache<Mutex>::_shard(uint32_t hash) {
     return hash >> (32 - kNumShardBits);
 }
 
-ShardedLRUCache::ShardedLRUCache(size_t capacity) : _last_id(0), _capacity(capacity) {
-    const size_t per_shard = (_capacity + (kNumShards - 1)) / kNumShards;
+template <typename Mutex>
+ShardedLRUCache<Mutex>::ShardedLRUCache(size_t capacity) : _last_id(0), _capacity(capacity) {
+    const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
     for (auto& _shard : _shards) {
         _shard.set_capacity(per_shard);
     }
 }
 
-void ShardedLRUCache::set_capacity(size_t capacity) {
-    // Maybe multi client try to set capactity, we protect it using mutex.
-    std::lock_guard l(_mutex);
+template <typename Mutex>
+void ShardedLRUCache<Mutex>::set_capacity(size_t capacity) {
     const size_t per_shard = (capacity + (kNumShards - 1)) / kNumShards;
-    for (auto& _shard : _shards) {
-        _shard.set_capacity(per_shard);
-    }
-    _capacity = capacity;
+    _capacity.update([&](size_t& total) {
+        for (auto& _shard : _shards) {
+            _shard.set_capacity(per_shard);
+        }
+        total = capacity;
+    });
 }
 
-Cache::Handle* ShardedLRUCache::insert(const CacheKey& key, void* value, size_t charge,
+template <typename Mutex>
+Cache::Handle* ShardedLRUCache<Mutex>::insert(const CacheKey& key, void* value, size_t charge,
                                        void (*deleter)(const CacheKey& key, void* value), CachePriority priority) {
     const uint32_t hash = _hash_slice(key);
     return _shards[_shard(hash)].insert(key, hash, value, charge, deleter, priority);
 }
 
-Cache::Handle* ShardedLRUCache::lookup(const CacheKey& key) {
+template <typename Mutex>
+Cache::Handle* ShardedLRUCache<Mutex>::lookup(const CacheKey& key) {
     const uint32_t hash = _hash_slice(key);
     return _shards[_shard(hash)].lookup(key, hash);
 }
 
-void ShardedLRUCache::release(Handle* handle) {
+template <typename Mutex>
+void ShardedLRUCache<Mutex>::release(Handle* handle) {
     LRUHandle* h = reinterpret_cast<LRUHandle*>(handle);
     _shards[_shard(h->hash)].release(handle);
 }
 
-void ShardedLRUCache::erase(const CacheKey& key) {
+template <typename Mutex>
+void ShardedLRUCache<Mutex>::erase(const CacheKey& key) {
     const uint32_t hash = _hash_slice(key);
     _shards[_shard(hash)].erase(key, hash);
 }
 
-void* ShardedLRUCache::value(Handle* handle) {
+template <typename Mutex>
+void* ShardedLRUCache<Mutex>::value(Handle* handle) {
     return reinterpret_cast<LRUHandle*>(handle)->value;
 }
 
-Slice ShardedLRUCache::value_slice(Handle* handle) {
+template <typename Mutex>
+Slice ShardedLRUCache<Mutex>::value_slice(Handle* handle) {
     auto lru_handle = reinterpret_cast<LRUHandle*>(handle);
     return Slice((char*)lru_handle->value, lru_handle->charge);
 }
 
-uint64_t ShardedLRUCache::new_id() {
-    std::lock_guard l(_mutex);
-    return ++(_last_id);
+template <typename Mutex>
+uint64_t ShardedLRUCache<Mutex>::new_id() {
+    return _last_id.fetch_add(1, std::memory_order_relaxed) + 1;
 }
 
-size_t ShardedLRUCache::get_capacity() {
-    std::lock_guard l(_mutex);
-    return _capacity;
+template <typename Mutex>
+size_t ShardedLRUCache<Mutex>::get_capacity() {
+    return _capacity.load();
 }
 
-void ShardedLRUCache::prune() {
+template <typename Mutex>
+void ShardedLRUCache<Mutex>::prune() {
     int num_prune = 0;
     for (auto& _shard : _shards) {
         num_prune += _shard.prune();
@@ -460,7 +489,8 @@ void ShardedLRUCache::prune() {
     VLOG(7) << "Successfully prune cache, clean " << num_prune << " entries.";
 }
 
-size_t ShardedLRUCache::get_memory_usage() {
+template <typename Mutex>
+size_t ShardedLRUCache<Mutex>::get_memory_usage() {
     size_t total_usage = 0;
     for (auto& _shard : _shards) {
         total_usage += _shard.get_usage();
@@ -468,8 +498,13 @@ size_t ShardedLRUCache::get_memory_usage() {
     return total_usage;
 }
 
+template class LRUCache<std::mutex>;
+template class LRUCache<com::grakra::concurrent::ParkingMutex>;
+template class ShardedLRUCache<std::mutex>;
+template class ShardedLRUCache<com::grakra::concurrent::ParkingMutex>;
+
 Cache* new_lru_cache(size_t capacity) {
-    return new ShardedLRUCache(capacity);
+    return new ShardedLRUCache<>(capacity);
 }
 
 } // namespace starrocks
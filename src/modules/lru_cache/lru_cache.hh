@@ -4,7 +4,9 @@
 
 #pragma once
 
+#include <atomic>
 #include <cassert>
+#include <concurrent/seq_lock.hh>
 #include <cstdint>
 #include <cstring>
 #include <mutex>
@@ -250,13 +252,16 @@ private:
     bool _resize();
 };
 
-// A single shard of sharded cache.
+// A single shard of sharded cache. Mutex is std::mutex or a drop-in
+// replacement such as com::grakra::concurrent::ParkingMutex.
+template <typename Mutex = std::mutex>
 class LRUCache {
 public:
     LRUCache();
     ~LRUCache();
 
-    // Separate from constructor so caller can easily make an array of LRUCache
+    // Separate from constructor so caller can easily make an array of LRUCache.
+    // evicts the unreferenced entries above a smaller capacity under _mutex.
     void set_capacity(size_t capacity);
 
     // Like Cache methods, but with an extra "hash" parameter.
@@ -280,11 +285,11 @@ private:
     void _evict_from_lru(size_t charge, std::vector<LRUHandle*>* deleted);
     void _evict_one_entry(LRUHandle* e);
 
-    // Initialized before use.
-    size_t _capacity{0};
+    // Initialized before use, written under _mutex and read without it.
+    std::atomic<size_t> _capacity{0};
 
     // _mutex protects the following state.
-    std::mutex _mutex;
+    Mutex _mutex;
     size_t _usage{0};
     uint64_t _last_id{0};
 
@@ -302,6 +307,7 @@ private:
 static const int kNumShardBits = 5;
 static const int kNumShards = 1 << kNumShardBits;
 
+template <typename Mutex = std::mutex>
 class ShardedLRUCache : public Cache {
 public:
     explicit ShardedLRUCache(size_t capacity);
@@ -323,10 +329,11 @@ private:
     static uint32_t _hash_slice(const CacheKey& s);
     static uint32_t _shard(uint32_t hash);
 
-    LRUCache _shards[kNumShards];
-    std::mutex _mutex;
-    uint64_t _last_id;
-    size_t _capacity;
+    LRUCache<Mutex> _shards[kNumShards];
+    std::atomic<uint64_t> _last_id;
+    // the writer lock of the SeqLock serializes set_capacity, so the shard
+    // capacities always sum up to one of the published totals.
+    com::grakra::concurrent::SeqLock<size_t> _capacity;
 };
 
 } // namespace starrocks
@@ -0,0 +1,96 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2021/08/13.
+//
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <cstring>
+#include <thread>
+
+#include "lru_cache/chunk_pipeline.hh"
+
+namespace starrocks {
+namespace query_cache {
+class TestChunkPipeline : public testing::Test {};
+
+static ChunkPtr make_chunk(int64_t id) {
+    auto column = std::make_shared<Column>();
+    column->resize(sizeof(id));
+    memcpy(column->data.data(), &id, sizeof(id));
+    auto chunk = std::make_shared<Chunk>();
+    chunk->append_column(column);
+    return chunk;
+}
+
+static int64_t chunk_id(const Chunk& chunk) {
+    int64_t id;
+    memcpy(&id, chunk.columns[0]->data.data(), sizeof(id));
+    return id;
+}
+
+TEST_F(TestChunkPipeline, testOrder) {
+    static constexpr int64_t CHUNK_NR = 20000;
+    for (auto [p0, p1, p2] : {std::tuple{1, 1, 1}, std::tuple{4, 1, 3}, std::tuple{2, 7, 5}}) {
+        ChunkPipeline pipeline(8);
+        // stages of uneven cost, chunks overtake each other inside a stage.
+        pipeline.add_stage(
+                        [](ChunkPtr chunk) {
+                            if (chunk_id(*chunk) % 7 == 0) {
+                                std::this_thread::yield();
+                            }
+                            return chunk;
+                        },
+                        p0)
+                .add_stage(make_filter([](const Chunk& chunk) { return chunk_id(chunk) % 3 != 0; }), p1)
+                .add_stage(make_project([](const Chunk& chunk) {
+                               auto projected = make_chunk(chunk_id(chunk) * 2);
+                               projected->append_column(chunk.columns[0]);
+                               return projected;
+                           }),
+                           p2);
+        int64_t next_id = 0;
+        int64_t last = -1;
+        int64_t count = 0;
+        bool ordered = true;
+        auto chunk_nr = pipeline.run([&]() { return next_id < CHUNK_NR ? make_chunk(next_id++) : nullptr; },
+                                     [&](ChunkPtr chunk) {
+                                         auto id = chunk_id(*chunk);
+                                         ordered &= id > last && id % 2 == 0 && (id / 2) % 3 != 0 &&
+                                                    chunk->columns.size() == 2;
+                                         last = id;
+                                         ++count;
+                                     });
+        ASSERT_EQ(chunk_nr, CHUNK_NR);
+        ASSERT_TRUE(ordered);
+        ASSERT_EQ(count, CHUNK_NR - (CHUNK_NR + 2) / 3);
+    }
+}
+
+TEST_F(TestChunkPipeline, testEmpty) {
+    ChunkPipeline pipeline;
+    pipeline.add_stage([](ChunkPtr chunk) { return chunk; }, 3);
+    int64_t count = 0;
+    auto chunk_nr = pipeline.run([]() { return nullptr; }, [&](ChunkPtr) { ++count; });
+    ASSERT_EQ(chunk_nr, 0);
+    ASSERT_EQ(count, 0);
+    // no stage at all.
+    ChunkPipeline empty;
+    int64_t next_id = 0;
+    chunk_nr = empty.run([&]() { return next_id < 100 ? make_chunk(next_id++) : nullptr; },
+                         [&](ChunkPtr chunk) { ASSERT_EQ(chunk_id(*chunk), count++); });
+    ASSERT_EQ(chunk_nr, 100);
+    ASSERT_EQ(count, 100);
+}
+} // namespace query_cache
+} // namespace starrocks
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
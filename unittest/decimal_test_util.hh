@@ -0,0 +1,23 @@
+//
+// Created by grakra on 2020/12/25.
+//
+
+#ifndef CPP_ETUDES_DECIMAL_TEST_UTIL_HH
+#define CPP_ETUDES_DECIMAL_TEST_UTIL_HH
+
+#include <decimal/decimal_exp10.hh>
+#include <random>
+
+namespace test {
+// a decimal of a random number of digits up to precision, either sign.
+static inline int128_t random_decimal(std::mt19937_64& rng, int precision) {
+    int128_t v = 0;
+    int digits = rng() % (precision + 1);
+    for (int i = 0; i < digits; ++i) {
+        v = v * 10 + rng() % 10;
+    }
+    return (rng() & 1) ? -v : v;
+}
+} // namespace test
+
+#endif // CPP_ETUDES_DECIMAL_TEST_UTIL_HH
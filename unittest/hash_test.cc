@@ -10,6 +10,9 @@
 #include <gtest/gtest.h>
 
 #include <concurrent/hash.hh>
+#include <string>
+#include <thread>
+#include <vector>
 
 namespace com {
 namespace grakra {
@@ -75,6 +78,264 @@ TEST_F(TestHash, testHashResizing) {
     // f(SLOT_INDEX_NR * SLOT_INDEX_NR * SLOT_INDEX_NR, 1);
 }
 
+TEST_F(TestHash, testRemove) {
+    Hash hash(0x100000, 4);
+    for (uint32_t key = 0; key < 1000; ++key) {
+        ASSERT_TRUE(hash.Put(key, key + 1));
+    }
+    uint32_t value;
+    for (uint32_t key = 0; key < 1000; key += 2) {
+        ASSERT_TRUE(hash.Remove(key));
+        ASSERT_FALSE(hash.Remove(key));
+    }
+    ASSERT_EQ(hash.get_size(), 500);
+    for (uint32_t key = 0; key < 1000; ++key) {
+        if (key % 2 == 0) {
+            ASSERT_FALSE(hash.Get(key, value));
+            ASSERT_TRUE(hash.Put(key, key + 2));
+        }
+        ASSERT_TRUE(hash.Get(key, value));
+        ASSERT_EQ(value, key % 2 == 0 ? key + 2 : key + 1);
+    }
+    ASSERT_EQ(hash.get_size(), 1000);
+}
+
+TEST_F(TestHash, testUpsertAndCompareAndSwap) {
+    Hash hash(0x100000, 4);
+    uint32_t value;
+    for (uint32_t key = 0; key < 1000; ++key) {
+        ASSERT_TRUE(hash.Upsert(key, key));
+        ASSERT_FALSE(hash.Upsert(key, key + 1));
+        ASSERT_TRUE(hash.Get(key, value));
+        ASSERT_EQ(value, key + 1);
+    }
+    ASSERT_EQ(hash.get_size(), 1000);
+    for (uint32_t key = 0; key < 1000; ++key) {
+        uint32_t expected = key;
+        ASSERT_FALSE(hash.CompareAndSwap(key, expected, key + 2));
+        ASSERT_EQ(expected, key + 1);
+        ASSERT_TRUE(hash.CompareAndSwap(key, expected, key + 2));
+        ASSERT_TRUE(hash.Get(key, value));
+        ASSERT_EQ(value, key + 2);
+    }
+    uint32_t expected = 0;
+    ASSERT_FALSE(hash.CompareAndSwap(1000, expected, 1));
+}
+
+TEST_F(TestHash, testGetOrInsert) {
+    Hash hash(0x100000, 4);
+    uint32_t value;
+    for (uint32_t key = 0; key < 1000; ++key) {
+        ASSERT_TRUE(hash.GetOrInsert(key, key, value));
+        ASSERT_EQ(value, key);
+        ASSERT_FALSE(hash.GetOrInsert(key, key + 1, value));
+        ASSERT_EQ(value, key);
+    }
+    ASSERT_EQ(hash.get_size(), 1000);
+}
+
+TEST_F(TestHash, testShrink) {
+    Hash hash(0x100000, 4);
+    const uint32_t n = 20000;
+    for (uint32_t key = 0; key < n; ++key) {
+        ASSERT_TRUE(hash.Put(key, key));
+    }
+    auto max_slot_nr = hash.get_slot_nr();
+    ASSERT_GE(max_slot_nr, n / hash.get_load_factor() / 2);
+    for (uint32_t key = 0; key < n - 100; ++key) {
+        ASSERT_TRUE(hash.Remove(key));
+    }
+    GTEST_LOG_(INFO) << "slot_nr: " << max_slot_nr << " => " << hash.get_slot_nr();
+    // shrinking follows the approximate size, a single thread leaves less than
+    // HASH_SIZE_BATCH of it unfolded in its stripe.
+    ASSERT_LE(hash.get_slot_nr() * hash.get_load_factor(), (100 + HASH_SIZE_BATCH) * HASH_SHRINK_RATIO);
+    uint32_t value;
+    for (uint32_t key = 0; key < n; ++key) {
+        ASSERT_EQ(hash.Get(key, value), key >= n - 100);
+    }
+    for (uint32_t key = 0; key < n; ++key) {
+        ASSERT_EQ(hash.Put(key, key), key < n - 100);
+    }
+    ASSERT_EQ(hash.get_size(), n);
+}
+
+TEST_F(TestHash, testMultiThreadChurn) {
+    Hash hash(0x100000, 4);
+    const size_t thread_nr = 8;
+    const uint32_t key_nr = 10000;
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < thread_nr; ++t) {
+        threads.emplace_back([&hash, t]() {
+            uint32_t value;
+            for (auto round = 0; round < 10; ++round) {
+                for (uint32_t key = t; key < key_nr; key += thread_nr) {
+                    ASSERT_TRUE(hash.Put(key, key));
+                }
+                for (uint32_t key = t; key < key_nr; key += thread_nr) {
+                    ASSERT_FALSE(hash.Upsert(key, key + 1));
+                    ASSERT_TRUE(hash.Get(key, value));
+                    ASSERT_EQ(value, key + 1);
+                    ASSERT_TRUE(hash.Remove(key));
+                }
+                // all threads contend for the same keys.
+                for (uint32_t key = key_nr; key < key_nr + 100; ++key) {
+                    hash.GetOrInsert(key, key, value);
+                    ASSERT_EQ(value, key);
+                    hash.Remove(key);
+                }
+            }
+        });
+    }
+    for (auto& thd : threads) {
+        thd.join();
+    }
+    ASSERT_EQ(hash.get_size(), 0);
+    uint32_t value;
+    for (uint32_t key = 0; key < key_nr + 100; ++key) {
+        ASSERT_FALSE(hash.Get(key, value));
+    }
+}
+
+TEST_F(TestHash, testInt64Key) {
+    Hash<int64_t, int64_t> hash(0x100000, 4);
+    const int64_t n = 10000;
+    for (int64_t i = 0; i < n; ++i) {
+        auto key = (i - n / 2) * 0x100000001ll;
+        ASSERT_TRUE(hash.Put(key, -key));
+        ASSERT_FALSE(hash.Put(key, key));
+    }
+    int64_t value;
+    for (int64_t i = 0; i < n; ++i) {
+        auto key = (i - n / 2) * 0x100000001ll;
+        ASSERT_TRUE(hash.Get(key, value));
+        ASSERT_EQ(value, -key);
+        ASSERT_FALSE(hash.Get(key + 1, value));
+    }
+    ASSERT_EQ(hash.get_size(), n);
+}
+
+TEST_F(TestHash, testStringDictionary) {
+    using Key = FixedBinaryKey<16>;
+    Hash<Key, std::string*> dict(0x1000, 4);
+    std::vector<std::unique_ptr<std::string>> strings;
+    for (auto i = 0; i < 1000; ++i) {
+        strings.push_back(std::make_unique<std::string>("str#" + std::to_string(i)));
+    }
+    std::string* value;
+    for (auto& s : strings) {
+        ASSERT_TRUE(dict.GetOrInsert(Key(*s), s.get(), value));
+        ASSERT_EQ(value, s.get());
+    }
+    for (auto& s : strings) {
+        auto copy = *s;
+        ASSERT_FALSE(dict.GetOrInsert(Key(copy), nullptr, value));
+        ASSERT_EQ(value, s.get());
+    }
+    ASSERT_FALSE(dict.Get(Key("str#1000"), value));
+    ASSERT_EQ(dict.get_size(), strings.size());
+}
+
+struct CollidedHashFn {
+    uint64_t operator()(uint64_t key) const { return key & 0x3; }
+};
+
+TEST_F(TestHash, testHashCollision) {
+    Hash<uint64_t, uint64_t, CollidedHashFn> hash(0x1000, 4);
+    for (uint64_t key = 0; key < 100; ++key) {
+        ASSERT_TRUE(hash.Put(key, key * 2));
+    }
+    uint64_t value;
+    for (uint64_t key = 0; key < 100; key += 3) {
+        ASSERT_TRUE(hash.Remove(key));
+    }
+    for (uint64_t key = 0; key < 100; ++key) {
+        if (key % 3 == 0) {
+            ASSERT_FALSE(hash.Get(key, value));
+        } else {
+            ASSERT_TRUE(hash.Get(key, value));
+            ASSERT_EQ(value, key * 2);
+        }
+    }
+}
+
+TEST_F(TestHash, testUnboundedGrowth) {
+    Hash<uint64_t, uint64_t> hash(SLOT_INDEX_NR / 2, 1);
+    ASSERT_EQ(hash.get_level_nr(), 1);
+    const uint64_t n = SLOT_INDEX_NR * SLOT_INDEX_NR * 4;
+    for (uint64_t key = 0; key < n; ++key) {
+        ASSERT_TRUE(hash.Put(key, key + 1));
+    }
+    GTEST_LOG_(INFO) << "slot_nr=" << hash.get_slot_nr() << ", level_nr=" << hash.get_level_nr();
+    ASSERT_GE(hash.get_slot_nr(), n / hash.get_load_factor() / 2);
+    ASSERT_EQ(hash.get_level_nr(), 3);
+    uint64_t value;
+    for (uint64_t key = 0; key < n; ++key) {
+        ASSERT_TRUE(hash.Get(key, value));
+        ASSERT_EQ(value, key + 1);
+    }
+}
+
+TEST_F(TestHash, testMultiThreadGrowth) {
+    Hash<uint64_t, uint64_t> hash(16, 1);
+    const size_t thread_nr = 8;
+    const uint64_t key_nr = 1 << 20;
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < thread_nr; ++t) {
+        threads.emplace_back([&hash, t]() {
+            uint64_t value;
+            for (uint64_t key = t; key < key_nr; key += thread_nr) {
+                ASSERT_TRUE(hash.Put(key, key));
+                ASSERT_TRUE(hash.Get(key, value));
+            }
+        });
+    }
+    for (auto& thd : threads) {
+        thd.join();
+    }
+    ASSERT_EQ(hash.get_size(), key_nr);
+    ASSERT_GE(hash.get_slot_nr(), key_nr / 2);
+    uint64_t value;
+    for (uint64_t key = 0; key < key_nr; ++key) {
+        ASSERT_TRUE(hash.Get(key, value));
+        ASSERT_EQ(value, key);
+    }
+}
+
+TEST_F(TestHash, testBatch) {
+    Hash<uint64_t, uint64_t> hash(16, 2);
+    const size_t n = 100003;
+    std::vector<uint64_t> keys(n);
+    std::vector<uint64_t> values(n);
+    for (size_t i = 0; i < n; ++i) {
+        keys[i] = i * 2;
+        values[i] = i;
+    }
+    // duplicated keys in a batch are inserted only once.
+    keys[n - 1] = keys[n - 2];
+    ASSERT_EQ(hash.PutBatch(keys.data(), values.data(), n), n - 1);
+    ASSERT_EQ(hash.PutBatch(keys.data(), values.data(), n), 0);
+    ASSERT_EQ(hash.get_size(), n - 1);
+    for (size_t i = 0; i < n; i += 7) {
+        ASSERT_TRUE(hash.Remove(keys[i]));
+    }
+
+    std::vector<uint64_t> probe_keys(n * 2);
+    for (size_t i = 0; i < probe_keys.size(); ++i) {
+        probe_keys[i] = i;
+    }
+    std::vector<uint64_t> probe_values(probe_keys.size());
+    std::unique_ptr<bool[]> found(new bool[probe_keys.size()]);
+    auto found_nr = hash.GetBatch(probe_keys.data(), probe_keys.size(), probe_values.data(), found.get());
+    ASSERT_EQ(found_nr, hash.get_size());
+    for (size_t i = 0; i < probe_keys.size(); ++i) {
+        uint64_t value;
+        ASSERT_EQ(found[i], hash.Get(probe_keys[i], value));
+        if (found[i]) {
+            ASSERT_EQ(probe_values[i], value);
+        }
+    }
+}
+
 } // namespace concurrent
 } // namespace grakra
 } // namespace com
@@ -190,8 +190,7 @@ void same_key_thread_func(std::shared_ptr<MichaelList> list, uint32_t key, size_
             break;
         }
         case 1: {
-            // TODO: Remove crashes
-            // list->Remove(key);
+            list->Remove(key);
             break;
         }
         case 2: {
@@ -0,0 +1,66 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2021/08/13.
+//
+
+#include <gtest/gtest.h>
+
+#include <memory>
+#include <string>
+
+#include "lru_cache/lru_cache.hh"
+
+namespace starrocks {
+class TestLRUCache : public testing::Test {};
+
+static int deleted_nr = 0;
+
+static void count_deleter(const CacheKey&, void*) {
+    ++deleted_nr;
+}
+
+static void insert_and_release(LRUCache<std::mutex>& cache, int i) {
+    std::string key = std::to_string(i);
+    CacheKey cache_key(key);
+    cache.release(cache.insert(cache_key, cache_key.hash(key.data(), key.size(), 0), nullptr, 1, count_deleter));
+}
+
+TEST_F(TestLRUCache, testShrinkCapacity) {
+    deleted_nr = 0;
+    LRUCache<std::mutex> cache;
+    cache.set_capacity(100);
+    for (int i = 0; i < 100; ++i) {
+        insert_and_release(cache, i);
+    }
+    ASSERT_EQ(cache.get_usage(), 100);
+    // the unreferenced entries above the new capacity are freed at once.
+    cache.set_capacity(10);
+    ASSERT_EQ(cache.get_capacity(), 10);
+    ASSERT_EQ(cache.get_usage(), 10);
+    ASSERT_EQ(deleted_nr, 90);
+    cache.set_capacity(100);
+    ASSERT_EQ(cache.get_usage(), 10);
+    ASSERT_EQ(deleted_nr, 90);
+}
+
+TEST_F(TestLRUCache, testShardedShrinkCapacity) {
+    std::unique_ptr<Cache> cache(new_lru_cache(1600));
+    for (int i = 0; i < 1600; ++i) {
+        std::string key = std::to_string(i);
+        cache->release(cache->insert(CacheKey(key), nullptr, 1, count_deleter));
+    }
+    ASSERT_GT(cache->get_memory_usage(), 160);
+    cache->set_capacity(160);
+    ASSERT_EQ(cache->get_capacity(), 160);
+    ASSERT_LE(cache->get_memory_usage(), 160);
+}
+} // namespace starrocks
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,165 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/14.
+//
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <concurrent/node_pool.hh>
+#include <memory>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+namespace com {
+namespace grakra {
+namespace concurrent {
+class TestNodePool : public testing::Test {};
+
+struct PoolNode {
+    MarkPtrType next;
+    uint32_t owner;
+    uint32_t seq;
+    PoolNode(uint32_t owner, uint32_t seq) : next(nullptr), owner(owner), seq(seq) {}
+};
+
+static void drain_limbo() {
+    auto& manager = EpochManager::instance();
+    for (auto i = 0; i < 2 * EpochManager::EPOCH_NR; ++i) {
+        manager.try_advance();
+    }
+}
+
+TEST_F(TestNodePool, testAllocateAndFree) {
+    NodePool<PoolNode> pool;
+    std::vector<PoolNode*> nodes;
+    std::unordered_set<PoolNode*> addresses;
+    for (uint32_t i = 0; i < 10000; ++i) {
+        auto node = pool.Allocate(0, i);
+        ASSERT_EQ(reinterpret_cast<uintptr_t>(node) % NODE_POOL_ALIGN, 0);
+        ASSERT_TRUE(addresses.insert(node).second);
+        nodes.push_back(node);
+    }
+    for (uint32_t i = 0; i < nodes.size(); ++i) {
+        ASSERT_EQ(nodes[i]->seq, i);
+    }
+    // the thread cache is LIFO.
+    pool.Free(nodes.back());
+    ASSERT_EQ(pool.Allocate(0, 0), nodes.back());
+    auto chunk_nr = pool.get_chunk_nr();
+    for (auto node : nodes) {
+        pool.Free(node);
+    }
+    // freed blocks are reused before any new chunk is carved.
+    for (uint32_t i = 0; i < 10000; ++i) {
+        pool.Allocate(0, i);
+    }
+    ASSERT_EQ(pool.get_chunk_nr(), chunk_nr);
+}
+
+// frees of another pool's nodes go back to that pool, interleaved with
+// allocations from this one.
+TEST_F(TestNodePool, testFreeIntoOtherPool) {
+    NodePool<PoolNode> pool_a;
+    NodePool<PoolNode> pool_b;
+    std::vector<PoolNode*> nodes_b;
+    std::unordered_set<PoolNode*> addresses_b;
+    for (uint32_t i = 0; i < 1000; ++i) {
+        nodes_b.push_back(pool_b.Allocate(1, i));
+        addresses_b.insert(nodes_b.back());
+    }
+    auto chunk_nr_b = pool_b.get_chunk_nr();
+    std::unordered_set<PoolNode*> addresses_a;
+    for (auto node : nodes_b) {
+        auto node_a = pool_a.Allocate(0, node->seq);
+        ASSERT_TRUE(addresses_a.insert(node_a).second);
+        ASSERT_EQ(addresses_b.count(node_a), 0);
+        pool_b.Free(node);
+    }
+    for (uint32_t i = 0; i < 1000; ++i) {
+        ASSERT_EQ(addresses_b.count(pool_b.Allocate(1, i)), 1);
+    }
+    ASSERT_EQ(pool_b.get_chunk_nr(), chunk_nr_b);
+}
+
+TEST_F(TestNodePool, testRetire) {
+    NodePool<PoolNode> pool;
+    std::vector<PoolNode*> nodes;
+    for (uint32_t round = 0; round < 10; ++round) {
+        for (uint32_t i = 0; i < 1000; ++i) {
+            nodes.push_back(pool.Allocate(0, i));
+        }
+        for (auto node : nodes) {
+            pool.Retire(node);
+        }
+        nodes.clear();
+        drain_limbo();
+    }
+    ASSERT_EQ(EpochManager::instance().get_pending_nr(), 0);
+    // 10 rounds of 1000 nodes fit in the chunks of the first round.
+    ASSERT_EQ(pool.get_chunk_nr(), 1);
+}
+
+TEST_F(TestNodePool, testRetiredNodesOutlivePool) {
+    for (auto i = 0; i < 10; ++i) {
+        auto pool = std::make_unique<NodePool<PoolNode>>();
+        for (uint32_t k = 0; k < 1000; ++k) {
+            pool->Retire(pool->Allocate(0, k));
+        }
+        pool.reset();
+        std::thread([]() { drain_limbo(); }).join();
+    }
+    drain_limbo();
+    ASSERT_EQ(EpochManager::instance().get_pending_nr(), 0);
+}
+
+TEST_F(TestNodePool, testMultiThread) {
+    static constexpr uint32_t THREAD_NR = 8;
+    static constexpr uint32_t ROUND_NR = 200;
+    static constexpr uint32_t NODE_NR = 500;
+    NodePool<PoolNode> pool;
+    std::atomic<bool> corrupted(false);
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < THREAD_NR; ++t) {
+        threads.emplace_back([&, t]() {
+            std::vector<PoolNode*> nodes;
+            for (uint32_t round = 0; round < ROUND_NR; ++round) {
+                for (uint32_t i = 0; i < NODE_NR; ++i) {
+                    nodes.push_back(pool.Allocate(t, i));
+                }
+                // a block handed out twice would be overwritten by another owner.
+                for (uint32_t i = 0; i < NODE_NR; ++i) {
+                    if (nodes[i]->owner != t || nodes[i]->seq != i) {
+                        corrupted = true;
+                    }
+                }
+                for (uint32_t i = 0; i < NODE_NR; ++i) {
+                    EpochGuard guard;
+                    if (i % 2 == 0) {
+                        pool.Free(nodes[i]);
+                    } else {
+                        pool.Retire(nodes[i]);
+                    }
+                }
+                nodes.clear();
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_FALSE(corrupted.load());
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,149 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/11/9.
+//
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <concurrent/event_count.hh>
+#include <concurrent/parking_mutex.hh>
+#include <mutex>
+#include <shared_mutex>
+#include <thread>
+#include <vector>
+
+namespace com {
+namespace grakra {
+namespace concurrent {
+class TestParkingMutex : public testing::Test {};
+
+TEST_F(TestParkingMutex, testMutex) {
+    static constexpr int THREAD_NR = 8;
+    static constexpr int LOOP_NR = 100000;
+    ParkingMutex mutex;
+    ASSERT_TRUE(mutex.try_lock());
+    ASSERT_FALSE(mutex.try_lock());
+    mutex.unlock();
+    int64_t counter = 0;
+    std::vector<std::thread> threads;
+    for (int i = 0; i < THREAD_NR; ++i) {
+        threads.emplace_back([&]() {
+            for (int k = 0; k < LOOP_NR; ++k) {
+                std::lock_guard guard(mutex);
+                ++counter;
+                // hold the lock long enough now and then to make others park.
+                if (k % 1000 == 0) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_EQ(counter, THREAD_NR * LOOP_NR);
+}
+
+TEST_F(TestParkingMutex, testSharedMutex) {
+    static constexpr int WRITER_NR = 2;
+    static constexpr int READER_NR = 6;
+    static constexpr int LOOP_NR = 50000;
+    ParkingSharedMutex mutex;
+    ASSERT_TRUE(mutex.try_lock_shared());
+    ASSERT_TRUE(mutex.try_lock_shared());
+    ASSERT_FALSE(mutex.try_lock());
+    mutex.unlock_shared();
+    mutex.unlock_shared();
+    ASSERT_TRUE(mutex.try_lock());
+    ASSERT_FALSE(mutex.try_lock_shared());
+    mutex.unlock();
+
+    // writers keep a == b, readers never see them differ.
+    int64_t a = 0;
+    int64_t b = 0;
+    std::atomic<int> reader_nr(0);
+    std::atomic<bool> failed(false);
+    std::vector<std::thread> threads;
+    for (int i = 0; i < WRITER_NR; ++i) {
+        threads.emplace_back([&]() {
+            for (int k = 0; k < LOOP_NR; ++k) {
+                std::lock_guard guard(mutex);
+                if (reader_nr.load() != 0) {
+                    failed = true;
+                }
+                ++a;
+                ++b;
+            }
+        });
+    }
+    for (int i = 0; i < READER_NR; ++i) {
+        threads.emplace_back([&]() {
+            for (int k = 0; k < LOOP_NR; ++k) {
+                std::shared_lock guard(mutex);
+                reader_nr.fetch_add(1);
+                if (a != b) {
+                    failed = true;
+                }
+                reader_nr.fetch_sub(1);
+            }
+        });
+    }
+    for (auto& t : threads) {
+        t.join();
+    }
+    ASSERT_FALSE(failed.load());
+    ASSERT_EQ(a, WRITER_NR * LOOP_NR);
+}
+
+TEST_F(TestParkingMutex, testEventCount) {
+    static constexpr int CONSUMER_NR = 4;
+    static constexpr int64_t ITEM_NR = 100000;
+    EventCount ec;
+    std::atomic<int64_t> available(0);
+    std::atomic<int64_t> consumed(0);
+    std::vector<std::thread> consumers;
+    for (int i = 0; i < CONSUMER_NR; ++i) {
+        consumers.emplace_back([&]() {
+            while (true) {
+                int64_t n = 0;
+                ec.await([&]() {
+                    n = available.load();
+                    while (n > 0 && !available.compare_exchange_weak(n, n - 1)) {
+                    }
+                    return n != 0;
+                });
+                // a negative count tells the consumers to quit.
+                if (n < 0) {
+                    return;
+                }
+                consumed.fetch_add(1);
+            }
+        });
+    }
+    for (int64_t i = 0; i < ITEM_NR; ++i) {
+        available.fetch_add(1);
+        ec.notify();
+    }
+    while (consumed.load() != ITEM_NR) {
+        std::this_thread::yield();
+    }
+    available.store(-1);
+    ec.notify_all();
+    for (auto& t : consumers) {
+        t.join();
+    }
+    ASSERT_EQ(consumed.load(), ITEM_NR);
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,89 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/10.
+//
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <concurrent/rcu_cell.hh>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace com {
+namespace grakra {
+namespace concurrent {
+class TestRcuCell : public testing::Test {};
+
+struct Quota {
+    std::string tenant;
+    std::vector<int64_t> limits;
+};
+
+TEST_F(TestRcuCell, testSingleThread) {
+    RcuCell<Quota> cell(Quota{"a", {1, 2}});
+    ASSERT_EQ(cell.load().tenant, "a");
+    cell.store(Quota{"b", {3}});
+    auto name = cell.read([](Quota const& q) { return q.tenant + std::to_string(q.limits[0]); });
+    ASSERT_EQ(name, "b3");
+    cell.update([](Quota& q) { q.limits.push_back(4); });
+    ASSERT_EQ(cell.load().limits, std::vector<int64_t>({3, 4}));
+}
+
+TEST_F(TestRcuCell, testMultiThread) {
+    static constexpr int WRITER_NR = 2;
+    static constexpr int READER_NR = 6;
+    static constexpr int UPDATE_NR = 10000;
+    // every published quota has limits {n, n, ..., n} of n items.
+    RcuCell<Quota> cell(Quota{"t", {}});
+    std::atomic<bool> stop(false);
+    std::atomic<bool> torn(false);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < READER_NR; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop.load()) {
+                cell.read([&](Quota const& q) {
+                    for (auto limit : q.limits) {
+                        if (limit != int64_t(q.limits.size())) {
+                            torn = true;
+                        }
+                    }
+                    return 0;
+                });
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (int i = 0; i < WRITER_NR; ++i) {
+        writers.emplace_back([&]() {
+            for (int k = 0; k < UPDATE_NR; ++k) {
+                cell.update([](Quota& q) {
+                    q.limits.push_back(0);
+                    std::fill(q.limits.begin(), q.limits.end(), int64_t(q.limits.size()));
+                });
+            }
+        });
+    }
+    for (auto& t : writers) {
+        t.join();
+    }
+    stop.store(true);
+    for (auto& t : readers) {
+        t.join();
+    }
+    ASSERT_FALSE(torn.load());
+    ASSERT_EQ(cell.load().limits.size(), WRITER_NR * UPDATE_NR);
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,92 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/10.
+//
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <concurrent/seq_lock.hh>
+#include <thread>
+#include <vector>
+
+namespace com {
+namespace grakra {
+namespace concurrent {
+class TestSeqLock : public testing::Test {};
+
+struct CacheConfig {
+    uint64_t capacity;
+    uint32_t shard_nr;
+    uint8_t policy;
+    // capacity_per_shard * shard_nr == capacity
+    uint64_t capacity_per_shard;
+};
+
+TEST_F(TestSeqLock, testSingleThread) {
+    SeqLock<CacheConfig> lock(CacheConfig{64, 4, 1, 16});
+    ASSERT_EQ(lock.get_version(), 0);
+    auto config = lock.load();
+    ASSERT_EQ(config.capacity, 64);
+    ASSERT_EQ(config.policy, 1);
+    lock.store(CacheConfig{128, 4, 2, 32});
+    lock.update([](CacheConfig& c) { c.policy = 3; });
+    config = lock.load();
+    ASSERT_EQ(config.capacity_per_shard, 32);
+    ASSERT_EQ(config.policy, 3);
+    ASSERT_EQ(lock.get_version(), 2);
+}
+
+TEST_F(TestSeqLock, testMultiThread) {
+    static constexpr int WRITER_NR = 2;
+    static constexpr int READER_NR = 6;
+    static constexpr uint64_t UPDATE_NR = 100000;
+    SeqLock<CacheConfig> lock(CacheConfig{0, 8, 0, 0});
+    std::atomic<bool> stop(false);
+    std::atomic<bool> torn(false);
+    std::vector<std::thread> readers;
+    for (int i = 0; i < READER_NR; ++i) {
+        readers.emplace_back([&]() {
+            while (!stop.load()) {
+                auto c = lock.load();
+                if (c.capacity != c.capacity_per_shard * c.shard_nr || c.policy != c.capacity_per_shard % 256) {
+                    torn = true;
+                }
+            }
+        });
+    }
+    std::vector<std::thread> writers;
+    for (int i = 0; i < WRITER_NR; ++i) {
+        writers.emplace_back([&]() {
+            for (uint64_t k = 0; k < UPDATE_NR; ++k) {
+                lock.update([](CacheConfig& c) {
+                    ++c.capacity_per_shard;
+                    c.capacity = c.capacity_per_shard * c.shard_nr;
+                    c.policy = c.capacity_per_shard % 256;
+                });
+            }
+        });
+    }
+    for (auto& t : writers) {
+        t.join();
+    }
+    stop.store(true);
+    for (auto& t : readers) {
+        t.join();
+    }
+    ASSERT_FALSE(torn.load());
+    ASSERT_EQ(lock.load().capacity_per_shard, WRITER_NR * UPDATE_NR);
+    ASSERT_EQ(lock.get_version(), WRITER_NR * UPDATE_NR);
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,76 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/10/24.
+//
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <concurrent/sharded_counter.hh>
+#include <thread>
+#include <vector>
+
+namespace com {
+namespace grakra {
+namespace concurrent {
+class TestShardedCounter : public testing::Test {};
+
+TEST_F(TestShardedCounter, testSingleThread) {
+    ShardedCounter<int64_t> counter(16, 4);
+    ASSERT_EQ(counter.get_stripe_nr(), 4);
+    ASSERT_EQ(counter.get_max_error(), 64);
+    for (int i = 0; i < 1000; ++i) {
+        counter.add(3);
+        ASSERT_EQ(counter.read_exact(), 3 * (i + 1));
+        ASSERT_LE(std::abs(counter.read_exact() - counter.read_approx()), counter.get_max_error());
+    }
+    for (int i = 0; i < 1000; ++i) {
+        counter.sub(3);
+    }
+    ASSERT_EQ(counter.read_exact(), 0);
+    ASSERT_LE(std::abs(counter.read_approx()), counter.get_max_error());
+}
+
+TEST_F(TestShardedCounter, testMultiThread) {
+    static constexpr int THREAD_NR = 8;
+    static constexpr int64_t ADD_NR = 100000;
+    ShardedCounter<int64_t> counter(32);
+    std::atomic<bool> stop(false);
+    // exact reads never go backwards, all the deltas are positive.
+    std::thread reader([&]() {
+        int64_t last = 0;
+        while (!stop.load()) {
+            auto value = counter.read_exact();
+            ASSERT_GE(value, last);
+            ASSERT_LE(value, THREAD_NR * ADD_NR);
+            last = value;
+        }
+    });
+    std::vector<std::thread> writers;
+    for (int i = 0; i < THREAD_NR; ++i) {
+        writers.emplace_back([&]() {
+            for (int64_t k = 0; k < ADD_NR; ++k) {
+                counter.add(1);
+            }
+        });
+    }
+    for (auto& t : writers) {
+        t.join();
+    }
+    stop.store(true);
+    reader.join();
+    ASSERT_EQ(counter.read_exact(), THREAD_NR * ADD_NR);
+    ASSERT_LE(THREAD_NR * ADD_NR - counter.read_approx(), counter.get_max_error());
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
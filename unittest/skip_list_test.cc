@@ -0,0 +1,171 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/21.
+//
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <concurrent/skip_list.hh>
+#include <random>
+#include <thread>
+#include <vector>
+
+namespace com {
+namespace grakra {
+namespace concurrent {
+class TestSkipList : public testing::Test {};
+
+TEST_F(TestSkipList, testSingleThread) {
+    SkipList<int64_t, int64_t> list;
+    std::vector<int64_t> keys;
+    for (int64_t key = 0; key < 10000; ++key) {
+        keys.push_back(key * 3);
+    }
+    std::shuffle(keys.begin(), keys.end(), std::mt19937_64(0));
+    for (auto key : keys) {
+        ASSERT_TRUE(list.Insert(key, -key));
+        ASSERT_FALSE(list.Insert(key, key));
+    }
+    ASSERT_EQ(list.get_size(), keys.size());
+    GTEST_LOG_(INFO) << "level_nr=" << list.get_level_nr();
+    int64_t value;
+    for (auto key : keys) {
+        ASSERT_TRUE(list.Get(key, value));
+        ASSERT_EQ(value, -key);
+        ASSERT_FALSE(list.Get(key + 1, value));
+    }
+    for (auto key : keys) {
+        if (key % 2 == 0) {
+            ASSERT_TRUE(list.Remove(key));
+            ASSERT_FALSE(list.Remove(key));
+            ASSERT_FALSE(list.Get(key, value));
+        }
+    }
+    ASSERT_EQ(list.get_size(), keys.size() / 2);
+    ASSERT_TRUE(list.Insert(0, 1));
+    ASSERT_TRUE(list.Get(0, value));
+    ASSERT_EQ(value, 1);
+}
+
+TEST_F(TestSkipList, testIterator) {
+    SkipList<int64_t, int64_t> list;
+    {
+        auto it = list.Begin();
+        ASSERT_FALSE(it.Valid());
+    }
+    for (int64_t key = 99; key >= 0; --key) {
+        ASSERT_TRUE(list.Insert(key * 10, key));
+    }
+    int64_t expect = 0;
+    for (auto it = list.Begin(); it.Valid(); it.Next(), ++expect) {
+        ASSERT_EQ(it.key(), expect * 10);
+        ASSERT_EQ(it.value(), expect);
+    }
+    ASSERT_EQ(expect, 100);
+
+    auto it = list.LowerBound(255);
+    ASSERT_TRUE(it.Valid());
+    ASSERT_EQ(it.key(), 260);
+    // the iterator survives removal of the node under it.
+    ASSERT_TRUE(list.Remove(260));
+    ASSERT_EQ(it.key(), 260);
+    it.Next();
+    ASSERT_EQ(it.key(), 270);
+    ASSERT_EQ(list.LowerBound(255).key(), 270);
+    ASSERT_FALSE(list.LowerBound(991).Valid());
+}
+
+TEST_F(TestSkipList, testMultiThreadChurn) {
+    SkipList<int64_t, int64_t> list;
+    static constexpr size_t thread_nr = 8;
+    static constexpr int64_t key_nr = 2000;
+    static constexpr size_t round_nr = 50;
+    // even keys below key_nr * 2 are stable, the others are inserted and
+    // removed over and over, the scanner must always see all the stable keys.
+    for (int64_t key = 0; key < key_nr; ++key) {
+        ASSERT_TRUE(list.Insert(key * 2, key));
+    }
+    std::atomic<bool> stop(false);
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < thread_nr; ++t) {
+        threads.emplace_back([&list, t]() {
+            for (auto r = 0; r < round_nr; ++r) {
+                for (int64_t i = t; i < key_nr * 2; i += thread_nr) {
+                    ASSERT_TRUE(list.Insert(key_nr * 2 + i * 2, i));
+                    ASSERT_TRUE(list.Insert(i * 2 + 1, i));
+                }
+                for (int64_t i = t; i < key_nr * 2; i += thread_nr) {
+                    ASSERT_TRUE(list.Remove(key_nr * 2 + i * 2));
+                    ASSERT_TRUE(list.Remove(i * 2 + 1));
+                }
+            }
+        });
+    }
+    std::thread scanner([&list, &stop]() {
+        while (!stop.load()) {
+            int64_t expect = 0;
+            int64_t last = -1;
+            for (auto it = list.Begin(); it.Valid(); it.Next()) {
+                ASSERT_GT(it.key(), last);
+                last = it.key();
+                if (last % 2 == 0 && last < key_nr * 2) {
+                    ASSERT_EQ(last, expect * 2);
+                    ++expect;
+                }
+            }
+            ASSERT_EQ(expect, key_nr);
+        }
+    });
+    for (auto& thd : threads) {
+        thd.join();
+    }
+    stop.store(true);
+    scanner.join();
+    ASSERT_EQ(list.get_size(), key_nr);
+    int64_t value;
+    for (int64_t key = 0; key < key_nr * 6; ++key) {
+        ASSERT_EQ(list.Get(key, value), key % 2 == 0 && key < key_nr * 2);
+    }
+}
+TEST_F(TestSkipList, testMultiThreadSameKeys) {
+    SkipList<int64_t, int64_t> list;
+    static constexpr size_t thread_nr = 8;
+    static constexpr int64_t key_nr = 64;
+    std::vector<std::thread> threads;
+    std::atomic<int64_t> balance(0);
+    for (auto t = 0; t < thread_nr; ++t) {
+        threads.emplace_back([&list, &balance, t]() {
+            std::mt19937_64 gen(t);
+            for (auto r = 0; r < 100000; ++r) {
+                int64_t key = gen() % key_nr;
+                if (gen() % 2 == 0) {
+                    balance += list.Insert(key, key);
+                } else {
+                    balance -= list.Remove(key);
+                }
+            }
+        });
+    }
+    for (auto& thd : threads) {
+        thd.join();
+    }
+    ASSERT_EQ(list.get_size(), balance.load());
+    int64_t n = 0;
+    for (auto it = list.Begin(); it.Valid(); it.Next()) {
+        ++n;
+    }
+    ASSERT_EQ(n, balance.load());
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
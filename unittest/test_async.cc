@@ -20,6 +20,8 @@
 #include <random>
 #include <thread>
 #include <tuple>
+
+#include "async.hh"
 using namespace std;
 class AsyncTest : public ::testing::Test {};
 
@@ -337,6 +339,111 @@ TEST_F(AsyncTest, testAssignRightValueToRightValueRef) {
     --a;
 }
 
+TEST_F(AsyncTest, testConcurrentLinkedList) {
+    async::ConcurrentLinkedList<std::string> stack;
+    ASSERT_TRUE(stack.empty());
+    ASSERT_FALSE(stack.pop().has_value());
+    for (int i = 0; i < 10; ++i) {
+        stack.push(std::to_string(i));
+    }
+    ASSERT_EQ(stack.pop().value(), "9");
+    ASSERT_EQ(stack.pop().value(), "8");
+    auto values = stack.pop_all();
+    ASSERT_EQ(values.size(), 8);
+    for (int i = 0; i < 8; ++i) {
+        ASSERT_EQ(values[i], std::to_string(i));
+    }
+    ASSERT_TRUE(stack.empty());
+    stack.add("left in stack");
+}
+
+TEST_F(AsyncTest, testConcurrentLinkedListMultiThread) {
+    async::ConcurrentLinkedList<int64_t> stack;
+    const int thread_nr = 8;
+    const int64_t item_nr = 100000;
+    std::atomic<int64_t> sum(0);
+    std::atomic<int64_t> count(0);
+    std::vector<std::thread> threads;
+    for (int t = 0; t < thread_nr; ++t) {
+        threads.emplace_back([&, t]() {
+            for (int64_t i = t + 1; i <= item_nr; i += thread_nr) {
+                stack.push(i);
+                if (i % 7 == 0) {
+                    for (auto v : stack.pop_all()) {
+                        sum += v;
+                        ++count;
+                    }
+                } else if (auto v = stack.pop(); v.has_value()) {
+                    sum += v.value();
+                    ++count;
+                }
+            }
+        });
+    }
+    for (auto& thd : threads) {
+        thd.join();
+    }
+    for (auto v : stack.pop_all()) {
+        sum += v;
+        ++count;
+    }
+    ASSERT_EQ(count.load(), item_nr);
+    ASSERT_EQ(sum.load(), item_nr * (item_nr + 1) / 2);
+}
+
+TEST_F(AsyncTest, testConcurrentQueue) {
+    async::ConcurrentQueue<std::unique_ptr<int>> q;
+    ASSERT_TRUE(q.empty());
+    ASSERT_FALSE(q.dequeue().has_value());
+    for (int i = 0; i < 10; ++i) {
+        q.enqueue(std::make_unique<int>(i));
+    }
+    for (int i = 0; i < 5; ++i) {
+        ASSERT_EQ(*q.dequeue().value(), i);
+    }
+    ASSERT_FALSE(q.empty());
+}
+
+TEST_F(AsyncTest, testConcurrentQueueMultiThread) {
+    async::ConcurrentQueue<int64_t> q;
+    const int producer_nr = 4;
+    const int consumer_nr = 4;
+    const int64_t item_nr = 200000;
+    std::atomic<int64_t> sum(0);
+    std::atomic<int64_t> count(0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producer_nr; ++p) {
+        threads.emplace_back([&, p]() {
+            for (int64_t i = p + 1; i <= item_nr; i += producer_nr) {
+                q.enqueue(i);
+            }
+        });
+    }
+    for (int c = 0; c < consumer_nr; ++c) {
+        threads.emplace_back([&]() {
+            // items of each producer are dequeued in FIFO order
+            std::vector<int64_t> last(producer_nr, 0);
+            while (count.load() < item_nr) {
+                if (auto v = q.dequeue(); v.has_value()) {
+                    auto p = (v.value() - 1) % producer_nr;
+                    ASSERT_GT(v.value(), last[p]);
+                    last[p] = v.value();
+                    sum += v.value();
+                    ++count;
+                } else {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    for (auto& thd : threads) {
+        thd.join();
+    }
+    ASSERT_EQ(count.load(), item_nr);
+    ASSERT_EQ(sum.load(), item_nr * (item_nr + 1) / 2);
+    ASSERT_TRUE(q.empty());
+}
+
 int main(int argc, char** argv) {
     ::testing::InitGoogleTest(&argc, argv);
     return RUN_ALL_TESTS();
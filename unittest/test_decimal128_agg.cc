@@ -0,0 +1,174 @@
+//
+// Created by grakra on 2020/12/19.
+//
+
+#include <gtest/gtest.h>
+
+#include <decimal/decimal128_agg.hh>
+#include <random>
+#include <vector>
+
+#include "decimal_test_util.hh"
+namespace test {
+class TestDecimal128Agg : public testing::Test {};
+
+// the sum as wraps * 2^128 + sum.
+struct ReferenceSum {
+    int128_t sum{0};
+    int64_t wraps{0};
+    int64_t count{0};
+    void add(int128_t x) {
+        if (__builtin_add_overflow(sum, x, &sum)) {
+            wraps += x > 0 ? 1 : -1;
+        }
+        ++count;
+    }
+    bool fit(int128_t max_result) const { return wraps == 0 && -max_result <= sum && sum <= max_result; }
+};
+
+TEST_F(TestDecimal128Agg, SumMatchesReference) {
+    std::mt19937_64 rng(20201219);
+    for (int round = 0; round < 300; ++round) {
+        int precision = 1 + rng() % 38;
+        size_t n = rng() % 10000;
+        bool nullable = rng() & 1;
+        std::vector<int128_t> data(n);
+        std::vector<uint8_t> nulls(n);
+        ReferenceSum expect;
+        for (size_t i = 0; i < n; ++i) {
+            data[i] = random_decimal(rng, precision);
+            nulls[i] = nullable && rng() % 3 == 0 ? 1 + rng() % 255 : 0;
+            if (nulls[i] == 0) {
+                expect.add(data[i]);
+            }
+        }
+        Decimal128SumState state;
+        decimal128_sum_update(state, data.data(), nullable ? nulls.data() : nullptr, n);
+        ASSERT_EQ(state.count, expect.count);
+        int128_t result;
+        uint8_t overflow;
+        auto max_result = decimal_internal::max_decimal_of(38);
+        ASSERT_EQ(decimal128_sum_finalize(&state, 1, 38, &result, &overflow), !expect.fit(max_result));
+        if (expect.fit(max_result)) {
+            ASSERT_TRUE(result == expect.sum) << "round=" << round;
+        }
+    }
+}
+
+TEST_F(TestDecimal128Agg, OverflowIsDeferred) {
+    const int128_t max38 = decimal_internal::max_decimal_of(38);
+    // the running sum leaves int128 but the total fits.
+    std::vector<int128_t> data{max38, max38, max38, -max38, -max38, -max38, 5};
+    Decimal128SumState state;
+    decimal128_sum_update(state, data.data(), nullptr, data.size());
+    int128_t result;
+    uint8_t overflow;
+    ASSERT_EQ(decimal128_sum_finalize(&state, 1, 38, &result, &overflow), 0);
+    ASSERT_TRUE(result == 5);
+
+    std::vector<int128_t> data2{max38, 1};
+    Decimal128SumState state2;
+    decimal128_sum_update(state2, data2.data(), nullptr, data2.size());
+    ASSERT_EQ(decimal128_sum_finalize(&state2, 1, 38, &result, &overflow), 1);
+    ASSERT_EQ(overflow, 1);
+    ASSERT_TRUE(result == 0);
+
+    // 99.99 + 0.02 exceeds decimal(4, 2) only.
+    std::vector<int128_t> data3{9999, 2};
+    Decimal128SumState state3;
+    decimal128_sum_update(state3, data3.data(), nullptr, data3.size());
+    ASSERT_EQ(decimal128_sum_finalize(&state3, 1, 4, &result, &overflow), 1);
+    ASSERT_EQ(decimal128_sum_finalize(&state3, 1, 5, &result, &overflow), 0);
+    ASSERT_TRUE(result == 10001);
+}
+
+TEST_F(TestDecimal128Agg, Grouped) {
+    std::mt19937_64 rng(20201220);
+    const size_t group_nr = 37;
+    const size_t n = 20000;
+    std::vector<int128_t> data(n);
+    std::vector<uint8_t> nulls(n);
+    std::vector<uint32_t> group_ids(n);
+    std::vector<ReferenceSum> expect(group_nr);
+    for (size_t i = 0; i < n; ++i) {
+        data[i] = random_decimal(rng, 38);
+        nulls[i] = rng() % 5 == 0;
+        group_ids[i] = rng() % group_nr;
+        if (nulls[i] == 0) {
+            expect[group_ids[i]].add(data[i]);
+        }
+    }
+    std::vector<Decimal128SumState> states(group_nr);
+    // two chunks, as the rows of a group by arrive.
+    decimal128_sum_update_grouped(states.data(), group_ids.data(), data.data(), nulls.data(), n / 2);
+    decimal128_sum_update_grouped(states.data(), group_ids.data() + n / 2, data.data() + n / 2,
+                                  nulls.data() + n / 2, n - n / 2);
+    std::vector<int128_t> result(group_nr);
+    std::vector<uint8_t> overflow(bitmap_size(group_nr));
+    auto max_result = decimal_internal::max_decimal_of(38);
+    size_t expect_overflow_nr = 0;
+    for (auto& e : expect) {
+        expect_overflow_nr += !e.fit(max_result);
+    }
+    ASSERT_EQ(decimal128_sum_finalize(states.data(), group_nr, 38, result.data(), overflow.data()),
+              expect_overflow_nr);
+    for (size_t g = 0; g < group_nr; ++g) {
+        ASSERT_EQ(states[g].count, expect[g].count);
+        ASSERT_EQ(bitmap_test(overflow.data(), g), !expect[g].fit(max_result));
+        if (expect[g].fit(max_result)) {
+            ASSERT_TRUE(result[g] == expect[g].sum);
+        }
+    }
+
+    // merging the partial states of two halves gives the same sums.
+    std::vector<Decimal128SumState> first(group_nr), second(group_nr);
+    decimal128_sum_update_grouped(first.data(), group_ids.data(), data.data(), nulls.data(), n / 3);
+    decimal128_sum_update_grouped(second.data(), group_ids.data() + n / 3, data.data() + n / 3,
+                                  nulls.data() + n / 3, n - n / 3);
+    for (size_t g = 0; g < group_nr; ++g) {
+        decimal128_sum_merge(first[g], second[g]);
+        ASSERT_TRUE(first[g].lo_sum + (static_cast<uint128_t>(first[g].hi_sum) << 64) ==
+                    states[g].lo_sum + (static_cast<uint128_t>(states[g].hi_sum) << 64));
+        ASSERT_EQ(first[g].count, states[g].count);
+    }
+}
+
+TEST_F(TestDecimal128Agg, Avg) {
+    std::vector<int128_t> data{1, 2, -1, -2, 7, 0, 0, 0};
+    std::vector<uint32_t> group_ids{0, 0, 1, 1, 2, 2, 2, 2};
+    std::vector<uint8_t> nulls{0, 0, 0, 0, 0, 0, 0, 0};
+    std::vector<Decimal128SumState> states(4);
+    decimal128_sum_update_grouped(states.data(), group_ids.data(), data.data(), nulls.data(), data.size());
+    std::vector<int128_t> result(states.size());
+    uint8_t overflow;
+    // 1.5, -1.5, 1.75 and NULL
+    ASSERT_EQ(decimal128_avg_finalize(states.data(), states.size(), 38, 1, result.data(), &overflow), 0);
+    ASSERT_TRUE(result[0] == 2);
+    ASSERT_TRUE(result[1] == -2);
+    ASSERT_TRUE(result[2] == 2);
+    ASSERT_TRUE(result[3] == 0);
+    ASSERT_EQ(decimal128_avg_finalize(states.data(), states.size(), 38, 100, result.data(), &overflow), 0);
+    ASSERT_TRUE(result[0] == 150);
+    ASSERT_TRUE(result[1] == -150);
+    ASSERT_TRUE(result[2] == 175);
+    ASSERT_EQ(decimal128_avg_finalize(states.data(), states.size(), 2, 100, result.data(), &overflow), 3);
+    ASSERT_EQ(overflow, 0b0111);
+
+    // the sum leaves int128, the average does not.
+    const int128_t max38 = decimal_internal::max_decimal_of(38);
+    std::vector<int128_t> big(6, max38);
+    big[5] = max38 - 6;
+    Decimal128SumState state;
+    decimal128_sum_update(state, big.data(), nullptr, big.size());
+    int128_t avg;
+    ASSERT_EQ(decimal128_avg_finalize(&state, 1, 38, 1, &avg, &overflow), 0);
+    ASSERT_TRUE(avg == max38 - 1);
+    ASSERT_EQ(decimal128_avg_finalize(&state, 1, 38, 10, &avg, &overflow), 1);
+}
+
+} // namespace test
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,164 @@
+//
+// Created by grakra on 2020/12/22.
+//
+
+#include <gtest/gtest.h>
+
+#include <cmath>
+#include <decimal/decimal128_cast.hh>
+#include <limits>
+#include <random>
+#include <vector>
+namespace test {
+class TestDecimal128Cast : public testing::Test {};
+
+static bool is_null(std::vector<uint8_t> const& nulls, size_t i) {
+    return (nulls[i >> 3] >> (i & 7)) & 1;
+}
+
+// the values of misc_test: testFloat2Decimal128 and testFloat2Decimal128Overflow.
+TEST_F(TestDecimal128Cast, MiscTestValues) {
+    float src[] = {-0.88404423f, 1.72587728E8f};
+    int128_t result[2];
+    std::vector<uint8_t> nulls(bitmap_size(2));
+    ASSERT_EQ(decimal128_from_float(src, 1, 38, 0, result, nulls.data()), 0);
+    ASSERT_EQ(result[0], 0);
+    // 1.7e38 does not fit decimal(38, 30).
+    ASSERT_EQ(decimal128_from_float(src + 1, 1, 38, 30, result, nulls.data()), 1);
+    ASSERT_TRUE(is_null(nulls, 0));
+    ASSERT_EQ(result[0], 0);
+    ASSERT_EQ(decimal128_from_float(src + 1, 1, 38, 29, result, nulls.data()), 0);
+    ASSERT_EQ(result[0], static_cast<int128_t>(static_cast<double>(src[1]) * 1e29));
+}
+
+TEST_F(TestDecimal128Cast, Exact) {
+    std::vector<double> src = {std::ldexp(1.0, 70),
+                               -(std::ldexp(1.0, 100) + std::ldexp(1.0, 48)),
+                               std::ldexp(1.0, 52) + 1,
+                               -std::ldexp(1.0, 64),
+                               0.5,
+                               -0.0,
+                               std::numeric_limits<double>::denorm_min(),
+                               -1.75};
+    std::vector<int128_t> expect = {static_cast<int128_t>(1) << 70,
+                                    -((static_cast<int128_t>(1) << 100) + (static_cast<int128_t>(1) << 48)),
+                                    (static_cast<int128_t>(1) << 52) + 1,
+                                    -(static_cast<int128_t>(1) << 64),
+                                    0,
+                                    0,
+                                    0,
+                                    -1};
+    std::vector<int128_t> result(src.size());
+    std::vector<uint8_t> nulls(bitmap_size(src.size()));
+    ASSERT_EQ(decimal128_from_double(src.data(), src.size(), 38, 0, result.data(), nulls.data()), 0);
+    for (size_t i = 0; i < src.size(); ++i) {
+        ASSERT_TRUE(result[i] == expect[i]) << i;
+    }
+}
+
+TEST_F(TestDecimal128Cast, Bound) {
+    int128_t max38 = 1;
+    for (int i = 0; i < 38; ++i) {
+        max38 *= 10;
+    }
+    // 10^38 is not a double, the doubles around it are told apart exactly.
+    double above = static_cast<double>(max38);
+    if (static_cast<int128_t>(above) < max38) {
+        above = std::nextafter(above, INFINITY);
+    }
+    double below = std::nextafter(above, 0.0);
+    std::vector<double> src = {999.99,
+                               -999.99,
+                               1000.0,
+                               -1000.0,
+                               std::numeric_limits<double>::quiet_NaN(),
+                               std::numeric_limits<double>::infinity(),
+                               -std::numeric_limits<double>::infinity(),
+                               1e300};
+    std::vector<int128_t> result(src.size());
+    std::vector<uint8_t> nulls(bitmap_size(src.size()));
+    ASSERT_EQ(decimal128_from_double(src.data(), src.size(), 3, 0, result.data(), nulls.data()), 6);
+    ASSERT_TRUE(result[0] == 999 && result[1] == -999);
+    for (size_t i = 2; i < src.size(); ++i) {
+        ASSERT_TRUE(is_null(nulls, i));
+        ASSERT_TRUE(result[i] == 0);
+    }
+
+    double edges[] = {below, -below, above, -above};
+    int128_t edge_result[4];
+    std::vector<uint8_t> edge_nulls(bitmap_size(4));
+    ASSERT_EQ(decimal128_from_double(edges, 4, 38, 0, edge_result, edge_nulls.data()), 2);
+    ASSERT_TRUE(edge_result[0] == static_cast<int128_t>(below) && edge_result[0] < max38);
+    ASSERT_TRUE(edge_result[1] == -edge_result[0]);
+    ASSERT_EQ(edge_nulls[0], 0b1100);
+}
+
+static double random_double(std::mt19937_64& rng) {
+    switch (rng() % 16) {
+    case 0:
+        return std::numeric_limits<double>::quiet_NaN();
+    case 1:
+        return (rng() & 1) ? std::numeric_limits<double>::infinity() : -std::numeric_limits<double>::infinity();
+    case 2:
+        return (rng() & 1) ? 0.0 : -0.0;
+    case 3: {
+        // any bit pattern, denormals included.
+        uint64_t bits = rng();
+        double v;
+        memcpy(&v, &bits, sizeof(v));
+        return v;
+    }
+    default: {
+        double m = static_cast<double>(rng() >> 11) / static_cast<double>(1ull << 53);
+        int e = static_cast<int>(rng() % 90) - 50;
+        return ((rng() & 1) ? -m : m) * std::pow(10.0, e);
+    }
+    }
+}
+
+template <typename T>
+static void cross_check_scalar(std::mt19937_64& rng) {
+    for (size_t n : {0, 1, 7, 8, 9, 31, 1000}) {
+        std::vector<T> src(n);
+        for (auto& v : src) {
+            v = static_cast<T>(random_double(rng));
+        }
+        for (int precision : {1, 9, 18, 27, 38}) {
+            for (int scale : {0, 2, precision / 2, precision}) {
+                std::vector<int128_t> result(n), expect(n);
+                std::vector<uint8_t> nulls(bitmap_size(n)), expect_nulls(bitmap_size(n));
+                auto null_nr = decimal_internal::float_to_decimal128(src.data(), n, precision, scale, result.data(),
+                                                                     nulls.data());
+                auto expect_null_nr = decimal128_from_float_scalar(src.data(), n, precision, scale, expect.data(),
+                                                                   expect_nulls.data());
+                ASSERT_EQ(null_nr, expect_null_nr);
+                ASSERT_EQ(nulls, expect_nulls);
+                int128_t factor = 1;
+                for (int k = 0; k < scale; ++k) {
+                    factor *= 10;
+                }
+                for (size_t i = 0; i < n; ++i) {
+                    ASSERT_TRUE(result[i] == expect[i]) << "n=" << n << ", i=" << i << ", v=" << src[i];
+                    // the expression of misc_test.
+                    if (!is_null(nulls, i)) {
+                        ASSERT_TRUE(result[i] == static_cast<int128_t>(factor * static_cast<double>(src[i])));
+                    }
+                }
+            }
+        }
+    }
+}
+
+TEST_F(TestDecimal128Cast, CrossCheckScalar) {
+    std::mt19937_64 rng(48);
+    for (int round = 0; round < 10; ++round) {
+        cross_check_scalar<double>(rng);
+        cross_check_scalar<float>(rng);
+    }
+}
+} // namespace test
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
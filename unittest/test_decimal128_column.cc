@@ -0,0 +1,120 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/14.
+//
+
+#include <gtest/gtest.h>
+
+#include <decimal/decimal128_column.hh>
+#include <random>
+#include <vector>
+namespace test {
+class TestDecimal128Column : public testing::Test {
+public:
+    static constexpr int128_t MAX_INT128 = static_cast<int128_t>((static_cast<unsigned __int128>(1) << 127) - 1);
+    static constexpr int128_t MIN_INT128 = -MAX_INT128 - 1;
+
+    // values near the carry boundary of the low half and near the int128 range.
+    static std::vector<int128_t> gen_values(size_t n, int seed) {
+        std::mt19937_64 gen(seed);
+        std::vector<int128_t> special = {0,
+                                         1,
+                                         -1,
+                                         static_cast<int128_t>(UINT64_MAX),
+                                         -static_cast<int128_t>(UINT64_MAX),
+                                         static_cast<int128_t>(1) << 64,
+                                         MAX_INT128,
+                                         MIN_INT128,
+                                         MAX_INT128 - 1,
+                                         MIN_INT128 + 1};
+        std::vector<int128_t> values(n);
+        for (size_t i = 0; i < n; ++i) {
+            switch (gen() % 3) {
+            case 0:
+                values[i] = special[gen() % special.size()];
+                break;
+            case 1:
+                values[i] = static_cast<int64_t>(gen());
+                break;
+            default:
+                values[i] = static_cast<int128_t>(static_cast<unsigned __int128>(gen()) << 64 | gen());
+            }
+        }
+        return values;
+    }
+
+    template <bool is_sub>
+    static void check(size_t n, bool nullable) {
+        auto a = gen_values(n, n);
+        auto b = gen_values(n, n + 1);
+        std::vector<uint8_t> a_null(n), b_null(n), c_null(n);
+        std::mt19937 gen(n);
+        for (size_t i = 0; i < n; ++i) {
+            a_null[i] = gen() % 5 == 0;
+            b_null[i] = gen() % 5 == 0;
+        }
+        Decimal128Column ca(a.data(), n), cb(b.data(), n), cc;
+        std::vector<uint8_t> overflow(bitmap_size(n));
+        size_t overflow_nr;
+        if (nullable) {
+            overflow_nr = is_sub ? decimal128_sub_nullable(ca, a_null.data(), cb, b_null.data(), cc, c_null.data(),
+                                                           overflow.data())
+                                 : decimal128_add_nullable(ca, a_null.data(), cb, b_null.data(), cc, c_null.data(),
+                                                           overflow.data());
+        } else {
+            overflow_nr = is_sub ? decimal128_sub(ca, cb, cc, overflow.data())
+                                 : decimal128_add(ca, cb, cc, overflow.data());
+        }
+        size_t expect_overflow_nr = 0;
+        for (size_t i = 0; i < n; ++i) {
+            int128_t expect;
+            bool expect_overflow =
+                    is_sub ? __builtin_sub_overflow(a[i], b[i], &expect) : __builtin_add_overflow(a[i], b[i], &expect);
+            if (nullable) {
+                ASSERT_EQ(c_null[i], a_null[i] | b_null[i]);
+                expect_overflow &= c_null[i] == 0;
+            }
+            expect_overflow_nr += expect_overflow;
+            ASSERT_EQ(cc.get(i), expect);
+            ASSERT_EQ(bitmap_test(overflow.data(), i), expect_overflow) << "row=" << i;
+        }
+        ASSERT_EQ(overflow_nr, expect_overflow_nr);
+    }
+};
+
+TEST_F(TestDecimal128Column, testSplitLayout) {
+    auto values = gen_values(100, 0);
+    Decimal128Column column(values.data(), values.size());
+    std::vector<int128_t> merged(values.size());
+    column.to_int128(merged.data());
+    ASSERT_EQ(merged, values);
+}
+
+TEST_F(TestDecimal128Column, testAdd) {
+    for (auto n : {0, 1, 7, 8, 9, 31, 4096, 4099}) {
+        check<false>(n, false);
+    }
+}
+
+TEST_F(TestDecimal128Column, testSub) {
+    for (auto n : {0, 1, 7, 8, 9, 31, 4096, 4099}) {
+        check<true>(n, false);
+    }
+}
+
+TEST_F(TestDecimal128Column, testNullable) {
+    for (auto n : {0, 5, 8, 13, 4096, 4099}) {
+        check<false>(n, true);
+        check<true>(n, true);
+    }
+}
+} // namespace test
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
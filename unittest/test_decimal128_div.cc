@@ -0,0 +1,139 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/17.
+//
+
+#include <gtest/gtest.h>
+
+#include <decimal/decimal128_column.hh>
+#include <decimal/decimal128_div.hh>
+#include <random>
+#include <vector>
+namespace test {
+class TestDecimal128Div : public testing::Test {
+public:
+    static constexpr int128_t MAX_INT128 = static_cast<int128_t>((static_cast<uint128_t>(1) << 127) - 1);
+    static constexpr int128_t MIN_INT128 = -MAX_INT128 - 1;
+
+    // magnitudes of 1..127 bits, so every path is taken.
+    static int128_t gen_value(std::mt19937_64& gen) {
+        auto v = static_cast<int128_t>((static_cast<uint128_t>(gen()) << 64 | gen()) >> (1 + gen() % 127));
+        return (gen() & 1) ? -v : v;
+    }
+
+    static bool reference(int128_t a, int128_t b, int128_t scale, int128_t& r) {
+        if (b == 0 || __builtin_mul_overflow(a, scale, &a)) {
+            return false;
+        }
+        if (a == MIN_INT128 && b == -1) {
+            return false;
+        }
+        r = a / b;
+        int128_t rem = a % b;
+        uint128_t abs_rem = rem < 0 ? -static_cast<uint128_t>(rem) : rem;
+        uint128_t abs_b = b < 0 ? -static_cast<uint128_t>(b) : b;
+        if (abs_rem >= abs_b - abs_rem) {
+            // the rounded quotient of MIN_INT128 / -2 etc. may leave the range.
+            if (__builtin_add_overflow(r, ((a < 0) != (b < 0)) ? -1 : 1, &r)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static void check(std::vector<int128_t> const& lhs, std::vector<int128_t> const& rhs, int128_t scale) {
+        auto n = lhs.size();
+        std::vector<int128_t> result(n);
+        std::vector<uint8_t> overflow(bitmap_size(n));
+        auto overflow_nr = decimal128_div(lhs.data(), rhs.data(), result.data(), n, scale, overflow.data());
+        size_t expect_overflow_nr = 0;
+        for (size_t i = 0; i < n; ++i) {
+            int128_t expect = 0;
+            bool ok = reference(lhs[i], rhs[i], scale, expect);
+            ASSERT_EQ(!ok, bitmap_test(overflow.data(), i)) << "row " << i;
+            ASSERT_TRUE(result[i] == expect) << "row " << i;
+            expect_overflow_nr += !ok;
+        }
+        ASSERT_EQ(overflow_nr, expect_overflow_nr);
+    }
+};
+
+TEST_F(TestDecimal128Div, Random) {
+    std::mt19937_64 gen(17);
+    for (size_t n : {0, 1, 7, 8, 255, 256, 257, 1000, 4096}) {
+        std::vector<int128_t> lhs(n), rhs(n);
+        for (size_t i = 0; i < n; ++i) {
+            lhs[i] = gen_value(gen);
+            rhs[i] = gen_value(gen);
+        }
+        check(lhs, rhs, 1);
+        check(lhs, rhs, 100);
+    }
+}
+
+// blocks of 64-bit operands take the one-pass path, unless some lhs * scale
+// leaves int64.
+TEST_F(TestDecimal128Div, Narrow) {
+    std::mt19937_64 gen(43);
+    for (int bits : {16, 31, 32, 40, 63, 64}) {
+        std::vector<int128_t> lhs(1000), rhs(1000);
+        for (size_t i = 0; i < lhs.size(); ++i) {
+            lhs[i] = static_cast<int64_t>(gen() >> (64 - bits));
+            rhs[i] = static_cast<int64_t>(gen() >> (64 - bits));
+            if (i % 97 == 0) {
+                rhs[i] = 0;
+            }
+        }
+        lhs[1] = INT64_MIN;
+        rhs[2] = INT64_MIN;
+        check(lhs, rhs, 1);
+        check(lhs, rhs, 100);
+    }
+}
+
+TEST_F(TestDecimal128Div, Special) {
+    std::vector<int128_t> values{0,
+                                 1,
+                                 -1,
+                                 2,
+                                 -2,
+                                 3,
+                                 static_cast<int128_t>(UINT64_MAX),
+                                 -static_cast<int128_t>(UINT64_MAX),
+                                 static_cast<int128_t>(1) << 64,
+                                 (static_cast<int128_t>(1) << 64) + 1,
+                                 MAX_INT128,
+                                 MIN_INT128,
+                                 MIN_INT128 + 1};
+    std::vector<int128_t> lhs, rhs;
+    for (auto a : values) {
+        for (auto b : values) {
+            lhs.push_back(a);
+            rhs.push_back(b);
+        }
+    }
+    check(lhs, rhs, 1);
+    check(lhs, rhs, 10);
+}
+
+TEST_F(TestDecimal128Div, Rounding) {
+    // decimal(10, 2) / decimal(10, 2) -> decimal(18, 4), scale = 10^4
+    std::vector<int128_t> lhs{100, 200, -200, 100, 5, -5};
+    std::vector<int128_t> rhs{300, 300, 300, -700, 100000, 100000};
+    std::vector<int128_t> result(lhs.size());
+    uint8_t overflow[1];
+    ASSERT_EQ(decimal128_div(lhs.data(), rhs.data(), result.data(), lhs.size(), 10000, overflow), 0);
+    std::vector<int128_t> expect{3333, 6667, -6667, -1429, 1, -1};
+    ASSERT_TRUE(result == expect);
+}
+
+} // namespace test
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
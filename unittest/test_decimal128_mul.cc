@@ -0,0 +1,149 @@
+//
+// Created by grakra on 2020/12/20.
+//
+
+#include <gtest/gtest.h>
+
+#include <decimal/decimal128_mul.hh>
+#include <random>
+#include <vector>
+
+#include "decimal_test_util.hh"
+namespace test {
+class TestDecimal128Mul : public testing::Test {};
+
+// bignum reference: 32-bit limbs, the product divided by 10 k times.
+static bool mul_rescale_reference(int128_t x, int128_t y, int k, DecimalRoundingMode mode, int128_t& result) {
+    uint128_t ux = x < 0 ? -static_cast<uint128_t>(x) : x;
+    uint128_t uy = y < 0 ? -static_cast<uint128_t>(y) : y;
+    uint32_t a[4], b[4];
+    for (int i = 0; i < 4; ++i) {
+        a[i] = static_cast<uint32_t>(ux >> (32 * i));
+        b[i] = static_cast<uint32_t>(uy >> (32 * i));
+    }
+    uint64_t p[8] = {0};
+    for (int i = 0; i < 4; ++i) {
+        uint64_t carry = 0;
+        for (int j = 0; j < 4; ++j) {
+            uint64_t t = static_cast<uint64_t>(a[i]) * b[j] + p[i + j] + carry;
+            p[i + j] = t & 0xffffffffull;
+            carry = t >> 32;
+        }
+        p[i + 4] += carry;
+    }
+    int last_digit = 0;
+    bool sticky = false;
+    for (int d = 0; d < k; ++d) {
+        sticky |= last_digit != 0;
+        uint64_t r = 0;
+        for (int i = 7; i >= 0; --i) {
+            uint64_t t = (r << 32) | p[i];
+            p[i] = t / 10;
+            r = t % 10;
+        }
+        last_digit = r;
+    }
+    for (int i = 4; i < 8; ++i) {
+        if (p[i] != 0) {
+            return false;
+        }
+    }
+    uint128_t q = 0;
+    for (int i = 3; i >= 0; --i) {
+        q = q << 32 | p[i];
+    }
+    bool up = false;
+    if (mode == DecimalRoundingMode::HALF_UP) {
+        up = last_digit >= 5;
+    } else if (mode == DecimalRoundingMode::HALF_EVEN) {
+        up = last_digit > 5 || (last_digit == 5 && (sticky || (q & 1)));
+    }
+    if ((q >> 127) != 0) {
+        return false;
+    }
+    q += up;
+    if ((q >> 127) != 0) {
+        return false;
+    }
+    result = ((x < 0) != (y < 0)) ? -static_cast<int128_t>(q) : static_cast<int128_t>(q);
+    return true;
+}
+
+TEST_F(TestDecimal128Mul, RandomMatchesReference) {
+    std::mt19937_64 rng(20201220);
+    const size_t n = 101;
+    const DecimalRoundingMode modes[] = {DecimalRoundingMode::HALF_UP, DecimalRoundingMode::HALF_EVEN,
+                                         DecimalRoundingMode::TRUNCATE};
+    std::vector<int128_t> lhs(n), rhs(n), result(n);
+    std::vector<uint8_t> overflow(bitmap_size(n));
+    for (int round = 0; round < 3000; ++round) {
+        auto mode = modes[round % 3];
+        int k = rng() % 39;
+        int p1 = 1 + rng() % 38;
+        int p2 = 1 + rng() % 38;
+        for (size_t i = 0; i < n; ++i) {
+            lhs[i] = random_decimal(rng, p1);
+            rhs[i] = random_decimal(rng, p2);
+        }
+        auto overflow_nr = decimal128_mul_rescale(lhs.data(), rhs.data(), result.data(), n, k, mode,
+                                                  overflow.data());
+        size_t expect_overflow_nr = 0;
+        for (size_t i = 0; i < n; ++i) {
+            int128_t expect = 0;
+            bool ok = mul_rescale_reference(lhs[i], rhs[i], k, mode, expect);
+            ASSERT_EQ(!ok, bitmap_test(overflow.data(), i)) << "k=" << k << " mode=" << int(mode);
+            ASSERT_TRUE(result[i] == expect) << "k=" << k << " mode=" << int(mode);
+            expect_overflow_nr += !ok;
+        }
+        ASSERT_EQ(overflow_nr, expect_overflow_nr);
+    }
+}
+
+TEST_F(TestDecimal128Mul, RoundingModes) {
+    // 0.25 * 0.5 = 0.125, 0.35 * 0.5 = 0.175, 0.05 * 0.1 = 0.005 to 2 digits.
+    std::vector<int128_t> lhs{25, -25, 35, 5, 25};
+    std::vector<int128_t> rhs{5, 5, 5, 1, 4};
+    std::vector<int128_t> result(lhs.size());
+    uint8_t overflow[1];
+    decimal128_mul_rescale<DecimalRoundingMode::HALF_UP>(lhs.data(), rhs.data(), result.data(), lhs.size(), 1,
+                                                         overflow);
+    ASSERT_EQ(result, (std::vector<int128_t>{13, -13, 18, 1, 10}));
+    decimal128_mul_rescale<DecimalRoundingMode::HALF_EVEN>(lhs.data(), rhs.data(), result.data(), lhs.size(), 1,
+                                                           overflow);
+    ASSERT_EQ(result, (std::vector<int128_t>{12, -12, 18, 0, 10}));
+    decimal128_mul_rescale<DecimalRoundingMode::TRUNCATE>(lhs.data(), rhs.data(), result.data(), lhs.size(), 1,
+                                                          overflow);
+    ASSERT_EQ(result, (std::vector<int128_t>{12, -12, 17, 0, 10}));
+}
+
+TEST_F(TestDecimal128Mul, WideProduct) {
+    // (10^38 - 1)^2 / 10^38 = 10^38 - 2 + 10^-38, the product needs 253 bits;
+    // (10^38 - 1) * 10 / 10^38 rounds to 10.
+    int128_t max38 = 1;
+    for (int i = 0; i < 38; ++i) {
+        max38 *= 10;
+    }
+    max38 -= 1;
+    std::vector<int128_t> lhs{max38, -max38, max38, max38};
+    std::vector<int128_t> rhs{max38, max38, 10, max38};
+    std::vector<int128_t> result(lhs.size());
+    uint8_t overflow[1];
+    auto n = decimal128_mul_rescale<DecimalRoundingMode::HALF_UP>(lhs.data(), rhs.data(), result.data(), 3, 38,
+                                                                  overflow);
+    ASSERT_EQ(n, 0);
+    ASSERT_TRUE(result[0] == max38 - 1);
+    ASSERT_TRUE(result[1] == -(max38 - 1));
+    ASSERT_TRUE(result[2] == 10);
+    // the quotient by 10 does not fit int128.
+    n = decimal128_mul_rescale<DecimalRoundingMode::HALF_UP>(lhs.data(), rhs.data(), result.data(), 4, 1, overflow);
+    ASSERT_EQ(n, 3);
+    ASSERT_EQ(overflow[0], 0b1011);
+    ASSERT_TRUE(result[2] == max38);
+}
+
+} // namespace test
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
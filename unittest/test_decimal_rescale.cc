@@ -0,0 +1,153 @@
+//
+// Created by grakra on 2020/12/24.
+//
+
+#include <gtest/gtest.h>
+
+#include <decimal/decimal_rescale.hh>
+#include <random>
+#include <vector>
+namespace test {
+class TestDecimalRescale : public testing::Test {};
+
+static int128_t exp10(int k) {
+    int128_t v = 1;
+    for (int i = 0; i < k; ++i) {
+        v *= 10;
+    }
+    return v;
+}
+
+static int128_t scale_down_reference(int128_t v, int k, DecimalRoundingMode mode) {
+    int128_t factor = exp10(k);
+    int128_t u = v < 0 ? -v : v;
+    int128_t q = u / factor;
+    int128_t r = u % factor;
+    if (mode == DecimalRoundingMode::HALF_UP) {
+        q += r >= factor - r;
+    } else if (mode == DecimalRoundingMode::HALF_EVEN) {
+        q += r > factor - r || (r == factor - r && (q & 1));
+    }
+    return v < 0 ? -q : q;
+}
+
+// values of all digit numbers, ties and the largest ones of the type.
+template <typename T>
+static std::vector<T> test_values(std::mt19937_64& rng, size_t n) {
+    constexpr int max_digits = decimal_internal::rescale_traits<T>::MAX_SCALE;
+    std::vector<T> values(n);
+    for (auto& v : values) {
+        int digits = rng() % (max_digits + 1);
+        int128_t x = 0;
+        for (int i = 0; i < digits; ++i) {
+            x = x * 10 + rng() % 10;
+        }
+        if (rng() % 4 == 0 && digits > 1) {
+            // x...x50...0, a tie for some k.
+            x = x / exp10(digits / 2) * exp10(digits / 2) + 5 * exp10(digits / 2 - 1);
+        }
+        v = static_cast<T>((rng() & 1) ? -x : x);
+    }
+    if (n >= 2) {
+        values[0] = static_cast<T>(exp10(max_digits) - 1);
+        values[1] = -values[0];
+    }
+    return values;
+}
+
+template <typename T>
+static void check_scale_up(std::mt19937_64& rng) {
+    constexpr int max_scale = decimal_internal::rescale_traits<T>::MAX_SCALE;
+    for (size_t n : {0, 1, 7, 8, 9, 100, 1027}) {
+        auto src = test_values<T>(rng, n);
+        for (int k = 0; k <= max_scale; ++k) {
+            for (int precision : {1, max_scale / 2, max_scale}) {
+                std::vector<T> dst(n);
+                std::vector<uint8_t> overflow(bitmap_size(n));
+                auto overflow_nr = decimal_scale_up(src.data(), dst.data(), n, k, precision, overflow.data());
+                size_t expect_overflow_nr = 0;
+                for (size_t i = 0; i < n; ++i) {
+                    int128_t x = src[i];
+                    int128_t bound = precision > k ? exp10(precision - k) - 1 : 0;
+                    bool ov = x > bound || x < -bound;
+                    int128_t expect = ov ? 0 : x * exp10(k);
+                    expect_overflow_nr += ov;
+                    ASSERT_EQ(ov, (overflow[i >> 3] >> (i & 7)) & 1) << "k=" << k << ", i=" << i;
+                    ASSERT_TRUE(static_cast<int128_t>(dst[i]) == expect) << "k=" << k << ", i=" << i;
+                }
+                ASSERT_EQ(overflow_nr, expect_overflow_nr);
+            }
+        }
+    }
+}
+
+template <typename T>
+static void check_scale_down(std::mt19937_64& rng) {
+    constexpr int max_scale = decimal_internal::rescale_traits<T>::MAX_SCALE;
+    for (size_t n : {0, 1, 7, 8, 9, 100, 1027}) {
+        auto src = test_values<T>(rng, n);
+        for (int k = 0; k <= max_scale; ++k) {
+            for (auto mode :
+                 {DecimalRoundingMode::HALF_UP, DecimalRoundingMode::HALF_EVEN, DecimalRoundingMode::TRUNCATE}) {
+                std::vector<T> dst(n);
+                decimal_scale_down(src.data(), dst.data(), n, k, mode);
+                for (size_t i = 0; i < n; ++i) {
+                    ASSERT_TRUE(static_cast<int128_t>(dst[i]) == scale_down_reference(src[i], k, mode))
+                            << "k=" << k << ", i=" << i << ", mode=" << static_cast<int>(mode);
+                }
+            }
+        }
+    }
+}
+
+TEST_F(TestDecimalRescale, ScaleUp) {
+    std::mt19937_64 rng(50);
+    check_scale_up<int32_t>(rng);
+    check_scale_up<int64_t>(rng);
+    check_scale_up<int128_t>(rng);
+}
+
+TEST_F(TestDecimalRescale, ScaleDown) {
+    std::mt19937_64 rng(50);
+    check_scale_down<int32_t>(rng);
+    check_scale_down<int64_t>(rng);
+    check_scale_down<int128_t>(rng);
+}
+
+TEST_F(TestDecimalRescale, ScaleDownRounding) {
+    int32_t src[] = {15, 25, -15, -25, 14, -16, 5, -5, 0};
+    int32_t half_up[] = {2, 3, -2, -3, 1, -2, 1, -1, 0};
+    int32_t half_even[] = {2, 2, -2, -2, 1, -2, 0, 0, 0};
+    int32_t truncate[] = {1, 2, -1, -2, 1, -1, 0, 0, 0};
+    int32_t dst[9];
+    decimal_scale_down<int32_t, 1>(src, dst, 9);
+    ASSERT_EQ(std::vector<int32_t>(dst, dst + 9), std::vector<int32_t>(half_up, half_up + 9));
+    decimal_scale_down<int32_t, 1, DecimalRoundingMode::HALF_EVEN>(src, dst, 9);
+    ASSERT_EQ(std::vector<int32_t>(dst, dst + 9), std::vector<int32_t>(half_even, half_even + 9));
+    decimal_scale_down<int32_t, 1, DecimalRoundingMode::TRUNCATE>(src, dst, 9);
+    ASSERT_EQ(std::vector<int32_t>(dst, dst + 9), std::vector<int32_t>(truncate, truncate + 9));
+}
+
+// the 32-bit magic numbers hold for every dividend below 2^31.
+TEST_F(TestDecimalRescale, Decimal32DivMagic) {
+    std::mt19937_64 rng(32);
+    auto check = [](uint32_t u, uint64_t magic, int shift, uint32_t factor) {
+        ASSERT_EQ((u * magic) >> shift, u / factor);
+    };
+    using namespace decimal_internal;
+    for (int round = 0; round < 100000; ++round) {
+        uint32_t u = rng() & 0x7fffffff;
+        check(u, Decimal32DivMagic<1>::MAGIC, Decimal32DivMagic<1>::SHIFT, 10);
+        check(u, Decimal32DivMagic<3>::MAGIC, Decimal32DivMagic<3>::SHIFT, 1000);
+        check(u, Decimal32DivMagic<7>::MAGIC, Decimal32DivMagic<7>::SHIFT, 10000000);
+        check(u, Decimal32DivMagic<9>::MAGIC, Decimal32DivMagic<9>::SHIFT, 1000000000);
+    }
+    check(0x7fffffff, Decimal32DivMagic<9>::MAGIC, Decimal32DivMagic<9>::SHIFT, 1000000000);
+    check(999999999, Decimal32DivMagic<9>::MAGIC, Decimal32DivMagic<9>::SHIFT, 1000000000);
+}
+} // namespace test
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,179 @@
+//
+// Created by grakra on 2020/12/18.
+//
+
+#include <gtest/gtest.h>
+
+#include <decimal/decimal_string.hh>
+#include <random>
+#include <string>
+#include <vector>
+
+#include "decimal_test_util.hh"
+namespace test {
+class TestDecimalString : public testing::Test {};
+
+static std::string format_one(int128_t v, int scale) {
+    char buf[decimal_internal::DECIMAL_TEXT_MAX_FORMAT];
+    return std::string(buf, decimal_internal::format_decimal128(v, scale, buf));
+}
+
+// parse every text as decimal(precision, scale) and compare with the scalar
+// parser.
+static void check_parse(std::vector<std::string> const& texts, int precision, int scale) {
+    BinaryColumn column;
+    for (auto& s : texts) {
+        column.append(s);
+    }
+    std::vector<int128_t> values(texts.size());
+    std::vector<uint8_t> errors(texts.size());
+    auto error_nr = decimal128_parse_column(column, precision, scale, values.data(), errors.data());
+    size_t expect_error_nr = 0;
+    for (size_t i = 0; i < texts.size(); ++i) {
+        int128_t expect;
+        bool ok = decimal_internal::parse_decimal128_scalar(texts[i].data(), texts[i].size(), precision, scale,
+                                                            expect);
+        ASSERT_EQ(errors[i], !ok) << texts[i] << " p=" << precision << " s=" << scale;
+        ASSERT_TRUE(values[i] == expect) << texts[i] << " p=" << precision << " s=" << scale;
+        expect_error_nr += !ok;
+    }
+    ASSERT_EQ(error_nr, expect_error_nr);
+}
+
+TEST_F(TestDecimalString, Format) {
+    ASSERT_EQ(format_one(0, 0), "0");
+    ASSERT_EQ(format_one(0, 2), "0.00");
+    ASSERT_EQ(format_one(5, 3), "0.005");
+    ASSERT_EQ(format_one(-5, 3), "-0.005");
+    ASSERT_EQ(format_one(123456789, 4), "12345.6789");
+    ASSERT_EQ(format_one(1, 38), "0.00000000000000000000000000000000000001");
+    int128_t max38 = decimal_internal::max_decimal_of(38);
+    ASSERT_EQ(format_one(max38, 0), std::string(38, '9'));
+    ASSERT_EQ(format_one(-max38, 10), "-" + std::string(28, '9') + "." + std::string(10, '9'));
+    ASSERT_EQ(format_one(static_cast<int128_t>(1) << 64, 0), "18446744073709551616");
+}
+
+TEST_F(TestDecimalString, RoundTrip) {
+    std::mt19937_64 rng(20201218);
+    const size_t n = 101;
+    for (int round = 0; round < 500; ++round) {
+        int precision = 1 + rng() % 38;
+        int scale = rng() % (precision + 1);
+        std::vector<int128_t> values(n), parsed(n);
+        for (auto& v : values) {
+            v = random_decimal(rng, precision);
+        }
+        BinaryColumn column;
+        std::vector<uint8_t> errors(n);
+        ASSERT_EQ(decimal128_format_column(values.data(), n, precision, scale, column, errors.data()), 0);
+        ASSERT_EQ(column.size(), n);
+        for (size_t i = 0; i < n; ++i) {
+            auto s = column.get_slice(i);
+            ASSERT_EQ(s.to_string(), format_one(values[i], scale));
+        }
+        ASSERT_EQ(decimal128_parse_column(column, precision, scale, parsed.data(), errors.data()), 0);
+        for (size_t i = 0; i < n; ++i) {
+            ASSERT_TRUE(parsed[i] == values[i]) << "p=" << precision << " s=" << scale;
+        }
+    }
+}
+
+TEST_F(TestDecimalString, ParseMatchesScalar) {
+    std::mt19937_64 rng(20201219);
+    const char alphabet[] = "0123456789000..-+a";
+    for (int round = 0; round < 300; ++round) {
+        int precision = 1 + rng() % 38;
+        int scale = rng() % (precision + 1);
+        std::vector<std::string> texts;
+        for (int i = 0; i < 64; ++i) {
+            std::string s;
+            if (rng() % 4 == 0) {
+                // random bytes, mostly malformed.
+                int len = rng() % 50;
+                for (int k = 0; k < len; ++k) {
+                    s.push_back(alphabet[rng() % (sizeof(alphabet) - 1)]);
+                }
+            } else {
+                if (rng() & 1) {
+                    s.push_back("-+"[rng() & 1]);
+                }
+                int int_len = rng() % (precision - scale + 3);
+                int frac_len = rng() % (scale + 3);
+                for (int k = 0; k < int_len; ++k) {
+                    s.push_back('0' + rng() % 10);
+                }
+                if (frac_len > 0 || rng() % 2) {
+                    s.push_back('.');
+                }
+                for (int k = 0; k < frac_len; ++k) {
+                    s.push_back('0' + rng() % 10);
+                }
+            }
+            texts.push_back(s);
+        }
+        check_parse(texts, precision, scale);
+    }
+}
+
+TEST_F(TestDecimalString, ParseErrors) {
+    std::vector<std::string> texts{"", "-", "+", ".", "1.2.3", "12a", "--1", "1 ", "1000", "999.996", "-999.995"};
+    BinaryColumn column;
+    for (auto& s : texts) {
+        column.append(s);
+    }
+    std::vector<int128_t> values(texts.size());
+    std::vector<uint8_t> errors(texts.size());
+    ASSERT_EQ(decimal128_parse_column(column, 5, 2, values.data(), errors.data()), texts.size());
+    for (auto v : values) {
+        ASSERT_TRUE(v == 0);
+    }
+    check_parse(texts, 5, 2);
+}
+
+TEST_F(TestDecimalString, ParseRounding) {
+    std::vector<std::string> texts{"1.005", "-1.005", "1.0049999", "0.995", "-0.995", "0001.10", ".5", "7.",
+                                   "999.994"};
+    std::vector<int128_t> expect{101, -101, 100, 100, -100, 110, 50, 700, 99999};
+    BinaryColumn column;
+    for (auto& s : texts) {
+        column.append(s);
+    }
+    std::vector<int128_t> values(texts.size());
+    std::vector<uint8_t> errors(texts.size());
+    ASSERT_EQ(decimal128_parse_column(column, 5, 2, values.data(), errors.data()), 0);
+    for (size_t i = 0; i < texts.size(); ++i) {
+        ASSERT_TRUE(values[i] == expect[i]) << texts[i];
+    }
+}
+
+TEST_F(TestDecimalString, LongFraction) {
+    std::string long_fraction = "-12.3456" + std::string(60, '9');
+    std::vector<std::string> texts{long_fraction, "0." + std::string(100, '0') + "1", std::string(60, '0') + "42"};
+    check_parse(texts, 10, 4);
+    BinaryColumn column;
+    for (auto& s : texts) {
+        column.append(s);
+    }
+    std::vector<int128_t> values(texts.size());
+    std::vector<uint8_t> errors(texts.size());
+    ASSERT_EQ(decimal128_parse_column(column, 10, 4, values.data(), errors.data()), 0);
+    ASSERT_TRUE(values[0] == -123457);
+    ASSERT_TRUE(values[1] == 0);
+    ASSERT_TRUE(values[2] == 420000);
+}
+
+TEST_F(TestDecimalString, FormatOverflow) {
+    std::vector<int128_t> values{99999, 100000, -100000, -99999};
+    BinaryColumn column;
+    std::vector<uint8_t> errors(values.size());
+    ASSERT_EQ(decimal128_format_column(values.data(), values.size(), 5, 2, column, errors.data()), 2);
+    ASSERT_EQ(errors, (std::vector<uint8_t>{0, 1, 1, 0}));
+    ASSERT_EQ(column.get_slice(1).to_string(), "1000.00");
+}
+
+} // namespace test
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
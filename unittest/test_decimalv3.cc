@@ -5,8 +5,13 @@
 #include <gtest/gtest.h>
 
 #include <decimal/decimal.hh>
+#include <decimal/decimal128_column.hh>
 #include <decimalv3.hh>
 #include <iostream>
+#include <random>
+#include <vector>
+
+#include "decimal_test_util.hh"
 namespace test {
 class TestDecimalV3 : public testing::Test {};
 
@@ -42,6 +47,239 @@ TEST_F(TestDecimalV3, Int32MulFloat32) {
     std::cout << "uint128_t:" << is_integer<uint128_t> << std::endl;
 }
 
+static_assert(std::is_same_v<DecimalV3<DecimalV3Op::ADD, 7, 2, 7, 2, 9, 2>::InterType, int32_t>);
+static_assert(std::is_same_v<DecimalV3<DecimalV3Op::ADD, 9, 2, 9, 2, 10, 2>::InterType, int64_t>);
+static_assert(std::is_same_v<DecimalV3<DecimalV3Op::MUL, 9, 2, 9, 2, 18, 4>::InterType, int64_t>);
+static_assert(std::is_same_v<DecimalV3<DecimalV3Op::MUL, 18, 2, 9, 2, 27, 4>::InterType, int128_t>);
+static_assert(!DecimalV3<DecimalV3Op::MUL, 18, 2, 9, 2, 27, 4>::CHECKED);
+static_assert(DecimalV3<DecimalV3Op::MUL, 38, 2, 18, 2, 38, 4>::CHECKED);
+static_assert(std::is_same_v<DecimalV3<DecimalV3Op::DIV, 9, 2, 9, 2, 18, 4>::InterType, int64_t>);
+static_assert(std::is_same_v<DecimalV3Rescale<9, 2, 18, 10>::InterType, int64_t>);
+static_assert(std::is_same_v<DecimalV3Rescale<18, 12, 9, 2>::InterType, int64_t>);
+static_assert(std::is_same_v<DecimalV3Rescale<9, 2, 18, 12>::InterType, int128_t>);
+
+static void store_decimal(void* data, size_t i, int precision, int128_t v) {
+    if (precision <= DECIMAL32_MAX_PRECISION) {
+        static_cast<int32_t*>(data)[i] = v;
+    } else if (precision <= DECIMAL64_MAX_PRECISION) {
+        static_cast<int64_t*>(data)[i] = v;
+    } else {
+        static_cast<int128_t*>(data)[i] = v;
+    }
+}
+
+static int128_t load_decimal(void const* data, size_t i, int precision) {
+    if (precision <= DECIMAL32_MAX_PRECISION) {
+        return static_cast<int32_t const*>(data)[i];
+    } else if (precision <= DECIMAL64_MAX_PRECISION) {
+        return static_cast<int64_t const*>(data)[i];
+    } else {
+        return static_cast<int128_t const*>(data)[i];
+    }
+}
+
+static int128_t div_round_half_up(int128_t a, int128_t b) {
+    int128_t q = a / b;
+    int128_t r = a % b;
+    if (2 * (r < 0 ? -r : r) >= (b < 0 ? -b : b)) {
+        q += ((a < 0) != (b < 0)) ? -1 : 1;
+    }
+    return q;
+}
+
+// |a * b| / 10^d rounded half up, by long multiplication of decimal digits, so
+// the product may exceed int128. return false if the quotient does.
+static bool mul_scale_down_reference(int128_t a, int128_t b, int d, int128_t& r) {
+    auto digits = [](int128_t v) {
+        std::vector<int> ds;
+        for (uint128_t u = v < 0 ? -static_cast<uint128_t>(v) : v; u != 0; u /= 10) {
+            ds.push_back(u % 10);
+        }
+        return ds;
+    };
+    auto x = digits(a);
+    auto y = digits(b);
+    std::vector<int> product(x.size() + y.size() + 1, 0);
+    for (size_t i = 0; i < x.size(); ++i) {
+        for (size_t j = 0; j < y.size(); ++j) {
+            product[i + j] += x[i] * y[j];
+        }
+    }
+    for (size_t i = 0; i + 1 < product.size(); ++i) {
+        product[i + 1] += product[i] / 10;
+        product[i] %= 10;
+    }
+    uint128_t q = 0;
+    for (int i = static_cast<int>(product.size()) - 1; i >= d; --i) {
+        if (q > (static_cast<uint128_t>(1) << 127) / 10) {
+            return false;
+        }
+        q = q * 10 + product[i];
+    }
+    q += d > 0 && d <= static_cast<int>(product.size()) && product[d - 1] >= 5;
+    if (q >> 127) {
+        return false;
+    }
+    r = ((a < 0) != (b < 0)) ? -static_cast<int128_t>(q) : static_cast<int128_t>(q);
+    return true;
+}
+
+// int128 reference of row i, return false if the row overflows.
+static bool decimalv3_reference(DecimalV3Op op, int s1, int s2, int rp, int rs, int128_t a, int128_t b,
+                                int128_t& r) {
+    bool ov = false;
+    int128_t x, y;
+    switch (op) {
+    case DecimalV3Op::ADD:
+        ov |= __builtin_mul_overflow(a, decimal_internal::exp10_of(rs - s1), &x);
+        ov |= __builtin_mul_overflow(b, decimal_internal::exp10_of(rs - s2), &y);
+        ov |= __builtin_add_overflow(x, y, &r);
+        break;
+    case DecimalV3Op::SUB:
+        ov |= __builtin_mul_overflow(a, decimal_internal::exp10_of(rs - s1), &x);
+        ov |= __builtin_mul_overflow(b, decimal_internal::exp10_of(rs - s2), &y);
+        ov |= __builtin_sub_overflow(x, y, &r);
+        break;
+    case DecimalV3Op::MUL:
+        if (rs >= s1 + s2) {
+            ov |= __builtin_mul_overflow(a, b, &r);
+            ov |= __builtin_mul_overflow(r, decimal_internal::exp10_of(rs - s1 - s2), &r);
+        } else {
+            ov |= !mul_scale_down_reference(a, b, s1 + s2 - rs, r);
+        }
+        break;
+    case DecimalV3Op::DIV:
+        if (b == 0) {
+            r = 0;
+            return false;
+        }
+        ov |= __builtin_mul_overflow(a, decimal_internal::exp10_of(rs + s2 - s1), &x);
+        if (!ov) {
+            r = div_round_half_up(x, b);
+        }
+        break;
+    case DecimalV3Op::RESCALE:
+        if (rs >= s1) {
+            ov |= __builtin_mul_overflow(a, decimal_internal::exp10_of(rs - s1), &r);
+        } else {
+            r = div_round_half_up(a, decimal_internal::exp10_of(s1 - rs));
+        }
+        break;
+    }
+    auto max_result = decimal_internal::max_decimal_of(rp);
+    return !ov && -max_result <= r && r <= max_result;
+}
+
+TEST_F(TestDecimalV3, RandomPrecisionAndScale) {
+    std::mt19937_64 rng(20201207);
+    const size_t n = 77;
+    std::vector<int128_t> lhs(n), rhs(n), result(n);
+    std::vector<uint8_t> overflow(bitmap_size(n));
+    const DecimalV3Op ops[] = {DecimalV3Op::ADD, DecimalV3Op::SUB, DecimalV3Op::MUL, DecimalV3Op::DIV,
+                               DecimalV3Op::RESCALE};
+    for (int round = 0; round < 2000; ++round) {
+        auto op = ops[round % DECIMALV3_OP_NR];
+        int p1 = 1 + rng() % DECIMAL128_MAX_PRECISION;
+        int s1 = rng() % (p1 + 1);
+        int p2 = 1 + rng() % DECIMAL128_MAX_PRECISION;
+        int s2 = rng() % (p2 + 1);
+        int rp = 1 + rng() % DECIMAL128_MAX_PRECISION;
+        int rs = rng() % (rp + 1);
+        auto call = decimalv3_resolve(op, p1, s1, p2, s2, rp, rs);
+        if (!decimalv3_is_legal(op, p1, s1, op == DecimalV3Op::RESCALE ? 1 : p2,
+                                op == DecimalV3Op::RESCALE ? 0 : s2, rp, rs)) {
+            ASSERT_FALSE(call.valid());
+            continue;
+        }
+        ASSERT_TRUE(call.valid());
+        if (op == DecimalV3Op::RESCALE) {
+            p2 = 1;
+            s2 = 0;
+        }
+        for (size_t i = 0; i < n; ++i) {
+            store_decimal(lhs.data(), i, p1, random_decimal(rng, p1));
+            store_decimal(rhs.data(), i, p2, random_decimal(rng, p2));
+        }
+        auto overflow_nr = call(lhs.data(), rhs.data(), result.data(), n, overflow.data());
+        size_t expect_overflow_nr = 0;
+        for (size_t i = 0; i < n; ++i) {
+            int128_t expect = 0;
+            auto a = load_decimal(lhs.data(), i, p1);
+            auto b = load_decimal(rhs.data(), i, p2);
+            bool ok = decimalv3_reference(op, s1, s2, rp, rs, a, b, expect);
+            ASSERT_EQ(!ok, bitmap_test(overflow.data(), i))
+                    << "op=" << int(op) << " p1=" << p1 << " s1=" << s1 << " p2=" << p2 << " s2=" << s2
+                    << " rp=" << rp << " rs=" << rs;
+            if (ok) {
+                ASSERT_TRUE(load_decimal(result.data(), i, rp) == expect)
+                        << "op=" << int(op) << " p1=" << p1 << " s1=" << s1 << " p2=" << p2 << " s2=" << s2
+                        << " rp=" << rp << " rs=" << rs;
+            } else {
+                ++expect_overflow_nr;
+            }
+        }
+        ASSERT_EQ(overflow_nr, expect_overflow_nr);
+    }
+}
+
+TEST_F(TestDecimalV3, CompileTimeMatchesRuntime) {
+    using Mul = DecimalV3<DecimalV3Op::MUL, 9, 4, 9, 4, 9, 2>;
+    std::vector<int32_t> lhs{123456789, -5000, 99999, 0, 15000, -15000, 999999999, 1};
+    std::vector<int32_t> rhs{1, 5000, -99999, 77, 50, 50, 999999999, -1};
+    std::vector<int32_t> result0(lhs.size()), result1(lhs.size());
+    uint8_t overflow0[1], overflow1[1];
+    auto n0 = Mul::compute(lhs.data(), rhs.data(), result0.data(), lhs.size(), overflow0);
+    auto n1 = decimalv3_resolve(DecimalV3Op::MUL, 9, 4, 9, 4, 9, 2)(lhs.data(), rhs.data(), result1.data(),
+                                                                     lhs.size(), overflow1);
+    ASSERT_EQ(n0, n1);
+    ASSERT_EQ(overflow0[0], overflow1[0]);
+    for (size_t i = 0; i < lhs.size(); ++i) {
+        if (!bitmap_test(overflow0, i)) {
+            ASSERT_EQ(result0[i], result1[i]);
+        }
+    }
+    // 1.5000 * 0.0050 = 0.0075 -> 0.01, -1.5000 * 0.0050 -> -0.01
+    ASSERT_EQ(result0[4], 1);
+    ASSERT_EQ(result0[5], -1);
+    // 99999.9999 * 99999.9999 overflows decimal(9, 2)
+    ASSERT_TRUE(bitmap_test(overflow0, 6));
+}
+
+// the int128 product overflows, but the scaled result fits.
+TEST_F(TestDecimalV3, WideProductScaledDown) {
+    using Mul = DecimalV3<DecimalV3Op::MUL, 38, 10, 38, 10, 38, 10>;
+    static_assert(Mul::CHECKED);
+    const int128_t e20 = decimal_internal::exp10_of(20);
+    std::vector<int128_t> lhs{e20, -e20, e20 + 5, decimal_internal::exp10_of(37), 15};
+    std::vector<int128_t> rhs{e20, e20, e20, decimal_internal::exp10_of(37), 1};
+    std::vector<int128_t> result(lhs.size());
+    uint8_t overflow[1];
+    auto n = Mul::compute(lhs.data(), rhs.data(), result.data(), lhs.size(), overflow);
+    ASSERT_EQ(n, 1);
+    ASSERT_EQ(overflow[0], 0b01000);
+    // 10000000000.0000000000 * 10000000000.0000000000 = 10^20
+    ASSERT_TRUE(result[0] == decimal_internal::exp10_of(30));
+    ASSERT_TRUE(result[1] == -decimal_internal::exp10_of(30));
+    // (10^20 + 5) * 10^20 / 10^10 = 10^30 + 5 * 10^10
+    ASSERT_TRUE(result[2] == decimal_internal::exp10_of(30) + 5 * decimal_internal::exp10_of(10));
+    // 1.5 * 10^-9 * 10^-10 rounds to 0.0000000000
+    ASSERT_TRUE(result[4] == 0);
+}
+
+TEST_F(TestDecimalV3, DivideByZero) {
+    std::vector<int64_t> lhs{100, 200, 300};
+    std::vector<int64_t> rhs{3, 0, -7};
+    std::vector<int64_t> result(lhs.size());
+    uint8_t overflow[1];
+    auto n = DecimalV3<DecimalV3Op::DIV, 10, 2, 10, 0, 18, 4>::compute(lhs.data(), rhs.data(), result.data(),
+                                                                     lhs.size(), overflow);
+    ASSERT_EQ(n, 1);
+    ASSERT_EQ(overflow[0], 0b010);
+    ASSERT_EQ(result[0], 3333);
+    ASSERT_EQ(result[1], 0);
+    ASSERT_EQ(result[2], -4286);
+}
+
 } // namespace test
 
 int main(int argc, char** argv) {
@@ -0,0 +1,160 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/12/16.
+//
+
+#include <gtest/gtest.h>
+
+#include <decimal/divider.hh>
+#include <limits>
+#include <random>
+#include <vector>
+namespace test {
+class TestDivider : public testing::Test {
+public:
+    template <typename T>
+    static T random_value(std::mt19937_64& gen) {
+        // mix small values with full-width ones, and random bit lengths.
+        auto v = static_cast<T>((static_cast<uint128_t>(gen()) << 64) | gen());
+        switch (gen() % 4) {
+        case 0:
+            return static_cast<T>(gen() % 1000);
+        case 1:
+            return static_cast<T>(v >> (gen() % (sizeof(T) * 8)));
+        default:
+            return v;
+        }
+    }
+
+    template <typename T>
+    static constexpr T max_value() {
+        using U = typename divider_traits<T>::unsigned_type;
+        return divider_traits<T>::is_signed ? static_cast<T>(static_cast<U>(~U(0)) >> 1) : static_cast<T>(~U(0));
+    }
+
+    template <typename T>
+    static constexpr T min_value() {
+        return divider_traits<T>::is_signed ? static_cast<T>(-max_value<T>() - 1) : T(0);
+    }
+
+    template <typename T>
+    static std::vector<T> special_values() {
+        constexpr T MAX = max_value<T>();
+        constexpr T MIN = min_value<T>();
+        std::vector<T> values{T(0), T(1), T(2), T(3), T(7), T(10), T(100), MAX, T(MAX - 1), MIN, T(MIN + 1)};
+        if (divider_traits<T>::is_signed) {
+            values.push_back(T(-1));
+            values.push_back(T(-10));
+        }
+        for (int i = 1; i < int(sizeof(T) * 8) - 1; ++i) {
+            values.push_back(T(1) << i);
+            values.push_back(T((T(1) << i) - 1));
+        }
+        return values;
+    }
+
+    template <typename T>
+    static void check_divisor(T d, std::vector<T> const& dividends) {
+        if (d == 0) {
+            return;
+        }
+        Divider<T> divider(d);
+        for (auto n : dividends) {
+            // MIN / -1 overflows.
+            if (divider_traits<T>::is_signed && d == T(-1) && n == min_value<T>()) {
+                continue;
+            }
+            ASSERT_TRUE(divider.divide(n) == n / d) << int64_t(n) << "/" << int64_t(d);
+        }
+    }
+
+    template <typename T>
+    static void check_type(int seed) {
+        std::mt19937_64 gen(seed);
+        auto dividends = special_values<T>();
+        for (int i = 0; i < 200; ++i) {
+            dividends.push_back(random_value<T>(gen));
+        }
+        for (auto d : special_values<T>()) {
+            check_divisor(d, dividends);
+        }
+        for (int i = 0; i < 500; ++i) {
+            check_divisor(random_value<T>(gen), dividends);
+        }
+    }
+};
+
+TEST_F(TestDivider, Int32) {
+    check_type<int32_t>(1);
+    check_type<uint32_t>(2);
+}
+
+TEST_F(TestDivider, Int64) {
+    check_type<int64_t>(3);
+    check_type<uint64_t>(4);
+}
+
+TEST_F(TestDivider, Int128) {
+    check_type<int128_t>(5);
+    check_type<uint128_t>(6);
+}
+
+TEST_F(TestDivider, PowersOfTen) {
+    std::mt19937_64 gen(7);
+    int128_t d = 1;
+    for (int k = 0; k <= 38; ++k) {
+        d = k == 0 ? 1 : d * 10;
+        Divider<int128_t> divider(d);
+        ASSERT_EQ(divider.get_algo() == DividerAlgo::SHIFT, k == 0);
+        for (int i = 0; i < 1000; ++i) {
+            auto n = random_value<int128_t>(gen);
+            ASSERT_TRUE(divider.divide(n) == n / d);
+        }
+    }
+}
+
+TEST_F(TestDivider, DivideRound) {
+    std::vector<int64_t> src{0, 4, 5, 6, -4, -5, -6, 15, -15, 149, 150, -149, -150};
+    std::vector<int64_t> dst(src.size());
+    divide_round_column(src.data(), dst.data(), 5, int64_t(10));
+    divide_round_column(src.data() + 5, dst.data() + 5, src.size() - 5, int64_t(10));
+    std::vector<int64_t> expect{0, 0, 1, 1, 0, -1, -1, 2, -2, 15, 15, -15, -15};
+    ASSERT_EQ(dst, expect);
+    divide_round_column(src.data(), dst.data(), src.size(), int64_t(-10));
+    for (size_t i = 0; i < src.size(); ++i) {
+        ASSERT_EQ(dst[i], -expect[i]);
+    }
+    divide_column(src.data(), dst.data(), src.size(), int64_t(10));
+    for (size_t i = 0; i < src.size(); ++i) {
+        ASSERT_EQ(dst[i], src[i] / 10);
+    }
+}
+
+TEST_F(TestDivider, ConstantColumn) {
+    std::mt19937_64 gen(8);
+    std::vector<int128_t> src(1000), dst(1000);
+    for (auto& v : src) {
+        v = random_value<int128_t>(gen);
+    }
+    for (int i = 0; i < 100; ++i) {
+        auto d = random_value<int128_t>(gen);
+        if (d == 0 || d == -1) {
+            continue;
+        }
+        divide_column(src.data(), dst.data(), src.size(), d);
+        for (size_t k = 0; k < src.size(); ++k) {
+            ASSERT_TRUE(dst[k] == src[k] / d);
+        }
+    }
+}
+
+} // namespace test
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
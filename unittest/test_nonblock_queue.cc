@@ -0,0 +1,166 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2021/08/13.
+//
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <memory>
+#include <thread>
+#include <vector>
+
+#include "concurrent/event_count.hh"
+#include "nonblock_queue.hh"
+namespace test {
+class TestNonblockQueue : public ::testing::Test {};
+
+TEST_F(TestNonblockQueue, testSingleThread) {
+    nonblock::Queue<int> q(5);
+    ASSERT_EQ(q.capacity(), 8);
+    int v;
+    ASSERT_FALSE(q.try_dequeue(v));
+    for (int lap = 0; lap < 3; ++lap) {
+        for (int i = 0; i < 8; ++i) {
+            ASSERT_TRUE(q.try_enqueue(i));
+        }
+        ASSERT_FALSE(q.try_enqueue(8));
+        ASSERT_EQ(q.size_approx(), 8);
+        for (int i = 0; i < 8; ++i) {
+            ASSERT_TRUE(q.try_dequeue(v));
+            ASSERT_EQ(v, i);
+        }
+        ASSERT_FALSE(q.try_dequeue(v));
+    }
+}
+
+TEST_F(TestNonblockQueue, testTinyCapacity) {
+    for (size_t capacity : {0, 1, 2}) {
+        nonblock::Queue<std::unique_ptr<int>> q(capacity);
+        ASSERT_EQ(q.capacity(), 2);
+        std::unique_ptr<int> v;
+        for (int lap = 0; lap < 3; ++lap) {
+            ASSERT_TRUE(q.try_enqueue(std::make_unique<int>(lap)));
+            ASSERT_TRUE(q.try_enqueue(std::make_unique<int>(lap + 1)));
+            ASSERT_FALSE(q.try_enqueue(std::make_unique<int>(lap + 2)));
+            ASSERT_TRUE(q.try_dequeue(v));
+            ASSERT_EQ(*v, lap);
+            ASSERT_TRUE(q.try_dequeue(v));
+            ASSERT_EQ(*v, lap + 1);
+            ASSERT_FALSE(q.try_dequeue(v));
+        }
+    }
+}
+
+TEST_F(TestNonblockQueue, testMoveOnly) {
+    nonblock::Queue<std::unique_ptr<int>> q(4);
+    ASSERT_TRUE(q.try_emplace(new int(1)));
+    ASSERT_TRUE(q.try_enqueue(std::make_unique<int>(2)));
+    // the remaining item is destructed along with the queue.
+    ASSERT_TRUE(q.try_enqueue(std::make_unique<int>(3)));
+    std::unique_ptr<int> v;
+    ASSERT_TRUE(q.try_dequeue(v));
+    ASSERT_EQ(*v, 1);
+    q.dequeue(v);
+    ASSERT_EQ(*v, 2);
+}
+
+TEST_F(TestNonblockQueue, testBulk) {
+    nonblock::Queue<int> q(8);
+    std::vector<int> in{0, 1, 2, 3, 4, 5, 6, 7, 8, 9};
+    ASSERT_EQ(q.try_enqueue_bulk(in.begin(), in.size()), 8);
+    ASSERT_EQ(q.try_enqueue_bulk(in.begin(), in.size()), 0);
+    std::vector<int> out(10, -1);
+    ASSERT_EQ(q.try_dequeue_bulk(out.begin(), 3), 3);
+    ASSERT_EQ(q.try_enqueue_bulk(in.begin() + 8, 2), 2);
+    ASSERT_EQ(q.try_dequeue_bulk(out.begin() + 3, 10), 7);
+    ASSERT_EQ(out, in);
+    ASSERT_EQ(q.try_dequeue_bulk(out.begin(), 10), 0);
+}
+
+template <typename Waiters>
+static void test_multi_producer_multi_consumer() {
+    nonblock::Queue<int64_t, Waiters> q(64);
+    const int producer_nr = 4;
+    const int consumer_nr = 4;
+    const int64_t item_nr = 200000;
+    std::atomic<int64_t> sum(0);
+    std::atomic<int64_t> count(0);
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producer_nr; ++p) {
+        threads.emplace_back([&q, p]() {
+            std::vector<int64_t> batch;
+            for (int64_t i = p + 1; i <= item_nr; i += producer_nr) {
+                // mix single and bulk operations
+                if (i % 3 == 0) {
+                    batch.push_back(i);
+                    if (batch.size() == 16) {
+                        q.enqueue_bulk(batch.begin(), batch.size());
+                        batch.clear();
+                    }
+                } else {
+                    q.enqueue(i);
+                }
+            }
+            q.enqueue_bulk(batch.begin(), batch.size());
+        });
+    }
+    for (int c = 0; c < consumer_nr; ++c) {
+        threads.emplace_back([&q, &sum, &count, c]() {
+            int64_t out[16];
+            int64_t stop_nr = 0;
+            while (stop_nr == 0) {
+                int64_t n = 1;
+                if (c % 2 == 0) {
+                    q.dequeue(out[0]);
+                } else {
+                    n = q.dequeue_bulk(out, 16);
+                }
+                for (int i = 0; i < n; ++i) {
+                    if (out[i] < 0) {
+                        ++stop_nr;
+                    } else {
+                        sum += out[i];
+                        ++count;
+                    }
+                }
+            }
+            // a bulk may take the stop items of the other consumers.
+            for (int i = 1; i < stop_nr; ++i) {
+                q.enqueue(-1);
+            }
+        });
+    }
+    for (int p = 0; p < producer_nr; ++p) {
+        threads[p].join();
+    }
+    while (count.load() < item_nr) {
+        std::this_thread::yield();
+    }
+    for (int c = 0; c < consumer_nr; ++c) {
+        q.enqueue(-1);
+    }
+    for (int c = 0; c < consumer_nr; ++c) {
+        threads[producer_nr + c].join();
+    }
+    ASSERT_EQ(count.load(), item_nr);
+    ASSERT_EQ(sum.load(), item_nr * (item_nr + 1) / 2);
+}
+
+TEST_F(TestNonblockQueue, testMultiProducerMultiConsumer) {
+    test_multi_producer_multi_consumer<nonblock::FutexWaiters>();
+}
+
+TEST_F(TestNonblockQueue, testMultiProducerMultiConsumerWithEventCount) {
+    test_multi_producer_multi_consumer<com::grakra::concurrent::EventCount>();
+}
+} // namespace test
+
+int main(int argc, char** argv) {
+    ::testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -0,0 +1,161 @@
+//
+// Created by grakra on 2020/12/21.
+//
+
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <cmath>
+#include <decimal/sort_key.hh>
+#include <limits>
+#include <random>
+#include <vector>
+namespace test {
+class TestSortKey : public testing::Test {};
+
+static int128_t random_int128(std::mt19937_64& rng) {
+    int digits = rng() % 39;
+    int128_t v = 0;
+    for (int i = 0; i < digits; ++i) {
+        v = v * 10 + rng() % 10;
+    }
+    return (rng() & 1) ? -v : v;
+}
+
+template <typename T>
+static void check_order(std::vector<T> const& values) {
+    const size_t row_size = sizeof(T);
+    std::vector<uint8_t> asc(values.size() * row_size), desc(values.size() * row_size);
+    encode_sort_key(values.data(), values.size(), asc.data(), row_size, 0);
+    encode_sort_key(values.data(), values.size(), desc.data(), row_size, 0, true);
+    for (size_t i = 0; i < values.size(); ++i) {
+        for (size_t j = 0; j < values.size(); ++j) {
+            auto a = values[i], b = values[j];
+            int expect = a < b ? -1 : (b < a ? 1 : 0);
+            int c = memcmp(asc.data() + i * row_size, asc.data() + j * row_size, row_size);
+            int d = memcmp(desc.data() + i * row_size, desc.data() + j * row_size, row_size);
+            ASSERT_EQ((c > 0) - (c < 0), expect) << i << " " << j;
+            ASSERT_EQ((d > 0) - (d < 0), -expect) << i << " " << j;
+        }
+    }
+}
+
+TEST_F(TestSortKey, Order) {
+    std::mt19937_64 rng(20201221);
+    std::vector<int32_t> v32{0, 1, -1, INT32_MAX, INT32_MIN, 256, -256, 65535};
+    std::vector<int64_t> v64{0, 1, -1, INT64_MAX, INT64_MIN, 1ll << 40, -(1ll << 40)};
+    std::vector<int128_t> v128{0, 1, -1, static_cast<int128_t>(1) << 64, -(static_cast<int128_t>(1) << 64)};
+    std::vector<double> vd{0.0, -1.5, 1.5, 1e300, -1e300, std::numeric_limits<double>::infinity(),
+                           -std::numeric_limits<double>::infinity(), 1e-300, -1e-300};
+    std::vector<float> vf{0.0f, -1.5f, 1.5f, 3e38f, -3e38f, 1e-40f, -1e-40f};
+    for (int i = 0; i < 64; ++i) {
+        v32.push_back(static_cast<int32_t>(rng()));
+        v64.push_back(static_cast<int64_t>(rng()));
+        v128.push_back(random_int128(rng));
+        vd.push_back((static_cast<double>(rng()) - 9.2e18) / (1 + rng() % 1000));
+        vf.push_back(static_cast<float>((static_cast<double>(rng()) - 9.2e18) / (1 + rng() % 1000)));
+    }
+    check_order(v32);
+    check_order(v64);
+    check_order(v128);
+    check_order(vd);
+    check_order(vf);
+}
+
+TEST_F(TestSortKey, FloatSpecials) {
+    std::vector<double> values{-0.0, 0.0, std::nan(""), -std::nan(""), std::numeric_limits<double>::infinity()};
+    std::vector<uint8_t> keys(values.size() * 8);
+    encode_sort_key(values.data(), values.size(), keys.data(), 8, 0);
+    // -0.0 ties 0.0, the NaNs tie and sort after +inf.
+    ASSERT_EQ(memcmp(keys.data(), keys.data() + 8, 8), 0);
+    ASSERT_EQ(memcmp(keys.data() + 16, keys.data() + 24, 8), 0);
+    ASSERT_GT(memcmp(keys.data() + 16, keys.data() + 32, 8), 0);
+}
+
+TEST_F(TestSortKey, RadixSortInt128) {
+    std::mt19937_64 rng(20201222);
+    for (size_t n : {0, 1, 2, 23, 24, 25, 100, 1000, 30000}) {
+        std::vector<int128_t> values(n);
+        for (auto& v : values) {
+            // many duplicates and long runs of equal leading bytes.
+            v = rng() % 4 == 0 ? static_cast<int128_t>(rng() % 7) : random_int128(rng);
+        }
+        const size_t key_size = sort_key_size<int128_t>();
+        const size_t row_size = key_size + sizeof(uint32_t);
+        for (bool lsd : {true, false}) {
+            std::vector<uint8_t> rows(n * row_size);
+            encode_sort_key(values.data(), n, rows.data(), row_size, 0);
+            encode_row_id(n, rows.data(), row_size, key_size);
+            if (lsd) {
+                radix_sort_lsd(rows.data(), n, row_size, key_size);
+            } else {
+                radix_sort_msd(rows.data(), n, row_size, key_size);
+            }
+            std::vector<uint32_t> expect(n);
+            for (size_t i = 0; i < n; ++i) {
+                expect[i] = i;
+            }
+            std::stable_sort(expect.begin(), expect.end(),
+                             [&](uint32_t a, uint32_t b) { return values[a] < values[b]; });
+            for (size_t i = 0; i < n; ++i) {
+                // both are stable, so even the ties agree.
+                ASSERT_EQ(decode_row_id(rows.data(), i, row_size, key_size), expect[i]) << "lsd=" << lsd;
+            }
+        }
+    }
+}
+
+TEST_F(TestSortKey, MultiColumnOrderBy) {
+    // ORDER BY a ASC, b DESC, c ASC NULLS LAST
+    std::mt19937_64 rng(20201223);
+    const size_t n = 5000;
+    std::vector<int128_t> a(n);
+    std::vector<double> b(n);
+    std::vector<int32_t> c(n);
+    std::vector<uint8_t> c_null(n);
+    for (size_t i = 0; i < n; ++i) {
+        a[i] = static_cast<int128_t>(rng() % 5) * 1000000000000000000ll * 100 - 200;
+        b[i] = static_cast<double>(rng() % 9) / 4 - 1;
+        c[i] = static_cast<int32_t>(rng() % 11) - 5;
+        c_null[i] = rng() % 6 == 0;
+    }
+    const size_t a_offset = 0;
+    const size_t b_offset = a_offset + sort_key_size<int128_t>();
+    const size_t c_offset = b_offset + sort_key_size<double>();
+    const size_t key_size = c_offset + sort_key_size<int32_t>(true);
+    const size_t row_size = key_size + sizeof(uint32_t);
+    std::vector<uint8_t> rows(n * row_size);
+    encode_sort_key(a.data(), n, rows.data(), row_size, a_offset);
+    encode_sort_key(b.data(), n, rows.data(), row_size, b_offset, true);
+    encode_sort_key_nullable(c.data(), c_null.data(), n, rows.data(), row_size, c_offset, false, false);
+    encode_row_id(n, rows.data(), row_size, key_size);
+    radix_sort_msd(rows.data(), n, row_size, key_size);
+
+    auto less = [&](uint32_t x, uint32_t y) {
+        if (a[x] != a[y]) {
+            return a[x] < a[y];
+        }
+        if (b[x] != b[y]) {
+            return b[x] > b[y];
+        }
+        if (c_null[x] != c_null[y]) {
+            return c_null[y] != 0;
+        }
+        return c_null[x] == 0 && c[x] < c[y];
+    };
+    std::vector<uint32_t> expect(n);
+    for (size_t i = 0; i < n; ++i) {
+        expect[i] = i;
+    }
+    std::stable_sort(expect.begin(), expect.end(), less);
+    for (size_t i = 0; i < n; ++i) {
+        ASSERT_EQ(decode_row_id(rows.data(), i, row_size, key_size), expect[i]);
+    }
+}
+
+} // namespace test
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}
@@ -38,6 +38,17 @@ TEST_F(TestUtil, testReverseBits) {
         ASSERT_EQ(n, reverse_bits(reverse_bits(n)));
     }
 }
+TEST_F(TestUtil, testReverseBits64) {
+    ASSERT_EQ(reverse_bits64(0x1ull), 0x8000000000000000ull);
+    ASSERT_EQ(reverse_bits64(0xf0ull), 0x0f00000000000000ull);
+    std::random_device rd;
+    std::mt19937_64 gen(rd());
+    for (auto i = 0; i < 10000; ++i) {
+        uint64_t n = gen();
+        ASSERT_EQ(reverse_bits64(n) >> 32, reverse_bits(static_cast<uint32_t>(n)));
+        ASSERT_EQ(n, reverse_bits64(reverse_bits64(n)));
+    }
+}
 typedef int32_t JulianDate;
 JulianDate from_date(int year, int month, int day) {
     JulianDate century;
@@ -0,0 +1,158 @@
+// Copyright (c) 2020 Ran Panfeng.  All rights reserved.
+// Author: satanson
+// Email: ranpanf@gmail.com
+// Github repository: https://github.com/satanson/cpp_etudes.git
+
+//
+// Created by grakra on 2020/7/22.
+//
+
+#include <gtest/gtest.h>
+
+#include <atomic>
+#include <concurrent/chase_lev_deque.hh>
+#include <concurrent/morsel.hh>
+#include <concurrent/work_stealing_pool.hh>
+#include <numeric>
+#include <random>
+#include <string_functions.hh>
+#include <thread>
+#include <vector>
+
+namespace com {
+namespace grakra {
+namespace concurrent {
+class TestWorkStealingPool : public testing::Test {};
+
+TEST_F(TestWorkStealingPool, testChaseLevDeque) {
+    static constexpr int64_t ITEM_NR = 100000;
+    static constexpr int THIEF_NR = 3;
+    ChaseLevDeque<int64_t> deque(4);
+    std::atomic<bool> done(false);
+    std::vector<int64_t> taken;
+    std::vector<std::vector<int64_t>> stolen(THIEF_NR);
+    std::vector<std::thread> thieves;
+    for (int i = 0; i < THIEF_NR; ++i) {
+        thieves.emplace_back([&, i]() {
+            while (!done.load() || !deque.Empty()) {
+                if (auto x = deque.Steal()) {
+                    stolen[i].push_back(x.value());
+                }
+            }
+        });
+    }
+    for (int64_t i = 0; i < ITEM_NR; ++i) {
+        deque.Push(i);
+        if (i % 3 == 0) {
+            if (auto x = deque.Take()) {
+                taken.push_back(x.value());
+            }
+        }
+    }
+    while (auto x = deque.Take()) {
+        taken.push_back(x.value());
+    }
+    done.store(true);
+    for (auto& t : thieves) {
+        t.join();
+    }
+    for (auto& s : stolen) {
+        taken.insert(taken.end(), s.begin(), s.end());
+    }
+    std::sort(taken.begin(), taken.end());
+    ASSERT_EQ(taken.size(), ITEM_NR);
+    for (int64_t i = 0; i < ITEM_NR; ++i) {
+        ASSERT_EQ(taken[i], i);
+    }
+}
+
+TEST_F(TestWorkStealingPool, testSubmit) {
+    static constexpr int TASK_NR = 10000;
+    std::atomic<int> counter(0);
+    {
+        WorkStealingPool pool(4);
+        for (int i = 0; i < TASK_NR; ++i) {
+            pool.Submit([&counter]() { counter.fetch_add(1); });
+        }
+        pool.ParallelFor(0, 1, 1, [](size_t, size_t) {});
+        while (counter.load() != TASK_NR) {
+            std::this_thread::yield();
+        }
+    }
+    ASSERT_EQ(counter.load(), TASK_NR);
+}
+
+TEST_F(TestWorkStealingPool, testParallelFor) {
+    WorkStealingPool pool(4);
+    for (size_t n : {0, 1, 7, 1000, 100003}) {
+        for (size_t grain : {1, 10, 8192}) {
+            std::vector<std::atomic<int>> hits(n);
+            pool.ParallelFor(0, n, grain, [&](size_t b, size_t e) {
+                ASSERT_LE(e - b, grain);
+                for (auto i = b; i < e; ++i) {
+                    hits[i].fetch_add(1);
+                }
+            });
+            for (size_t i = 0; i < n; ++i) {
+                ASSERT_EQ(hits[i].load(), 1);
+            }
+        }
+    }
+}
+
+TEST_F(TestWorkStealingPool, testNestedParallelFor) {
+    WorkStealingPool pool(3);
+    std::atomic<size_t> sum(0);
+    pool.ParallelFor(0, 100, 1, [&](size_t b, size_t e) {
+        for (auto i = b; i < e; ++i) {
+            pool.ParallelFor(0, 1000, 16, [&](size_t b2, size_t e2) { sum.fetch_add(e2 - b2); });
+        }
+    });
+    ASSERT_EQ(sum.load(), 100 * 1000);
+}
+
+TEST_F(TestWorkStealingPool, testConcurrentCallers) {
+    WorkStealingPool pool(4);
+    std::vector<std::thread> callers;
+    std::atomic<size_t> sum(0);
+    for (int i = 0; i < 4; ++i) {
+        callers.emplace_back([&]() {
+            for (int k = 0; k < 100; ++k) {
+                pool.ParallelFor(0, 10000, 100, [&](size_t b, size_t e) { sum.fetch_add(e - b); });
+            }
+        });
+    }
+    for (auto& t : callers) {
+        t.join();
+    }
+    ASSERT_EQ(sum.load(), 4 * 100 * 10000);
+}
+
+TEST_F(TestWorkStealingPool, testParallelBinaryKernel) {
+    WorkStealingPool pool(4);
+    std::mt19937 rand(0);
+    BinaryColumn src;
+    for (int i = 0; i < 100000; ++i) {
+        std::string s(rand() % 20, 'a');
+        for (auto& c : s) {
+            c = 'A' + rand() % 58;
+        }
+        src.append(s);
+    }
+    BinaryColumn expect;
+    StringFunctions::upper_vector_old(src, expect);
+    for (size_t morsel_row_nr : {size_t(1000), MORSEL_ROW_NR, size_t(1000000)}) {
+        BinaryColumn actual;
+        ParallelBinaryKernel(pool, src, actual, &StringFunctions::upper_vector_old, morsel_row_nr);
+        ASSERT_EQ(actual.offsets, expect.offsets);
+        ASSERT_EQ(actual.bytes, expect.bytes);
+    }
+}
+} // namespace concurrent
+} // namespace grakra
+} // namespace com
+
+int main(int argc, char** argv) {
+    testing::InitGoogleTest(&argc, argv);
+    return RUN_ALL_TESTS();
+}